@@ -3,14 +3,40 @@
 
 static void update_irq(acia6551_t* acia);
 static void update_status(acia6551_t* acia);
+static void sync_receiver(acia6551_t* acia);
 static void start_transmit(acia6551_t* acia);
+static void finish_transmit(acia6551_t* acia);
+static uint64_t tx_cycles_left(const acia6551_t* acia);
+static uint64_t rx_frame_cycles(const acia6551_t* acia);
 static uint32_t get_clock_divider(uint8_t baud_rate);
 
 void acia6551_init(acia6551_t* acia) {
     memset(acia, 0, sizeof(acia6551_t));
+    spsc_ring_init(&acia->rx_ring, ACIA_RX_FIFO_SIZE);
+    spsc_ring_init(&acia->tx_ring, ACIA_TX_FIFO_SIZE);
+    atomic_init(&acia->rx_overruns, 0);
     acia6551_reset(acia);
 }
 
+void acia6551_free(acia6551_t* acia) {
+    spsc_ring_free(&acia->rx_ring);
+    spsc_ring_free(&acia->tx_ring);
+}
+
+int acia6551_set_fifo_capacity(acia6551_t* acia, size_t rx_size, size_t tx_size) {
+    if (rx_size == 0 || tx_size == 0) {
+        return -1;
+    }
+    if (spsc_ring_resize(&acia->rx_ring, rx_size) != 0 ||
+        spsc_ring_resize(&acia->tx_ring, tx_size) != 0) {
+        return -1;
+    }
+    acia->status &= ~ACIA_STATUS_RDRF;
+    acia->status |= ACIA_STATUS_TDRE;
+    update_irq(acia);
+    return 0;
+}
+
 void acia6551_reset(acia6551_t* acia) {
     acia->data_rx = 0;
     acia->data_tx = 0;
@@ -18,13 +44,9 @@ void acia6551_reset(acia6551_t* acia) {
     acia->command = 0;
     acia->control = 0;
     
-    acia->rx_fifo_head = 0;
-    acia->rx_fifo_tail = 0;
-    acia->rx_fifo_count = 0;
-    
-    acia->tx_fifo_head = 0;
-    acia->tx_fifo_tail = 0;
-    acia->tx_fifo_count = 0;
+    spsc_ring_clear(&acia->rx_ring);
+    spsc_ring_clear(&acia->tx_ring);
+    atomic_store(&acia->rx_overruns, 0);
     
     acia->parity_error = false;
     acia->framing_error = false;
@@ -45,6 +67,9 @@ void acia6551_reset(acia6551_t* acia) {
     acia->tx_bits_remaining = 0;
     acia->rx_shift_reg = 0;
     acia->rx_bits_remaining = 0;
+    
+    // Reset releases IRQ
+    update_irq(acia);
 }
 
 uint8_t acia6551_read(acia6551_t* acia, uint8_t reg) {
@@ -55,23 +80,16 @@ uint8_t acia6551_read(acia6551_t* acia, uint8_t reg) {
     switch (reg) {
         case ACIA_DATA:
             // Read received data
-            if (acia->rx_fifo_count > 0) {
-                value = acia->rx_fifo[acia->rx_fifo_tail];
-                acia->rx_fifo_tail = (acia->rx_fifo_tail + 1) % ACIA_RX_FIFO_SIZE;
-                acia->rx_fifo_count--;
-                
-                // Update data register
-                if (acia->rx_fifo_count > 0) {
-                    acia->data_rx = acia->rx_fifo[acia->rx_fifo_tail];
-                } else {
-                    acia->data_rx = 0;
-                }
-            } else {
+            sync_receiver(acia);
+            if (!spsc_ring_pop_byte(&acia->rx_ring, &value)) {
                 value = acia->data_rx;
             }
             
-            // Clear RDRF flag
-            acia->status &= ~ACIA_STATUS_RDRF;
+            // Update data register, clearing RDRF once the FIFO is drained
+            if (!spsc_ring_peek(&acia->rx_ring, &acia->data_rx)) {
+                acia->data_rx = 0;
+                acia->status &= ~ACIA_STATUS_RDRF;
+            }
             
             // Clear error flags on data read
             acia->parity_error = false;
@@ -83,6 +101,7 @@ uint8_t acia6551_read(acia6551_t* acia, uint8_t reg) {
             break;
             
         case ACIA_STATUS:
+            sync_receiver(acia);
             update_status(acia);
             value = acia->status;
             break;
@@ -108,11 +127,7 @@ void acia6551_write(acia6551_t* acia, uint8_t reg, uint8_t value) {
             acia->data_tx = value;
             
             // Add to transmit FIFO
-            if (acia->tx_fifo_count < ACIA_TX_FIFO_SIZE) {
-                acia->tx_fifo[acia->tx_fifo_head] = value;
-                acia->tx_fifo_head = (acia->tx_fifo_head + 1) % ACIA_TX_FIFO_SIZE;
-                acia->tx_fifo_count++;
-            }
+            spsc_ring_push_byte(&acia->tx_ring, value);
             
             // Clear TDRE flag
             acia->status &= ~ACIA_STATUS_TDRE;
@@ -121,6 +136,11 @@ void acia6551_write(acia6551_t* acia, uint8_t reg, uint8_t value) {
             if (acia->tx_bits_remaining == 0) {
                 start_transmit(acia);
             }
+            if (acia->unthrottled) {
+                while (acia->tx_bits_remaining > 0) {
+                    finish_transmit(acia);
+                }
+            }
             
             update_irq(acia);
             break;
@@ -165,41 +185,74 @@ void acia6551_write(acia6551_t* acia, uint8_t reg, uint8_t value) {
 }
 
 void acia6551_clock(acia6551_t* acia, uint32_t cycles) {
-    // This is a simplified clock implementation
-    // In a real implementation, you'd handle bit-level timing
-    
-    // For now, we'll just handle byte-level transmission
-    for (uint32_t i = 0; i < cycles; i++) {
-        // Transmit side
-        if (acia->tx_bits_remaining > 0) {
-            acia->tx_clock_counter++;
-            if (acia->tx_clock_counter >= acia->tx_clock_divider) {
-                acia->tx_clock_counter = 0;
-                acia->tx_bits_remaining--;
-                
-                if (acia->tx_bits_remaining == 0) {
-                    // Byte transmission complete
-                    if (acia->tx_fifo_count > 0) {
-                        // More data to send
-                        start_transmit(acia);
-                    } else {
-                        // Transmit buffer empty
-                        acia->status |= ACIA_STATUS_TDRE;
-                        update_irq(acia);
-                    }
-                }
-            }
+    // Transmit side: skip straight to the end of each character
+    uint64_t remaining = cycles;
+    while (remaining > 0 && acia->tx_bits_remaining > 0) {
+        uint64_t left = tx_cycles_left(acia);
+        if (remaining >= left) {
+            remaining -= left;
+            finish_transmit(acia);
+            continue;
         }
-        
-        // Receive side - check for incoming data via callback
-        if (acia->rx_byte_callback) {
+
+        // Part way through the character
+        uint64_t divider = acia->tx_clock_divider ? acia->tx_clock_divider : 1;
+        uint64_t first = acia->tx_clock_counter < divider ? divider - acia->tx_clock_counter : 1;
+        if (remaining < first) {
+            acia->tx_clock_counter += (uint32_t)remaining;
+        } else {
+            remaining -= first;
+            acia->tx_bits_remaining -= (uint8_t)(1 + remaining / divider);
+            acia->tx_clock_counter = (uint32_t)(remaining % divider);
+        }
+        break;
+    }
+
+    // Receive side: one byte per character time at most, asked for at the
+    // character boundaries (every call when unthrottled)
+    if (acia->rx_byte_callback) {
+        uint64_t frames;
+        if (acia->unthrottled) {
+            frames = spsc_ring_free_space(&acia->rx_ring);
+        } else {
+            uint64_t frame = rx_frame_cycles(acia);
+            uint64_t total = (uint64_t)acia->rx_clock_counter + cycles;
+            frames = total / frame;
+            acia->rx_clock_counter = (uint32_t)(total % frame);
+        }
+        while (frames-- > 0) {
             bool available = false;
             uint8_t byte = acia->rx_byte_callback(acia->byte_context, &available);
-            if (available) {
-                acia6551_receive_byte(acia, byte);
+            if (!available) {
+                break;
             }
+            acia6551_receive_byte(acia, byte);
         }
     }
+
+    // Bytes queued since the last look, by the callback or a host thread
+    sync_receiver(acia);
+}
+
+uint64_t acia6551_cycles_to_event(const acia6551_t* acia) {
+    uint64_t next = 0;
+    if (acia->tx_bits_remaining > 0) {
+        next = tx_cycles_left(acia);
+    }
+    if (acia->rx_byte_callback && !acia->unthrottled) {
+        uint64_t rx = rx_frame_cycles(acia) - acia->rx_clock_counter;
+        if (next == 0 || rx < next) {
+            next = rx;
+        }
+    }
+    return next;
+}
+
+void acia6551_set_unthrottled(acia6551_t* acia, bool unthrottled) {
+    acia->unthrottled = unthrottled;
+    while (unthrottled && acia->tx_bits_remaining > 0) {
+        finish_transmit(acia);
+    }
 }
 
 void acia6551_set_dcd(acia6551_t* acia, bool state) {
@@ -228,33 +281,17 @@ bool acia6551_get_irq(acia6551_t* acia) {
     return (acia->status & ACIA_STATUS_IRQ) != 0;
 }
 
+// Producer end of the receive FIFO: touches nothing the CPU side owns
 void acia6551_receive_byte(acia6551_t* acia, uint8_t byte) {
-    // Add to receive FIFO
-    if (acia->rx_fifo_count < ACIA_RX_FIFO_SIZE) {
-        acia->rx_fifo[acia->rx_fifo_head] = byte;
-        acia->rx_fifo_head = (acia->rx_fifo_head + 1) % ACIA_RX_FIFO_SIZE;
-        acia->rx_fifo_count++;
-        
-        // Update data register
-        acia->data_rx = acia->rx_fifo[acia->rx_fifo_tail];
-        
-        // Set RDRF flag
-        acia->status |= ACIA_STATUS_RDRF;
-        update_irq(acia);
-    } else {
-        // Buffer overflow
-        acia->overrun_error = true;
-        update_status(acia);
+    if (!spsc_ring_push_byte(&acia->rx_ring, byte)) {
+        // Buffer overflow, reported by the next sync_receiver()
+        atomic_fetch_add_explicit(&acia->rx_overruns, 1, memory_order_relaxed);
     }
 }
 
 bool acia6551_transmit_byte_available(acia6551_t* acia, uint8_t* byte) {
-    if (acia->tx_fifo_count > 0) {
-        *byte = acia->tx_fifo[acia->tx_fifo_tail];
-        acia->tx_fifo_tail = (acia->tx_fifo_tail + 1) % ACIA_TX_FIFO_SIZE;
-        acia->tx_fifo_count--;
-        
-        if (acia->tx_fifo_count == 0) {
+    if (spsc_ring_pop_byte(&acia->tx_ring, byte)) {
+        if (spsc_ring_empty(&acia->tx_ring)) {
             acia->status |= ACIA_STATUS_TDRE;
             update_irq(acia);
         }
@@ -287,6 +324,28 @@ void acia6551_set_byte_callbacks(acia6551_t* acia,
     acia->byte_context = context;
 }
 
+// Copy register/FIFO/shift state from src, keeping dst's callbacks and
+// FIFO storage
+void acia6551_copy_state(acia6551_t* dst, const acia6551_t* src) {
+    acia6551_t wiring = *dst;
+    *dst = *src;
+    dst->rx_ring = wiring.rx_ring;
+    dst->tx_ring = wiring.tx_ring;
+    spsc_ring_copy(&dst->rx_ring, &src->rx_ring);
+    spsc_ring_copy(&dst->tx_ring, &src->tx_ring);
+    atomic_store(&dst->rx_overruns, atomic_load(&src->rx_overruns));
+    dst->tx_callback = wiring.tx_callback;
+    dst->rx_callback = wiring.rx_callback;
+    dst->serial_context = wiring.serial_context;
+    dst->tx_byte_callback = wiring.tx_byte_callback;
+    dst->rx_byte_callback = wiring.rx_byte_callback;
+    dst->byte_context = wiring.byte_context;
+    dst->irq_callback = wiring.irq_callback;
+    dst->irq_context = wiring.irq_context;
+    dst->dtr_callback = wiring.dtr_callback;
+    dst->dtr_context = wiring.dtr_context;
+}
+
 uint32_t acia6551_get_baud_rate(acia6551_t* acia) {
     static const uint32_t baud_rates[] = {
         0,      // External clock
@@ -310,6 +369,21 @@ uint8_t acia6551_get_word_length(acia6551_t* acia) {
 
 // Internal helper functions
 
+// Bring RDRF, the data register and the overrun flag up to date with what
+// the producer has queued
+static void sync_receiver(acia6551_t* acia) {
+    unsigned overruns = atomic_load_explicit(&acia->rx_overruns, memory_order_relaxed);
+    if (overruns > 0) {
+        atomic_fetch_sub_explicit(&acia->rx_overruns, overruns, memory_order_relaxed);
+        acia->overrun_error = true;
+        update_status(acia);
+    }
+    if (!(acia->status & ACIA_STATUS_RDRF) && spsc_ring_peek(&acia->rx_ring, &acia->data_rx)) {
+        acia->status |= ACIA_STATUS_RDRF;
+        update_irq(acia);
+    }
+}
+
 static void update_irq(acia6551_t* acia) {
     bool irq_active = false;
     uint8_t irq_mode = acia->command & ACIA_CMD_IRQ_MASK;
@@ -374,11 +448,8 @@ static void update_status(acia6551_t* acia) {
 }
 
 static void start_transmit(acia6551_t* acia) {
-    if (acia->tx_fifo_count > 0) {
-        uint8_t byte = acia->tx_fifo[acia->tx_fifo_tail];
-        acia->tx_fifo_tail = (acia->tx_fifo_tail + 1) % ACIA_TX_FIFO_SIZE;
-        acia->tx_fifo_count--;
-        
+    uint8_t byte;
+    if (spsc_ring_pop_byte(&acia->tx_ring, &byte)) {
         // Call byte-level callback if available
         if (acia->tx_byte_callback) {
             acia->tx_byte_callback(acia->byte_context, byte);
@@ -391,12 +462,38 @@ static void start_transmit(acia6551_t* acia) {
         acia->tx_clock_counter = 0;
         
         // If FIFO is now empty, set TDRE
-        if (acia->tx_fifo_count == 0) {
+        if (spsc_ring_empty(&acia->tx_ring)) {
             acia->status |= ACIA_STATUS_TDRE;
         }
     }
 }
 
+// The character being shifted out has gone: send the next one or report
+// the transmitter empty
+static void finish_transmit(acia6551_t* acia) {
+    acia->tx_clock_counter = 0;
+    acia->tx_bits_remaining = 0;
+    if (!spsc_ring_empty(&acia->tx_ring)) {
+        start_transmit(acia);
+    } else {
+        acia->status |= ACIA_STATUS_TDRE;
+        update_irq(acia);
+    }
+}
+
+// Cycles until the character being shifted out is complete
+static uint64_t tx_cycles_left(const acia6551_t* acia) {
+    uint64_t divider = acia->tx_clock_divider ? acia->tx_clock_divider : 1;
+    uint64_t first = acia->tx_clock_counter < divider ? divider - acia->tx_clock_counter : 1;
+    return first + (uint64_t)(acia->tx_bits_remaining - 1) * divider;
+}
+
+// Cycles per received character: data bits plus start and stop
+static uint64_t rx_frame_cycles(const acia6551_t* acia) {
+    uint64_t divider = acia->rx_clock_divider ? acia->rx_clock_divider : 1;
+    return divider * (acia6551_get_word_length((acia6551_t*)acia) + 2);
+}
+
 static uint32_t get_clock_divider(uint8_t baud_rate) {
     // Simplified clock divider calculation
     // In a real implementation, this would be based on the master clock frequency
@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include "spsc_ring.h"
 
 // 6551 ACIA Register offsets
 #define ACIA_DATA       0x00  // Transmit/Receive Data Register
@@ -68,7 +70,7 @@
 
 #define ACIA_CTRL_STOP_BITS     0x80  // Stop bits (0=1 stop, 1=1.5/2 stop)
 
-// FIFO sizes
+// Default FIFO sizes (see acia6551_set_fifo_capacity())
 #define ACIA_RX_FIFO_SIZE 256
 #define ACIA_TX_FIFO_SIZE 256
 
@@ -80,17 +82,15 @@ typedef struct acia6551_s {
     uint8_t command;        // Command register
     uint8_t control;        // Control register
     
-    // Receive FIFO
-    uint8_t rx_fifo[ACIA_RX_FIFO_SIZE];
-    uint16_t rx_fifo_head;  // Write position
-    uint16_t rx_fifo_tail;  // Read position
-    uint16_t rx_fifo_count; // Number of bytes in FIFO
+    // Receive FIFO.  acia6551_receive_byte() is the producer and may run on
+    // a host I/O thread; RDRF and the IRQ follow on the CPU side (register
+    // reads and clocking).
+    spsc_ring_t rx_ring;
+    atomic_uint rx_overruns;    // Bytes dropped on a full FIFO, not yet in the status
     
-    // Transmit FIFO
-    uint8_t tx_fifo[ACIA_TX_FIFO_SIZE];
-    uint16_t tx_fifo_head;
-    uint16_t tx_fifo_tail;
-    uint16_t tx_fifo_count;
+    // Transmit FIFO, filled by data register writes and drained by the
+    // transmitter (or acia6551_transmit_byte_available()) on the CPU side
+    spsc_ring_t tx_ring;
     
     // Error flags
     bool parity_error;
@@ -108,7 +108,8 @@ typedef struct acia6551_s {
     uint32_t tx_clock_divider;  // Clock divider for transmit
     uint32_t rx_clock_divider;  // Clock divider for receive
     uint32_t tx_clock_counter;  // Current transmit clock count
-    uint32_t rx_clock_counter;  // Current receive clock count
+    uint32_t rx_clock_counter;  // Cycles into the current receive character
+    bool unthrottled;           // Transmit completes at once, no baud timing
     
     // Shift registers
     uint16_t tx_shift_reg;      // Transmit shift register
@@ -138,16 +139,35 @@ typedef struct acia6551_s {
 // Initialize ACIA
 void acia6551_init(acia6551_t* acia);
 
+// Release the FIFO storage
+void acia6551_free(acia6551_t* acia);
+
 // Reset ACIA to power-on state
 void acia6551_reset(acia6551_t* acia);
 
+// Resize the FIFOs (rounded up to a power of two), dropping their contents.
+// Only while no host thread is using them.
+// Returns: 0 on success, -1 on error
+int acia6551_set_fifo_capacity(acia6551_t* acia, size_t rx_size, size_t tx_size);
+
 // Register access
 uint8_t acia6551_read(acia6551_t* acia, uint8_t reg);
 void acia6551_write(acia6551_t* acia, uint8_t reg, uint8_t value);
 
-// Clock the ACIA (call regularly to handle serial timing)
+// Clock the ACIA (call regularly to handle serial timing).  Cost depends on
+// the characters finished, not the cycles: the receive callback is asked
+// for one byte per character time instead of every cycle.
 void acia6551_clock(acia6551_t* acia, uint32_t cycles);
 
+// Cycles until the current transmit character ends or the receive callback
+// is next due, 0 if neither is pending
+uint64_t acia6551_cycles_to_event(const acia6551_t* acia);
+
+// Unthrottled mode: written bytes go out immediately and the receive
+// callback is drained on every clock call, for runs that don't care about
+// baud timing
+void acia6551_set_unthrottled(acia6551_t* acia, bool unthrottled);
+
 // Control line inputs
 void acia6551_set_dcd(acia6551_t* acia, bool state);
 void acia6551_set_dsr(acia6551_t* acia, bool state);
@@ -160,7 +180,10 @@ bool acia6551_get_rts(acia6551_t* acia);
 // Get IRQ state
 bool acia6551_get_irq(acia6551_t* acia);
 
-// High-level byte interface (easier to use than bit-level)
+// High-level byte interface (easier to use than bit-level).  receive_byte
+// only queues the byte, so one host thread may call it while the CPU thread
+// runs; the status register and IRQ catch up at the next register read or
+// clock.
 void acia6551_receive_byte(acia6551_t* acia, uint8_t byte);
 bool acia6551_transmit_byte_available(acia6551_t* acia, uint8_t* byte);
 
@@ -178,6 +201,9 @@ void acia6551_set_byte_callbacks(acia6551_t* acia,
                                   uint8_t (*rx_fn)(void*, bool*),
                                   void* context);
 
+// Copy register/FIFO/shift state from src, keeping dst's callbacks
+void acia6551_copy_state(acia6551_t* dst, const acia6551_t* src);
+
 // Get current baud rate (returns 0 if external clock)
 uint32_t acia6551_get_baud_rate(acia6551_t* acia);
 
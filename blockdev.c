@@ -0,0 +1,334 @@
+#include "blockdev.h"
+#include "memory_map.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static void update_irq(blockdev_t* dev) {
+    if (dev->irq_callback) {
+        dev->irq_callback(dev->irq_context, blockdev_get_irq(dev));
+    }
+}
+
+void blockdev_init(blockdev_t* dev) {
+    memset(dev, 0, sizeof(blockdev_t));
+}
+
+static uint64_t capacity(const blockdev_t* dev) {
+    return dev->media ? dev->media->size / BLOCKDEV_SECTOR_SIZE : 0;
+}
+
+// The command is over: drop BUSY/DRQ and interrupt
+static void complete(blockdev_t* dev) {
+    dev->status = dev->error ? BLOCKDEV_STATUS_ERR : 0;
+    dev->pio_command = 0;
+    dev->pio_remaining = 0;
+    dev->irq_pending = true;
+    update_irq(dev);
+}
+
+static void fail(blockdev_t* dev, uint8_t error) {
+    dev->error = error;
+    complete(dev);
+}
+
+// Returns: true if a DMA command was started
+static bool start_command(blockdev_t* dev, uint8_t command) {
+    dev->status = 0;
+    dev->error = 0;
+    dev->pio_command = 0;
+    dev->pio_remaining = 0;
+    dev->irq_pending = false;
+    update_irq(dev);
+
+    if (!dev->media) {
+        fail(dev, BLOCKDEV_ERROR_ABORT);
+        return false;
+    }
+    if (command == BLOCKDEV_CMD_FLUSH) {
+        if (blockdev_flush(dev) != 0) {
+            fail(dev, BLOCKDEV_ERROR_ABORT);
+        } else {
+            complete(dev);
+        }
+        return false;
+    }
+
+    bool write = command == BLOCKDEV_CMD_WRITE || command == BLOCKDEV_CMD_WRITE_DMA;
+    bool dma = command == BLOCKDEV_CMD_READ_DMA || command == BLOCKDEV_CMD_WRITE_DMA;
+    if (!write && !dma && command != BLOCKDEV_CMD_READ) {
+        fail(dev, BLOCKDEV_ERROR_ABORT);
+        return false;
+    }
+    if (write && dev->media->read_only) {
+        fail(dev, BLOCKDEV_ERROR_ABORT);
+        return false;
+    }
+    uint32_t sectors = dev->count ? dev->count : 256;
+    if ((uint64_t)dev->lba + sectors > capacity(dev)) {
+        fail(dev, BLOCKDEV_ERROR_RANGE);
+        return false;
+    }
+
+    if (dma) {
+        dev->pio_command = command;
+        dev->status = BLOCKDEV_STATUS_BUSY;
+        return true;
+    }
+    dev->pio_command = command;
+    dev->pio_offset = (size_t)dev->lba * BLOCKDEV_SECTOR_SIZE;
+    dev->pio_remaining = (size_t)sectors * BLOCKDEV_SECTOR_SIZE;
+    dev->status = BLOCKDEV_STATUS_DRQ;
+    return false;
+}
+
+// One byte went through the data port
+static void pio_advance(blockdev_t* dev) {
+    dev->pio_offset++;
+    dev->pio_remaining--;
+    if (dev->pio_offset % BLOCKDEV_SECTOR_SIZE == 0) {
+        dev->lba++;
+        dev->count--;
+        if (dev->pio_command == BLOCKDEV_CMD_READ) {
+            dev->sectors_read++;
+        } else {
+            dev->sectors_written++;
+        }
+    }
+    if (dev->pio_remaining == 0) {
+        complete(dev);
+    }
+}
+
+uint8_t blockdev_read(blockdev_t* dev, uint8_t reg) {
+    uint64_t sectors = capacity(dev);
+    if (sectors > UINT32_MAX) {
+        sectors = UINT32_MAX;
+    }
+    switch (reg) {
+        case BLOCKDEV_LBA0:      return dev->lba & 0xFF;
+        case BLOCKDEV_LBA1:      return (dev->lba >> 8) & 0xFF;
+        case BLOCKDEV_LBA2:      return (dev->lba >> 16) & 0xFF;
+        case BLOCKDEV_LBA3:      return (dev->lba >> 24) & 0xFF;
+        case BLOCKDEV_COUNT:     return dev->count;
+        case BLOCKDEV_COMMAND: {
+            uint8_t status = dev->status | (dev->media ? BLOCKDEV_STATUS_READY : 0);
+            if (dev->irq_pending) {
+                dev->irq_pending = false;
+                update_irq(dev);
+            }
+            return status;
+        }
+        case BLOCKDEV_DATA:
+            if (dev->media && dev->pio_command == BLOCKDEV_CMD_READ && dev->pio_remaining > 0) {
+                uint8_t value = dev->media->data[dev->pio_offset];
+                pio_advance(dev);
+                return value;
+            }
+            return 0xFF;
+        case BLOCKDEV_ERROR:     return dev->error;
+        case BLOCKDEV_DMA_LO:    return dev->dma_address & 0xFF;
+        case BLOCKDEV_DMA_HI:    return (dev->dma_address >> 8) & 0xFF;
+        case BLOCKDEV_DMA_BANK:  return (dev->dma_address >> 16) & 0xFF;
+        case BLOCKDEV_CONTROL:   return dev->control;
+        case BLOCKDEV_CAPACITY0: return sectors & 0xFF;
+        case BLOCKDEV_CAPACITY1: return (sectors >> 8) & 0xFF;
+        case BLOCKDEV_CAPACITY2: return (sectors >> 16) & 0xFF;
+        case BLOCKDEV_CAPACITY3: return (sectors >> 24) & 0xFF;
+        default:
+            return 0xFF;
+    }
+}
+
+bool blockdev_write(blockdev_t* dev, uint8_t reg, uint8_t value) {
+    switch (reg) {
+        case BLOCKDEV_LBA0:
+            dev->lba = (dev->lba & 0xFFFFFF00) | value;
+            break;
+        case BLOCKDEV_LBA1:
+            dev->lba = (dev->lba & 0xFFFF00FF) | ((uint32_t)value << 8);
+            break;
+        case BLOCKDEV_LBA2:
+            dev->lba = (dev->lba & 0xFF00FFFF) | ((uint32_t)value << 16);
+            break;
+        case BLOCKDEV_LBA3:
+            dev->lba = (dev->lba & 0x00FFFFFF) | ((uint32_t)value << 24);
+            break;
+        case BLOCKDEV_COUNT:
+            dev->count = value;
+            break;
+        case BLOCKDEV_COMMAND:
+            return start_command(dev, value);
+        case BLOCKDEV_DATA:
+            if (dev->media && dev->pio_command == BLOCKDEV_CMD_WRITE && dev->pio_remaining > 0) {
+                dev->media->data[dev->pio_offset] = value;
+                pio_advance(dev);
+            }
+            break;
+        case BLOCKDEV_DMA_LO:
+            dev->dma_address = (dev->dma_address & 0xFFFF00) | value;
+            break;
+        case BLOCKDEV_DMA_HI:
+            dev->dma_address = (dev->dma_address & 0xFF00FF) | ((uint32_t)value << 8);
+            break;
+        case BLOCKDEV_DMA_BANK:
+            dev->dma_address = (dev->dma_address & 0x00FFFF) | ((uint32_t)value << 16);
+            break;
+        case BLOCKDEV_CONTROL:
+            dev->control = value;
+            update_irq(dev);
+            break;
+        default:
+            break;
+    }
+    return false;
+}
+
+void blockdev_run_dma(blockdev_t* dev, machine_state_t* machine) {
+    if (!(dev->status & BLOCKDEV_STATUS_BUSY) || !dev->media) {
+        return;
+    }
+    uint32_t sectors = dev->count ? dev->count : 256;
+    size_t length = (size_t)sectors * BLOCKDEV_SECTOR_SIZE;
+    uint8_t* image = dev->media->data + (size_t)dev->lba * BLOCKDEV_SECTOR_SIZE;
+    if (dev->pio_command == BLOCKDEV_CMD_READ_DMA) {
+        machine_copy_to_guest(machine, dev->dma_address, image, length);
+        dev->sectors_read += sectors;
+    } else {
+        machine_copy_from_guest(machine, dev->dma_address, image, length);
+        dev->sectors_written += sectors;
+    }
+    dev->lba += sectors;
+    dev->dma_address = (uint32_t)((dev->dma_address + length) & 0xFFFFFF);
+    dev->count = 0;
+    complete(dev);
+}
+
+int blockdev_attach(blockdev_t* dev, const char* filename, bool read_only) {
+    int fd = open(filename, read_only ? O_RDONLY : O_RDWR);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot open disk image '%s'\n", filename);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        fprintf(stderr, "Error: Cannot stat disk image '%s'\n", filename);
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size / BLOCKDEV_SECTOR_SIZE * BLOCKDEV_SECTOR_SIZE;
+    if (size == 0) {
+        fprintf(stderr, "Error: Disk image '%s' is smaller than a sector\n", filename);
+        close(fd);
+        return -1;
+    }
+
+    // MAP_SHARED: sector writes land in the page cache and reach the file
+    // without a save step, even if the emulator dies
+    int prot = read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+    uint8_t* data = (uint8_t*)mmap(NULL, size, prot, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Error: Cannot map disk image '%s'\n", filename);
+        return -1;
+    }
+    blockdev_media_t* media = (blockdev_media_t*)calloc(1, sizeof(blockdev_media_t));
+    if (!media) {
+        munmap(data, size);
+        return -1;
+    }
+    media->data = data;
+    media->size = size;
+    media->read_only = read_only;
+    media->refs = 1;
+
+    blockdev_detach(dev);
+    dev->media = media;
+    return 0;
+}
+
+void blockdev_detach(blockdev_t* dev) {
+    blockdev_media_t* media = dev->media;
+    dev->media = NULL;
+    dev->pio_command = 0;
+    dev->pio_remaining = 0;
+    if (media && __atomic_sub_fetch(&media->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        munmap(media->data, media->size);
+        free(media);
+    }
+}
+
+void blockdev_share(blockdev_t* dst, const blockdev_t* src) {
+    if (dst->media == src->media) {
+        return;
+    }
+    blockdev_detach(dst);
+    dst->media = src->media;
+    if (dst->media) {
+        __atomic_add_fetch(&dst->media->refs, 1, __ATOMIC_RELAXED);
+    }
+}
+
+int blockdev_flush(blockdev_t* dev) {
+    if (!dev->media || dev->media->read_only) {
+        return 0;
+    }
+    if (msync(dev->media->data, dev->media->size, MS_SYNC) != 0) {
+        perror("msync");
+        return -1;
+    }
+    return 0;
+}
+
+int blockdev_create_image(const char* filename, uint32_t sectors) {
+    int fd = open(filename, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot create disk image '%s'\n", filename);
+        return -1;
+    }
+    int result = ftruncate(fd, (off_t)sectors * BLOCKDEV_SECTOR_SIZE);
+    close(fd);
+    if (result != 0) {
+        fprintf(stderr, "Error: Cannot size disk image '%s'\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+bool blockdev_get_irq(blockdev_t* dev) {
+    return dev->irq_pending && (dev->control & BLOCKDEV_CONTROL_IRQ_ENABLE);
+}
+
+void blockdev_set_irq_callback(blockdev_t* dev, void (*callback)(void*, bool), void* context) {
+    dev->irq_callback = callback;
+    dev->irq_context = context;
+}
+
+void blockdev_copy_state(blockdev_t* dst, const blockdev_t* src) {
+    blockdev_media_t* media = dst->media;
+    void (*callback)(void*, bool) = dst->irq_callback;
+    void* context = dst->irq_context;
+    *dst = *src;
+    dst->media = media;
+    dst->irq_callback = callback;
+    dst->irq_context = context;
+
+    // A transfer in flight must fit dst's image, which may be smaller: cancel
+    // it the way an out-of-range command fails
+    bool fits = true;
+    if (dst->status & BLOCKDEV_STATUS_BUSY) {
+        uint32_t sectors = dst->count ? dst->count : 256;
+        fits = (uint64_t)dst->lba + sectors <= capacity(dst);
+    } else if (dst->pio_command && dst->pio_remaining > 0) {
+        uint64_t sectors = (dst->pio_remaining + BLOCKDEV_SECTOR_SIZE - 1) / BLOCKDEV_SECTOR_SIZE;
+        fits = (uint64_t)dst->pio_offset + dst->pio_remaining <= capacity(dst) * BLOCKDEV_SECTOR_SIZE &&
+               (uint64_t)dst->lba + sectors <= capacity(dst);
+    }
+    if (!fits) {
+        fail(dst, BLOCKDEV_ERROR_RANGE);
+    }
+}
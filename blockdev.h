@@ -0,0 +1,134 @@
+#ifndef __BLOCKDEV_H__
+#define __BLOCKDEV_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "machine.h"
+
+// Block storage device (CF/SD style)
+//
+// A disk of 512-byte sectors backed by a host image file mapped MAP_SHARED,
+// so sector transfers are plain copies between the mapping and guest memory
+// and guest writes reach the file with no per-byte I/O.  Commands complete
+// at once:
+//
+// - PIO: the data port walks the sectors straight out of (or into) the
+//   mapping; DRQ stays set until COUNT sectors have gone by
+// - DMA: COUNT sectors are copied between the mapping and guest memory at
+//   the 24-bit DMA address in one go
+//
+// LBA and the DMA address advance past the sectors moved.  Like SRAM, the
+// image is outside the snapshot/clone machinery: snapshots capture the
+// registers only, and clones share the image.
+
+#define BLOCKDEV_SECTOR_SIZE  512
+
+// Register offsets
+#define BLOCKDEV_LBA0         0x00  // Sector address, bits 0-7
+#define BLOCKDEV_LBA1         0x01  //                 bits 8-15
+#define BLOCKDEV_LBA2         0x02  //                 bits 16-23
+#define BLOCKDEV_LBA3         0x03  //                 bits 24-31
+#define BLOCKDEV_COUNT        0x04  // Sectors per command (0 = 256)
+#define BLOCKDEV_COMMAND      0x05  // Write: command; read: status (acknowledges the IRQ)
+#define BLOCKDEV_DATA         0x06  // PIO data port
+#define BLOCKDEV_ERROR        0x07  // Error bits of the last command
+#define BLOCKDEV_DMA_LO       0x08  // Guest address for DMA commands
+#define BLOCKDEV_DMA_HI       0x09
+#define BLOCKDEV_DMA_BANK     0x0A
+#define BLOCKDEV_CONTROL      0x0B  // Interrupt enable
+#define BLOCKDEV_CAPACITY0    0x0C  // Disk size in sectors (read-only), bits 0-7
+#define BLOCKDEV_CAPACITY1    0x0D
+#define BLOCKDEV_CAPACITY2    0x0E
+#define BLOCKDEV_CAPACITY3    0x0F
+
+// Commands (ATA numbering)
+#define BLOCKDEV_CMD_READ       0x20
+#define BLOCKDEV_CMD_WRITE      0x30
+#define BLOCKDEV_CMD_READ_DMA   0xC8
+#define BLOCKDEV_CMD_WRITE_DMA  0xCA
+#define BLOCKDEV_CMD_FLUSH      0xE7
+
+// Status bits
+#define BLOCKDEV_STATUS_ERR   0x01  // Last command failed, see BLOCKDEV_ERROR
+#define BLOCKDEV_STATUS_DRQ   0x08  // Data port has data / wants data
+#define BLOCKDEV_STATUS_READY 0x40  // Image attached
+#define BLOCKDEV_STATUS_BUSY  0x80
+
+// Error bits
+#define BLOCKDEV_ERROR_ABORT  0x04  // Unknown command, no image, or write to a read-only image
+#define BLOCKDEV_ERROR_RANGE  0x10  // Sectors past the end of the image
+
+// Control bits
+#define BLOCKDEV_CONTROL_IRQ_ENABLE 0x01
+
+// A mapped image, shared by a machine and its clones
+typedef struct blockdev_media_s {
+    uint8_t *data;
+    size_t size;               // Whole sectors only
+    bool read_only;
+    uint32_t refs;             // Atomic: clones may let go on any thread
+} blockdev_media_t;
+
+typedef struct blockdev_s {
+    uint32_t lba;
+    uint8_t count;
+    uint8_t status;
+    uint8_t error;
+    uint8_t control;
+    uint32_t dma_address;      // 24-bit
+
+    // PIO transfer in progress
+    uint8_t pio_command;       // BLOCKDEV_CMD_READ/WRITE, 0 if none
+    size_t pio_offset;         // Next byte of the image
+    size_t pio_remaining;      // Bytes left in the command
+
+    bool irq_pending;          // Command finished, status not read yet
+
+    // Totals since power-on
+    uint64_t sectors_read;
+    uint64_t sectors_written;
+
+    blockdev_media_t *media;   // NULL: no image attached
+
+    // IRQ callback (optional)
+    void (*irq_callback)(void* context, bool state);
+    void* irq_context;
+} blockdev_t;
+
+void blockdev_init(blockdev_t* dev);
+
+// Register access.  blockdev_write() returns true for a DMA command, which
+// the owner then runs with blockdev_run_dma().
+uint8_t blockdev_read(blockdev_t* dev, uint8_t reg);
+bool blockdev_write(blockdev_t* dev, uint8_t reg, uint8_t value);
+
+// Copy the sectors of a DMA command between the image and `machine`'s memory
+void blockdev_run_dma(blockdev_t* dev, machine_state_t* machine);
+
+// Map the image `filename` (its size rounded down to whole sectors)
+// Returns: 0 on success, -1 on error
+int blockdev_attach(blockdev_t* dev, const char* filename, bool read_only);
+
+// Drop this device's reference to its image
+void blockdev_detach(blockdev_t* dev);
+
+// Attach the image `src` is using to `dst` as well
+void blockdev_share(blockdev_t* dst, const blockdev_t* src);
+
+// Write the image back to its file (msync), e.g. at checkpoints.  Optional:
+// the kernel writes the pages back on its own.
+// Returns: 0 on success, -1 on error
+int blockdev_flush(blockdev_t* dev);
+
+// Create (or resize) an image file of `sectors` sectors; new space reads as zero
+// Returns: 0 on success, -1 on error
+int blockdev_create_image(const char* filename, uint32_t sectors);
+
+bool blockdev_get_irq(blockdev_t* dev);
+void blockdev_set_irq_callback(blockdev_t* dev, void (*callback)(void*, bool), void* context);
+
+// Copy register state, keeping dst's image and callback
+void blockdev_copy_state(blockdev_t* dst, const blockdev_t* src);
+
+#endif // __BLOCKDEV_H__
@@ -6,6 +6,9 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
 
 // Port B bit assignments for FT245 control/status
 #define PORTB_RD_N      0x01  // Bit 0: RD# output (active low)
@@ -19,8 +22,26 @@ typedef struct fifo_s {
     ft245_t ft245;
     via6522_t via;
     uint8_t portb_outputs;  // Track current Port B output state
+    
+    // board_fifo_wait() sleepers, woken by FT245 FIFO activity
+    pthread_mutex_t wait_lock;
+    pthread_cond_t wait_cond;
+    atomic_int waiters;
 } fifo_t;
 
+// FT245 FIFO activity, possibly on the host thread.  Only takes the lock
+// when someone is asleep: the fence orders the ring update before the
+// waiter count, pairing with the waiter's increment before its check.
+static void board_fifo_event(void* context) {
+    fifo_t *fifo = (fifo_t *)context;
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&fifo->waiters, memory_order_relaxed) > 0) {
+        pthread_mutex_lock(&fifo->wait_lock);
+        pthread_cond_broadcast(&fifo->wait_cond);
+        pthread_mutex_unlock(&fifo->wait_lock);
+    }
+}
+
 fifo_t *init_board_fifo(void) {
     fifo_t *fifo = (fifo_t *)malloc(sizeof(fifo_t));
     if (!fifo) {
@@ -35,6 +56,16 @@ fifo_t *init_board_fifo(void) {
     // Initialize Port B outputs: RD# and WR both inactive (high)
     fifo->portb_outputs = PORTB_RD_N;  // RD# high (inactive), WR low (inactive)
     
+    // Waiters sleep on the monotonic clock
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&fifo->wait_lock, NULL);
+    pthread_cond_init(&fifo->wait_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    atomic_init(&fifo->waiters, 0);
+    ft245_set_fifo_event_callback(&fifo->ft245, board_fifo_event, fifo);
+    
     // Connect USB (simulate USB cable connected and enumerated)
     ft245_set_usb_connected(&fifo->ft245, true);
     ft245_set_usb_configured(&fifo->ft245, true);
@@ -56,10 +87,20 @@ fifo_t *init_board_fifo(void) {
 
 void free_board_fifo(fifo_t *fifo) {
     if (fifo) {
+        ft245_free(&fifo->ft245);
+        pthread_cond_destroy(&fifo->wait_cond);
+        pthread_mutex_destroy(&fifo->wait_lock);
         free(fifo);
     }
 }
 
+// Copy the board state from src; dst's VIA stays wired to dst's FT245
+void board_fifo_copy_state(fifo_t *dst, const fifo_t *src) {
+    ft245_copy_state(&dst->ft245, &src->ft245);
+    via6522_copy_state(&dst->via, &src->via);
+    dst->portb_outputs = src->portb_outputs;
+}
+
 // Port A callbacks - FT245 Data Bus
 // Reading Port A reads the current FT245 data bus value
 uint8_t board_fifo_via_port_a_read(void* context) {
@@ -131,11 +172,110 @@ void board_fifo_via_port_b_write(void* context, uint8_t value) {
     }
 }
 void board_fifo_clock(fifo_t *fifo) {
+    board_fifo_clock_n(fifo, 1);
+}
+
+void board_fifo_clock_n(fifo_t *fifo, uint32_t cycles) {
     if (!fifo) return;
     
     // Clock both devices
-    ft245_clock(&fifo->ft245);
-    via6522_clock(&fifo->via);
+    ft245_clock_n(&fifo->ft245, cycles);
+    via6522_clock_n(&fifo->via, cycles);
+}
+
+// Fast handshake: the RD# strobe as one step.  Assert RD#, wait out the
+// read latency, take the byte, release RD#.
+bool board_fifo_fast_read(fifo_t *fifo, uint8_t *data) {
+    if (!fifo || ft245_get_rxf(&fifo->ft245)) return false;
+    
+    ft245_set_rd(&fifo->ft245, true);
+    board_fifo_clock_n(fifo, BOARD_FIFO_STROBE_CYCLES - 1);
+    *data = ft245_read(&fifo->ft245);
+    ft245_set_rd(&fifo->ft245, false);
+    board_fifo_clock_n(fifo, 1);
+    return true;
+}
+
+// Fast handshake: put the byte on the bus and pulse WR
+bool board_fifo_fast_write(fifo_t *fifo, uint8_t data) {
+    if (!fifo || ft245_get_txe(&fifo->ft245)) return false;
+    
+    ft245_write(&fifo->ft245, data);
+    ft245_set_wr(&fifo->ft245, true);
+    board_fifo_clock_n(fifo, BOARD_FIFO_STROBE_CYCLES - 1);
+    ft245_set_wr(&fifo->ft245, false);
+    board_fifo_clock_n(fifo, 1);
+    return true;
+}
+
+// Events out of `events` that hold now
+static int ready_events(fifo_t *fifo, int events) {
+    int ready = 0;
+    if ((events & BOARD_FIFO_READABLE) && ft245_get_rx_fifo_count(&fifo->ft245) > 0) {
+        ready |= BOARD_FIFO_READABLE;
+    }
+    if ((events & BOARD_FIFO_WRITABLE) && ft245_get_tx_fifo_free(&fifo->ft245) > 0) {
+        ready |= BOARD_FIFO_WRITABLE;
+    }
+    if ((events & BOARD_FIFO_USB_READABLE) && ft245_get_tx_fifo_count(&fifo->ft245) > 0) {
+        ready |= BOARD_FIFO_USB_READABLE;
+    }
+    if ((events & BOARD_FIFO_USB_WRITABLE) && ft245_get_rx_fifo_free(&fifo->ft245) > 0) {
+        ready |= BOARD_FIFO_USB_WRITABLE;
+    }
+    return ready;
+}
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+int board_fifo_wait(fifo_t *fifo, int events, int timeout_ms) {
+    if (!fifo) return 0;
+    
+    // A host attached through pull callbacks only delivers when the FT245
+    // is clocked: give it a cycle per check and check every millisecond
+    ft245_t *ft245 = &fifo->ft245;
+    bool pull = (events & BOARD_FIFO_READABLE) &&
+                (ft245->usb_rx_callback || ft245->usb_rx_buffer_callback);
+    if (pull) {
+        board_fifo_clock(fifo);
+    }
+    int ready = ready_events(fifo, events);
+    if (ready || timeout_ms == 0) {
+        return ready;
+    }
+    
+    uint64_t now = monotonic_ns();
+    uint64_t deadline = timeout_ms < 0 ? UINT64_MAX : now + (uint64_t)timeout_ms * 1000000ULL;
+    atomic_fetch_add(&fifo->waiters, 1);
+    pthread_mutex_lock(&fifo->wait_lock);
+    while (!(ready = ready_events(fifo, events)) && now < deadline) {
+        uint64_t until = deadline;
+        if (pull && until - now > BOARD_FIFO_POLL_NS) {
+            until = now + BOARD_FIFO_POLL_NS;
+        }
+        if (until == UINT64_MAX) {
+            pthread_cond_wait(&fifo->wait_cond, &fifo->wait_lock);
+        } else {
+            struct timespec ts = {
+                .tv_sec = (time_t)(until / 1000000000ULL),
+                .tv_nsec = (long)(until % 1000000000ULL),
+            };
+            pthread_cond_timedwait(&fifo->wait_cond, &fifo->wait_lock, &ts);
+        }
+        if (pull) {
+            pthread_mutex_unlock(&fifo->wait_lock);
+            board_fifo_clock(fifo);
+            pthread_mutex_lock(&fifo->wait_lock);
+        }
+        now = monotonic_ns();
+    }
+    pthread_mutex_unlock(&fifo->wait_lock);
+    atomic_fetch_sub(&fifo->waiters, 1);
+    return ready;
 }
 
 // Helper functions for testing/external use
@@ -192,3 +332,9 @@ via6522_t* board_fifo_get_via(fifo_t *fifo) {
     if (!fifo) return NULL;
     return &fifo->via;
 }
+
+// Get FT245 instance for USB-side callbacks
+ft245_t* board_fifo_get_ft245(fifo_t *fifo) {
+    if (!fifo) return NULL;
+    return &fifo->ft245;
+}
@@ -7,6 +7,7 @@
 // Forward declarations
 typedef struct fifo_s fifo_t;
 typedef struct via6522_s via6522_t;
+typedef struct ft245_s ft245_t;
 
 // Port B bit assignments for FT245 control/status
 #define PORTB_RD_N      0x01  // Bit 0: RD# output (active low)
@@ -21,9 +22,42 @@ fifo_t *init_board_fifo(void);
 // Free the board FIFO
 void free_board_fifo(fifo_t *fifo);
 
+// Copy the board state (VIA, FT245, port B outputs) from src into dst
+void board_fifo_copy_state(fifo_t *dst, const fifo_t *src);
+
 // Clock the board (updates both VIA and FT245)
 void board_fifo_clock(fifo_t *fifo);
 
+// Clock the board by several cycles in one step
+void board_fifo_clock_n(fifo_t *fifo, uint32_t cycles);
+
+// Cycles one RD#/WR strobe takes, from assert to release
+#define BOARD_FIFO_STROBE_CYCLES 6
+
+// Fast handshake path: one RD# or WR strobe, with its latency and cycles,
+// without stepping the VIA's port registers through the sequence.  Port B
+// outputs are left as they were (RD# high, WR low between transfers).
+// Return false, without using any cycles, when RXF#/TXE# says not ready.
+bool board_fifo_fast_read(fifo_t *fifo, uint8_t *data);
+bool board_fifo_fast_write(fifo_t *fifo, uint8_t data);
+
+// Events for board_fifo_wait()
+#define BOARD_FIFO_READABLE      0x01  // CPU side: RX FIFO has data (RXF# low)
+#define BOARD_FIFO_WRITABLE      0x02  // CPU side: TX FIFO has space (TXE# low)
+#define BOARD_FIFO_USB_READABLE  0x04  // USB side: CPU output waiting
+#define BOARD_FIFO_USB_WRITABLE  0x08  // USB side: room to send to the CPU
+
+// Poll interval for hosts attached through FT245 pull callbacks
+#define BOARD_FIFO_POLL_NS 1000000ULL
+
+// Sleep until one of `events` holds, woken by the other side moving bytes
+// through the FIFOs.  timeout_ms < 0 waits forever, 0 only checks.  The
+// CPU-side events are for the thread running the CPU side, the USB-side ones
+// for the host thread.  A host attached through pull callbacks is polled
+// (the FT245 is clocked a cycle at a time) instead of waking the waiter.
+// Returns: the events that hold, 0 on timeout
+int board_fifo_wait(fifo_t *fifo, int events, int timeout_ms);
+
 // USB side operations (simulating PC/USB host)
 // Send data from USB/PC to CPU (adds to FT245 RX FIFO)
 bool board_fifo_usb_send_to_cpu(fifo_t *fifo, uint8_t data);
@@ -51,6 +85,9 @@ uint16_t board_fifo_get_tx_count(fifo_t *fifo);  // Bytes waiting to send to USB
 // Get VIA instance (for interrupt checking)
 via6522_t* board_fifo_get_via(fifo_t *fifo);
 
+// Get FT245 instance (for USB-side callbacks)
+ft245_t* board_fifo_get_ft245(fifo_t *fifo);
+
 // Port callbacks (internal use)
 uint8_t board_fifo_via_port_a_read(void* context);
 void board_fifo_via_port_a_write(void* context, uint8_t value);
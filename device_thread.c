@@ -0,0 +1,180 @@
+#include "device_thread.h"
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include "machine_setup.h"
+#include "spsc_ring.h"
+
+struct device_thread_s {
+    machine_state_t *machine;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;       // Worker: steps queued or stop
+    _Atomic bool sleeping;     // Worker is (about to be) waiting on `wake`
+    _Atomic bool stop;
+
+    // Cycles of each queued machine_clock_devices() call (CPU -> worker)
+    spsc_ring_t steps;
+    uint64_t posted;           // Steps ever queued (CPU)
+    _Atomic uint64_t done;     // Steps ever run (worker)
+
+    // Published by the worker after each batch, horizon last: IRQ lines as
+    // of the batch and the cycle they hold until at least.  The CPU zeroes
+    // the horizon whenever it may change device state itself.
+    _Atomic uint32_t sources;
+    _Atomic uint64_t horizon;
+
+    device_thread_stats_t stats;  // CPU side only
+};
+
+static void *device_thread_main(void *arg) {
+    device_thread_t *thread = (device_thread_t *)arg;
+    machine_state_t *machine = thread->machine;
+    unsigned idle = 0;
+
+    for (;;) {
+        const uint8_t *span;
+        size_t count = spsc_ring_read_span(&thread->steps, &span);
+        if (count > 0) {
+            for (size_t i = 0; i < count; i++) {
+                machine_step_devices(machine, span[i]);
+            }
+            spsc_ring_consume(&thread->steps, count);
+
+            atomic_store_explicit(&thread->sources, machine->irq_sources, memory_order_relaxed);
+            atomic_store_explicit(&thread->horizon, machine_devices_irq_horizon(machine),
+                                  memory_order_release);
+            atomic_fetch_add_explicit(&thread->done, count, memory_order_release);
+            idle = 0;
+            continue;
+        }
+        if (atomic_load(&thread->stop)) {
+            break;
+        }
+        if (++idle < DEVICE_THREAD_SPINS) {
+            sched_yield();
+            continue;
+        }
+
+        // Out of work for a while: sleep until device_thread_post() wakes us.
+        // sleeping is set before the ring is checked and the poster checks
+        // sleeping after queueing, so one of the two sees the other.
+        pthread_mutex_lock(&thread->lock);
+        atomic_store(&thread->sleeping, true);
+        atomic_thread_fence(memory_order_seq_cst);
+        while (spsc_ring_empty(&thread->steps) && !atomic_load(&thread->stop)) {
+            pthread_cond_wait(&thread->wake, &thread->lock);
+        }
+        atomic_store(&thread->sleeping, false);
+        pthread_mutex_unlock(&thread->lock);
+        idle = 0;
+    }
+    return NULL;
+}
+
+device_thread_t *device_thread_create(machine_state_t *machine) {
+    device_thread_t *thread = (device_thread_t *)calloc(1, sizeof(device_thread_t));
+    if (!thread) {
+        return NULL;
+    }
+    thread->machine = machine;
+    if (spsc_ring_init(&thread->steps, DEVICE_THREAD_QUEUE) != 0) {
+        free(thread);
+        return NULL;
+    }
+    atomic_init(&thread->sleeping, false);
+    atomic_init(&thread->stop, false);
+    atomic_init(&thread->done, 0);
+    atomic_init(&thread->sources, machine->irq_sources);
+    atomic_init(&thread->horizon, 0);
+    pthread_mutex_init(&thread->lock, NULL);
+    pthread_cond_init(&thread->wake, NULL);
+
+    if (pthread_create(&thread->thread, NULL, device_thread_main, thread) != 0) {
+        pthread_cond_destroy(&thread->wake);
+        pthread_mutex_destroy(&thread->lock);
+        spsc_ring_free(&thread->steps);
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void device_thread_destroy(device_thread_t *thread) {
+    if (!thread) {
+        return;
+    }
+    device_thread_sync(thread);
+    pthread_mutex_lock(&thread->lock);
+    atomic_store(&thread->stop, true);
+    pthread_cond_signal(&thread->wake);
+    pthread_mutex_unlock(&thread->lock);
+    pthread_join(thread->thread, NULL);
+
+    pthread_cond_destroy(&thread->wake);
+    pthread_mutex_destroy(&thread->lock);
+    spsc_ring_free(&thread->steps);
+    free(thread);
+}
+
+void device_thread_post(device_thread_t *thread, uint8_t cycles) {
+    while (!spsc_ring_push_byte(&thread->steps, cycles)) {
+        sched_yield();  // The worker is a full queue behind
+    }
+    thread->posted++;
+    thread->stats.steps++;
+
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&thread->sleeping)) {
+        pthread_mutex_lock(&thread->lock);
+        pthread_cond_signal(&thread->wake);
+        pthread_mutex_unlock(&thread->lock);
+        thread->stats.wakeups++;
+    }
+}
+
+static bool caught_up(device_thread_t *thread) {
+    return atomic_load_explicit(&thread->done, memory_order_acquire) == thread->posted;
+}
+
+static void wait_for_worker(device_thread_t *thread) {
+    while (!caught_up(thread)) {
+        sched_yield();
+    }
+}
+
+void device_thread_sync(device_thread_t *thread) {
+    if (!caught_up(thread)) {
+        thread->stats.syncs++;
+        wait_for_worker(thread);
+    }
+
+    // The caller may change device state, which the published horizon
+    // doesn't know about.  The worker's next publish comes after the next
+    // post, so it can only replace this.
+    atomic_store_explicit(&thread->horizon, 0, memory_order_relaxed);
+}
+
+uint32_t device_thread_irq_sources(device_thread_t *thread) {
+    machine_state_t *machine = thread->machine;
+    if (caught_up(thread)) {
+        return machine->irq_sources;
+    }
+
+    // The lines published at the worker's time hold until the horizon, and
+    // the worker trails the CPU, so they are the lines now too
+    uint64_t horizon = atomic_load_explicit(&thread->horizon, memory_order_acquire);
+    if (machine->cycles < horizon) {
+        thread->stats.irq_lookahead++;
+        return atomic_load_explicit(&thread->sources, memory_order_relaxed);
+    }
+
+    thread->stats.irq_waits++;
+    wait_for_worker(thread);
+    return machine->irq_sources;
+}
+
+void device_thread_get_stats(device_thread_t *thread, device_thread_stats_t *stats) {
+    *stats = thread->stats;
+}
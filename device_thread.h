@@ -0,0 +1,68 @@
+#ifndef __DEVICE_THREAD_H__
+#define __DEVICE_THREAD_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "machine.h"
+
+// Device thread
+//
+// Clocks a machine's devices on a worker thread while the CPU runs ahead,
+// as a conservative parallel simulation.  The CPU queues the cycles of each
+// machine_clock_devices() call; the worker replays them through
+// machine_step_devices() in the same order and with the same sizes, so the
+// devices go through exactly the calls they would on the CPU thread and
+// results are identical.
+//
+// The worker never gets ahead of the CPU, since any instruction might touch
+// a device.  The CPU waits for it (device_thread_sync()) only when it is
+// about to look at device state: an MMIO access, host access to a device, a
+// snapshot.  Sampling the IRQ lines doesn't need a wait while the CPU is
+// short of the lookahead horizon the worker publishes with them: the
+// earliest cycle a device could change its line without the CPU touching it
+// (see machine_devices_irq_horizon()).
+//
+// Device callbacks (ACIA byte and IRQ callbacks, FT245 pull callbacks) run
+// on the worker, so whatever they reach must be safe to use from it.  A host
+// bridge isn't: its rings are shared with host_bridge_poll() without
+// locking, and machine_start_device_thread() refuses a machine that has one
+// attached.
+//
+// Only the thread running the CPU calls these.
+
+#define DEVICE_THREAD_QUEUE  4096  // machine_clock_devices() calls the worker may trail by
+#define DEVICE_THREAD_SPINS  64    // Empty polls before the worker sleeps
+
+typedef struct device_thread_s device_thread_t;
+
+typedef struct device_thread_stats_s {
+    uint64_t steps;            // machine_clock_devices() calls handed over
+    uint64_t syncs;            // Times the CPU had to wait for the worker
+    uint64_t irq_lookahead;    // IRQ samples answered from the published horizon
+    uint64_t irq_waits;        // IRQ samples past the horizon, which waited
+    uint64_t wakeups;          // Times the worker was woken from sleep
+} device_thread_stats_t;
+
+// Start a worker for `machine`'s devices.  They must be current as of
+// machine->cycles.
+// Returns: thread, or NULL on failure
+device_thread_t *device_thread_create(machine_state_t *machine);
+
+// Let the worker catch up, stop it and free it
+void device_thread_destroy(device_thread_t *thread);
+
+// Queue one machine_clock_devices() call's cycles; waits if the worker is
+// DEVICE_THREAD_QUEUE calls behind
+void device_thread_post(device_thread_t *thread, uint8_t cycles);
+
+// Wait until the worker has run everything queued.  The devices then belong
+// to the calling thread until the next device_thread_post().
+void device_thread_sync(device_thread_t *thread);
+
+// machine->irq_sources as of machine->cycles, waiting only when the CPU is
+// past the lookahead horizon
+uint32_t device_thread_irq_sources(device_thread_t *thread);
+
+void device_thread_get_stats(device_thread_t *thread, device_thread_stats_t *stats);
+
+#endif // __DEVICE_THREAD_H__
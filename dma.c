@@ -0,0 +1,182 @@
+#include "dma.h"
+#include "memory_map.h"
+#include "processor_helpers.h"
+#include <string.h>
+
+#define ADDRESS_MASK 0xFFFFFF
+
+static void update_irq(dma_t* dma) {
+    if (dma->irq_callback) {
+        dma->irq_callback(dma->irq_context, dma_get_irq(dma));
+    }
+}
+
+void dma_init(dma_t* dma) {
+    memset(dma, 0, sizeof(dma_t));
+    dma_reset(dma);
+}
+
+void dma_reset(dma_t* dma) {
+    dma->source = 0;
+    dma->dest = 0;
+    dma->count = 0;
+    dma->mode = 0;
+    dma->status = 0;
+    update_irq(dma);
+}
+
+uint8_t dma_read(dma_t* dma, uint8_t reg) {
+    switch (reg) {
+        case DMA_SRC_LO:   return dma->source & 0xFF;
+        case DMA_SRC_HI:   return (dma->source >> 8) & 0xFF;
+        case DMA_SRC_BANK: return (dma->source >> 16) & 0xFF;
+        case DMA_DST_LO:   return dma->dest & 0xFF;
+        case DMA_DST_HI:   return (dma->dest >> 8) & 0xFF;
+        case DMA_DST_BANK: return (dma->dest >> 16) & 0xFF;
+        case DMA_COUNT_LO: return dma->count & 0xFF;
+        case DMA_COUNT_HI: return (dma->count >> 8) & 0xFF;
+        case DMA_MODE:     return dma->mode;
+        case DMA_CTRL: {
+            uint8_t status = dma->status;
+            if (status & DMA_STATUS_DONE) {
+                dma->status &= ~DMA_STATUS_DONE;
+                update_irq(dma);
+            }
+            return status;
+        }
+        default:
+            return 0xFF;
+    }
+}
+
+static uint32_t set_byte(uint32_t value, int shift, uint8_t byte) {
+    return (value & ~((uint32_t)0xFF << shift)) | ((uint32_t)byte << shift);
+}
+
+bool dma_write(dma_t* dma, uint8_t reg, uint8_t value) {
+    switch (reg) {
+        case DMA_SRC_LO:   dma->source = set_byte(dma->source, 0, value); break;
+        case DMA_SRC_HI:   dma->source = set_byte(dma->source, 8, value); break;
+        case DMA_SRC_BANK: dma->source = set_byte(dma->source, 16, value); break;
+        case DMA_DST_LO:   dma->dest = set_byte(dma->dest, 0, value); break;
+        case DMA_DST_HI:   dma->dest = set_byte(dma->dest, 8, value); break;
+        case DMA_DST_BANK: dma->dest = set_byte(dma->dest, 16, value); break;
+        case DMA_COUNT_LO: dma->count = (dma->count & 0xFF00) | value; break;
+        case DMA_COUNT_HI: dma->count = (dma->count & 0x00FF) | (value << 8); break;
+        case DMA_MODE:
+            dma->mode = value;
+            update_irq(dma);
+            break;
+        case DMA_CTRL:
+            if ((value & DMA_CTRL_START) && !(dma->status & DMA_STATUS_BUSY)) {
+                dma->status = DMA_STATUS_BUSY;
+                update_irq(dma);
+                return true;
+            }
+            break;
+        default:
+            break;
+    }
+    return false;
+}
+
+static void copy_byte(machine_state_t* machine, uint32_t from, uint32_t to) {
+    long_address_t src = { .bank = (from >> 16) & 0xFF, .address = from & 0xFFFF };
+    long_address_t dst = { .bank = (to >> 16) & 0xFF, .address = to & 0xFFFF };
+    write_byte_long(machine, dst, read_byte_long(machine, src));
+}
+
+// Memory to memory, with the result a byte-by-byte forward copy would give:
+// a destination a few bytes ahead of the source repeats those bytes
+static void copy_memory(dma_t* dma, machine_state_t* machine, uint32_t length) {
+    uint32_t src = dma->source;
+    uint32_t dst = dma->dest;
+    while (length > 0) {
+        uint32_t src_run = 0;
+        uint32_t dst_run = 0;
+        uint8_t* from = machine_memory_run(machine, src, false, &src_run);
+        uint8_t* to = from ? machine_memory_run(machine, dst, true, &dst_run) : NULL;
+        if (!to) {
+            copy_byte(machine, src, dst);
+            src = (src + 1) & ADDRESS_MASK;
+            dst = (dst + 1) & ADDRESS_MASK;
+            length--;
+            continue;
+        }
+
+        uint32_t n = length;
+        if (src_run < n) {
+            n = src_run;
+        }
+        if (dst_run < n) {
+            n = dst_run;
+        }
+        uintptr_t gap = (uintptr_t)to - (uintptr_t)from;
+        uint32_t step = (uintptr_t)to > (uintptr_t)from && gap < n ? (uint32_t)gap : n;
+        memory_map_prepare_range(machine->memory_map, to, n);
+        for (uint32_t done = 0; done < n; done += step) {
+            memmove(to + done, from + done, n - done < step ? n - done : step);
+        }
+        dma->memcpy_bytes += n;
+        src = (src + n) & ADDRESS_MASK;
+        dst = (dst + n) & ADDRESS_MASK;
+        length -= n;
+    }
+}
+
+uint32_t dma_transfer(dma_t* dma, machine_state_t* machine) {
+    uint8_t mode = dma->mode & DMA_MODE_MASK;
+    if (mode != DMA_MODE_MEM_TO_MEM && mode != DMA_MODE_MEM_TO_DEV && mode != DMA_MODE_DEV_TO_MEM) {
+        dma->status = DMA_STATUS_ERROR;
+        update_irq(dma);
+        return 0;
+    }
+
+    uint32_t length = dma->count ? dma->count : 0x10000;
+    if (mode == DMA_MODE_MEM_TO_MEM) {
+        copy_memory(dma, machine, length);
+        dma->source = (dma->source + length) & ADDRESS_MASK;
+        dma->dest = (dma->dest + length) & ADDRESS_MASK;
+    } else if (mode == DMA_MODE_MEM_TO_DEV) {
+        for (uint32_t i = 0; i < length; i++) {
+            copy_byte(machine, dma->source, dma->dest);
+            dma->source = (dma->source + 1) & ADDRESS_MASK;
+        }
+    } else {
+        for (uint32_t i = 0; i < length; i++) {
+            copy_byte(machine, dma->source, dma->dest);
+            dma->dest = (dma->dest + 1) & ADDRESS_MASK;
+        }
+    }
+    dma->count = 0;
+
+    uint32_t cycles = length * DMA_CYCLES_PER_BYTE;
+    dma->transfers++;
+    dma->bytes += length;
+    dma->stolen_cycles += cycles;
+    return cycles;
+}
+
+void dma_complete(dma_t* dma) {
+    if (dma->status & DMA_STATUS_BUSY) {
+        dma->status = DMA_STATUS_DONE;
+        update_irq(dma);
+    }
+}
+
+bool dma_get_irq(dma_t* dma) {
+    return (dma->status & DMA_STATUS_DONE) && (dma->mode & DMA_MODE_IRQ_ENABLE);
+}
+
+void dma_set_irq_callback(dma_t* dma, void (*callback)(void*, bool), void* context) {
+    dma->irq_callback = callback;
+    dma->irq_context = context;
+}
+
+void dma_copy_state(dma_t* dst, const dma_t* src) {
+    void (*callback)(void*, bool) = dst->irq_callback;
+    void* context = dst->irq_context;
+    *dst = *src;
+    dst->irq_callback = callback;
+    dst->irq_context = context;
+}
@@ -0,0 +1,94 @@
+#ifndef __DMA_H__
+#define __DMA_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "machine.h"
+
+// DMA controller
+//
+// Moves a block of up to 64KB between 24-bit addresses while the CPU is held
+// off the bus.  The guest sets up source, destination, count and mode, then
+// writes DMA_CTRL_START; the machine steals DMA_CYCLES_PER_BYTE cycles per
+// byte from the CPU and the DONE flag (and IRQ, if enabled) comes up at the
+// cycle the last byte would have moved.
+//
+// - memory to memory: both addresses count up.  Runs of plain RAM/ROM are
+//   moved with memcpy; anything else (devices, mapper registers) goes through
+//   the region callbacks a byte at a time.
+// - memory to device: the destination stays put, e.g. a FIFO data register
+// - device to memory: the source stays put
+//
+// Device modes do one register access per byte with no flow control, so the
+// device must be able to take (or supply) the whole block.
+
+// Register offsets
+#define DMA_SRC_LO    0x00  // Source address, bits 0-7
+#define DMA_SRC_HI    0x01  //                 bits 8-15
+#define DMA_SRC_BANK  0x02  //                 bits 16-23
+#define DMA_DST_LO    0x03  // Destination address
+#define DMA_DST_HI    0x04
+#define DMA_DST_BANK  0x05
+#define DMA_COUNT_LO  0x06  // Bytes to move (0 = 65536)
+#define DMA_COUNT_HI  0x07
+#define DMA_MODE      0x08  // Transfer mode and IRQ enable
+#define DMA_CTRL      0x09  // Write: start; read: status (clears DONE)
+#define DMA_REGISTERS 0x10  // Size of the register window
+
+// DMA_MODE bits
+#define DMA_MODE_MEM_TO_MEM   0x00
+#define DMA_MODE_MEM_TO_DEV   0x01
+#define DMA_MODE_DEV_TO_MEM   0x02
+#define DMA_MODE_MASK         0x03
+#define DMA_MODE_IRQ_ENABLE   0x80
+
+// DMA_CTRL bits
+#define DMA_CTRL_START        0x01  // Write: start a transfer
+#define DMA_STATUS_BUSY       0x01  // Read: transfer in progress
+#define DMA_STATUS_ERROR      0x40  // Read: last start had an invalid mode
+#define DMA_STATUS_DONE       0x80  // Read: transfer finished (IRQ source)
+
+// Bus cycles per byte moved (one read, one write); MVN takes 7
+#define DMA_CYCLES_PER_BYTE   2
+
+typedef struct dma_s {
+    uint32_t source;           // 24-bit addresses; advanced past the block when done
+    uint32_t dest;
+    uint16_t count;            // 0 = 65536; reads back 0 after a transfer
+    uint8_t mode;
+    uint8_t status;
+
+    // Totals since power-on
+    uint64_t transfers;
+    uint64_t bytes;
+    uint64_t stolen_cycles;    // CPU cycles lost to transfers
+    uint64_t memcpy_bytes;     // Bytes moved as host memcpy rather than byte-wise
+
+    // IRQ callback (optional)
+    void (*irq_callback)(void* context, bool state);
+    void* irq_context;
+} dma_t;
+
+void dma_init(dma_t* dma);
+void dma_reset(dma_t* dma);
+
+// Register access.  dma_write() returns true when the write starts a
+// transfer, which the owner then runs with dma_transfer().
+uint8_t dma_read(dma_t* dma, uint8_t reg);
+bool dma_write(dma_t* dma, uint8_t reg, uint8_t value);
+
+// Move the programmed block through `machine`'s address space.  Memory
+// effects happen at once; the controller stays BUSY until dma_complete().
+// Returns: CPU cycles the transfer takes (0 if the mode was invalid)
+uint32_t dma_transfer(dma_t* dma, machine_state_t* machine);
+
+// The transfer's last cycle has passed: clear BUSY, set DONE, raise the IRQ
+void dma_complete(dma_t* dma);
+
+bool dma_get_irq(dma_t* dma);
+void dma_set_irq_callback(dma_t* dma, void (*callback)(void*, bool), void* context);
+
+// Copy register state, keeping dst's callback
+void dma_copy_state(dma_t* dst, const dma_t* src);
+
+#endif // __DMA_H__
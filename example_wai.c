@@ -45,7 +45,7 @@ int main() {
     machine->processor.emulation_mode = true;
     
     // Get VIA and set up timer to generate interrupt after 50 cycles
-    via6522_t *via = get_via_instance();
+    via6522_t *via = get_via_instance(machine);
     via6522_write(via, 0x0E, 0xC0); // Enable Timer 1 interrupt
     via6522_write(via, 0x04, 50);   // Timer countdown value (low byte)
     via6522_write(via, 0x05, 0);    // Timer countdown value (high byte, starts timer)
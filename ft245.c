@@ -2,12 +2,39 @@
 #include <string.h>
 
 static void update_status_signals(ft245_t* ft245);
+static void pull_host_data(ft245_t* ft245, uint32_t max_bytes);
+
+static inline void fifo_event(ft245_t* ft245) {
+    if (ft245->fifo_event_callback) {
+        ft245->fifo_event_callback(ft245->fifo_event_context);
+    }
+}
 
 void ft245_init(ft245_t* ft245) {
     memset(ft245, 0, sizeof(ft245_t));
+    spsc_ring_init(&ft245->rx_ring, FT245_RX_FIFO_SIZE);
+    spsc_ring_init(&ft245->tx_ring, FT245_TX_FIFO_SIZE);
     ft245_reset(ft245);
 }
 
+void ft245_free(ft245_t* ft245) {
+    spsc_ring_free(&ft245->rx_ring);
+    spsc_ring_free(&ft245->tx_ring);
+}
+
+int ft245_set_fifo_capacity(ft245_t* ft245, uint16_t rx_size, uint16_t tx_size) {
+    if (rx_size == 0 || tx_size == 0 ||
+        rx_size > FT245_FIFO_MAX_SIZE || tx_size > FT245_FIFO_MAX_SIZE) {
+        return -1;
+    }
+    if (spsc_ring_resize(&ft245->rx_ring, rx_size) != 0 ||
+        spsc_ring_resize(&ft245->tx_ring, tx_size) != 0) {
+        return -1;
+    }
+    update_status_signals(ft245);
+    return 0;
+}
+
 void ft245_reset(ft245_t* ft245) {
     ft245->data_bus = 0xFF;  // Bus idle state
     
@@ -18,14 +45,10 @@ void ft245_reset(ft245_t* ft245) {
     ft245->wr = false;       // Not writing
     ft245->pwren_n = true;   // Not powered/configured
     
-    // Clear FIFOs
-    ft245->rx_fifo_head = 0;
-    ft245->rx_fifo_tail = 0;
-    ft245->rx_fifo_count = 0;
-    
-    ft245->tx_fifo_head = 0;
-    ft245->tx_fifo_tail = 0;
-    ft245->tx_fifo_count = 0;
+    // Clear FIFOs (both sides quiet: clear moves tail, and the CPU side
+    // produces into tx_ring)
+    spsc_ring_clear(&ft245->rx_ring);
+    spsc_ring_clear(&ft245->tx_ring);
     
     // USB state
     ft245->usb_connected = false;
@@ -44,17 +67,16 @@ uint8_t ft245_read(ft245_t* ft245) {
     uint8_t data = 0xFF;
     
     // Check if RD# is asserted (low) and data is available
-    if (!ft245->rd_n && ft245->rx_fifo_count > 0) {
+    if (!ft245->rd_n && !spsc_ring_empty(&ft245->rx_ring)) {
         if (ft245->read_timer >= ft245->read_latency) {
             // Read data from RX FIFO
-            data = ft245->rx_fifo[ft245->rx_fifo_tail];
-            ft245->rx_fifo_tail = (ft245->rx_fifo_tail + 1) % FT245_RX_FIFO_SIZE;
-            ft245->rx_fifo_count--;
+            spsc_ring_pop_byte(&ft245->rx_ring, &data);
             
             ft245->data_bus = data;
             ft245->read_timer = 0;
             
             update_status_signals(ft245);
+            fifo_event(ft245);
         } else {
             // Return current data bus value during latency period
             data = ft245->data_bus;
@@ -88,28 +110,27 @@ void ft245_set_wr(ft245_t* ft245, bool state) {
     // On rising edge, perform write operation if data is on bus
     if (!old_state && ft245->wr) {
         // Check if buffer has space
-        if (ft245->tx_fifo_count < FT245_TX_FIFO_SIZE) {
-            // Write data from data bus to TX FIFO
-            ft245->tx_fifo[ft245->tx_fifo_head] = ft245->data_bus;
-            ft245->tx_fifo_head = (ft245->tx_fifo_head + 1) % FT245_TX_FIFO_SIZE;
-            ft245->tx_fifo_count++;
-            
+        // Write data from data bus to TX FIFO
+        if (spsc_ring_push_byte(&ft245->tx_ring, ft245->data_bus)) {
             // Call USB transmit callback if available
             if (ft245->usb_tx_callback) {
                 ft245->usb_tx_callback(ft245->usb_context, ft245->data_bus);
             }
             
             update_status_signals(ft245);
+            fifo_event(ft245);
         }
         ft245->write_timer = 0;
     }
 }
 
 bool ft245_get_rxf(ft245_t* ft245) {
+    update_status_signals(ft245);
     return ft245->rxf_n;  // Active low - false means data available
 }
 
 bool ft245_get_txe(ft245_t* ft245) {
+    update_status_signals(ft245);
     return ft245->txe_n;  // Active low - false means space available
 }
 
@@ -121,55 +142,37 @@ uint8_t ft245_get_data_bus(ft245_t* ft245) {
     return ft245->data_bus;
 }
 
+// The USB side is the RX ring's producer and the TX ring's consumer.  It
+// leaves RXF#/TXE# alone: the CPU side recomputes them when it looks.
 bool ft245_usb_receive(ft245_t* ft245, uint8_t data) {
-    if (ft245->rx_fifo_count < FT245_RX_FIFO_SIZE) {
-        ft245->rx_fifo[ft245->rx_fifo_head] = data;
-        ft245->rx_fifo_head = (ft245->rx_fifo_head + 1) % FT245_RX_FIFO_SIZE;
-        ft245->rx_fifo_count++;
-        
-        update_status_signals(ft245);
-        return true;
+    if (!spsc_ring_push_byte(&ft245->rx_ring, data)) {
+        return false;  // FIFO full
     }
-    return false;  // FIFO full
+    fifo_event(ft245);
+    return true;
 }
 
 bool ft245_usb_transmit(ft245_t* ft245, uint8_t* data) {
-    if (ft245->tx_fifo_count > 0) {
-        *data = ft245->tx_fifo[ft245->tx_fifo_tail];
-        ft245->tx_fifo_tail = (ft245->tx_fifo_tail + 1) % FT245_TX_FIFO_SIZE;
-        ft245->tx_fifo_count--;
-        
-        update_status_signals(ft245);
-        return true;
+    if (!spsc_ring_pop_byte(&ft245->tx_ring, data)) {
+        return false;  // FIFO empty
     }
-    return false;  // FIFO empty
+    fifo_event(ft245);
+    return true;
 }
 
 uint16_t ft245_usb_receive_buffer(ft245_t* ft245, const uint8_t* buffer, uint16_t length) {
-    uint16_t count = 0;
-    
-    for (uint16_t i = 0; i < length; i++) {
-        if (ft245_usb_receive(ft245, buffer[i])) {
-            count++;
-        } else {
-            break;  // FIFO full
-        }
+    uint16_t count = (uint16_t)spsc_ring_push(&ft245->rx_ring, buffer, length);
+    if (count > 0) {
+        fifo_event(ft245);
     }
-    
     return count;
 }
 
 uint16_t ft245_usb_transmit_buffer(ft245_t* ft245, uint8_t* buffer, uint16_t max_length) {
-    uint16_t count = 0;
-    
-    for (uint16_t i = 0; i < max_length; i++) {
-        if (ft245_usb_transmit(ft245, &buffer[i])) {
-            count++;
-        } else {
-            break;  // FIFO empty
-        }
+    uint16_t count = (uint16_t)spsc_ring_pop(&ft245->tx_ring, buffer, max_length);
+    if (count > 0) {
+        fifo_event(ft245);
     }
-    
     return count;
 }
 
@@ -177,14 +180,10 @@ void ft245_set_usb_connected(ft245_t* ft245, bool connected) {
     ft245->usb_connected = connected;
     
     if (!connected) {
-        // USB disconnected - reset state
+        // USB disconnected - reset state (both sides quiet, as for reset)
         ft245->usb_configured = false;
-        ft245->rx_fifo_head = 0;
-        ft245->rx_fifo_tail = 0;
-        ft245->rx_fifo_count = 0;
-        ft245->tx_fifo_head = 0;
-        ft245->tx_fifo_tail = 0;
-        ft245->tx_fifo_count = 0;
+        spsc_ring_clear(&ft245->rx_ring);
+        spsc_ring_clear(&ft245->tx_ring);
     }
     
     update_status_signals(ft245);
@@ -198,41 +197,53 @@ void ft245_set_usb_configured(ft245_t* ft245, bool configured) {
 }
 
 uint16_t ft245_get_rx_fifo_count(ft245_t* ft245) {
-    return ft245->rx_fifo_count;
+    return (uint16_t)spsc_ring_count(&ft245->rx_ring);
 }
 
 uint16_t ft245_get_tx_fifo_count(ft245_t* ft245) {
-    return ft245->tx_fifo_count;
+    return (uint16_t)spsc_ring_count(&ft245->tx_ring);
 }
 
 uint16_t ft245_get_rx_fifo_free(ft245_t* ft245) {
-    return FT245_RX_FIFO_SIZE - ft245->rx_fifo_count;
+    return (uint16_t)spsc_ring_free_space(&ft245->rx_ring);
 }
 
 uint16_t ft245_get_tx_fifo_free(ft245_t* ft245) {
-    return FT245_TX_FIFO_SIZE - ft245->tx_fifo_count;
+    return (uint16_t)spsc_ring_free_space(&ft245->tx_ring);
 }
 
 void ft245_clock(ft245_t* ft245) {
-    // Update read timer
+    ft245_clock_n(ft245, 1);
+}
+
+void ft245_clock_n(ft245_t* ft245, uint32_t cycles) {
+    if (cycles == 0) {
+        return;
+    }
+    
+    // Update read timer.  Host data that arrives before the latency runs out
+    // is what the data bus shows, so pull that much first.
     if (!ft245->rd_n && ft245->read_timer < ft245->read_latency) {
-        ft245->read_timer++;
-        
-        if (ft245->read_timer >= ft245->read_latency && ft245->rx_fifo_count > 0) {
+        uint32_t left = ft245->read_latency - ft245->read_timer;
+        if (cycles >= left) {
+            pull_host_data(ft245, left - 1);
+            ft245->read_timer = ft245->read_latency;
             // Latency complete, update data bus
-            uint8_t data = ft245->rx_fifo[ft245->rx_fifo_tail];
-            ft245->data_bus = data;
+            spsc_ring_peek(&ft245->rx_ring, &ft245->data_bus);
+            pull_host_data(ft245, cycles - (left - 1));
+            update_status_signals(ft245);
+            return;
         }
+        ft245->read_timer += cycles;
     }
     
-    // Check for USB receive callback
-    if (ft245->usb_rx_callback) {
-        bool available = false;
-        uint8_t byte = ft245->usb_rx_callback(ft245->usb_context, &available);
-        if (available) {
-            ft245_usb_receive(ft245, byte);
-        }
-    }
+    pull_host_data(ft245, cycles);
+    update_status_signals(ft245);
+}
+
+void ft245_set_usb_rx_buffer_callback(ft245_t* ft245,
+                                       uint16_t (*rx_buffer_fn)(void*, uint8_t*, uint16_t)) {
+    ft245->usb_rx_buffer_callback = rx_buffer_fn;
 }
 
 void ft245_set_usb_callbacks(ft245_t* ft245,
@@ -251,17 +262,76 @@ void ft245_set_status_callback(ft245_t* ft245,
     ft245->status_context = context;
 }
 
+void ft245_set_fifo_event_callback(ft245_t* ft245,
+                                    void (*event_fn)(void*),
+                                    void* context) {
+    ft245->fifo_event_callback = event_fn;
+    ft245->fifo_event_context = context;
+}
+
+// Copy bus/FIFO state from src, keeping dst's callbacks and FIFO storage
+void ft245_copy_state(ft245_t* dst, const ft245_t* src) {
+    ft245_t wiring = *dst;
+    *dst = *src;
+    dst->rx_ring = wiring.rx_ring;
+    dst->tx_ring = wiring.tx_ring;
+    spsc_ring_copy(&dst->rx_ring, &src->rx_ring);
+    spsc_ring_copy(&dst->tx_ring, &src->tx_ring);
+    dst->usb_tx_callback = wiring.usb_tx_callback;
+    dst->usb_rx_callback = wiring.usb_rx_callback;
+    dst->usb_rx_buffer_callback = wiring.usb_rx_buffer_callback;
+    dst->usb_context = wiring.usb_context;
+    dst->status_callback = wiring.status_callback;
+    dst->status_context = wiring.status_context;
+    dst->fifo_event_callback = wiring.fifo_event_callback;
+    dst->fifo_event_context = wiring.fifo_event_context;
+}
+
 // Internal helper functions
 
+// USB delivers at most one byte per cycle; take up to max_bytes from the
+// host in one go, never more than the RX FIFO can hold.  The bulk callback
+// writes straight into the ring (twice when the free space wraps).
+static void pull_host_data(ft245_t* ft245, uint32_t max_bytes) {
+    if (ft245->usb_rx_buffer_callback) {
+        while (max_bytes > 0) {
+            uint8_t *span;
+            size_t room = spsc_ring_write_span(&ft245->rx_ring, &span);
+            if (room > max_bytes) {
+                room = max_bytes;
+            }
+            if (room == 0) {
+                break;
+            }
+            uint16_t count = ft245->usb_rx_buffer_callback(ft245->usb_context, span, (uint16_t)room);
+            spsc_ring_commit(&ft245->rx_ring, count);
+            max_bytes -= count;
+            if (count < room) {
+                break;
+            }
+        }
+    } else if (ft245->usb_rx_callback) {
+        while (max_bytes > 0 && spsc_ring_free_space(&ft245->rx_ring) > 0) {
+            bool available = false;
+            uint8_t byte = ft245->usb_rx_callback(ft245->usb_context, &available);
+            if (!available) {
+                break;
+            }
+            spsc_ring_push_byte(&ft245->rx_ring, byte);
+            max_bytes--;
+        }
+    }
+}
+
 static void update_status_signals(ft245_t* ft245) {
     bool old_rxf = ft245->rxf_n;
     bool old_txe = ft245->txe_n;
     
     // Update RXF# - low when data available to read
-    ft245->rxf_n = (ft245->rx_fifo_count == 0);
+    ft245->rxf_n = spsc_ring_empty(&ft245->rx_ring);
     
     // Update TXE# - low when transmit buffer has space
-    ft245->txe_n = (ft245->tx_fifo_count >= FT245_TX_FIFO_SIZE);
+    ft245->txe_n = (spsc_ring_free_space(&ft245->tx_ring) == 0);
     
     // Update PWREN# - low when USB configured
     ft245->pwren_n = !(ft245->usb_connected && ft245->usb_configured);
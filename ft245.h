@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "spsc_ring.h"
 
 // FT245 operates with 8-bit data bus and control signals
 // Control signals (active low unless noted):
@@ -12,9 +13,10 @@
 // - WR (input): Write strobe from CPU (active high in async mode)
 // - PWREN# (output): USB configured and powered
 
-// FIFO sizes
+// Default FIFO sizes (see ft245_set_fifo_capacity())
 #define FT245_RX_FIFO_SIZE 512  // USB->CPU buffer
 #define FT245_TX_FIFO_SIZE 512  // CPU->USB buffer
+#define FT245_FIFO_MAX_SIZE 32768  // Largest capacity the 16-bit counts can report
 
 // Status flags
 #define FT245_STATUS_RXF    0x01  // Data available to read (active low in hardware)
@@ -32,17 +34,11 @@ typedef struct ft245_s {
     bool wr;                   // WR - Write strobe (input from CPU)
     bool pwren_n;              // PWREN# - USB configured (output)
     
-    // Receive FIFO (USB -> CPU)
-    uint8_t rx_fifo[FT245_RX_FIFO_SIZE];
-    uint16_t rx_fifo_head;     // Write position
-    uint16_t rx_fifo_tail;     // Read position
-    uint16_t rx_fifo_count;    // Number of bytes in FIFO
-    
-    // Transmit FIFO (CPU -> USB)
-    uint8_t tx_fifo[FT245_TX_FIFO_SIZE];
-    uint16_t tx_fifo_head;     // Write position
-    uint16_t tx_fifo_tail;     // Read position
-    uint16_t tx_fifo_count;    // Number of bytes in FIFO
+    // FIFOs.  The USB side of each may run on a host I/O thread: it
+    // produces into rx_ring and consumes from tx_ring, and the CPU side does
+    // the opposite.  RXF#/TXE# are recomputed on the CPU side.
+    spsc_ring_t rx_ring;       // USB -> CPU
+    spsc_ring_t tx_ring;       // CPU -> USB
     
     // USB connection state
     bool usb_connected;        // USB cable connected
@@ -61,19 +57,38 @@ typedef struct ft245_s {
     // Called to check if USB has data to send to CPU
     uint8_t (*usb_rx_callback)(void* context, bool* available);
     
+    // Optional bulk form of usb_rx_callback: fill up to max_length bytes,
+    // return how many.  Used instead of usb_rx_callback when set.
+    uint16_t (*usb_rx_buffer_callback)(void* context, uint8_t* buffer, uint16_t max_length);
+    
     void* usb_context;
     
     // Status change callback
     void (*status_callback)(void* context, bool rxf, bool txe);
     void* status_context;
+    
+    // FIFO activity callback: called from whichever side just moved bytes
+    // into or out of a ring, so it may run on the host thread
+    void (*fifo_event_callback)(void* context);
+    void* fifo_event_context;
 } ft245_t;
 
 // Initialize FT245
 void ft245_init(ft245_t* ft245);
 
-// Reset FT245 to power-on state
+// Release the FIFO storage
+void ft245_free(ft245_t* ft245);
+
+// Reset FT245 to power-on state, dropping the FIFOs' contents.  Only while
+// no host thread is using them.
 void ft245_reset(ft245_t* ft245);
 
+// Resize the FIFOs (rounded up to a power of two, at most
+// FT245_FIFO_MAX_SIZE), dropping their contents.  Only while no host thread
+// is using them.
+// Returns: 0 on success, -1 on error
+int ft245_set_fifo_capacity(ft245_t* ft245, uint16_t rx_size, uint16_t tx_size);
+
 // Read data from FT245 (CPU reads from USB)
 uint8_t ft245_read(ft245_t* ft245);
 
@@ -84,7 +99,7 @@ void ft245_write(ft245_t* ft245, uint8_t data);
 void ft245_set_rd(ft245_t* ft245, bool state);  // RD# pin
 void ft245_set_wr(ft245_t* ft245, bool state);  // WR pin
 
-// Control signal outputs (to CPU)
+// Control signal outputs (to CPU), brought up to date with the FIFOs
 bool ft245_get_rxf(ft245_t* ft245);  // Returns RXF# state (low = data available)
 bool ft245_get_txe(ft245_t* ft245);  // Returns TXE# state (low = space available)
 bool ft245_get_pwren(ft245_t* ft245); // Returns PWREN# state
@@ -92,7 +107,8 @@ bool ft245_get_pwren(ft245_t* ft245); // Returns PWREN# state
 // Get current data bus value
 uint8_t ft245_get_data_bus(ft245_t* ft245);
 
-// USB side operations (simulating PC/USB host)
+// USB side operations (simulating PC/USB host).  These only touch the FIFO
+// rings, so one host thread may call them while the CPU thread runs.
 // Add data to RX FIFO (from USB/PC to CPU)
 bool ft245_usb_receive(ft245_t* ft245, uint8_t data);
 
@@ -105,11 +121,12 @@ uint16_t ft245_usb_receive_buffer(ft245_t* ft245, const uint8_t* buffer, uint16_
 // Get multiple bytes from TX FIFO
 uint16_t ft245_usb_transmit_buffer(ft245_t* ft245, uint8_t* buffer, uint16_t max_length);
 
-// USB connection control
+// USB connection control.  Disconnecting drops the FIFOs' contents, so
+// like ft245_reset() it needs both the CPU side and the host side quiet.
 void ft245_set_usb_connected(ft245_t* ft245, bool connected);
 void ft245_set_usb_configured(ft245_t* ft245, bool configured);
 
-// Get FIFO status
+// Get FIFO status (exact from the side that is asking)
 uint16_t ft245_get_rx_fifo_count(ft245_t* ft245);
 uint16_t ft245_get_tx_fifo_count(ft245_t* ft245);
 uint16_t ft245_get_rx_fifo_free(ft245_t* ft245);
@@ -118,14 +135,29 @@ uint16_t ft245_get_tx_fifo_free(ft245_t* ft245);
 // Clock the FT245 (for timing-accurate simulation)
 void ft245_clock(ft245_t* ft245);
 
+// Clock the FT245 by several cycles in one step.  Host data (one byte per
+// cycle at most, and only what fits in the RX FIFO) is pulled in bulk.
+void ft245_clock_n(ft245_t* ft245, uint32_t cycles);
+
 // Set callbacks
 void ft245_set_usb_callbacks(ft245_t* ft245,
                               void (*tx_fn)(void*, uint8_t),
                               uint8_t (*rx_fn)(void*, bool*),
                               void* context);
 
+// Bulk host source; shares usb_context with ft245_set_usb_callbacks()
+void ft245_set_usb_rx_buffer_callback(ft245_t* ft245,
+                                       uint16_t (*rx_buffer_fn)(void*, uint8_t*, uint16_t));
+
 void ft245_set_status_callback(ft245_t* ft245,
                                 void (*status_fn)(void*, bool, bool),
                                 void* context);
 
+void ft245_set_fifo_event_callback(ft245_t* ft245,
+                                    void (*event_fn)(void*),
+                                    void* context);
+
+// Copy bus/FIFO state from src, keeping dst's callbacks
+void ft245_copy_state(ft245_t* dst, const ft245_t* src);
+
 #endif // __FT245_H__
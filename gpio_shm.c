@@ -0,0 +1,148 @@
+#include "gpio_shm.h"
+#include <stddef.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static gpio_shm_t *map_segment(int fd) {
+    void *addr = mmap(NULL, sizeof(gpio_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return addr == MAP_FAILED ? NULL : (gpio_shm_t *)addr;
+}
+
+gpio_shm_t *gpio_shm_create(const char *name) {
+    shm_unlink(name);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(gpio_shm_t)) != 0) {
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    gpio_shm_t *shm = map_segment(fd);
+    if (!shm) {
+        shm_unlink(name);
+        return NULL;
+    }
+    // A new segment is zero filled; the magic goes in last
+    shm->version = GPIO_SHM_VERSION;
+    atomic_thread_fence(memory_order_release);
+    shm->magic = GPIO_SHM_MAGIC;
+    return shm;
+}
+
+gpio_shm_t *gpio_shm_open(const char *name) {
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(gpio_shm_t)) {
+        close(fd);
+        return NULL;
+    }
+    gpio_shm_t *shm = map_segment(fd);
+    if (shm && (shm->magic != GPIO_SHM_MAGIC || shm->version != GPIO_SHM_VERSION)) {
+        gpio_shm_close(shm);
+        return NULL;
+    }
+    atomic_thread_fence(memory_order_acquire);
+    return shm;
+}
+
+void gpio_shm_close(gpio_shm_t *shm) {
+    if (shm) {
+        munmap(shm, sizeof(gpio_shm_t));
+    }
+}
+
+int gpio_shm_unlink(const char *name) {
+    return shm_unlink(name);
+}
+
+gpio_shm_chip_t *gpio_shm_chip(gpio_shm_t *shm, int chip) {
+    if (!shm || chip < 0 || chip >= GPIO_SHM_CHIPS) {
+        return NULL;
+    }
+    return &shm->chips[chip];
+}
+
+// Seqlock writes: odd counter, fields, even counter.  Fields are relaxed
+// atomics; the fences order them against the counter.
+#define LOAD(field)         atomic_load_explicit(&(field), memory_order_relaxed)
+#define STORE(field, value) atomic_store_explicit(&(field), (value), memory_order_relaxed)
+
+void gpio_shm_publish(gpio_shm_chip_t *chip, const gpio_shm_outputs_t *outputs) {
+    // Only the emulator writes this block, so it can compare in place
+    if (LOAD(chip->out_port_a) == outputs->port_a && LOAD(chip->out_port_b) == outputs->port_b &&
+        LOAD(chip->out_ddr_a) == outputs->ddr_a && LOAD(chip->out_ddr_b) == outputs->ddr_b &&
+        LOAD(chip->out_lines) == outputs->lines) {
+        return;
+    }
+    unsigned seq = LOAD(chip->out_seq);
+    STORE(chip->out_seq, seq + 1);
+    atomic_thread_fence(memory_order_release);
+    STORE(chip->out_port_a, outputs->port_a);
+    STORE(chip->out_port_b, outputs->port_b);
+    STORE(chip->out_ddr_a, outputs->ddr_a);
+    STORE(chip->out_ddr_b, outputs->ddr_b);
+    STORE(chip->out_lines, outputs->lines);
+    atomic_store_explicit(&chip->out_seq, seq + 2, memory_order_release);
+}
+
+bool gpio_shm_poll_inputs(gpio_shm_chip_t *chip, uint32_t *seen, gpio_shm_inputs_t *inputs) {
+    unsigned seq = atomic_load_explicit(&chip->in_seq, memory_order_acquire);
+    if (seq == *seen || (seq & 1)) {
+        return false;
+    }
+    gpio_shm_inputs_t taken = {
+        .port_a = LOAD(chip->in_port_a),
+        .port_b = LOAD(chip->in_port_b),
+        .lines = LOAD(chip->in_lines),
+    };
+    atomic_thread_fence(memory_order_acquire);
+    if (LOAD(chip->in_seq) != seq) {
+        return false;
+    }
+    *inputs = taken;
+    *seen = seq;
+    return true;
+}
+
+void gpio_shm_set_inputs(gpio_shm_chip_t *chip, const gpio_shm_inputs_t *inputs) {
+    unsigned seq = LOAD(chip->in_seq);
+    STORE(chip->in_seq, seq + 1);
+    atomic_thread_fence(memory_order_release);
+    STORE(chip->in_port_a, inputs->port_a);
+    STORE(chip->in_port_b, inputs->port_b);
+    STORE(chip->in_lines, inputs->lines);
+    atomic_store_explicit(&chip->in_seq, seq + 2, memory_order_release);
+}
+
+uint32_t gpio_shm_read_outputs(gpio_shm_chip_t *chip, gpio_shm_outputs_t *outputs) {
+    for (;;) {
+        unsigned seq = atomic_load_explicit(&chip->out_seq, memory_order_acquire);
+        if (seq & 1) {
+            sched_yield();  // The emulator is part way through a publish
+            continue;
+        }
+        outputs->port_a = LOAD(chip->out_port_a);
+        outputs->port_b = LOAD(chip->out_port_b);
+        outputs->ddr_a = LOAD(chip->out_ddr_a);
+        outputs->ddr_b = LOAD(chip->out_ddr_b);
+        outputs->lines = LOAD(chip->out_lines);
+        atomic_thread_fence(memory_order_acquire);
+        if (LOAD(chip->out_seq) == seq) {
+            return seq;
+        }
+    }
+}
+
+uint32_t gpio_shm_output_seq(gpio_shm_chip_t *chip) {
+    return atomic_load_explicit(&chip->out_seq, memory_order_acquire);
+}
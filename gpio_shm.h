@@ -0,0 +1,106 @@
+#ifndef __GPIO_SHM_H__
+#define __GPIO_SHM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// Shared-memory GPIO mirror
+//
+// A POSIX shared memory segment mirroring the ports of a VIA and a PIA, so
+// a test harness in another process can drive input pins and watch outputs
+// without a syscall per access.  Each chip has two blocks, each written by
+// one side only and guarded by its own sequence counter (a seqlock, odd
+// while a write is in progress):
+//
+// - outputs: the emulator publishes the output registers, DDRs and control
+//   line levels whenever the CPU touches the chip and something changed
+// - inputs: the harness drives the port pins and CA1/CA2/CB1/CB2; the chip
+//   takes them the next time it is accessed (or, for the VIA, clocked)
+//
+// A changed sequence counter is the change notification: poll it to see
+// whether there is anything new to read.
+
+#define GPIO_SHM_MAGIC    0x4F495047  // "GPIO"
+#define GPIO_SHM_VERSION  1
+
+// Chips in the segment
+#define GPIO_SHM_VIA    0
+#define GPIO_SHM_PIA    1
+#define GPIO_SHM_CHIPS  2
+
+// Control line bits
+#define GPIO_SHM_CA1  0x01
+#define GPIO_SHM_CA2  0x02
+#define GPIO_SHM_CB1  0x04
+#define GPIO_SHM_CB2  0x08
+
+typedef struct gpio_shm_outputs_s {
+    uint8_t port_a;            // Output register A (ORA / PIA port A data)
+    uint8_t port_b;            // Output register B
+    uint8_t ddr_a;             // 1 = output
+    uint8_t ddr_b;
+    uint8_t lines;             // CA1/CA2/CB1/CB2 levels as the chip sees them
+} gpio_shm_outputs_t;
+
+typedef struct gpio_shm_inputs_s {
+    uint8_t port_a;            // Pin levels, used for the DDR input bits
+    uint8_t port_b;
+    uint8_t lines;             // CA1/CB1, and CA2/CB2 when they are inputs
+} gpio_shm_inputs_t;
+
+// One chip; each block on its own cache line so the two writers don't share
+typedef struct gpio_shm_chip_s {
+    _Alignas(64) atomic_uint out_seq;
+    _Atomic uint8_t out_port_a;
+    _Atomic uint8_t out_port_b;
+    _Atomic uint8_t out_ddr_a;
+    _Atomic uint8_t out_ddr_b;
+    _Atomic uint8_t out_lines;
+
+    _Alignas(64) atomic_uint in_seq;
+    _Atomic uint8_t in_port_a;
+    _Atomic uint8_t in_port_b;
+    _Atomic uint8_t in_lines;
+} gpio_shm_chip_t;
+
+typedef struct gpio_shm_s {
+    uint32_t magic;
+    uint32_t version;
+    gpio_shm_chip_t chips[GPIO_SHM_CHIPS];
+} gpio_shm_t;
+
+// Emulator side: create the segment `name` ("/something"), replacing any
+// old one, with every sequence counter and input at 0
+// Returns: mapped segment, or NULL on failure
+gpio_shm_t *gpio_shm_create(const char *name);
+
+// Harness side: map an existing segment
+// Returns: mapped segment, or NULL if missing or not a GPIO mirror
+gpio_shm_t *gpio_shm_open(const char *name);
+
+// Unmap the segment; gpio_shm_unlink() removes the name
+void gpio_shm_close(gpio_shm_t *shm);
+int gpio_shm_unlink(const char *name);
+
+gpio_shm_chip_t *gpio_shm_chip(gpio_shm_t *shm, int chip);
+
+// Emulator side: publish outputs, bumping out_seq only if anything changed
+void gpio_shm_publish(gpio_shm_chip_t *chip, const gpio_shm_outputs_t *outputs);
+
+// Emulator side: take the inputs if in_seq moved past *seen.  Never waits:
+// a harness write in progress is picked up on a later call.
+// Returns: true with *inputs and *seen updated, false if nothing new
+bool gpio_shm_poll_inputs(gpio_shm_chip_t *chip, uint32_t *seen, gpio_shm_inputs_t *inputs);
+
+// Harness side: drive the inputs (one writer)
+void gpio_shm_set_inputs(gpio_shm_chip_t *chip, const gpio_shm_inputs_t *inputs);
+
+// Harness side: consistent snapshot of the outputs
+// Returns: the output sequence number it belongs to
+uint32_t gpio_shm_read_outputs(gpio_shm_chip_t *chip, gpio_shm_outputs_t *outputs);
+
+// Current output sequence number, for cheap change polling
+uint32_t gpio_shm_output_seq(gpio_shm_chip_t *chip);
+
+#endif // __GPIO_SHM_H__
@@ -0,0 +1,402 @@
+#define _GNU_SOURCE
+#include "host_bridge.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+static host_bridge_t *bridge_alloc(host_bridge_kind_t kind) {
+    host_bridge_t *bridge = (host_bridge_t *)calloc(1, sizeof(host_bridge_t));
+    if (!bridge) {
+        return NULL;
+    }
+    bridge->kind = kind;
+    bridge->fd = -1;
+    bridge->out_fd = -1;
+    bridge->listen_fd = -1;
+    bridge->hold_fd = -1;
+    return bridge;
+}
+
+static int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0) {
+        return -1;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+host_bridge_t *host_bridge_open_pty(void) {
+    host_bridge_t *bridge = bridge_alloc(HOST_BRIDGE_PTY);
+    if (!bridge) {
+        return NULL;
+    }
+
+    bridge->fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (bridge->fd < 0 || grantpt(bridge->fd) != 0 || unlockpt(bridge->fd) != 0 ||
+        ptsname_r(bridge->fd, bridge->path, sizeof(bridge->path)) != 0) {
+        perror("host_bridge: posix_openpt");
+        host_bridge_close(bridge);
+        return NULL;
+    }
+
+    // Raw mode, so bytes pass through without echo or line editing
+    bridge->hold_fd = open(bridge->path, O_RDWR | O_NOCTTY);
+    struct termios tio;
+    if (bridge->hold_fd < 0 || tcgetattr(bridge->hold_fd, &tio) != 0) {
+        perror("host_bridge: pty slave");
+        host_bridge_close(bridge);
+        return NULL;
+    }
+    cfmakeraw(&tio);
+    tcsetattr(bridge->hold_fd, TCSANOW, &tio);
+
+    if (set_nonblocking(bridge->fd) != 0) {
+        host_bridge_close(bridge);
+        return NULL;
+    }
+    bridge->out_fd = bridge->fd;
+    return bridge;
+}
+
+host_bridge_t *host_bridge_open_socket(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "host_bridge: socket path too long: %s\n", path);
+        return NULL;
+    }
+    host_bridge_t *bridge = bridge_alloc(HOST_BRIDGE_SOCKET);
+    if (!bridge) {
+        return NULL;
+    }
+    strcpy(addr.sun_path, path);
+    strcpy(bridge->path, path);
+
+    bridge->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (bridge->listen_fd < 0) {
+        perror("host_bridge: socket");
+        host_bridge_close(bridge);
+        return NULL;
+    }
+    unlink(path);
+    if (bind(bridge->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(bridge->listen_fd, 1) != 0) {
+        perror("host_bridge: bind");
+        host_bridge_close(bridge);
+        return NULL;
+    }
+    return bridge;
+}
+
+static int make_fifo(const char *path) {
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        return S_ISFIFO(st.st_mode) ? 0 : -1;
+    }
+    return mkfifo(path, 0600);
+}
+
+host_bridge_t *host_bridge_open_fifo(const char *in_path, const char *out_path) {
+    host_bridge_t *bridge = bridge_alloc(HOST_BRIDGE_FIFO);
+    if (!bridge) {
+        return NULL;
+    }
+    if (strlen(in_path) >= sizeof(bridge->path) || strlen(out_path) >= sizeof(bridge->out_path) ||
+        make_fifo(in_path) != 0 || make_fifo(out_path) != 0) {
+        fprintf(stderr, "host_bridge: cannot create pipes %s, %s\n", in_path, out_path);
+        free(bridge);
+        return NULL;
+    }
+    strcpy(bridge->path, in_path);
+    strcpy(bridge->out_path, out_path);
+
+    // Holding a writer of our own keeps reads at EAGAIN, not EOF, between
+    // host writers
+    bridge->fd = open(in_path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    bridge->hold_fd = open(in_path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (bridge->fd < 0 || bridge->hold_fd < 0) {
+        perror("host_bridge: open pipe");
+        host_bridge_close(bridge);
+        return NULL;
+    }
+    return bridge;
+}
+
+void host_bridge_close(host_bridge_t *bridge) {
+    if (!bridge) {
+        return;
+    }
+    if (bridge->out_fd >= 0 && bridge->out_fd != bridge->fd) {
+        close(bridge->out_fd);
+    }
+    if (bridge->fd >= 0) {
+        close(bridge->fd);
+    }
+    if (bridge->hold_fd >= 0) {
+        close(bridge->hold_fd);
+    }
+    if (bridge->listen_fd >= 0) {
+        close(bridge->listen_fd);
+        unlink(bridge->path);
+    }
+    free(bridge);
+}
+
+const char *host_bridge_path(const host_bridge_t *bridge) {
+    return bridge->path;
+}
+
+bool host_bridge_connected(const host_bridge_t *bridge) {
+    return bridge->out_fd >= 0;
+}
+
+// The ring's free space (for filling) or its contents (for draining) as up
+// to two contiguous segments
+static int ring_free_iov(host_bridge_ring_t *ring, struct iovec iov[2]) {
+    size_t free_space = HOST_BRIDGE_BUFFER_SIZE - ring->count;
+    size_t tail = (ring->head + ring->count) % HOST_BRIDGE_BUFFER_SIZE;
+    size_t first = HOST_BRIDGE_BUFFER_SIZE - tail;
+    if (first > free_space) {
+        first = free_space;
+    }
+    iov[0] = (struct iovec){ .iov_base = ring->data + tail, .iov_len = first };
+    iov[1] = (struct iovec){ .iov_base = ring->data, .iov_len = free_space - first };
+    return iov[1].iov_len ? 2 : 1;
+}
+
+static int ring_used_iov(host_bridge_ring_t *ring, struct iovec iov[2]) {
+    size_t first = HOST_BRIDGE_BUFFER_SIZE - ring->head;
+    if (first > ring->count) {
+        first = ring->count;
+    }
+    iov[0] = (struct iovec){ .iov_base = ring->data + ring->head, .iov_len = first };
+    iov[1] = (struct iovec){ .iov_base = ring->data, .iov_len = ring->count - first };
+    return iov[1].iov_len ? 2 : 1;
+}
+
+static size_t ring_push(host_bridge_ring_t *ring, const uint8_t *data, size_t size) {
+    struct iovec iov[2];
+    int segments = ring_free_iov(ring, iov);
+    size_t done = 0;
+    for (int i = 0; i < segments && done < size; i++) {
+        size_t chunk = size - done < iov[i].iov_len ? size - done : iov[i].iov_len;
+        memcpy(iov[i].iov_base, data + done, chunk);
+        done += chunk;
+    }
+    ring->count += done;
+    return done;
+}
+
+static size_t ring_pop(host_bridge_ring_t *ring, uint8_t *data, size_t size) {
+    struct iovec iov[2];
+    int segments = ring_used_iov(ring, iov);
+    size_t done = 0;
+    for (int i = 0; i < segments && done < size; i++) {
+        size_t chunk = size - done < iov[i].iov_len ? size - done : iov[i].iov_len;
+        memcpy(data + done, iov[i].iov_base, chunk);
+        done += chunk;
+    }
+    ring->head = (ring->head + done) % HOST_BRIDGE_BUFFER_SIZE;
+    ring->count -= done;
+    return done;
+}
+
+static void ring_consume(host_bridge_ring_t *ring, size_t size) {
+    ring->head = (ring->head + size) % HOST_BRIDGE_BUFFER_SIZE;
+    ring->count -= size;
+}
+
+// The host went away.  A socket drops the client and listens again; a named
+// pipe keeps its output for the next reader.
+static void hang_up(host_bridge_t *bridge) {
+    if (bridge->kind == HOST_BRIDGE_FIFO) {
+        close(bridge->out_fd);
+        bridge->out_fd = -1;
+        return;
+    }
+    if (bridge->kind != HOST_BRIDGE_SOCKET) {
+        return;
+    }
+    close(bridge->fd);
+    bridge->fd = -1;
+    bridge->out_fd = -1;
+    bridge->tx_dropped += bridge->tx.count;
+    bridge->tx.count = 0;
+    bridge->tx.head = 0;
+}
+
+static void fill_rx(host_bridge_t *bridge) {
+    if (bridge->rx.count == HOST_BRIDGE_BUFFER_SIZE) {
+        return;
+    }
+    struct iovec iov[2];
+    int segments = ring_free_iov(&bridge->rx, iov);
+    ssize_t got = readv(bridge->fd, iov, segments);
+    bridge->read_calls++;
+    if (got > 0) {
+        bridge->rx.count += (size_t)got;
+    } else if (bridge->kind != HOST_BRIDGE_FIFO &&
+               (got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))) {
+        hang_up(bridge);
+    }
+}
+
+// writev() to a pipe whose reader has gone, without taking the SIGPIPE
+static ssize_t pipe_writev(int fd, const struct iovec *iov, int count) {
+    sigset_t pipe_set, old_set, pending;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    sigpending(&pending);
+    bool already_pending = sigismember(&pending, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_set, &old_set);
+
+    ssize_t sent = writev(fd, iov, count);
+    int saved_errno = errno;
+    if (sent < 0 && errno == EPIPE && !already_pending) {
+        const struct timespec zero = { 0, 0 };
+        sigtimedwait(&pipe_set, NULL, &zero);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+    errno = saved_errno;
+    return sent;
+}
+
+static void flush_tx(host_bridge_t *bridge) {
+    if (bridge->tx.count == 0 || bridge->out_fd < 0) {
+        return;
+    }
+    struct iovec iov[2];
+    struct msghdr msg = { .msg_iov = iov };
+    msg.msg_iovlen = ring_used_iov(&bridge->tx, iov);
+    ssize_t sent;
+    if (bridge->kind == HOST_BRIDGE_SOCKET) {
+        // No SIGPIPE when the client has gone
+        sent = sendmsg(bridge->out_fd, &msg, MSG_NOSIGNAL);
+    } else if (bridge->kind == HOST_BRIDGE_FIFO) {
+        sent = pipe_writev(bridge->out_fd, iov, (int)msg.msg_iovlen);
+    } else {
+        sent = writev(bridge->out_fd, iov, (int)msg.msg_iovlen);
+    }
+    bridge->write_calls++;
+    if (sent > 0) {
+        ring_consume(&bridge->tx, (size_t)sent);
+    } else if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        hang_up(bridge);
+    }
+}
+
+// Move FT245 transmit data into the ring, as much as the ring has room for
+static void drain_ft245(host_bridge_t *bridge) {
+    struct iovec iov[2];
+    int segments = ring_free_iov(&bridge->tx, iov);
+    for (int i = 0; i < segments; i++) {
+        size_t room = iov[i].iov_len < UINT16_MAX ? iov[i].iov_len : UINT16_MAX;
+        uint16_t got = ft245_usb_transmit_buffer(bridge->ft245, (uint8_t *)iov[i].iov_base, (uint16_t)room);
+        bridge->tx.count += got;
+        if (got < room) {
+            break;
+        }
+    }
+}
+
+// Offer received data to the FT245, as much as its FIFO has room for
+static void feed_ft245(host_bridge_t *bridge) {
+    struct iovec iov[2];
+    int segments = ring_used_iov(&bridge->rx, iov);
+    for (int i = 0; i < segments; i++) {
+        size_t length = iov[i].iov_len < UINT16_MAX ? iov[i].iov_len : UINT16_MAX;
+        uint16_t taken = ft245_usb_receive_buffer(bridge->ft245, (const uint8_t *)iov[i].iov_base, (uint16_t)length);
+        ring_consume(&bridge->rx, taken);
+        if (taken < length) {
+            break;
+        }
+    }
+}
+
+void host_bridge_poll(host_bridge_t *bridge) {
+    if (bridge->fd < 0 && bridge->listen_fd >= 0) {
+        bridge->fd = accept4(bridge->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        bridge->out_fd = bridge->fd;
+    }
+    if (bridge->out_fd < 0 && bridge->kind == HOST_BRIDGE_FIFO) {
+        // Fails with ENXIO until the host opens the pipe for reading
+        bridge->out_fd = open(bridge->out_path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    }
+
+    if (bridge->fd >= 0) {
+        fill_rx(bridge);
+    }
+    if (bridge->ft245) {
+        feed_ft245(bridge);
+        drain_ft245(bridge);
+    }
+    flush_tx(bridge);
+    if (bridge->ft245 && bridge->tx.count == 0) {
+        // The host kept up: take whatever the flush made room for
+        drain_ft245(bridge);
+        flush_tx(bridge);
+    }
+}
+
+size_t host_bridge_receive(host_bridge_t *bridge, uint8_t *data, size_t size) {
+    return ring_pop(&bridge->rx, data, size);
+}
+
+size_t host_bridge_transmit(host_bridge_t *bridge, const uint8_t *data, size_t size) {
+    // No socket client: the line is open, output goes nowhere
+    size_t done = 0;
+    bool open_line = bridge->kind == HOST_BRIDGE_SOCKET && bridge->fd < 0;
+    while (!open_line && done < size) {
+        done += ring_push(&bridge->tx, data + done, size - done);
+        if (done == size || (flush_tx(bridge), bridge->tx.count == HOST_BRIDGE_BUFFER_SIZE)) {
+            break;
+        }
+    }
+    bridge->tx_dropped += size - done;
+    return done;
+}
+
+// ACIA byte callbacks
+static void acia_tx_byte(void *context, uint8_t byte) {
+    host_bridge_transmit((host_bridge_t *)context, &byte, 1);
+}
+
+static uint8_t acia_rx_byte(void *context, bool *available) {
+    uint8_t byte = 0;
+    *available = host_bridge_receive((host_bridge_t *)context, &byte, 1) == 1;
+    return byte;
+}
+
+void host_bridge_attach_acia(host_bridge_t *bridge, acia6551_t *acia) {
+    acia6551_set_byte_callbacks(acia, acia_tx_byte, acia_rx_byte, bridge);
+}
+
+// FT245 bulk source: between polls the FT245 refills its FIFO straight from
+// the receive ring as the CPU reads
+static uint16_t ft245_rx_buffer(void *context, uint8_t *buffer, uint16_t max_length) {
+    return (uint16_t)host_bridge_receive((host_bridge_t *)context, buffer, max_length);
+}
+
+void host_bridge_attach_ft245(host_bridge_t *bridge, ft245_t *ft245) {
+    bridge->ft245 = ft245;
+    ft245_set_usb_callbacks(ft245, NULL, NULL, bridge);
+    ft245_set_usb_rx_buffer_callback(ft245, ft245_rx_buffer);
+}
+
+bool host_bridge_attached_acia(const acia6551_t *acia) {
+    return acia->tx_byte_callback == acia_tx_byte || acia->rx_byte_callback == acia_rx_byte;
+}
+
+bool host_bridge_attached_ft245(const ft245_t *ft245) {
+    return ft245->usb_rx_buffer_callback == ft245_rx_buffer;
+}
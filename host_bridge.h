@@ -0,0 +1,103 @@
+#ifndef __HOST_BRIDGE_H__
+#define __HOST_BRIDGE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "acia6551.h"
+#include "ft245.h"
+
+// Host bridge
+//
+// Connects an emulated serial or USB FIFO device to a host pseudo-terminal,
+// Unix domain socket or pair of named pipes.  The device side only touches
+// two in-memory rings; the host side is moved by host_bridge_poll(), which
+// the emulator's main loop calls once per tick: one nonblocking read() fills
+// the receive ring and one write() drains the transmit ring, however many
+// bytes went through in between.
+
+#define HOST_BRIDGE_BUFFER_SIZE 4096
+
+typedef enum host_bridge_kind_e {
+    HOST_BRIDGE_PTY,           // Pseudo-terminal; host programs open path
+    HOST_BRIDGE_SOCKET,        // Listening Unix socket at path, one client at a time
+    HOST_BRIDGE_FIFO,          // Named pipes: host writes path, reads out_path
+} host_bridge_kind_t;
+
+// Byte ring between the device and the host descriptor
+typedef struct host_bridge_ring_s {
+    uint8_t data[HOST_BRIDGE_BUFFER_SIZE];
+    size_t head;               // Next byte out
+    size_t count;
+} host_bridge_ring_t;
+
+typedef struct host_bridge_s {
+    host_bridge_kind_t kind;
+    int fd;                    // Read side: pty master, connected client or input pipe (-1 if none)
+    int out_fd;                // Write side: same as fd except for named pipes (-1 if none)
+    int listen_fd;             // Listening socket (-1 if not a socket)
+    int hold_fd;               // pty slave or input pipe writer, held open so reads never see a hangup
+    char path[108];            // pty device name, socket path or input pipe
+    char out_path[108];        // Output pipe (named pipes only)
+    host_bridge_ring_t rx;     // Host -> device
+    host_bridge_ring_t tx;     // Device -> host
+    uint64_t read_calls;       // read() syscalls made
+    uint64_t write_calls;      // write() syscalls made
+    uint64_t tx_dropped;       // Device output lost with no host attached or the ring full
+    ft245_t *ft245;            // Attached FT245, moved by host_bridge_poll() (NULL if none)
+} host_bridge_t;
+
+// Open a pseudo-terminal in raw mode.  Its slave name is host_bridge_path().
+// Returns: bridge, or NULL on failure
+host_bridge_t *host_bridge_open_pty(void);
+
+// Listen on a Unix stream socket at `path` (an existing socket file is
+// replaced).  The first client is accepted by host_bridge_poll(); when it
+// hangs up the bridge listens again.
+// Returns: bridge, or NULL on failure
+host_bridge_t *host_bridge_open_socket(const char *path);
+
+// Named pipes, created if missing: the host writes to `in_path` and reads
+// from `out_path`.  Output waits in the transmit ring until a reader opens
+// `out_path`.
+// Returns: bridge, or NULL on failure
+host_bridge_t *host_bridge_open_fifo(const char *in_path, const char *out_path);
+
+// Close every descriptor, remove the socket file and free the bridge
+void host_bridge_close(host_bridge_t *bridge);
+
+// pty slave name, socket path or input pipe
+const char *host_bridge_path(const host_bridge_t *bridge);
+
+// True when a host program is attached (always true for a pty; for named
+// pipes, when the output pipe has a reader)
+bool host_bridge_connected(const host_bridge_t *bridge);
+
+// Accept a pending client, read what the host has sent into the receive ring
+// and flush the transmit ring.  Never blocks.
+void host_bridge_poll(host_bridge_t *bridge);
+
+// Device-side access to the rings (no syscalls)
+size_t host_bridge_receive(host_bridge_t *bridge, uint8_t *data, size_t size);
+size_t host_bridge_transmit(host_bridge_t *bridge, const uint8_t *data, size_t size);
+
+// Wire the ACIA's byte callbacks to the bridge.  Pair with
+// acia6551_set_unthrottled() to run the console at host speed.
+//
+// The rings and the FT245 are moved by host_bridge_poll() on the caller's
+// thread with no locking, so a bridged machine can't run a device thread
+// (machine_start_device_thread() refuses).
+void host_bridge_attach_acia(host_bridge_t *bridge, acia6551_t *acia);
+
+// Connect the FT245's USB side to the bridge.  Data moves in blocks sized to
+// the free space on the other side, and nothing is dropped: a full FT245
+// receive FIFO leaves host data in the pipe or socket, so the host's writes
+// block, and host output that isn't read keeps TX FIFO bytes on the board,
+// so TXE# stays high and the CPU waits.
+void host_bridge_attach_ft245(host_bridge_t *bridge, ft245_t *ft245);
+
+// True when the device's callbacks lead to a host bridge
+bool host_bridge_attached_acia(const acia6551_t *acia);
+bool host_bridge_attached_ft245(const ft245_t *ft245);
+
+#endif // __HOST_BRIDGE_H__
@@ -11,6 +11,7 @@
 #include <ctype.h>
 #include "machine_setup.h"
 #include "processor_helpers.h"
+#include "memory_map.h"
 
 /*
  * Load simple address:bytes format
@@ -68,7 +69,7 @@ static int load_simple_hex_file(machine_state_t *machine, const char *filename)
             memory_region_t *region = find_current_memory_region(machine, address);
             if (region) {
                 unsigned int offset = address - region->start_offset;
-                region->data[offset] = (unsigned char)byte_val;
+                memory_map_poke(machine->memory_map, &region->data[offset], (unsigned char)byte_val);
                 total_bytes++;
             } else {
                 fprintf(stderr, "Warning: Address 0x%04X not in any memory region\n", address);
@@ -166,7 +167,7 @@ static int load_intel_hex_file(machine_state_t *machine, const char *filename) {
                     memory_region_t *region = find_current_memory_region(machine, full_address);
                     if (region) {
                         unsigned int offset = full_address - region->start_offset;
-                        region->data[offset] = (unsigned char)byte_val;
+                        memory_map_poke(machine->memory_map, &region->data[offset], (unsigned char)byte_val);
                         total_bytes++;
                     } else {
                         fprintf(stderr, "Warning: Address 0x%04X not in any memory region\n", full_address);
@@ -0,0 +1,398 @@
+#include "iolog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "machine_setup.h"
+
+#define IOLOG_HEADER_SIZE   13      // Magic, version, starting cycle
+#define IOLOG_PENDING_MAX   65536   // Host input queued ahead of the machine
+
+typedef struct iolog_buffer_s {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+} iolog_buffer_t;
+
+struct iolog_s {
+    gpio_shm_chip_t pins[GPIO_SHM_CHIPS];  // First, for the chips' alignment
+
+    bool replay;
+    iolog_buffer_t log;        // Encoded log
+    size_t position;           // Replay: offset of the next entry's type byte
+    uint64_t start;            // Cycle the log starts at
+    uint64_t last;             // Cycle of the previous entry (start before the first)
+    uint64_t next;             // Replay: cycle the next entry is due (UINT64_MAX: none)
+
+    // Recording: host input waiting for the next step, as type byte then
+    // one byte (IOLOG_ACIA/USB) or port A, port B and lines (IOLOG_VIA/PIA).
+    // Hosts add to `pending` under lock; the step swaps it with `taken`.
+    pthread_mutex_t lock;
+    iolog_buffer_t pending;
+    iolog_buffer_t taken;
+    _Atomic bool has_pending;
+
+    iolog_stats_t stats;
+};
+
+static int buffer_reserve(iolog_buffer_t *buffer, size_t extra) {
+    if (buffer->size + extra <= buffer->capacity) {
+        return 0;
+    }
+    size_t capacity = buffer->capacity ? buffer->capacity : 256;
+    while (capacity < buffer->size + extra) {
+        capacity *= 2;
+    }
+    uint8_t *data = (uint8_t *)realloc(buffer->data, capacity);
+    if (!data) {
+        return -1;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return 0;
+}
+
+static void put_varint(iolog_buffer_t *buffer, uint64_t value) {
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        buffer->data[buffer->size++] = byte | (value ? 0x80 : 0);
+    } while (value);
+}
+
+// Returns: false if the varint runs off the end or past 64 bits
+static bool get_varint(const uint8_t *data, size_t size, size_t *position, uint64_t *value) {
+    *value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (*position >= size) {
+            return false;
+        }
+        uint8_t byte = data[(*position)++];
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Little-endian fixed-width fields of the header
+static void put_le(uint8_t *data, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        data[i] = (value >> (i * 8)) & 0xFF;
+    }
+}
+
+static uint64_t get_le(const uint8_t *data, int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+static iolog_t *iolog_alloc(void) {
+    size_t size = (sizeof(iolog_t) + 63) & ~(size_t)63;
+    iolog_t *log = (iolog_t *)aligned_alloc(64, size);
+    if (!log) {
+        return NULL;
+    }
+    memset(log, 0, sizeof(iolog_t));
+    pthread_mutex_init(&log->lock, NULL);
+    atomic_init(&log->has_pending, false);
+    log->next = UINT64_MAX;
+    return log;
+}
+
+iolog_t *iolog_create(void) {
+    return iolog_alloc();
+}
+
+// Walk every entry of a loaded log
+// Returns: true if they are all well formed
+static bool validate(const iolog_buffer_t *log) {
+    size_t position = IOLOG_HEADER_SIZE;
+    while (position < log->size) {
+        uint64_t delta, count;
+        if (!get_varint(log->data, log->size, &position, &delta) || position >= log->size) {
+            return false;
+        }
+        uint8_t type = log->data[position++];
+        if (type == IOLOG_ACIA || type == IOLOG_USB) {
+            if (!get_varint(log->data, log->size, &position, &count) || count == 0 ||
+                count > log->size - position) {
+                return false;
+            }
+            position += count;
+        } else if (type == IOLOG_VIA || type == IOLOG_PIA) {
+            if (log->size - position < 3) {
+                return false;
+            }
+            position += 3;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+iolog_t *iolog_load(const char *filename) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot open I/O log '%s'\n", filename);
+        return NULL;
+    }
+    iolog_t *log = iolog_alloc();
+    if (!log) {
+        fclose(file);
+        return NULL;
+    }
+    uint8_t chunk[4096];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        if (buffer_reserve(&log->log, got) != 0) {
+            break;
+        }
+        memcpy(log->log.data + log->log.size, chunk, got);
+        log->log.size += got;
+    }
+    bool failed = ferror(file) || got > 0;
+    fclose(file);
+
+    const uint8_t *data = log->log.data;
+    if (failed || log->log.size < IOLOG_HEADER_SIZE ||
+        get_le(data, 4) != IOLOG_MAGIC || data[4] != IOLOG_VERSION ||
+        !validate(&log->log)) {
+        fprintf(stderr, "Error: '%s' is not a valid I/O log\n", filename);
+        iolog_free(log);
+        return NULL;
+    }
+    log->replay = true;
+    log->start = get_le(data + 5, 8);
+    log->stats.size = log->log.size;
+    return log;
+}
+
+int iolog_save(const iolog_t *log, const char *filename) {
+    FILE *file = fopen(filename, "wb");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot create I/O log '%s'\n", filename);
+        return -1;
+    }
+    bool ok = fwrite(log->log.data, 1, log->log.size, file) == log->log.size;
+    if (fclose(file) != 0 || !ok) {
+        fprintf(stderr, "Error: Cannot write I/O log '%s'\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+void iolog_free(iolog_t *log) {
+    if (!log) {
+        return;
+    }
+    pthread_mutex_destroy(&log->lock);
+    free(log->log.data);
+    free(log->pending.data);
+    free(log->taken.data);
+    free(log);
+}
+
+bool iolog_is_replay(const iolog_t *log) {
+    return log->replay;
+}
+
+bool iolog_replay_done(const iolog_t *log) {
+    return log->replay && log->position >= log->log.size;
+}
+
+gpio_shm_chip_t *iolog_pins(iolog_t *log, int chip) {
+    return chip >= 0 && chip < GPIO_SHM_CHIPS ? &log->pins[chip] : NULL;
+}
+
+// Replay: cycle the entry at log->position is due, from its delta
+static void read_next(iolog_t *log) {
+    uint64_t delta;
+    if (log->position < log->log.size &&
+        get_varint(log->log.data, log->log.size, &log->position, &delta)) {
+        log->next = log->last + delta;
+    } else {
+        log->position = log->log.size;
+        log->next = UINT64_MAX;
+    }
+}
+
+int iolog_begin(iolog_t *log, uint64_t start) {
+    if (log->replay) {
+        if (start != log->start) {
+            fprintf(stderr, "Error: I/O log starts at cycle %llu, machine is at %llu\n",
+                    (unsigned long long)log->start, (unsigned long long)start);
+            return -1;
+        }
+        log->position = IOLOG_HEADER_SIZE;
+        log->last = start;
+        memset(&log->stats, 0, sizeof(log->stats));
+        log->stats.size = log->log.size;
+        read_next(log);
+        return 0;
+    }
+
+    // Recording starts over
+    log->log.size = 0;
+    if (buffer_reserve(&log->log, IOLOG_HEADER_SIZE) != 0) {
+        return -1;
+    }
+    put_le(log->log.data, IOLOG_MAGIC, 4);
+    log->log.data[4] = IOLOG_VERSION;
+    put_le(log->log.data + 5, start, 8);
+    log->log.size = IOLOG_HEADER_SIZE;
+    log->start = start;
+    log->last = start;
+    memset(&log->stats, 0, sizeof(log->stats));
+    log->stats.size = log->log.size;
+    return 0;
+}
+
+// Host input for the next step
+// Returns: input records queued
+static size_t queue_input(iolog_t *log, uint8_t type, const uint8_t *data, size_t length,
+                          size_t record) {
+    if (log->replay) {
+        return 0;
+    }
+    pthread_mutex_lock(&log->lock);
+    size_t room = (IOLOG_PENDING_MAX - log->pending.size) / (1 + record);
+    size_t count = length / record < room ? length / record : room;
+    if (count > 0 && buffer_reserve(&log->pending, count * (1 + record)) == 0) {
+        for (size_t i = 0; i < count; i++) {
+            log->pending.data[log->pending.size++] = type;
+            memcpy(log->pending.data + log->pending.size, data + i * record, record);
+            log->pending.size += record;
+        }
+        atomic_store_explicit(&log->has_pending, true, memory_order_release);
+    } else {
+        count = 0;
+    }
+    pthread_mutex_unlock(&log->lock);
+    return count;
+}
+
+size_t iolog_send_acia(iolog_t *log, const uint8_t *data, size_t length) {
+    return queue_input(log, IOLOG_ACIA, data, length, 1);
+}
+
+size_t iolog_send_usb(iolog_t *log, const uint8_t *data, size_t length) {
+    return queue_input(log, IOLOG_USB, data, length, 1);
+}
+
+void iolog_set_pins(iolog_t *log, int chip, const gpio_shm_inputs_t *pins) {
+    uint8_t record[3] = { pins->port_a, pins->port_b, pins->lines };
+    queue_input(log, chip == GPIO_SHM_PIA ? IOLOG_PIA : IOLOG_VIA, record, sizeof(record), 3);
+}
+
+static void deliver(iolog_t *log, machine_state_t *machine, uint8_t type, const uint8_t *data,
+                    size_t length) {
+    if (type == IOLOG_ACIA || type == IOLOG_USB) {
+        for (size_t i = 0; i < length; i++) {
+            if (type == IOLOG_ACIA) {
+                machine_deliver_acia(machine, data[i]);
+            } else {
+                machine_deliver_usb(machine, data[i]);
+            }
+        }
+        log->stats.bytes += length;
+    } else {
+        gpio_shm_inputs_t pins = { .port_a = data[0], .port_b = data[1], .lines = data[2] };
+        machine_deliver_pins(machine, type == IOLOG_PIA ? GPIO_SHM_PIA : GPIO_SHM_VIA, &pins);
+        log->stats.pin_changes++;
+    }
+    log->stats.entries++;
+}
+
+// Recording: one entry for `length` bytes of `type` (or a pin change), then
+// the delivery.  Input the log has no room for isn't delivered either, so
+// the log stays a faithful record of what the guest saw.
+static void record(iolog_t *log, machine_state_t *machine, uint64_t now, uint8_t type,
+                   const uint8_t *data, size_t length) {
+    if (buffer_reserve(&log->log, 10 + 1 + 10 + length) != 0) {
+        log->stats.dropped += type == IOLOG_ACIA || type == IOLOG_USB ? length : 1;
+        return;
+    }
+    put_varint(&log->log, now - log->last);
+    log->log.data[log->log.size++] = type;
+    if (type == IOLOG_ACIA || type == IOLOG_USB) {
+        put_varint(&log->log, length);
+    }
+    memcpy(log->log.data + log->log.size, data, length);
+    log->log.size += length;
+    log->last = now;
+    log->stats.last_cycle = now;
+    log->stats.size = log->log.size;
+    deliver(log, machine, type, data, length);
+}
+
+static void record_step(iolog_t *log, machine_state_t *machine, uint64_t now) {
+    if (!atomic_load_explicit(&log->has_pending, memory_order_acquire)) {
+        return;
+    }
+    pthread_mutex_lock(&log->lock);
+    iolog_buffer_t swap = log->taken;
+    log->taken = log->pending;
+    log->pending = swap;
+    log->pending.size = 0;
+    atomic_store_explicit(&log->has_pending, false, memory_order_relaxed);
+    pthread_mutex_unlock(&log->lock);
+
+    // Runs of bytes for one device go in as one entry
+    const uint8_t *input = log->taken.data;
+    size_t size = log->taken.size;
+    uint8_t run[256];
+    size_t position = 0;
+    while (position < size) {
+        uint8_t type = input[position];
+        if (type == IOLOG_VIA || type == IOLOG_PIA) {
+            record(log, machine, now, type, input + position + 1, 3);
+            position += 4;
+            continue;
+        }
+        size_t length = 0;
+        while (position < size && input[position] == type && length < sizeof(run)) {
+            run[length++] = input[position + 1];
+            position += 2;
+        }
+        record(log, machine, now, type, run, length);
+    }
+}
+
+static void replay_step(iolog_t *log, machine_state_t *machine, uint64_t now) {
+    const uint8_t *data = log->log.data;
+    while (log->next <= now) {
+        uint8_t type = data[log->position++];
+        uint64_t length = 3;
+        if (type == IOLOG_ACIA || type == IOLOG_USB) {
+            get_varint(data, log->log.size, &log->position, &length);
+        }
+        deliver(log, machine, type, data + log->position, (size_t)length);
+        log->position += (size_t)length;
+        log->last = log->next;
+        log->stats.last_cycle = log->next;
+        read_next(log);
+    }
+}
+
+void iolog_step(iolog_t *log, machine_state_t *machine, uint64_t now) {
+    if (log->replay) {
+        replay_step(log, machine, now);
+    } else {
+        record_step(log, machine, now);
+    }
+}
+
+uint64_t iolog_next_due(const iolog_t *log) {
+    return log->replay ? log->next : 0;
+}
+
+void iolog_get_stats(const iolog_t *log, iolog_stats_t *stats) {
+    *stats = log->stats;
+}
@@ -0,0 +1,96 @@
+#ifndef __IOLOG_H__
+#define __IOLOG_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "machine.h"
+#include "gpio_shm.h"
+
+// Host I/O record and replay
+//
+// Makes a run that depends on input timing reproducible.  A recorder sits
+// between the host and the machine: bytes for the ACIA and the FT245 and
+// pin changes for the VIA and PIA go to it instead of straight to the
+// devices, and it delivers them at the end of the next device clock step,
+// logging each with the machine cycle it went in at.  A replayer delivers
+// the logged inputs at the same steps of a run started from the same state,
+// with no host attached, so the run repeats exactly and can go flat out.
+//
+// While a log is attached the VIA's and PIA's GPIO mirror is the log's
+// (see via6522_attach_gpio()): their input pins and control lines are the
+// ones set through iolog_set_pins().
+//
+// The log is compact binary: a header with the starting cycle, then one
+// entry per delivery of
+//
+//   varint  cycles since the previous entry (or the start)
+//   u8      IOLOG_ACIA / IOLOG_USB: varint count, then the bytes
+//           IOLOG_VIA / IOLOG_PIA:  port A pins, port B pins, control lines
+//                                   (GPIO_SHM_CA1 ...)
+
+#define IOLOG_MAGIC    0x474C4F49  // "IOLG"
+#define IOLOG_VERSION  1
+
+// Entry types
+#define IOLOG_ACIA  0x01  // Bytes into the ACIA's receive FIFO
+#define IOLOG_USB   0x02  // Bytes from the USB host into the FT245
+#define IOLOG_VIA   0x03  // Standalone VIA pins
+#define IOLOG_PIA   0x04  // PIA pins
+
+typedef struct iolog_s iolog_t;
+
+typedef struct iolog_stats_s {
+    uint64_t entries;          // Deliveries logged, or replayed so far
+    uint64_t bytes;            // ACIA and USB bytes among them
+    uint64_t pin_changes;
+    uint64_t last_cycle;       // Cycle of the latest delivery
+    size_t size;               // Encoded log size, header included
+    uint64_t dropped;          // Recording: input bytes or pin changes lost, out of memory to log them
+} iolog_stats_t;
+
+// An empty log to record into
+// Returns: log, or NULL on failure
+iolog_t *iolog_create(void);
+
+// Read a recorded log to replay
+// Returns: log, or NULL on failure
+iolog_t *iolog_load(const char *filename);
+
+// Write a recording out.  Only once it is detached, or the machine's
+// devices are synced (machine_sync_devices()).
+// Returns: 0 on success, -1 on error
+int iolog_save(const iolog_t *log, const char *filename);
+
+void iolog_free(iolog_t *log);
+
+bool iolog_is_replay(const iolog_t *log);
+
+// Replay: every logged input delivered
+bool iolog_replay_done(const iolog_t *log);
+
+// Host side, from any thread.  Recording queues the input for the machine;
+// a replay ignores it, its input coming from the log.
+// Returns: bytes accepted
+size_t iolog_send_acia(iolog_t *log, const uint8_t *data, size_t length);
+size_t iolog_send_usb(iolog_t *log, const uint8_t *data, size_t length);
+void iolog_set_pins(iolog_t *log, int chip, const gpio_shm_inputs_t *pins);
+
+// Machine side, from machine_step_devices(): deliver what is due at `now`
+void iolog_step(iolog_t *log, machine_state_t *machine, uint64_t now);
+
+// Earliest cycle the log may deliver input, for the device thread's IRQ
+// lookahead: a replay's next entry (UINT64_MAX when done); a recording
+// takes host input at any step, so 0
+uint64_t iolog_next_due(const iolog_t *log);
+
+// Start recording or replaying at `start` (the machine's cycle count)
+// Returns: 0 on success, -1 if a replay doesn't start at `start`
+int iolog_begin(iolog_t *log, uint64_t start);
+
+// The log's pin mirror for GPIO_SHM_VIA or GPIO_SHM_PIA
+gpio_shm_chip_t *iolog_pins(iolog_t *log, int chip);
+
+void iolog_get_stats(const iolog_t *log, iolog_stats_t *stats);
+
+#endif // __IOLOG_H__
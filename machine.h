@@ -37,7 +37,8 @@ typedef enum mem_flags_e {
     MEM_READONLY = 0x01,
     MEM_READWRITE = 0x02,
     MEM_DEVICE = 0x04,
-    MEM_SPECIAL = 0x08
+    MEM_SPECIAL = 0x08,
+    MEM_MAPPED = 0x10       // data points into a host mapping owned elsewhere, never free()'d
 } mem_flags_t;
 
 typedef struct memory_region_s {
@@ -49,6 +50,7 @@ typedef struct memory_region_s {
     void (*write_byte)(struct memory_region_s*, uint16_t, uint8_t);
     uint16_t (*read_word)(struct memory_region_s*, uint16_t);
     void (*write_word)(struct memory_region_s*, uint16_t, uint16_t);
+    void *device;             // Device state for regions with their own callbacks (e.g. mappers)
     struct memory_region_s *next;
 } memory_region_t;
 
@@ -60,6 +62,22 @@ typedef struct memory_bank_s {
 // Forward declaration for callback
 typedef struct machine_state_s machine_state_t;
 
+// Host-side backing for the address space (see memory_map.h)
+typedef struct memory_map_s memory_map_t;
+
+// Pending device events (see scheduler.h)
+typedef struct scheduler_s scheduler_t;
+
+// Devices owned by a machine (see machine_setup.h)
+typedef struct machine_hardware_s machine_hardware_t;
+
+// Running totals kept by the run loop (read by the guest through perfctr.h)
+typedef struct machine_counters_s {
+    uint64_t instructions;            // Instructions retired
+    uint64_t irqs_taken;              // Hardware interrupts taken
+    uint64_t wai_cycles;              // Cycles spent waiting in WAI
+} machine_counters_t;
+
 // Hardware callback functions for processor to use
 typedef void (*hardware_clock_fn)(machine_state_t*, uint8_t cycles);
 typedef bool (*hardware_check_irq_fn)(machine_state_t*);
@@ -68,6 +86,13 @@ typedef void (*hardware_process_irq_fn)(machine_state_t*);
 typedef struct machine_state_s {
     processor_state_t processor;
     memory_bank_t *memory_banks[256]; // Array of memory banks
+    memory_map_t *memory_map;         // RAM reservation and host mappings behind the banks
+    uint64_t cycles;                  // CPU cycles clocked since power-on
+    machine_counters_t counters;      // Other totals since power-on
+    scheduler_t *scheduler;           // Next state change of each lazily clocked device
+    uint32_t irq_sources;             // Devices holding IRQ asserted (IRQ_SOURCE_* bits)
+    uint32_t irq_taken_sources;       // irq_sources when the last IRQ was taken (for debugging)
+    machine_hardware_t *hardware;     // ACIA, PIA, VIAs and FIFO of this machine
     
     // Callbacks for hardware interaction (set by machine_setup.c)
     hardware_clock_fn clock_hardware;
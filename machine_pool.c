@@ -0,0 +1,85 @@
+#include "machine_pool.h"
+#include "machine_setup.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+static int pool_park(machine_pool_t *pool, machine_state_t *machine) {
+    if (pool->idle_count == pool->idle_capacity) {
+        size_t capacity = pool->idle_capacity ? pool->idle_capacity * 2 : 8;
+        machine_state_t **idle = (machine_state_t **)realloc(pool->idle, capacity * sizeof(machine_state_t *));
+        if (!idle) {
+            return -1;
+        }
+        pool->idle = idle;
+        pool->idle_capacity = capacity;
+    }
+    pool->idle[pool->idle_count++] = machine;
+    return 0;
+}
+
+machine_pool_t *machine_pool_create(size_t count, machine_pool_setup_fn setup, void *context) {
+    machine_pool_t *pool = (machine_pool_t *)calloc(1, sizeof(machine_pool_t));
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->template = create_machine();
+    if (!pool->template) {
+        free(pool);
+        return NULL;
+    }
+    if (setup) {
+        setup(pool->template, context);
+    }
+
+    // Members inherit this sync point, so restoring the baseline on release
+    // only rewrites what the member dirtied
+    pool->baseline = machine_snapshot(pool->template);
+    if (!pool->baseline) {
+        machine_pool_destroy(pool);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        machine_state_t *machine = machine_clone(pool->template);
+        if (!machine || pool_park(pool, machine) != 0) {
+            fprintf(stderr, "Error: Failed to fill machine pool\n");
+            destroy_machine(machine);
+            machine_pool_destroy(pool);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+machine_state_t *machine_pool_acquire(machine_pool_t *pool) {
+    if (pool->idle_count > 0) {
+        return pool->idle[--pool->idle_count];
+    }
+    return machine_clone(pool->template);
+}
+
+void machine_pool_release(machine_pool_t *pool, machine_state_t *machine) {
+    if (!machine) {
+        return;
+    }
+    if (machine_restore(machine, pool->baseline) != 0 || pool_park(pool, machine) != 0) {
+        destroy_machine(machine);
+    }
+}
+
+void machine_pool_destroy(machine_pool_t *pool) {
+    if (!pool) {
+        return;
+    }
+    for (size_t i = 0; i < pool->idle_count; i++) {
+        destroy_machine(pool->idle[i]);
+    }
+    free(pool->idle);
+    machine_snapshot_free(pool->baseline);
+    if (pool->template) {
+        destroy_machine(pool->template);
+    }
+    free(pool);
+}
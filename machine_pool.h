@@ -0,0 +1,45 @@
+#ifndef __MACHINE_POOL_H__
+#define __MACHINE_POOL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "machine.h"
+#include "snapshot.h"
+
+// Pool of ready-to-run machines
+//
+// A pool sets up one template machine (default layout plus whatever the setup
+// callback adds: RAM banks, ROM, mappers, a loaded program) and snapshots it.
+// Members are clones of the template, so they share its pages until written.
+// Releasing a member restores the template snapshot, which only rewrites the
+// pages the member dirtied, and parks it for the next acquire; nothing is
+// freed or rebuilt between runs.
+//
+// The bank layout is not part of the snapshot: code that installs regions on
+// a member should destroy it with destroy_machine() instead of releasing it.
+
+typedef void (*machine_pool_setup_fn)(machine_state_t *machine, void *context);
+
+typedef struct machine_pool_s {
+    machine_state_t *template;      // Machine every member is cloned from
+    machine_snapshot_t *baseline;   // Template state members go back to
+    machine_state_t **idle;         // Members ready to be handed out
+    size_t idle_count;
+    size_t idle_capacity;
+} machine_pool_t;
+
+// Create a pool holding `count` idle machines.  `setup` (optional) runs once
+// on the template before it is snapshotted.
+machine_pool_t *machine_pool_create(size_t count, machine_pool_setup_fn setup, void *context);
+
+// Take a machine in the template state; clones a new one if none are idle
+machine_state_t *machine_pool_acquire(machine_pool_t *pool);
+
+// Return a machine taken from the pool
+void machine_pool_release(machine_pool_t *pool, machine_state_t *machine);
+
+// Free the pool and its idle machines.  Machines still acquired stay valid and
+// are freed with destroy_machine().
+void machine_pool_destroy(machine_pool_t *pool);
+
+#endif // __MACHINE_POOL_H__
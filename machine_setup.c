@@ -4,28 +4,267 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
 #include "via6522.h"
 #include "board_fifo.h"
 #include "pia6521.h"
 #include "acia6551.h"
+#include "dma.h"
+#include "blockdev.h"
+#include "perfctr.h"
 #include "ops.h"
 #include "state.h"
 #include "processor_helpers.h"
+#include "memory_map.h"
+#include "mapper.h"
+#include "scheduler.h"
+#include "device_thread.h"
+#include "gpio_shm.h"
+#include "iolog.h"
+#include "host_bridge.h"
+
+// Lazy clocking.  The ACIA and VIA are only clocked up to hw->clocked when
+// their next event is due or the CPU touches their registers; *_synced is the
+// cycle they were last clocked to (DEVICE_UNSYNCED: adopt the next machine
+// time seen).  A device handed out by get_*_instance() can be changed by the
+// host behind the scheduler's back, so from then on it is clocked eagerly on
+// every machine_clock_devices() call.
+#define DEVICE_UNSYNCED UINT64_MAX
+
+// IRQ line aggregation.  Each device's irq_callback sets or clears its
+// IRQ_SOURCE_* bit in machine->irq_sources, so checking for an interrupt is
+// a single load.
+static void set_irq_source(machine_state_t *machine, uint32_t source, bool state) {
+    if (state) {
+        machine->irq_sources |= source;
+    } else {
+        machine->irq_sources &= ~source;
+    }
+}
+
+static void acia_irq_changed(void *context, bool state) {
+    set_irq_source((machine_state_t *)context, IRQ_SOURCE_ACIA, state);
+}
+
+static void via_irq_changed(void *context, bool state) {
+    set_irq_source((machine_state_t *)context, IRQ_SOURCE_VIA, state);
+}
+
+static void board_fifo_irq_changed(void *context, bool state) {
+    set_irq_source((machine_state_t *)context, IRQ_SOURCE_BOARD_FIFO, state);
+}
+
+static void dma_irq_changed(void *context, bool state) {
+    set_irq_source((machine_state_t *)context, IRQ_SOURCE_DMA, state);
+}
+
+static void blockdev_irq_changed(void *context, bool state) {
+    set_irq_source((machine_state_t *)context, IRQ_SOURCE_BLOCKDEV, state);
+}
 
-// Global ACIA instance (at 0x7F80)
-static acia6551_t g_acia;
-static bool g_acia_initialized = false;
+// Re-read every IRQ line, after device state was replaced wholesale
+static void refresh_irq_sources(machine_state_t *machine) {
+    machine_hardware_t *hw = machine->hardware;
+    uint32_t sources = 0;
+    if (hw->acia_initialized && acia6551_get_irq(&hw->acia)) {
+        sources |= IRQ_SOURCE_ACIA;
+    }
+    if (hw->via_initialized && via6522_get_irq(&hw->via)) {
+        sources |= IRQ_SOURCE_VIA;
+    }
+    if (hw->board_fifo && via6522_get_irq(board_fifo_get_via(hw->board_fifo))) {
+        sources |= IRQ_SOURCE_BOARD_FIFO;
+    }
+    if (hw->dma_initialized && dma_get_irq(&hw->dma)) {
+        sources |= IRQ_SOURCE_DMA;
+    }
+    if (hw->blockdev_initialized && blockdev_get_irq(&hw->blockdev)) {
+        sources |= IRQ_SOURCE_BLOCKDEV;
+    }
+    machine->irq_sources = sources;
+}
 
-// Global PIA instance (at 0x7FA0)
-static pia6521_t g_pia;
-static bool g_pia_initialized = false;
+// Allocate the machine's peripherals.  Only the board FIFO exists from the
+// start; the others power on when first used.
+static machine_hardware_t *create_hardware(machine_state_t *machine) {
+    machine_hardware_t *hw = (machine_hardware_t *)calloc(1, sizeof(machine_hardware_t));
+    if (!hw) {
+        return NULL;
+    }
+    hw->acia_synced = DEVICE_UNSYNCED;
+    hw->via_synced = DEVICE_UNSYNCED;
+    hw->clocked = machine->cycles;
+    hw->board_fifo = init_board_fifo();
+    if (hw->board_fifo) {
+        via6522_set_irq_callback(board_fifo_get_via(hw->board_fifo), board_fifo_irq_changed, machine);
+    }
+    return hw;
+}
 
-// Global VIA instance (standalone at 0x7FC0)
-static via6522_t g_via;
-static bool g_via_initialized = false;
+static void destroy_hardware(machine_hardware_t *hw) {
+    if (!hw) {
+        return;
+    }
+    device_thread_destroy(hw->device_thread);
+    if (hw->acia_initialized) {
+        acia6551_free(&hw->acia);
+    }
+    if (hw->blockdev_initialized) {
+        blockdev_detach(&hw->blockdev);
+    }
+    free_board_fifo(hw->board_fifo);
+    free(hw);
+}
 
-// Global board FIFO instance (VIA+FT245 at 0x7FE0)
-static fifo_t *g_board_fifo = NULL;
+// Bring a device stamp up to the devices' time; returns the cycles to clock
+static uint64_t device_elapsed(machine_state_t *machine, uint64_t *synced) {
+    uint64_t now = machine->hardware->clocked;
+    uint64_t elapsed = *synced < now ? now - *synced : 0;
+    *synced = now;
+    return elapsed;
+}
+
+static void sync_acia(machine_state_t *machine) {
+    machine_hardware_t *hw = machine->hardware;
+    uint64_t elapsed = device_elapsed(machine, &hw->acia_synced);
+    while (elapsed > UINT32_MAX) {
+        acia6551_clock(&hw->acia, UINT32_MAX);
+        elapsed -= UINT32_MAX;
+    }
+    if (elapsed) {
+        acia6551_clock(&hw->acia, (uint32_t)elapsed);
+    }
+}
+
+static void sync_via(machine_state_t *machine) {
+    machine_hardware_t *hw = machine->hardware;
+    uint64_t elapsed = device_elapsed(machine, &hw->via_synced);
+    if (elapsed) {
+        via6522_clock_n(&hw->via, elapsed);
+    }
+}
+
+static void acia_event(machine_state_t *machine, void *context);
+static void via_event(machine_state_t *machine, void *context);
+
+// Each machine has its own scheduler, so events are keyed by callback alone
+static void schedule_acia(machine_state_t *machine) {
+    machine_hardware_t *hw = machine->hardware;
+    uint64_t next = acia6551_cycles_to_event(&hw->acia);
+    if (hw->acia_eager || next == 0) {
+        scheduler_cancel(machine->scheduler, acia_event, NULL);
+        return;
+    }
+    scheduler_schedule(machine->scheduler, hw->acia_synced + next, acia_event, NULL);
+}
+
+static void schedule_via(machine_state_t *machine) {
+    machine_hardware_t *hw = machine->hardware;
+    uint64_t next = via6522_cycles_to_irq(&hw->via);
+    if (hw->via_eager || next == 0) {
+        scheduler_cancel(machine->scheduler, via_event, NULL);
+        return;
+    }
+    scheduler_schedule(machine->scheduler, hw->via_synced + next, via_event, NULL);
+}
+
+static void acia_event(machine_state_t *machine, void *context) {
+    sync_acia(machine);
+    schedule_acia(machine);
+}
+
+static void via_event(machine_state_t *machine, void *context) {
+    sync_via(machine);
+    schedule_via(machine);
+}
+
+// Power a device on the first time it is used
+static void power_on_acia(machine_state_t *machine) {
+    machine_hardware_t *hw = machine->hardware;
+    if (!hw->acia_initialized) {
+        acia6551_init(&hw->acia);
+        acia6551_set_irq_callback(&hw->acia, acia_irq_changed, machine);
+        hw->acia_initialized = true;
+        hw->acia_synced = hw->clocked;
+    }
+}
+
+static void power_on_via(machine_state_t *machine) {
+    machine_hardware_t *hw = machine->hardware;
+    if (!hw->via_initialized) {
+        via6522_init(&hw->via);
+        via6522_set_irq_callback(&hw->via, via_irq_changed, machine);
+        hw->via_initialized = true;
+        hw->via_synced = hw->clocked;
+    }
+}
+
+static void power_on_pia(machine_state_t *machine) {
+    machine_hardware_t *hw = machine->hardware;
+    if (!hw->pia_initialized) {
+        pia6521_init(&hw->pia);
+        hw->pia_initialized = true;
+    }
+}
+
+static void power_on_dma(machine_state_t *machine) {
+    machine_hardware_t *hw = machine->hardware;
+    if (!hw->dma_initialized) {
+        dma_init(&hw->dma);
+        dma_set_irq_callback(&hw->dma, dma_irq_changed, machine);
+        hw->dma_initialized = true;
+    }
+}
+
+static void power_on_blockdev(machine_state_t *machine) {
+    machine_hardware_t *hw = machine->hardware;
+    if (!hw->blockdev_initialized) {
+        blockdev_init(&hw->blockdev);
+        blockdev_set_irq_callback(&hw->blockdev, blockdev_irq_changed, machine);
+        hw->blockdev_initialized = true;
+    }
+}
+
+static void power_on_perfctr(machine_state_t *machine) {
+    machine_hardware_t *hw = machine->hardware;
+    if (!hw->perfctr_initialized) {
+        perfctr_init(&hw->perfctr);
+        hw->perfctr_initialized = true;
+    }
+}
+
+static void dma_event(machine_state_t *machine, void *context) {
+    dma_complete(&machine->hardware->dma);
+}
+
+// The CPU is off the bus while the DMA controller moves the block.  The data
+// moves at once; the stolen cycles are then clocked through the other devices
+// so their events land in order, with the completion on the last one.
+static void run_dma(machine_state_t *machine) {
+    uint32_t cycles = dma_transfer(&machine->hardware->dma, machine);
+    if (cycles == 0) {
+        return;
+    }
+    scheduler_schedule(machine->scheduler, machine->cycles + cycles, dma_event, NULL);
+    while (cycles > 0) {
+        uint8_t chunk = cycles > UINT8_MAX ? UINT8_MAX : (uint8_t)cycles;
+        machine_clock_devices(machine, chunk);
+        cycles -= chunk;
+    }
+}
+
+// Device about to be accessed by the CPU: power it on or catch it up
+static acia6551_t *machine_acia(machine_state_t *machine) {
+    power_on_acia(machine);
+    sync_acia(machine);
+    return &machine->hardware->acia;
+}
+
+static via6522_t *machine_via(machine_state_t *machine) {
+    power_on_via(machine);
+    sync_via(machine);
+    return &machine->hardware->via;
+}
 
 void initialize_processor(processor_state_t *state) {
     state->A.full = 0;
@@ -104,43 +343,69 @@ void write_word_to_region_nodev(memory_region_t *memory, uint16_t address, uint1
 }
 
 uint8_t read_byte_from_region_dev(memory_region_t *region, uint16_t address) {
+    // Devices are mapped at 0x7F80-0x7FEF; a device thread must catch up first
+    if (address >= 0x7F80 && address <= 0x7FEF) {
+        machine_sync_devices((machine_state_t *)region->device);
+    }
+
     // ACIA is mapped at 0x7F80-0x7F83 (4 registers)
     if (address >= 0x7F80 && address <= 0x7F83) {
-        if (!g_acia_initialized) {
-            acia6551_init(&g_acia);
-            g_acia_initialized = true;
-        }
+        machine_state_t *machine = (machine_state_t *)region->device;
         uint8_t reg = address & 0x03;  // Get register offset (0-3)
-        return acia6551_read(&g_acia, reg);
+        uint8_t value = acia6551_read(machine_acia(machine), reg);
+        schedule_acia(machine);
+        return value;
+    }
+
+    // Block device is mapped at 0x7F90-0x7F9F (16 registers)
+    if (address >= 0x7F90 && address <= 0x7F9F) {
+        machine_state_t *machine = (machine_state_t *)region->device;
+        power_on_blockdev(machine);
+        uint8_t reg = address & 0x0F;  // Get register offset (0-15)
+        return blockdev_read(&machine->hardware->blockdev, reg);
     }
     
     // PIA is mapped at 0x7FA0-0x7FA3 (4 registers)
     if (address >= 0x7FA0 && address <= 0x7FA3) {
-        if (!g_pia_initialized) {
-            pia6521_init(&g_pia);
-            g_pia_initialized = true;
-        }
+        machine_state_t *machine = (machine_state_t *)region->device;
+        power_on_pia(machine);
         uint8_t reg = address & 0x03;  // Get register offset (0-3)
-        return pia6521_read(&g_pia, reg);
+        return pia6521_read(&machine->hardware->pia, reg);
+    }
+
+    // Performance counters are mapped at 0x7FB0-0x7FBF (16 registers)
+    if (address >= 0x7FB0 && address <= 0x7FBF) {
+        machine_state_t *machine = (machine_state_t *)region->device;
+        power_on_perfctr(machine);
+        uint8_t reg = address & 0x0F;  // Get register offset (0-15)
+        return perfctr_read(&machine->hardware->perfctr, reg);
     }
     
     // Standalone VIA is mapped at 0x7FC0-0x7FCF (16 registers)
     if (address >= 0x7FC0 && address <= 0x7FCF) {
-        if (!g_via_initialized) {
-            via6522_init(&g_via);
-            g_via_initialized = true;
-        }
+        machine_state_t *machine = (machine_state_t *)region->device;
         uint8_t reg = address & 0x0F;  // Get register offset (0-15)
-        return via6522_read(&g_via, reg);
+        uint8_t value = via6522_read(machine_via(machine), reg);
+        schedule_via(machine);
+        return value;
+    }
+
+    // DMA controller is mapped at 0x7FD0-0x7FDF (16 registers)
+    if (address >= 0x7FD0 && address <= 0x7FDF) {
+        machine_state_t *machine = (machine_state_t *)region->device;
+        power_on_dma(machine);
+        uint8_t reg = address & 0x0F;  // Get register offset (0-15)
+        return dma_read(&machine->hardware->dma, reg);
     }
     
     // Board FIFO (VIA+FT245) is mapped at 0x7FE0-0x7FEF (16 registers)
     if (address >= 0x7FE0 && address <= 0x7FEF) {
-        if (!g_board_fifo) {
+        machine_state_t *machine = (machine_state_t *)region->device;
+        if (!machine->hardware->board_fifo) {
             return 0xFF; // No device present
         }
         uint8_t reg = address & 0x0F;  // Get register offset (0-15)
-        return board_fifo_read_via(g_board_fifo, reg);
+        return board_fifo_read_via(machine->hardware->board_fifo, reg);
     }
     
     // Default for other devices
@@ -155,46 +420,77 @@ uint16_t read_word_from_region_dev(memory_region_t *region, uint16_t address) {
 }
 
 void write_byte_to_region_dev(memory_region_t *region, uint16_t address, uint8_t value) {
+    // Devices are mapped at 0x7F80-0x7FEF; a device thread must catch up first
+    if (address >= 0x7F80 && address <= 0x7FEF) {
+        machine_sync_devices((machine_state_t *)region->device);
+    }
+
     // ACIA is mapped at 0x7F80-0x7F83 (4 registers)
     if (address >= 0x7F80 && address <= 0x7F83) {
-        if (!g_acia_initialized) {
-            acia6551_init(&g_acia);
-            g_acia_initialized = true;
-        }
+        machine_state_t *machine = (machine_state_t *)region->device;
         uint8_t reg = address & 0x03;  // Get register offset (0-3)
-        acia6551_write(&g_acia, reg, value);
+        acia6551_write(machine_acia(machine), reg, value);
+        schedule_acia(machine);
+        return;
+    }
+
+    // Block device is mapped at 0x7F90-0x7F9F (16 registers)
+    if (address >= 0x7F90 && address <= 0x7F9F) {
+        machine_state_t *machine = (machine_state_t *)region->device;
+        power_on_blockdev(machine);
+        uint8_t reg = address & 0x0F;  // Get register offset (0-15)
+        if (blockdev_write(&machine->hardware->blockdev, reg, value)) {
+            blockdev_run_dma(&machine->hardware->blockdev, machine);
+        }
         return;
     }
     
     // PIA is mapped at 0x7FA0-0x7FA3 (4 registers)
     if (address >= 0x7FA0 && address <= 0x7FA3) {
-        if (!g_pia_initialized) {
-            pia6521_init(&g_pia);
-            g_pia_initialized = true;
-        }
+        machine_state_t *machine = (machine_state_t *)region->device;
+        power_on_pia(machine);
         uint8_t reg = address & 0x03;  // Get register offset (0-3)
-        pia6521_write(&g_pia, reg, value);
+        pia6521_write(&machine->hardware->pia, reg, value);
+        return;
+    }
+
+    // Performance counters are mapped at 0x7FB0-0x7FBF (16 registers)
+    if (address >= 0x7FB0 && address <= 0x7FBF) {
+        machine_state_t *machine = (machine_state_t *)region->device;
+        power_on_perfctr(machine);
+        uint8_t reg = address & 0x0F;  // Get register offset (0-15)
+        perfctr_write(&machine->hardware->perfctr, machine, reg, value);
         return;
     }
     
     // Standalone VIA is mapped at 0x7FC0-0x7FCF (16 registers)
     if (address >= 0x7FC0 && address <= 0x7FCF) {
-        if (!g_via_initialized) {
-            via6522_init(&g_via);
-            g_via_initialized = true;
-        }
+        machine_state_t *machine = (machine_state_t *)region->device;
         uint8_t reg = address & 0x0F;  // Get register offset (0-15)
-        via6522_write(&g_via, reg, value);
+        via6522_write(machine_via(machine), reg, value);
+        schedule_via(machine);
+        return;
+    }
+
+    // DMA controller is mapped at 0x7FD0-0x7FDF (16 registers)
+    if (address >= 0x7FD0 && address <= 0x7FDF) {
+        machine_state_t *machine = (machine_state_t *)region->device;
+        power_on_dma(machine);
+        uint8_t reg = address & 0x0F;  // Get register offset (0-15)
+        if (dma_write(&machine->hardware->dma, reg, value)) {
+            run_dma(machine);
+        }
         return;
     }
     
     // Board FIFO (VIA+FT245) is mapped at 0x7FE0-0x7FEF (16 registers)
     if (address >= 0x7FE0 && address <= 0x7FEF) {
-        if (!g_board_fifo) {
+        machine_state_t *machine = (machine_state_t *)region->device;
+        if (!machine->hardware->board_fifo) {
             return; // No device present
         }
         uint8_t reg = address & 0x0F;  // Get register offset (0-15)
-        board_fifo_write_via(g_board_fifo, reg, value);
+        board_fifo_write_via(machine->hardware->board_fifo, reg, value);
         return;
     }
     
@@ -207,7 +503,34 @@ void write_word_to_region_dev(memory_region_t *region, uint16_t address, uint16_
     write_byte_to_region_dev(region, address + 1, (value >> 8) & 0xFF);
 }
 
+// Free a bank and its regions.  Mapped regions borrow their data from the
+// machine's memory map, so only malloc'd backing is released here.
+void free_memory_bank(memory_bank_t *bank) {
+    if (!bank) {
+        return;
+    }
+    memory_region_t *region = bank->regions;
+    while (region) {
+        memory_region_t *next = region->next;
+        if (region->data && !(region->flags & MEM_MAPPED)) {
+            free(region->data);
+        }
+        free(region);
+        region = next;
+    }
+    free(bank);
+}
+
+static void free_memory_banks(machine_state_t *machine) {
+    for (int i = 0; i < 256; i++) {
+        free_memory_bank(machine->memory_banks[i]);
+        machine->memory_banks[i] = NULL;
+    }
+}
+
 void initialize_memory_regions(machine_state_t *machine) {
+    memory_map_t *map = machine->memory_map;
+
     for (int i = 0; i < 256; i++) {
         machine->memory_banks[i] = NULL; // Initialize memory banks to NULL
     }
@@ -221,14 +544,21 @@ void initialize_memory_regions(machine_state_t *machine) {
     memory_region_t *region1 = (memory_region_t*)malloc(sizeof(memory_region_t));
     memory_region_t *region2 = (memory_region_t*)malloc(sizeof(memory_region_t));
 
+    // Bank 0 RAM lives at the bottom of the RAM reservation like every other bank
     region0->start_offset = 0x0000;
     region0->end_offset = 0x7F7F;
-    region0->data = (uint8_t *)malloc(0x7F80 * sizeof(uint8_t));
+    if (map) {
+        region0->data = memory_map_bank(map, 0);
+        region0->flags = MEM_READWRITE | MEM_MAPPED;
+    } else {
+        region0->data = (uint8_t *)malloc(0x7F80 * sizeof(uint8_t));
+        region0->flags = MEM_READWRITE;
+    }
     region0->read_byte = read_byte_from_region_nodev;
-    region0->write_byte = write_byte_to_region_nodev;
+    region0->write_byte = map ? write_byte_to_region_ram : write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
-    region0->write_word = write_word_to_region_nodev;
-    region0->flags = MEM_READWRITE;
+    region0->write_word = map ? write_word_to_region_ram : write_word_to_region_nodev;
+    region0->device = map;
 
     // Region: ACIA at 0x7F80-0x7F83 (4 bytes)
     memory_region_t *region_acia = (memory_region_t*)malloc(sizeof(memory_region_t));
@@ -240,17 +570,31 @@ void initialize_memory_regions(machine_state_t *machine) {
     region_acia->read_word = read_word_from_region_dev;
     region_acia->write_word = write_word_to_region_dev;
     region_acia->flags = MEM_DEVICE;
+    region_acia->device = machine;
 
-    // Region: Gap between ACIA and PIA (0x7F84-0x7F9F)
+    // Region: Gap between ACIA and block device (0x7F84-0x7F8F)
     memory_region_t *region_gap_acia_pia = (memory_region_t*)malloc(sizeof(memory_region_t));
     region_gap_acia_pia->start_offset = 0x7F84;
-    region_gap_acia_pia->end_offset = 0x7F9F;
+    region_gap_acia_pia->end_offset = 0x7F8F;
     region_gap_acia_pia->data = NULL;
     region_gap_acia_pia->read_byte = read_byte_from_region_dev;
     region_gap_acia_pia->write_byte = write_byte_to_region_dev;
     region_gap_acia_pia->read_word = read_word_from_region_dev;
     region_gap_acia_pia->write_word = write_word_to_region_dev;
     region_gap_acia_pia->flags = MEM_DEVICE;
+    region_gap_acia_pia->device = machine;
+
+    // Region: Block device at 0x7F90-0x7F9F (16 bytes)
+    memory_region_t *region_blockdev = (memory_region_t*)malloc(sizeof(memory_region_t));
+    region_blockdev->start_offset = 0x7F90;
+    region_blockdev->end_offset = 0x7F9F;
+    region_blockdev->data = NULL; // No backing storage for devices
+    region_blockdev->read_byte = read_byte_from_region_dev;
+    region_blockdev->write_byte = write_byte_to_region_dev;
+    region_blockdev->read_word = read_word_from_region_dev;
+    region_blockdev->write_word = write_word_to_region_dev;
+    region_blockdev->flags = MEM_DEVICE;
+    region_blockdev->device = machine;
 
     // Region: PIA at 0x7FA0-0x7FA3 (4 bytes)
     memory_region_t *region_pia = (memory_region_t*)malloc(sizeof(memory_region_t));
@@ -262,17 +606,31 @@ void initialize_memory_regions(machine_state_t *machine) {
     region_pia->read_word = read_word_from_region_dev;
     region_pia->write_word = write_word_to_region_dev;
     region_pia->flags = MEM_DEVICE;
+    region_pia->device = machine;
 
-    // Region: Gap between PIA and VIA (0x7FA4-0x7FBF)
+    // Region: Gap between PIA and performance counters (0x7FA4-0x7FAF)
     memory_region_t *region_gap1 = (memory_region_t*)malloc(sizeof(memory_region_t));
     region_gap1->start_offset = 0x7FA4;
-    region_gap1->end_offset = 0x7FBF;
+    region_gap1->end_offset = 0x7FAF;
     region_gap1->data = NULL;
     region_gap1->read_byte = read_byte_from_region_dev;
     region_gap1->write_byte = write_byte_to_region_dev;
     region_gap1->read_word = read_word_from_region_dev;
     region_gap1->write_word = write_word_to_region_dev;
     region_gap1->flags = MEM_DEVICE;
+    region_gap1->device = machine;
+
+    // Region: Performance counters at 0x7FB0-0x7FBF (16 bytes)
+    memory_region_t *region_perfctr = (memory_region_t*)malloc(sizeof(memory_region_t));
+    region_perfctr->start_offset = 0x7FB0;
+    region_perfctr->end_offset = 0x7FBF;
+    region_perfctr->data = NULL; // No backing storage for devices
+    region_perfctr->read_byte = read_byte_from_region_dev;
+    region_perfctr->write_byte = write_byte_to_region_dev;
+    region_perfctr->read_word = read_word_from_region_dev;
+    region_perfctr->write_word = write_word_to_region_dev;
+    region_perfctr->flags = MEM_DEVICE;
+    region_perfctr->device = machine;
 
     // Region: Standalone VIA at 0x7FC0-0x7FCF (16 bytes)
     memory_region_t *region_via = (memory_region_t*)malloc(sizeof(memory_region_t));
@@ -284,17 +642,19 @@ void initialize_memory_regions(machine_state_t *machine) {
     region_via->read_word = read_word_from_region_dev;
     region_via->write_word = write_word_to_region_dev;
     region_via->flags = MEM_DEVICE;
-
-    // Region: Device gap 0x7FD0-0x7FDF
-    memory_region_t *region_gap = (memory_region_t*)malloc(sizeof(memory_region_t));
-    region_gap->start_offset = 0x7FD0;
-    region_gap->end_offset = 0x7FDF;
-    region_gap->data = NULL;
-    region_gap->read_byte = read_byte_from_region_dev;
-    region_gap->write_byte = write_byte_to_region_dev;
-    region_gap->read_word = read_word_from_region_dev;
-    region_gap->write_word = write_word_to_region_dev;
-    region_gap->flags = MEM_DEVICE;
+    region_via->device = machine;
+
+    // Region: DMA controller at 0x7FD0-0x7FDF (16 bytes)
+    memory_region_t *region_dma = (memory_region_t*)malloc(sizeof(memory_region_t));
+    region_dma->start_offset = 0x7FD0;
+    region_dma->end_offset = 0x7FDF;
+    region_dma->data = NULL;
+    region_dma->read_byte = read_byte_from_region_dev;
+    region_dma->write_byte = write_byte_to_region_dev;
+    region_dma->read_word = read_word_from_region_dev;
+    region_dma->write_word = write_word_to_region_dev;
+    region_dma->flags = MEM_DEVICE;
+    region_dma->device = machine;
 
     // Region: Board FIFO (VIA+FT245) at 0x7FE0-0x7FEF (16 bytes)
     memory_region_t *region_board_fifo = (memory_region_t*)malloc(sizeof(memory_region_t));
@@ -306,44 +666,77 @@ void initialize_memory_regions(machine_state_t *machine) {
     region_board_fifo->read_word = read_word_from_region_dev;
     region_board_fifo->write_word = write_word_to_region_dev;
     region_board_fifo->flags = MEM_DEVICE;
+    region_board_fifo->device = machine;
 
     region1->start_offset = 0x7FF0;
     region1->end_offset = 0x7FFF;
-    region1->data = (uint8_t *)malloc(16 * sizeof(uint8_t));
+    region1->data = (uint8_t *)calloc(16, sizeof(uint8_t));
     region1->read_byte = read_byte_from_region_dev;  // Default read/write functions can be set later
     region1->write_byte = write_byte_to_region_dev;
     region1->read_word = read_word_from_region_dev;
     region1->write_word = write_word_to_region_dev;
     region1->flags = MEM_DEVICE;
+    region1->device = machine;
 
     region2->start_offset = 0x8000;
     region2->end_offset = 0xFFFF;
-    region2->data = (uint8_t *)malloc(32768 * sizeof(uint8_t));
+    if (map) {
+        // The default ROM sits in bank 0's pages so clones share it and
+        // snapshots capture what the loaders put there
+        region2->data = memory_map_bank(map, 0) + 0x8000;
+        region2->flags = MEM_READONLY | MEM_MAPPED;
+    } else {
+        region2->data = (uint8_t *)calloc(32768, sizeof(uint8_t));
+        region2->flags = MEM_READONLY;
+    }
     region2->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region2->write_byte = write_byte_to_region_nodev;
     region2->read_word = read_word_from_region_nodev;
     region2->write_word = write_word_to_region_nodev;
-    region2->flags = MEM_READONLY;
+    region2->device = NULL;
     
     // Link all regions together
     region0->next = region_acia;
     region_acia->next = region_gap_acia_pia;
-    region_gap_acia_pia->next = region_pia;
+    region_gap_acia_pia->next = region_blockdev;
+    region_blockdev->next = region_pia;
     region_pia->next = region_gap1;
-    region_gap1->next = region_via;
-    region_via->next = region_gap;
-    region_gap->next = region_board_fifo;
+    region_gap1->next = region_perfctr;
+    region_perfctr->next = region_via;
+    region_via->next = region_dma;
+    region_dma->next = region_board_fifo;
     region_board_fifo->next = region1;
     region1->next = region2;
     region2->next = NULL;
     bank0->regions = region0;
+
+    // Re-create any RAM banks configured with machine_add_ram_banks()
+    if (map) {
+        for (int i = 1; i < 256; i++) {
+            if (memory_map_is_ram_bank(map, i)) {
+                machine->memory_banks[i] = memory_map_create_ram_bank(map, i);
+            }
+        }
+
+        // Mappers come back up showing their first page
+        for (mapper_t *mapper = map->mappers; mapper; mapper = mapper->next) {
+            mapper->current = 0;
+            mapper->latch = 0;
+            mapper_install(machine, mapper);
+        }
+    }
 }
 
 void initialize_machine(machine_state_t *machine) {
     initialize_processor(&machine->processor);
 
-    g_board_fifo = init_board_fifo();
-    
+    machine->cycles = 0;
+    memset(&machine->counters, 0, sizeof(machine->counters));
+    machine->irq_sources = 0;
+    machine->irq_taken_sources = 0;
+    machine->hardware = create_hardware(machine);
+    machine->scheduler = scheduler_create();
+    machine->memory_map = memory_map_create();
     initialize_memory_regions(machine);
     
     // Set up hardware callback functions for processor to use
@@ -355,8 +748,13 @@ void initialize_machine(machine_state_t *machine) {
 void initialize_machine_with_state(machine_state_t *machine, const initial_state_t *init) {
     initialize_processor_with_state(&machine->processor, init);
 
-    g_board_fifo = init_board_fifo();
-    
+    machine->cycles = 0;
+    memset(&machine->counters, 0, sizeof(machine->counters));
+    machine->irq_sources = 0;
+    machine->irq_taken_sources = 0;
+    machine->hardware = create_hardware(machine);
+    machine->scheduler = scheduler_create();
+    machine->memory_map = memory_map_create();
     initialize_memory_regions(machine);
     
     // Set up hardware callback functions for processor to use
@@ -367,49 +765,179 @@ void initialize_machine_with_state(machine_state_t *machine, const initial_state
 
 // Clock devices (call this in your main emulation loop)
 void machine_clock_devices(machine_state_t *machine, uint8_t cycles) {
+    machine->cycles += cycles;
+    if (machine->hardware->device_thread) {
+        device_thread_post(machine->hardware->device_thread, cycles);
+    } else {
+        machine_step_devices(machine, cycles);
+    }
+}
+
+void machine_step_devices(machine_state_t *machine, uint8_t cycles) {
+    machine_hardware_t *hw = machine->hardware;
+    hw->clocked += cycles;
+
     // Clock ACIA at 0x7F80
-    if (g_acia_initialized) {
-        acia6551_clock(&g_acia, cycles);
+    if (hw->acia_initialized && hw->acia_eager) {
+        sync_acia(machine);
     }
     
     // PIA at 0x7FA0 doesn't need clocking (no timers)
     
     // Clock standalone VIA at 0x7FC0
-    if (g_via_initialized) {
-        for (uint8_t i = 0; i < cycles; i++) {
-            via6522_clock(&g_via);
-        }
+    if (hw->via_initialized && hw->via_eager) {
+        sync_via(machine);
+    }
+
+    // Lazily clocked devices whose next state change is due
+    if (scheduler_next(machine->scheduler) <= hw->clocked) {
+        scheduler_run(machine->scheduler, machine, hw->clocked);
     }
     
     // Clock board FIFO (VIA+FT245) at 0x7FE0
-    if (g_board_fifo) {
-        for (uint8_t i = 0; i < cycles; i++) {
-            board_fifo_clock(g_board_fifo);
+    if (hw->board_fifo) {
+        board_fifo_clock_n(hw->board_fifo, cycles);
+    }
+
+    // Host input due by now goes in at the end of the step
+    if (hw->iolog) {
+        iolog_step(hw->iolog, machine, hw->clocked);
+    }
+}
+
+// Earliest cycle the ACIA, either VIA or a scheduled event (lazy devices,
+// DMA completion) could move an IRQ line.  Lines otherwise only move when
+// the CPU or host touches a device, which syncs with the device thread.
+uint64_t machine_devices_irq_horizon(machine_state_t *machine) {
+    machine_hardware_t *hw = machine->hardware;
+    uint64_t horizon = scheduler_next(machine->scheduler);
+    if (hw->acia_initialized && hw->acia_eager) {
+        uint64_t next = acia6551_cycles_to_event(&hw->acia);
+        if (next && hw->acia_synced + next < horizon) {
+            horizon = hw->acia_synced + next;
         }
     }
+    if (hw->via_initialized && hw->via_eager) {
+        uint64_t next = via6522_cycles_to_irq(&hw->via);
+        if (next && hw->via_synced + next < horizon) {
+            horizon = hw->via_synced + next;
+        }
+    }
+    if (hw->board_fifo) {
+        uint64_t next = via6522_cycles_to_irq(board_fifo_get_via(hw->board_fifo));
+        if (next && hw->clocked + next < horizon) {
+            horizon = hw->clocked + next;
+        }
+    }
+    if (hw->iolog && iolog_next_due(hw->iolog) < horizon) {
+        horizon = iolog_next_due(hw->iolog);
+    }
+    return horizon;
 }
 
-// Check if any hardware device has a pending interrupt
-bool machine_check_interrupts(machine_state_t *machine) {
-    bool interrupt_pending = false;
-    
-    // Check ACIA interrupt
-    if (g_acia_initialized && acia6551_get_irq(&g_acia)) {
-        interrupt_pending = true;
+// IRQ lines as of machine->cycles
+uint32_t machine_irq_sources(machine_state_t *machine) {
+    device_thread_t *thread = machine->hardware->device_thread;
+    return thread ? device_thread_irq_sources(thread) : machine->irq_sources;
+}
+
+int machine_start_device_thread(machine_state_t *machine) {
+    machine_hardware_t *hw = machine->hardware;
+    if (hw->device_thread) {
+        return 0;
     }
-    
-    // Check standalone VIA interrupt
-    if (g_via_initialized && via6522_get_irq(&g_via)) {
-        interrupt_pending = true;
+    if ((hw->acia_initialized && host_bridge_attached_acia(&hw->acia)) ||
+        (hw->board_fifo && host_bridge_attached_ft245(board_fifo_get_ft245(hw->board_fifo)))) {
+        fprintf(stderr, "Error: Device thread with a host bridge attached\n");
+        return -1;
     }
-    
-    // Check board FIFO interrupt (if it has interrupt support)
-    if (g_board_fifo) {
-        via6522_t *fifo_via = board_fifo_get_via(g_board_fifo);
-        if (fifo_via && via6522_get_irq(fifo_via)) {
-            interrupt_pending = true;
+    hw->device_thread = device_thread_create(machine);
+    return hw->device_thread ? 0 : -1;
+}
+
+void machine_stop_device_thread(machine_state_t *machine) {
+    machine_hardware_t *hw = machine->hardware;
+    device_thread_destroy(hw->device_thread);
+    hw->device_thread = NULL;
+}
+
+// Wait for the device thread, if any, to clock the devices up to
+// machine->cycles
+void machine_sync_devices(machine_state_t *machine) {
+    if (machine->hardware->device_thread) {
+        device_thread_sync(machine->hardware->device_thread);
+    }
+}
+
+int machine_attach_iolog(machine_state_t *machine, iolog_t *log) {
+    machine_hardware_t *hw = machine->hardware;
+    machine_sync_devices(machine);
+    if (iolog_begin(log, machine->cycles) != 0) {
+        return -1;
+    }
+    power_on_via(machine);
+    power_on_pia(machine);
+    sync_via(machine);
+    via6522_attach_gpio(&hw->via, iolog_pins(log, GPIO_SHM_VIA));
+    pia6521_attach_gpio(&hw->pia, iolog_pins(log, GPIO_SHM_PIA));
+    schedule_via(machine);
+    hw->iolog = log;
+    return 0;
+}
+
+void machine_detach_iolog(machine_state_t *machine) {
+    machine_hardware_t *hw = machine->hardware;
+    if (!hw->iolog) {
+        return;
+    }
+    machine_sync_devices(machine);
+    sync_via(machine);
+    via6522_attach_gpio(&hw->via, NULL);
+    pia6521_attach_gpio(&hw->pia, NULL);
+    schedule_via(machine);
+    hw->iolog = NULL;
+}
+
+// The byte lands in the receive FIFO and RDRF goes up straight away, as if
+// the ACIA had just finished receiving it
+void machine_deliver_acia(machine_state_t *machine, uint8_t data) {
+    machine_hardware_t *hw = machine->hardware;
+    power_on_acia(machine);
+    sync_acia(machine);
+    acia6551_receive_byte(&hw->acia, data);
+    acia6551_clock(&hw->acia, 0);
+    schedule_acia(machine);
+}
+
+void machine_deliver_usb(machine_state_t *machine, uint8_t data) {
+    if (machine->hardware->board_fifo) {
+        board_fifo_usb_send_to_cpu(machine->hardware->board_fifo, data);
+    }
+}
+
+// The VIA takes new pins at once, so a control line edge flags now; the PIA
+// takes them at its next access
+void machine_deliver_pins(machine_state_t *machine, int chip, const gpio_shm_inputs_t *pins) {
+    machine_hardware_t *hw = machine->hardware;
+    if (chip == GPIO_SHM_PIA) {
+        power_on_pia(machine);
+        if (hw->pia.gpio) {
+            gpio_shm_set_inputs(hw->pia.gpio, pins);
         }
+        return;
+    }
+    power_on_via(machine);
+    sync_via(machine);
+    if (hw->via.gpio) {
+        gpio_shm_set_inputs(hw->via.gpio, pins);
+        via6522_clock_n(&hw->via, 0);
     }
+    schedule_via(machine);
+}
+
+// Check if any hardware device has a pending interrupt
+bool machine_check_interrupts(machine_state_t *machine) {
+    bool interrupt_pending = machine_irq_sources(machine) != 0;
     
     // Update processor interrupt pending flag
     machine->processor.interrupt_pending = interrupt_pending;
@@ -417,6 +945,31 @@ bool machine_check_interrupts(machine_state_t *machine) {
     return interrupt_pending;
 }
 
+// Names of the IRQ_SOURCE_* bits set in `sources`, space separated
+const char *machine_irq_source_names(uint32_t sources, char *buffer, size_t size) {
+    static const struct {
+        uint32_t source;
+        const char *name;
+    } names[] = {
+        { IRQ_SOURCE_ACIA, "ACIA" },
+        { IRQ_SOURCE_VIA, "VIA" },
+        { IRQ_SOURCE_BOARD_FIFO, "BOARD_FIFO" },
+        { IRQ_SOURCE_DMA, "DMA" },
+        { IRQ_SOURCE_BLOCKDEV, "BLOCKDEV" },
+    };
+
+    size_t used = 0;
+    if (size > 0) {
+        buffer[0] = '\0';
+    }
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if ((sources & names[i].source) && used < size) {
+            used += snprintf(buffer + used, size - used, "%s%s", used ? " " : "", names[i].name);
+        }
+    }
+    return buffer;
+}
+
 // Process hardware interrupt (IRQ)
 // This is called after WAI or can be called at the start of each instruction
 void machine_process_interrupt(machine_state_t *machine) {
@@ -431,6 +984,8 @@ void machine_process_interrupt(machine_state_t *machine) {
     if (!machine_check_interrupts(machine)) {
         return;
     }
+    machine->irq_taken_sources = machine_irq_sources(machine);
+    machine->counters.irqs_taken++;
     
     // Save processor state to stack
     if (!state->emulation_mode) {
@@ -461,132 +1016,240 @@ void machine_process_interrupt(machine_state_t *machine) {
 
 // Cleanup
 void cleanup_machine_with_via(machine_state_t *machine) {
-    if (g_board_fifo) {
-        free_board_fifo(g_board_fifo);
-        g_board_fifo = NULL;
-    }
+    destroy_hardware(machine->hardware);
+    machine->hardware = NULL;
     
     // Free memory regions
-    if (machine->memory_banks[0]) {
-        memory_region_t *region = machine->memory_banks[0]->regions;
-        while (region) {
-            memory_region_t *next = region->next;
-            if (region->data) {
-                free(region->data);
-            }
-            free(region);
-            region = next;
-        }
-        free(machine->memory_banks[0]);
-        machine->memory_banks[0] = NULL;
-    }
+    free_memory_banks(machine);
+    memory_map_destroy(machine->memory_map);
+    machine->memory_map = NULL;
+    scheduler_destroy(machine->scheduler);
+    machine->scheduler = NULL;
 }
 
 // Example: USB side operations (for testing/debugging)
-void usb_send_byte_to_cpu(uint8_t data) {
-    if (g_board_fifo) {
-        board_fifo_usb_send_to_cpu(g_board_fifo, data);
+void usb_send_byte_to_cpu(machine_state_t *machine, uint8_t data) {
+    machine_sync_devices(machine);
+    if (machine->hardware->board_fifo) {
+        board_fifo_usb_send_to_cpu(machine->hardware->board_fifo, data);
     }
 }
 
-uint8_t usb_receive_byte_from_cpu(void) {
+uint8_t usb_receive_byte_from_cpu(machine_state_t *machine) {
     uint8_t data = 0;
-    if (g_board_fifo) {
-        board_fifo_usb_receive_from_cpu(g_board_fifo, &data);
+    machine_sync_devices(machine);
+    if (machine->hardware->board_fifo) {
+        board_fifo_usb_receive_from_cpu(machine->hardware->board_fifo, &data);
     }
     return data;
 }
 
 // Get standalone VIA instance for direct access (e.g., setting callbacks)
-via6522_t* get_via_instance(void) {
-    if (!g_via_initialized) {
-        via6522_init(&g_via);
-        g_via_initialized = true;
-    }
-    return &g_via;
+via6522_t* get_via_instance(machine_state_t *machine) {
+    machine_sync_devices(machine);
+    machine->hardware->via_eager = true;
+    scheduler_cancel(machine->scheduler, via_event, NULL);
+    return machine_via(machine);
 }
 
 // Get PIA instance for direct access (e.g., setting callbacks)
-pia6521_t* get_pia_instance(void) {
-    if (!g_pia_initialized) {
-        pia6521_init(&g_pia);
-        g_pia_initialized = true;
-    }
-    return &g_pia;
+pia6521_t* get_pia_instance(machine_state_t *machine) {
+    machine_sync_devices(machine);
+    power_on_pia(machine);
+    return &machine->hardware->pia;
 }
 
 // Get ACIA instance for direct access (e.g., setting callbacks)
-acia6551_t* get_acia_instance(void) {
-    if (!g_acia_initialized) {
-        acia6551_init(&g_acia);
-        g_acia_initialized = true;
+acia6551_t* get_acia_instance(machine_state_t *machine) {
+    machine_sync_devices(machine);
+    machine->hardware->acia_eager = true;
+    scheduler_cancel(machine->scheduler, acia_event, NULL);
+    return machine_acia(machine);
+}
+
+// Get DMA controller instance for direct access (e.g., reading its totals)
+dma_t* get_dma_instance(machine_state_t *machine) {
+    machine_sync_devices(machine);
+    power_on_dma(machine);
+    return &machine->hardware->dma;
+}
+
+// Get block device instance for direct access (e.g., attaching a disk image)
+blockdev_t* get_blockdev_instance(machine_state_t *machine) {
+    machine_sync_devices(machine);
+    power_on_blockdev(machine);
+    return &machine->hardware->blockdev;
+}
+
+// Get performance counters for direct access (e.g., setting the mark callback)
+perfctr_t* get_perfctr_instance(machine_state_t *machine) {
+    machine_sync_devices(machine);
+    power_on_perfctr(machine);
+    return &machine->hardware->perfctr;
+}
+
+// Capture device state.  Callbacks are host wiring rather than machine state,
+// so loading keeps whatever the live devices are currently connected to.
+void machine_save_devices(machine_state_t *machine, machine_devices_t *devices) {
+    machine_hardware_t *hw = machine->hardware;
+    machine_sync_devices(machine);
+    if (hw->acia_initialized) {
+        sync_acia(machine);
+    }
+    if (hw->via_initialized) {
+        sync_via(machine);
+    }
+
+    // Devices not touched yet are captured in their power-on state
+    devices->via = hw->via;
+    devices->pia = hw->pia;
+    if (!hw->via_initialized) {
+        via6522_init(&devices->via);
+    }
+    if (!hw->pia_initialized) {
+        pia6521_init(&devices->pia);
+    }
+    devices->dma = hw->dma;
+    if (!hw->dma_initialized) {
+        dma_init(&devices->dma);
+    }
+    devices->blockdev = hw->blockdev;
+    devices->blockdev.media = NULL;
+    if (!hw->blockdev_initialized) {
+        blockdev_init(&devices->blockdev);
+    }
+    devices->perfctr = hw->perfctr;
+    if (!hw->perfctr_initialized) {
+        perfctr_init(&devices->perfctr);
+    }
+
+    // The ACIA's FIFOs live on the heap, so the capture gets its own
+    if (!devices->acia.rx_ring.data) {
+        acia6551_init(&devices->acia);
+    } else if (!hw->acia_initialized) {
+        acia6551_reset(&devices->acia);
+    }
+    if (hw->acia_initialized) {
+        acia6551_copy_state(&devices->acia, &hw->acia);
+    }
+    devices->via_initialized = hw->via_initialized;
+    devices->pia_initialized = hw->pia_initialized;
+    devices->acia_initialized = hw->acia_initialized;
+    devices->dma_initialized = hw->dma_initialized;
+    devices->blockdev_initialized = hw->blockdev_initialized;
+    devices->perfctr_initialized = hw->perfctr_initialized;
+
+    if (hw->board_fifo) {
+        if (!devices->board_fifo) {
+            devices->board_fifo = init_board_fifo();
+        }
+        if (devices->board_fifo) {
+            board_fifo_copy_state(devices->board_fifo, hw->board_fifo);
+        }
     }
-    return &g_acia;
 }
 
-// Load a binary file into the ROM region (0x8000-0xFFFF)
+void machine_load_devices(machine_state_t *machine, const machine_devices_t *devices) {
+    machine_hardware_t *hw = machine->hardware;
+    machine_sync_devices(machine);
+    if (devices->via_initialized) {
+        power_on_via(machine);
+    }
+    if (devices->pia_initialized) {
+        power_on_pia(machine);
+    }
+    if (devices->acia_initialized) {
+        power_on_acia(machine);
+    }
+    if (devices->dma_initialized) {
+        power_on_dma(machine);
+    }
+    if (devices->blockdev_initialized) {
+        power_on_blockdev(machine);
+    }
+    if (devices->perfctr_initialized) {
+        power_on_perfctr(machine);
+    }
+    if (hw->via_initialized) {
+        via6522_copy_state(&hw->via, &devices->via);
+    }
+    if (hw->pia_initialized) {
+        pia6521_copy_state(&hw->pia, &devices->pia);
+    }
+    if (hw->acia_initialized) {
+        acia6551_copy_state(&hw->acia, &devices->acia);
+    }
+    if (hw->dma_initialized) {
+        dma_copy_state(&hw->dma, &devices->dma);
+    }
+    if (hw->blockdev_initialized) {
+        blockdev_copy_state(&hw->blockdev, &devices->blockdev);
+    }
+    if (hw->perfctr_initialized) {
+        perfctr_copy_state(&hw->perfctr, &devices->perfctr);
+    }
+
+    if (hw->board_fifo && devices->board_fifo) {
+        board_fifo_copy_state(hw->board_fifo, devices->board_fifo);
+    }
+    refresh_irq_sources(machine);
+
+    // The loaded state is current as of the machine's cycle count
+    hw->clocked = machine->cycles;
+    hw->acia_synced = machine->cycles;
+    hw->via_synced = machine->cycles;
+    schedule_acia(machine);
+    schedule_via(machine);
+}
+
+void machine_free_devices(machine_devices_t *devices) {
+    acia6551_free(&devices->acia);
+    free_board_fifo(devices->board_fifo);
+    devices->board_fifo = NULL;
+}
+
+// Map a binary ROM image into the address space.  The first 32KB lands at
+// 0x8000-0xFFFF in bank 0 and every further 32KB at 0x8000-0xFFFF of the next
+// bank, so images of any size are mapped without copying or truncation.
 // Returns: 0 on success, -1 on error
 int load_rom_from_file(machine_state_t *machine, const char *filename) {
-    FILE *fp = fopen(filename, "rb");
-    if (!fp) {
+    struct stat st;
+    if (stat(filename, &st) != 0) {
         fprintf(stderr, "Error: Cannot open ROM file '%s'\n", filename);
         return -1;
     }
-    
-    // Get file size
-    fseek(fp, 0, SEEK_END);
-    long file_size = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
-    
-    // ROM region is 0x8000-0xFFFF (32KB)
+
+    // ROM windows are 0x8000-0xFFFF (32KB) per bank
     const size_t rom_size = 32768;
-    
-    if (file_size > rom_size) {
-        fprintf(stderr, "Warning: ROM file '%s' is %ld bytes, truncating to %zu bytes\n",
-                filename, file_size, rom_size);
-        file_size = rom_size;
-    }
-    
-    // Find the ROM region (region2 at 0x8000-0xFFFF)
-    memory_bank_t *bank0 = machine->memory_banks[0];
-    if (!bank0) {
-        fprintf(stderr, "Error: Memory bank 0 not initialized\n");
-        fclose(fp);
+    size_t file_size = (size_t)st.st_size;
+    size_t banks = file_size > rom_size ? (file_size + rom_size - 1) / rom_size : 1;
+
+    if (banks > RAM_BANK_COUNT) {
+        fprintf(stderr, "Error: ROM file '%s' is %zu bytes, larger than the address space\n",
+                filename, file_size);
         return -1;
     }
-    
-    memory_region_t *rom_region = NULL;
-    memory_region_t *region = bank0->regions;
-    while (region) {
-        if (region->start_offset == 0x8000 && region->end_offset == 0xFFFF) {
-            rom_region = region;
-            break;
-        }
-        region = region->next;
+
+    rom_layout_t layout[RAM_BANK_COUNT];
+    for (size_t i = 0; i < banks; i++) {
+        layout[i].file_offset = (uint32_t)(i * rom_size);
+        layout[i].bank = (uint8_t)i;
+        layout[i].start = 0x8000;
+        layout[i].end = 0xFFFF;
     }
-    
-    if (!rom_region || !rom_region->data) {
-        fprintf(stderr, "Error: ROM region not found or not initialized\n");
-        fclose(fp);
+
+    if (machine_map_rom(machine, filename, layout, banks) != 0) {
         return -1;
     }
-    
-    // Clear ROM to 0xFF (typical unprogrammed ROM state)
-    memset(rom_region->data, 0xFF, rom_size);
-    
-    // Read file into ROM
-    size_t bytes_read = fread(rom_region->data, 1, file_size, fp);
-    fclose(fp);
-    
-    if (bytes_read != (size_t)file_size) {
-        fprintf(stderr, "Error: Failed to read complete ROM file (read %zu of %ld bytes)\n",
-                bytes_read, file_size);
-        return -1;
+
+    if (banks == 1) {
+        printf("Loaded %zu bytes from '%s' into ROM at 0x8000-0x%04X\n",
+               file_size, filename, file_size ? 0x8000 + (int)file_size - 1 : 0x8000);
+    } else {
+        printf("Loaded %zu bytes from '%s' into ROM at $00:8000-$%02zX:FFFF\n",
+               file_size, filename, banks - 1);
     }
-    
-    printf("Loaded %zu bytes from '%s' into ROM at 0x8000-0x%04X\n",
-           bytes_read, filename, 0x8000 + (int)bytes_read - 1);
-    
+
     return 0;
 }
 
@@ -654,7 +1317,7 @@ int load_hex_file(machine_state_t *machine, const char *filename) {
             
             if (region && region->data) {
                 // Write directly to region data (bypassing readonly check for loading)
-                region->data[addr16 - region->start_offset] = (uint8_t)byte_val;
+                memory_map_poke(machine->memory_map, &region->data[addr16 - region->start_offset], (uint8_t)byte_val);
                 bytes_on_line++;
                 address++;
             } else if (region) {
@@ -683,148 +1346,33 @@ int load_hex_file(machine_state_t *machine, const char *filename) {
 void reset_machine(machine_state_t *machine) {
     reset_processor(&machine->processor);
 
-    // free memory banks and regions
-    for (int i = 0; i < 256; i++) {
-        if (machine->memory_banks[i] != NULL) {
-            // Free memory regions in the bank
-            memory_region_t *region = machine->memory_banks[i]->regions;
-            while (region) {
-                memory_region_t *next = region->next;
-                if (region->data) {
-                    free(region->data);
-                }
-                free(region);
-                region = next;
-            }
-            free(machine->memory_banks[i]);
-        }
+    // free memory banks and regions, then rebuild the same layout over
+    // freshly zeroed RAM.  ROM and SRAM mappings only mapper pages still
+    // use are kept; the rest go with the regions (callers map them again).
+    free_memory_banks(machine);
+    if (machine->memory_map) {
+        memory_map_release_mappings(machine->memory_map);
+        memory_map_clear_ram(machine->memory_map);
     }
+    initialize_memory_regions(machine);
+}
 
-    // redefine banks here at some point in the future
-    /*
-     * what follows is all experimental design work for memory regions and banks
-     */
-    memory_bank_t *bank0 = machine->memory_banks[0];
-    memory_region_t *region0 = (memory_region_t*)malloc(sizeof(memory_region_t));
-    memory_region_t *region1 = (memory_region_t*)malloc(sizeof(memory_region_t));
-    memory_region_t *region2 = (memory_region_t*)malloc(sizeof(memory_region_t));
-
-    region0->start_offset = 0x0000;
-    region0->end_offset = 0x7F7F;
-    region0->data = (uint8_t *)malloc(0x7F80 * sizeof(uint8_t));
-    region0->read_byte = read_byte_from_region_nodev;
-    region0->write_byte = write_byte_to_region_nodev;
-    region0->read_word = read_word_from_region_nodev;
-    region0->write_word = write_word_to_region_nodev;
-    region0->flags = MEM_READWRITE;
-
-    // Region: ACIA at 0x7F80-0x7F83 (4 bytes)
-    memory_region_t *region_acia = (memory_region_t*)malloc(sizeof(memory_region_t));
-    region_acia->start_offset = 0x7F80;
-    region_acia->end_offset = 0x7F83;
-    region_acia->data = NULL; // No backing storage for devices
-    region_acia->read_byte = read_byte_from_region_dev;
-    region_acia->write_byte = write_byte_to_region_dev;
-    region_acia->read_word = read_word_from_region_dev;
-    region_acia->write_word = write_word_to_region_dev;
-    region_acia->flags = MEM_DEVICE;
-
-    // Region: Gap between ACIA and PIA (0x7F84-0x7F9F)
-    memory_region_t *region_gap_acia_pia = (memory_region_t*)malloc(sizeof(memory_region_t));
-    region_gap_acia_pia->start_offset = 0x7F84;
-    region_gap_acia_pia->end_offset = 0x7F9F;
-    region_gap_acia_pia->data = NULL;
-    region_gap_acia_pia->read_byte = read_byte_from_region_dev;
-    region_gap_acia_pia->write_byte = write_byte_to_region_dev;
-    region_gap_acia_pia->read_word = read_word_from_region_dev;
-    region_gap_acia_pia->write_word = write_word_to_region_dev;
-    region_gap_acia_pia->flags = MEM_DEVICE;
-
-    // Region: PIA at 0x7FA0-0x7FA3 (4 bytes)
-    memory_region_t *region_pia = (memory_region_t*)malloc(sizeof(memory_region_t));
-    region_pia->start_offset = 0x7FA0;
-    region_pia->end_offset = 0x7FA3;
-    region_pia->data = NULL; // No backing storage for devices
-    region_pia->read_byte = read_byte_from_region_dev;
-    region_pia->write_byte = write_byte_to_region_dev;
-    region_pia->read_word = read_word_from_region_dev;
-    region_pia->write_word = write_word_to_region_dev;
-    region_pia->flags = MEM_DEVICE;
-
-    // Region: Gap between PIA and VIA (0x7FA4-0x7FBF)
-    memory_region_t *region_gap1 = (memory_region_t*)malloc(sizeof(memory_region_t));
-    region_gap1->start_offset = 0x7FA4;
-    region_gap1->end_offset = 0x7FBF;
-    region_gap1->data = NULL;
-    region_gap1->read_byte = read_byte_from_region_dev;
-    region_gap1->write_byte = write_byte_to_region_dev;
-    region_gap1->read_word = read_word_from_region_dev;
-    region_gap1->write_word = write_word_to_region_dev;
-    region_gap1->flags = MEM_DEVICE;
-
-    // Region: Standalone VIA at 0x7FC0-0x7FCF (16 bytes)
-    memory_region_t *region_via = (memory_region_t*)malloc(sizeof(memory_region_t));
-    region_via->start_offset = 0x7FC0;
-    region_via->end_offset = 0x7FCF;
-    region_via->data = NULL; // No backing storage for devices
-    region_via->read_byte = read_byte_from_region_dev;
-    region_via->write_byte = write_byte_to_region_dev;
-    region_via->read_word = read_word_from_region_dev;
-    region_via->write_word = write_word_to_region_dev;
-    region_via->flags = MEM_DEVICE;
-
-    // Region: Device gap 0x7FD0-0x7FDF
-    memory_region_t *region_gap = (memory_region_t*)malloc(sizeof(memory_region_t));
-    region_gap->start_offset = 0x7FD0;
-    region_gap->end_offset = 0x7FDF;
-    region_gap->data = NULL;
-    region_gap->read_byte = read_byte_from_region_dev;
-    region_gap->write_byte = write_byte_to_region_dev;
-    region_gap->read_word = read_word_from_region_dev;
-    region_gap->write_word = write_word_to_region_dev;
-    region_gap->flags = MEM_DEVICE;
-
-    // Region: Board FIFO (VIA+FT245) at 0x7FE0-0x7FEF (16 bytes)
-    memory_region_t *region_board_fifo = (memory_region_t*)malloc(sizeof(memory_region_t));
-    region_board_fifo->start_offset = 0x7FE0;
-    region_board_fifo->end_offset = 0x7FEF;
-    region_board_fifo->data = NULL; // No backing storage for devices
-    region_board_fifo->read_byte = read_byte_from_region_dev;
-    region_board_fifo->write_byte = write_byte_to_region_dev;
-    region_board_fifo->read_word = read_word_from_region_dev;
-    region_board_fifo->write_word = write_word_to_region_dev;
-    region_board_fifo->flags = MEM_DEVICE;
-
-    region1->start_offset = 0x7FF0;
-    region1->end_offset = 0x7FFF;
-    region1->data = (uint8_t *)malloc(16 * sizeof(uint8_t));
-    region1->read_byte = read_byte_from_region_dev;  // Default read/write functions can be set later
-    region1->write_byte = write_byte_to_region_dev;
-    region1->read_word = read_word_from_region_dev;
-    region1->write_word = write_word_to_region_dev;
-    region1->flags = MEM_DEVICE;
+// Reset without rebuilding anything: banks, overlays and mappers stay
+// installed (mappers go back to their first page) and only the RAM pages
+// written since they were last cleared are zeroed
+void reset_machine_fast(machine_state_t *machine) {
+    memory_map_t *map = machine->memory_map;
+    if (!map) {
+        reset_machine(machine);
+        return;
+    }
 
-    region2->start_offset = 0x8000;
-    region2->end_offset = 0xFFFF;
-    region2->data = (uint8_t *)malloc(32768 * sizeof(uint8_t));
-    region2->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
-    region2->write_byte = write_byte_to_region_nodev;
-    region2->read_word = read_word_from_region_nodev;
-    region2->write_word = write_word_to_region_nodev;
-    region2->flags = MEM_READONLY;
-    
-    // Link all regions together
-    region0->next = region_acia;
-    region_acia->next = region_gap_acia_pia;
-    region_gap_acia_pia->next = region_pia;
-    region_pia->next = region_gap1;
-    region_gap1->next = region_via;
-    region_via->next = region_gap;
-    region_gap->next = region_board_fifo;
-    region_board_fifo->next = region1;
-    region1->next = region2;
-    region2->next = NULL;
-    bank0->regions = region0;
+    reset_processor(&machine->processor);
+    memory_map_clear_written(map);
+    for (mapper_t *mapper = map->mappers; mapper; mapper = mapper->next) {
+        mapper_select(mapper, 0);
+        mapper->latch = 0;
+    }
 }
 
 machine_state_t* create_machine() {
@@ -840,24 +1388,160 @@ machine_state_t* create_machine_with_state(const initial_state_t *init) {
 }
 
 void destroy_machine(machine_state_t *machine) {
-    for (int i = 0; i < 256; i++) {
-        if (machine->memory_banks[i] != NULL) {
-            // Free memory regions in the bank
-            memory_region_t *region = machine->memory_banks[i]->regions;
-            while (region) {
-                memory_region_t *next = region->next;
-                if (region->data) {
-                    free(region->data);
-                }
-                free(region);
-                region = next;
+    destroy_hardware(machine->hardware);
+    free_memory_banks(machine);
+    memory_map_destroy(machine->memory_map);
+    scheduler_destroy(machine->scheduler);
+    free(machine);
+}
+
+// Copy one region of `parent` for the clone `machine`, pointing everything
+// that lived in the parent's memory map at the clone's
+static memory_region_t *clone_region(machine_state_t *machine, const machine_state_t *parent,
+                                     const memory_region_t *region) {
+    memory_map_t *map = machine->memory_map;
+    memory_map_t *parent_map = parent->memory_map;
+    memory_region_t *copy = (memory_region_t *)malloc(sizeof(memory_region_t));
+    if (!copy) {
+        return NULL;
+    }
+    *copy = *region;
+    copy->next = NULL;
+
+    if (region->data) {
+        uint8_t *data = memory_map_translate(parent_map, map, region->data);
+        if (data == region->data && !(region->flags & MEM_MAPPED)) {
+            // Private heap backing gets a private copy
+            size_t size = (size_t)(region->end_offset - region->start_offset) + 1;
+            data = (uint8_t *)malloc(size);
+            if (!data) {
+                free(copy);
+                return NULL;
             }
-            if (machine->memory_banks[i] != NULL) {
-            //    free(machine->memory_banks[i]);
+            memcpy(data, region->data, size);
+        }
+        copy->data = data;
+    }
+
+    if (region->device == parent_map) {
+        copy->device = map;
+    } else if (region->device == parent) {
+        copy->device = machine;
+    }
+    mapper_t *parent_mapper = parent_map->mappers;
+    for (mapper_t *mapper = map->mappers; mapper && parent_mapper;
+         mapper = mapper->next, parent_mapper = parent_mapper->next) {
+        if (region == parent_mapper->window) {
+            mapper->window = copy;
+        } else if (region == parent_mapper->registers) {
+            mapper->registers = copy;
+            copy->device = mapper;
+        }
+    }
+    return copy;
+}
+
+// Give the clone its own copy of the parent's devices.  Host callbacks stay
+// with the parent; the clone's devices start out unwired and lazily clocked.
+static void clone_hardware(machine_state_t *machine, machine_state_t *parent) {
+    machine_hardware_t *hw = machine->hardware;
+    machine_hardware_t *parent_hw = parent->hardware;
+    if (parent_hw->acia_initialized) {
+        sync_acia(parent);
+        power_on_acia(machine);
+        acia6551_copy_state(&hw->acia, &parent_hw->acia);
+    }
+    if (parent_hw->via_initialized) {
+        sync_via(parent);
+        power_on_via(machine);
+        via6522_copy_state(&hw->via, &parent_hw->via);
+    }
+    if (parent_hw->pia_initialized) {
+        power_on_pia(machine);
+        pia6521_copy_state(&hw->pia, &parent_hw->pia);
+    }
+    if (parent_hw->dma_initialized) {
+        power_on_dma(machine);
+        dma_copy_state(&hw->dma, &parent_hw->dma);
+    }
+    if (parent_hw->blockdev_initialized) {
+        power_on_blockdev(machine);
+        blockdev_copy_state(&hw->blockdev, &parent_hw->blockdev);
+        blockdev_share(&hw->blockdev, &parent_hw->blockdev);
+    }
+    if (parent_hw->perfctr_initialized) {
+        power_on_perfctr(machine);
+        perfctr_copy_state(&hw->perfctr, &parent_hw->perfctr);
+    }
+    if (hw->board_fifo && parent_hw->board_fifo) {
+        board_fifo_copy_state(hw->board_fifo, parent_hw->board_fifo);
+    }
+    hw->acia_synced = machine->cycles;
+    hw->via_synced = machine->cycles;
+    refresh_irq_sources(machine);
+    schedule_acia(machine);
+    schedule_via(machine);
+}
+
+// Create a copy of `parent` whose memory starts out sharing every page with
+// it.  A page is only duplicated when either machine writes to it, so a clone
+// costs page-table work rather than copying, no matter how much RAM is mapped.
+machine_state_t *machine_clone(machine_state_t *parent) {
+    machine_sync_devices(parent);
+    if (!parent->memory_map) {
+        fprintf(stderr, "Error: Machine has no memory map\n");
+        return NULL;
+    }
+
+    machine_state_t *machine = (machine_state_t *)malloc(sizeof(machine_state_t));
+    if (!machine) {
+        return NULL;
+    }
+    *machine = *parent;
+    for (int i = 0; i < 256; i++) {
+        machine->memory_banks[i] = NULL;
+    }
+    machine->hardware = create_hardware(machine);
+    machine->scheduler = scheduler_clone(parent->scheduler);
+    machine->memory_map = memory_map_clone(parent->memory_map);
+    if (!machine->hardware || !machine->memory_map || !machine->scheduler) {
+        destroy_hardware(machine->hardware);
+        memory_map_destroy(machine->memory_map);
+        scheduler_destroy(machine->scheduler);
+        free(machine);
+        return NULL;
+    }
+    clone_hardware(machine, parent);
+    if (mapper_clone_all(machine->memory_map, parent->memory_map) != 0) {
+        destroy_machine(machine);
+        return NULL;
+    }
+
+    for (int i = 0; i < 256; i++) {
+        memory_bank_t *bank = parent->memory_banks[i];
+        if (!bank) {
+            continue;
+        }
+        memory_bank_t *copy = (memory_bank_t *)malloc(sizeof(memory_bank_t));
+        if (!copy) {
+            destroy_machine(machine);
+            return NULL;
+        }
+        *copy = *bank;
+        copy->regions = NULL;
+        machine->memory_banks[i] = copy;
+
+        memory_region_t **tail = &copy->regions;
+        for (memory_region_t *region = bank->regions; region; region = region->next) {
+            *tail = clone_region(machine, parent, region);
+            if (!*tail) {
+                destroy_machine(machine);
+                return NULL;
             }
+            tail = &(*tail)->next;
         }
     }
-    free(machine);
+    return machine;
 }
 
 // External opcode table from tbl.c
@@ -943,6 +1627,89 @@ static void format_operand(step_result_t *result, const opcode_t *op, uint32_t o
     }
 }
 
+// Fetch the operands of the instruction at pc.  Sizes that depend on the
+// M/X flags are resolved against the machine's processor.
+static uint8_t fetch_operands(machine_state_t *machine, uint16_t pc, const opcode_t *op,
+                              uint16_t *arg1, uint16_t *arg2, uint32_t *operand) {
+    uint8_t operand_size = op->psize;
+    if (op->munge != NULL) {
+        operand_size = op->munge(operand_size);
+    }
+    
+    // Fetch operands - must match what the instruction handler expects
+    *arg1 = 0;
+    *arg2 = 0;
+    *operand = 0;
+    if (operand_size == 1) {
+        *arg1 = read_byte_new(machine, pc + 1);
+        *operand = *arg1;
+    } else if (operand_size == 2) {
+        // Read as 16-bit word (low byte, high byte)
+        uint8_t low = read_byte_new(machine, pc + 1);
+        uint8_t high = read_byte_new(machine, pc + 2);
+        *arg1 = low | (high << 8);
+        *operand = *arg1;
+    } else if (operand_size == 3) {
+        // For 24-bit addressing: arg1 is 16-bit address, arg2 is bank
+        uint8_t low = read_byte_new(machine, pc + 1);
+        uint8_t high = read_byte_new(machine, pc + 2);
+        uint8_t bank = read_byte_new(machine, pc + 3);
+        *arg1 = low | (high << 8);
+        *arg2 = bank;
+        *operand = *arg1 | (bank << 16);
+    }
+    return operand_size;
+}
+
+// Run a fetched instruction and clock the devices by its cycles
+// Returns: cycles taken, not counting WAI's wait
+static uint32_t execute_decoded(machine_state_t *machine, uint8_t opcode, uint16_t pc,
+                                uint8_t instruction_size, uint16_t arg1, uint16_t arg2) {
+    const opcode_t *op = &opcodes[opcode];
+    
+    // Get base cycle count from opcode table
+    uint32_t cycles = op->cycles;
+    
+    // MVP or MVN - cycles depend on the block size, which A counts down to
+    // $FFFF as the instruction runs; take it (as the move does) beforehand
+    if (opcode == 0x44 || opcode == 0x54) {
+        uint16_t block_size = machine->processor.A.full + 1;
+        cycles += (uint32_t)block_size * 7; // Each byte transfer takes 7 cycles
+    }
+
+    // Update PC before execution (instruction might modify it)
+    machine->processor.PC += instruction_size;
+    
+    // Execute the instruction
+    if (op->op != NULL) {
+        machine = op->op(machine, arg1, arg2);
+    }
+
+    if (opcode == 0x80) { // BRA
+        // Add 1 cycle if branch is taken
+        int8_t offset = (int8_t)(arg1 & 0xFF);
+        uint16_t target_pc = machine->processor.PC + offset;
+        if ((offset < 0 && target_pc < pc) || (offset > 0 && target_pc > pc)) {
+            cycles += 1;
+        }
+    }
+
+    machine->counters.instructions++;
+    if (opcode == 0xCB) { // WAI
+        machine->counters.wai_cycles += machine->processor.wai_cycles;
+    }
+
+    // Clock hardware devices based on instruction cycles, a block move's
+    // in steps the devices take
+    uint32_t left = cycles;
+    do {
+        uint8_t chunk = left > UINT8_MAX ? UINT8_MAX : (uint8_t)left;
+        machine_clock_devices(machine, chunk);
+        left -= chunk;
+    } while (left > 0);
+    return cycles;
+}
+
 // Single-step execution with disassembly
 step_result_t* machine_step(machine_state_t *machine) {
     if (!machine) {
@@ -974,66 +1741,14 @@ step_result_t* machine_step(machine_state_t *machine) {
     result->mnemonic[sizeof(result->mnemonic) - 1] = '\0';
     
     // Calculate instruction size based on addressing mode and processor flags
-    uint8_t operand_size = op->psize;
-    if (op->munge != NULL) {
-        operand_size = op->munge(operand_size);
-    }
+    uint16_t arg1, arg2;
+    uint8_t operand_size = fetch_operands(machine, pc, op, &arg1, &arg2, &result->operand);
     result->instruction_size = 1 + operand_size; // opcode + operand bytes
     
-    // Fetch operands - must match what the instruction handler expects
-    uint16_t arg1 = 0, arg2 = 0;
-    if (operand_size == 1) {
-        arg1 = read_byte_new(machine, pc + 1);
-        result->operand = arg1;
-    } else if (operand_size == 2) {
-        // Read as 16-bit word (low byte, high byte)
-        uint8_t low = read_byte_new(machine, pc + 1);
-        uint8_t high = read_byte_new(machine, pc + 2);
-        arg1 = low | (high << 8);
-        result->operand = arg1;
-        //fprintf(stderr, "DEBUG: PC=$%04X, operand_size=2, low=$%02X, high=$%02X, arg1=$%04X\n", 
-        //        pc, low, high, arg1);
-    } else if (operand_size == 3) {
-        // For 24-bit addressing: arg1 is 16-bit address, arg2 is bank
-        uint8_t low = read_byte_new(machine, pc + 1);
-        uint8_t high = read_byte_new(machine, pc + 2);
-        uint8_t bank = read_byte_new(machine, pc + 3);
-        arg1 = low | (high << 8);
-        arg2 = bank;
-        result->operand = arg1 | (bank << 16);
-    }
-    
     // Format operand string
     format_operand(result, op, result->operand, operand_size);
     
-    // Get base cycle count from opcode table
-    result->cycles = op->cycles;
-    
-    // Update PC before execution (instruction might modify it)
-    machine->processor.PC += result->instruction_size;
-    
-    // Execute the instruction
-    if (op->op != NULL) {
-        machine = op->op(machine, arg1, arg2);
-    }
-    
-    if (result->opcode == 0x44 || result->opcode == 0x54) { 
-        // MVP or MVN - cycles depend on A register (block size)
-        uint16_t block_size = machine->processor.A.full + 1;
-        result->cycles += (block_size * 7); // Each byte transfer takes 7 cycles
-    }
-
-    if (result->opcode == 0x80) { // BRA
-        // Add 1 cycle if branch is taken
-        int8_t offset = (int8_t)(result->operand & 0xFF);
-        uint16_t target_pc = machine->processor.PC + offset;
-        if ((offset < 0 && target_pc < pc) || (offset > 0 && target_pc > pc)) {
-            result->cycles += 1;
-        }
-    }
-
-    // Clock hardware devices based on instruction cycles
-    machine_clock_devices(machine, result->cycles);
+    result->cycles = execute_decoded(machine, result->opcode, pc, result->instruction_size, arg1, arg2);
     
     // Check for special states
     if (result->opcode == 0xDB) { // STP
@@ -1049,6 +1764,27 @@ step_result_t* machine_step(machine_state_t *machine) {
     return result;
 }
 
+// Execute one instruction without disassembling it or allocating
+// Returns: cycles taken (including time waiting in WAI); *halted is set on STP
+uint32_t machine_execute_instruction(machine_state_t *machine, bool *halted) {
+    set_emulated_processor(&machine->processor);
+    
+    uint16_t pc = machine->processor.PC;
+    uint8_t opcode = read_byte_new(machine, pc);
+    uint16_t arg1, arg2;
+    uint32_t operand;
+    uint8_t operand_size = fetch_operands(machine, pc, &opcodes[opcode], &arg1, &arg2, &operand);
+    uint32_t cycles = execute_decoded(machine, opcode, pc, 1 + operand_size, arg1, arg2);
+    
+    if (opcode == 0xCB) { // WAI
+        cycles += machine->processor.wai_cycles;
+    }
+    if (halted) {
+        *halted = (opcode == 0xDB); // STP
+    }
+    return cycles;
+}
+
 void free_step_result(step_result_t *result) {
     if (result) {
         free(result);
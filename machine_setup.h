@@ -4,6 +4,12 @@
 #include "via6522.h"
 #include "pia6521.h"
 #include "acia6551.h"
+#include "board_fifo.h"
+#include "dma.h"
+#include "blockdev.h"
+#include "perfctr.h"
+#include "device_thread.h"
+#include "iolog.h"
 
 // Structure to hold single-step execution results
 typedef struct step_result_s {
@@ -18,6 +24,58 @@ typedef struct step_result_s {
     bool waiting;              // True if processor waiting (WAI instruction)
 } step_result_t;
 
+// IRQ sources, as bits in machine->irq_sources
+#define IRQ_SOURCE_ACIA       0x01  // ACIA at 0x7F80
+#define IRQ_SOURCE_VIA        0x02  // Standalone VIA at 0x7FC0
+#define IRQ_SOURCE_BOARD_FIFO 0x04  // Board FIFO VIA at 0x7FE0
+#define IRQ_SOURCE_DMA        0x08  // DMA controller at 0x7FD0
+#define IRQ_SOURCE_BLOCKDEV   0x10  // Block device at 0x7F90
+
+// Peripherals owned by one machine (machine->hardware).  The ACIA, PIA, VIA,
+// DMA controller, block device and performance counters power on when the
+// CPU first touches them; the board FIFO always exists.  With a device
+// thread the devices are clocked on it and trail the CPU (clocked <
+// machine->cycles) until machine_sync_devices().
+struct machine_hardware_s {
+    acia6551_t acia;           // ACIA at 0x7F80
+    blockdev_t blockdev;       // Block device at 0x7F90
+    pia6521_t pia;             // PIA at 0x7FA0
+    perfctr_t perfctr;         // Performance counters at 0x7FB0
+    via6522_t via;             // Standalone VIA at 0x7FC0
+    dma_t dma;                 // DMA controller at 0x7FD0
+    fifo_t *board_fifo;        // VIA+FT245 at 0x7FE0 (NULL if allocation failed)
+    bool acia_initialized;
+    bool pia_initialized;
+    bool via_initialized;
+    bool dma_initialized;
+    bool blockdev_initialized;
+    bool perfctr_initialized;
+    uint64_t acia_synced;      // Machine cycle the ACIA was last clocked to
+    uint64_t via_synced;       // Machine cycle the VIA was last clocked to
+    bool acia_eager;           // Handed to the host: clock every cycle
+    bool via_eager;
+    uint64_t clocked;          // Machine cycle the devices have been clocked to
+    device_thread_t *device_thread;  // Clocking the devices (NULL: the CPU's thread does)
+    iolog_t *iolog;            // Recording or replaying host input (NULL: neither)
+};
+
+// Device state captured by machine snapshots
+typedef struct machine_devices_s {
+    via6522_t via;
+    pia6521_t pia;
+    acia6551_t acia;
+    dma_t dma;
+    blockdev_t blockdev;       // Registers only; the disk image is not captured
+    perfctr_t perfctr;
+    fifo_t *board_fifo;        // Private copy of the board (NULL if there is none)
+    bool via_initialized;
+    bool pia_initialized;
+    bool acia_initialized;
+    bool dma_initialized;
+    bool blockdev_initialized;
+    bool perfctr_initialized;
+} machine_devices_t;
+
 // Structure for user-defined initial processor state
 typedef struct initial_state_s {
     uint16_t A;                // Accumulator (full 16-bit value)
@@ -39,18 +97,57 @@ void reset_processor(processor_state_t *state);
 void initialize_machine(machine_state_t *machine);
 void initialize_machine_with_state(machine_state_t *machine, const initial_state_t *init);
 void reset_machine(machine_state_t *machine);
+void reset_machine_fast(machine_state_t *machine);
 machine_state_t* create_machine();
 machine_state_t* create_machine_with_state(const initial_state_t *init);
 void destroy_machine(machine_state_t *machine);
+machine_state_t* machine_clone(machine_state_t *parent);
 void machine_clock_devices(machine_state_t *machine, uint8_t cycles);
 bool machine_check_interrupts(machine_state_t *machine);
+uint32_t machine_irq_sources(machine_state_t *machine);
+const char *machine_irq_source_names(uint32_t sources, char *buffer, size_t size);
 void machine_process_interrupt(machine_state_t *machine);
 void cleanup_machine_with_via(machine_state_t *machine);
-void usb_send_byte_to_cpu(uint8_t data);
-uint8_t usb_receive_byte_from_cpu(void);
-via6522_t* get_via_instance(void);
-pia6521_t* get_pia_instance(void);
-acia6551_t* get_acia_instance(void);
+void usb_send_byte_to_cpu(machine_state_t *machine, uint8_t data);
+uint8_t usb_receive_byte_from_cpu(machine_state_t *machine);
+via6522_t* get_via_instance(machine_state_t *machine);
+pia6521_t* get_pia_instance(machine_state_t *machine);
+acia6551_t* get_acia_instance(machine_state_t *machine);
+dma_t* get_dma_instance(machine_state_t *machine);
+blockdev_t* get_blockdev_instance(machine_state_t *machine);
+perfctr_t* get_perfctr_instance(machine_state_t *machine);
+void machine_save_devices(machine_state_t *machine, machine_devices_t *devices);
+void machine_load_devices(machine_state_t *machine, const machine_devices_t *devices);
+void machine_free_devices(machine_devices_t *devices);
+
+// Device thread (see device_thread.h).  While it runs, the host reaches the
+// devices only from the thread running the CPU, through the calls above or
+// after machine_sync_devices().  Refused while a host bridge is attached.
+// Returns: 0 on success, -1 on error
+int machine_start_device_thread(machine_state_t *machine);
+void machine_stop_device_thread(machine_state_t *machine);
+void machine_sync_devices(machine_state_t *machine);
+
+// The device thread's half of machine_clock_devices(): clock the devices
+// from hw->clocked by `cycles`
+void machine_step_devices(machine_state_t *machine, uint8_t cycles);
+
+// Earliest machine cycle at which a device could change its IRQ line with
+// no CPU access in between, UINT64_MAX if none will
+uint64_t machine_devices_irq_horizon(machine_state_t *machine);
+
+// Host input record and replay (see iolog.h).  Attaching starts the log at
+// the machine's current cycle and hands the VIA's and PIA's pins to it,
+// replacing any GPIO mirror they had; the caller keeps ownership of the log.
+// Returns: 0 on success, -1 if a replay was recorded from another cycle
+int machine_attach_iolog(machine_state_t *machine, iolog_t *log);
+void machine_detach_iolog(machine_state_t *machine);
+
+// Input from the log into the devices, at hw->clocked (iolog.c only)
+void machine_deliver_acia(machine_state_t *machine, uint8_t data);
+void machine_deliver_usb(machine_state_t *machine, uint8_t data);
+void machine_deliver_pins(machine_state_t *machine, int chip, const gpio_shm_inputs_t *pins);
+
 int load_rom_from_file(machine_state_t *machine, const char *filename);
 int load_hex_file(machine_state_t *machine, const char *filename);
 uint8_t read_byte_from_region_nodev(memory_region_t *region, uint16_t address);
@@ -61,9 +158,14 @@ uint8_t read_byte_from_region_dev(memory_region_t *region, uint16_t address);
 uint16_t read_word_from_region_dev(memory_region_t *region, uint16_t address);
 void write_byte_to_region_dev(memory_region_t *region, uint16_t address, uint8_t value);
 void write_word_to_region_dev(memory_region_t *region, uint16_t address, uint16_t value);
+void initialize_memory_regions(machine_state_t *machine);
+void free_memory_bank(memory_bank_t *bank);
 
 // Single-step execution with disassembly
 step_result_t* machine_step(machine_state_t *machine);
 void free_step_result(step_result_t *result);
 
+// Execute one instruction, no disassembly or allocation (for run loops)
+uint32_t machine_execute_instruction(machine_state_t *machine, bool *halted);
+
 #endif // __MACHINE_SETUP_H__
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include "mapper.h"
+#include "memory_map.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static uint8_t read_byte_from_mapper_registers(memory_region_t *region, uint16_t address) {
+    mapper_t *mapper = (mapper_t *)region->device;
+    if (mapper->read) {
+        return mapper->read(mapper, address - region->start_offset);
+    }
+    return 0xFF;
+}
+
+static void write_byte_to_mapper_registers(memory_region_t *region, uint16_t address, uint8_t value) {
+    mapper_t *mapper = (mapper_t *)region->device;
+    if (mapper->write) {
+        mapper->write(mapper, address - region->start_offset, value);
+    }
+}
+
+static uint16_t read_word_from_mapper_registers(memory_region_t *region, uint16_t address) {
+    uint8_t low = read_byte_from_mapper_registers(region, address);
+    uint8_t high = read_byte_from_mapper_registers(region, address + 1);
+    return (high << 8) | low;
+}
+
+static void write_word_to_mapper_registers(memory_region_t *region, uint16_t address, uint16_t value) {
+    write_byte_to_mapper_registers(region, address, value & 0xFF);
+    write_byte_to_mapper_registers(region, address + 1, (value >> 8) & 0xFF);
+}
+
+int mapper_install(machine_state_t *machine, mapper_t *mapper) {
+    mapper_config_t *config = &mapper->config;
+    mapper_page_t *page = &mapper->pages[mapper->current];
+
+    mapper->window = memory_map_install_region(machine, config->window_bank,
+                                               config->window_start, config->window_end,
+                                               page->data, page->flags | MEM_MAPPED);
+    mapper->registers = memory_map_install_region(machine, config->reg_bank, config->reg_address,
+                                                  config->reg_address + config->reg_count - 1,
+                                                  NULL, MEM_DEVICE);
+    if (!mapper->window || !mapper->registers) {
+        fprintf(stderr, "Error: Failed to install mapper regions\n");
+        return -1;
+    }
+
+    mapper->registers->read_byte = read_byte_from_mapper_registers;
+    mapper->registers->write_byte = write_byte_to_mapper_registers;
+    mapper->registers->read_word = read_word_from_mapper_registers;
+    mapper->registers->write_word = write_word_to_mapper_registers;
+    mapper->registers->device = mapper;
+
+    // Window writes are tracked like any other RAM in the reservation
+    mapper->window->write_byte = write_byte_to_region_ram;
+    mapper->window->write_word = write_word_to_region_ram;
+    mapper->window->device = machine->memory_map;
+    return 0;
+}
+
+mapper_t *mapper_create(machine_state_t *machine, const mapper_config_t *config,
+                        mapper_read_fn read, mapper_write_fn write) {
+    memory_map_t *map = machine->memory_map;
+    if (!map) {
+        fprintf(stderr, "Error: Machine has no memory map\n");
+        return NULL;
+    }
+    if (config->page_count == 0 || config->reg_count == 0 ||
+        config->window_end < config->window_start ||
+        (uint32_t)config->reg_address + config->reg_count > 0x10000) {
+        fprintf(stderr, "Error: Invalid mapper configuration\n");
+        return NULL;
+    }
+
+    size_t window_size = (size_t)(config->window_end - config->window_start) + 1;
+    mapper_t *mapper = (mapper_t *)calloc(1, sizeof(mapper_t));
+    if (!mapper) {
+        return NULL;
+    }
+    mapper->config = *config;
+    mapper->read = read;
+    mapper->write = write;
+    mapper->pages = (mapper_page_t *)calloc(config->page_count, sizeof(mapper_page_t));
+    if (!mapper->pages) {
+        free(mapper);
+        return NULL;
+    }
+
+    for (uint16_t i = 0; i < config->page_count; i++) {
+        mapper->pages[i].data = memory_map_alloc(map, window_size);
+        mapper->pages[i].flags = config->page_flags ? config->page_flags : MEM_READWRITE;
+        mapper->pages[i].owned = true;
+        if (!mapper->pages[i].data) {
+            mapper_destroy(mapper);
+            return NULL;
+        }
+    }
+
+    if (mapper_install(machine, mapper) != 0) {
+        mapper_destroy(mapper);
+        return NULL;
+    }
+
+    mapper->next = map->mappers;
+    map->mappers = mapper;
+    return mapper;
+}
+
+void mapper_select(mapper_t *mapper, uint16_t page) {
+    page %= mapper->config.page_count;
+    mapper->current = page;
+
+    // The window is looked up on every access, so this is all a switch takes;
+    // there are no decoded copies of the range to invalidate
+    mapper->window->data = mapper->pages[page].data;
+    mapper->window->flags = mapper->pages[page].flags | MEM_MAPPED;
+}
+
+uint8_t *mapper_page_data(mapper_t *mapper, uint16_t page) {
+    if (page >= mapper->config.page_count) {
+        return NULL;
+    }
+    return mapper->pages[page].data;
+}
+
+void mapper_set_page(mapper_t *mapper, uint16_t page, uint8_t *data, uint32_t flags) {
+    if (page >= mapper->config.page_count) {
+        return;
+    }
+    mapper->pages[page].data = data;
+    mapper->pages[page].flags = flags;
+    mapper->pages[page].owned = false;
+    if (page == mapper->current) {
+        mapper_select(mapper, page);
+    }
+}
+
+void mapper_destroy(mapper_t *mapper) {
+    if (!mapper) {
+        return;
+    }
+    // Owned pages live in the memory map's pool and go away with it
+    free(mapper->pages);
+    free(mapper);
+}
+
+int mapper_clone_all(memory_map_t *child, memory_map_t *parent) {
+    mapper_t **tail = &child->mappers;
+    for (mapper_t *mapper = parent->mappers; mapper; mapper = mapper->next) {
+        mapper_t *copy = (mapper_t *)malloc(sizeof(mapper_t));
+        if (!copy) {
+            return -1;
+        }
+        *copy = *mapper;
+        copy->next = NULL;
+        copy->window = NULL;
+        copy->registers = NULL;
+        copy->pages = (mapper_page_t *)malloc(mapper->config.page_count * sizeof(mapper_page_t));
+        if (!copy->pages) {
+            free(copy);
+            return -1;
+        }
+        // Pool pages move with the reservation, caller-owned pages are shared
+        for (uint16_t i = 0; i < mapper->config.page_count; i++) {
+            copy->pages[i] = mapper->pages[i];
+            copy->pages[i].data = memory_map_translate(parent, child, mapper->pages[i].data);
+        }
+        *tail = copy;
+        tail = &copy->next;
+    }
+    return 0;
+}
+
+static uint8_t latch_mapper_read(mapper_t *mapper, uint16_t offset) {
+    return mapper->latch;
+}
+
+static void latch_mapper_write(mapper_t *mapper, uint16_t offset, uint8_t value) {
+    mapper->latch = value;
+    mapper_select(mapper, value & mapper->config.latch_mask);
+}
+
+mapper_t *latch_mapper_create(machine_state_t *machine, const mapper_config_t *config) {
+    mapper_config_t latch_config = *config;
+    latch_config.reg_count = 1;
+    if (latch_config.latch_mask == 0) {
+        latch_config.latch_mask = 0xFF;
+    }
+    return mapper_create(machine, &latch_config, latch_mapper_read, latch_mapper_write);
+}
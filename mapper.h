@@ -0,0 +1,86 @@
+#ifndef __MAPPER_H__
+#define __MAPPER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "machine.h"
+
+// Bank-switching mappers
+//
+// A mapper owns a window of the address space and a set of pages that can be
+// shown through it.  Writes to the mapper's registers select which page the
+// window points at; switching is a single pointer update on the window region,
+// so no regions are freed or rebuilt.
+
+typedef struct mapper_s mapper_t;
+
+// Register access hooks (offset is relative to the first register)
+typedef uint8_t (*mapper_read_fn)(mapper_t *mapper, uint16_t offset);
+typedef void (*mapper_write_fn)(mapper_t *mapper, uint16_t offset, uint8_t value);
+
+// One selectable page of backing memory
+typedef struct mapper_page_s {
+    uint8_t *data;            // Window-sized backing buffer
+    uint32_t flags;           // MEM_READONLY or MEM_READWRITE
+    bool owned;               // Allocated by the mapper from the memory map's pool
+} mapper_page_t;
+
+typedef struct mapper_config_s {
+    uint8_t reg_bank;         // Bank holding the control register(s)
+    uint16_t reg_address;     // First control register
+    uint16_t reg_count;       // Number of control registers
+    uint8_t window_bank;      // Bank holding the switched window
+    uint16_t window_start;    // First address of the window
+    uint16_t window_end;      // Last address of the window (inclusive)
+    uint16_t page_count;      // Number of selectable pages
+    uint32_t page_flags;      // Default access for mapper-allocated pages
+    uint8_t latch_mask;       // Latch mapper: bits of the register that select the page
+} mapper_config_t;
+
+struct mapper_s {
+    mapper_config_t config;
+    mapper_page_t *pages;
+    uint16_t current;         // Page currently shown through the window
+    uint8_t latch;            // Last value written to the control register
+    memory_region_t *window;  // Window region (data swapped on page select)
+    memory_region_t *registers;
+
+    mapper_read_fn read;
+    mapper_write_fn write;
+    void *context;            // Implementation-specific state
+
+    struct mapper_s *next;    // Next mapper registered with the machine
+};
+
+// Create a mapper with `page_count` zeroed pages and install its regions.
+// The mapper is owned by the machine and freed with its memory map.
+mapper_t *mapper_create(machine_state_t *machine, const mapper_config_t *config,
+                        mapper_read_fn read, mapper_write_fn write);
+
+// Show `page` through the window (O(1))
+void mapper_select(mapper_t *mapper, uint16_t page);
+
+// Backing buffer of a page, e.g. to load it
+uint8_t *mapper_page_data(mapper_t *mapper, uint16_t page);
+
+// Point a page at caller-owned memory (e.g. a window of a mapped ROM image).
+// Caller-owned pages are not captured by snapshots.
+void mapper_set_page(mapper_t *mapper, uint16_t page, uint8_t *data, uint32_t flags);
+
+// Re-create the mapper's regions after the machine's banks were rebuilt
+int mapper_install(machine_state_t *machine, mapper_t *mapper);
+
+// Copy every mapper of `parent` onto `child` (a memory_map_clone() of it), in
+// order.  Window and register regions are attached when the banks are cloned;
+// `context` is shared with the original.
+// Returns: 0 on success, -1 on error
+int mapper_clone_all(memory_map_t *child, memory_map_t *parent);
+
+// Release the mapper's state (regions belong to the banks, pages to the pool)
+void mapper_destroy(mapper_t *mapper);
+
+// Reference implementation: a single write-only latch whose masked value
+// selects the page; reads return the last value written
+mapper_t *latch_mapper_create(machine_state_t *machine, const mapper_config_t *config);
+
+#endif // __MAPPER_H__
@@ -0,0 +1,789 @@
+#include "memory_map.h"
+#include "machine_setup.h"
+#include "mapper.h"
+#include "snapshot.h"
+#include "processor_helpers.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Map `pages` slots starting at `first` over host memory at `addr`
+static int map_slots(uint8_t *addr, page_slot_t first, size_t pages) {
+    void *mapped = mmap(addr, pages << MEMORY_PAGE_SHIFT, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_FIXED, page_pool_fd(), page_pool_offset(first));
+    return mapped == MAP_FAILED ? -1 : 0;
+}
+
+// Release the slots behind `count` pages, batching consecutive slots
+static void release_slots(const page_slot_t *slots, size_t count) {
+    size_t start = 0;
+    for (size_t i = 1; i <= count; i++) {
+        if (i == count || slots[i] != slots[i - 1] + 1) {
+            page_pool_release_run(slots[start], (uint32_t)(i - start));
+            start = i;
+        }
+    }
+}
+
+static memory_map_t *memory_map_alloc_struct(void) {
+    memory_map_t *map = (memory_map_t *)calloc(1, sizeof(memory_map_t));
+    if (!map) {
+        fprintf(stderr, "Failed to allocate memory map\n");
+        return NULL;
+    }
+
+    map->sync_pages = (snapshot_page_t **)calloc(MEMORY_PAGE_COUNT, sizeof(snapshot_page_t *));
+    map->slots = (page_slot_t *)malloc(MEMORY_PAGE_COUNT * sizeof(page_slot_t));
+    if (!map->sync_pages || !map->slots) {
+        fprintf(stderr, "Failed to allocate memory map\n");
+        free(map->sync_pages);
+        free(map->slots);
+        free(map);
+        return NULL;
+    }
+
+    // Hold the address range for the whole 24-bit space (plus the pool); the
+    // pages themselves are mapped over it from the page pool
+    void *ram = mmap(NULL, MEMORY_MAP_SIZE, PROT_NONE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (ram == MAP_FAILED) {
+        fprintf(stderr, "Failed to reserve %zu bytes for RAM\n", MEMORY_MAP_SIZE);
+        free(map->sync_pages);
+        free(map->slots);
+        free(map);
+        return NULL;
+    }
+    map->ram = (uint8_t *)ram;
+    return map;
+}
+
+memory_map_t *memory_map_create(void) {
+    memory_map_t *map = memory_map_alloc_struct();
+    if (!map) {
+        return NULL;
+    }
+
+    // One run of fresh slots; the pool file is sparse, so nothing becomes
+    // resident until first touch
+    page_slot_t first;
+    if (page_pool_alloc_run(MEMORY_PAGE_COUNT, &first) != 0 ||
+        map_slots(map->ram, first, MEMORY_PAGE_COUNT) != 0) {
+        fprintf(stderr, "Failed to map %zu bytes for RAM\n", MEMORY_MAP_SIZE);
+        munmap(map->ram, MEMORY_MAP_SIZE);
+        free(map->sync_pages);
+        free(map->slots);
+        free(map);
+        return NULL;
+    }
+    for (size_t page = 0; page < MEMORY_PAGE_COUNT; page++) {
+        map->slots[page] = first + (page_slot_t)page;
+    }
+    return map;
+}
+
+memory_map_t *memory_map_clone(memory_map_t *map) {
+    memory_map_t *clone = memory_map_alloc_struct();
+    if (!clone) {
+        return NULL;
+    }
+
+    // Map the parent's slots, one mmap per run of consecutive slots
+    size_t start = 0;
+    for (size_t page = 1; page <= MEMORY_PAGE_COUNT; page++) {
+        if (page == MEMORY_PAGE_COUNT || map->slots[page] != map->slots[page - 1] + 1) {
+            if (map_slots(clone->ram + (start << MEMORY_PAGE_SHIFT), map->slots[start], page - start) != 0) {
+                fprintf(stderr, "Failed to map cloned RAM\n");
+                munmap(clone->ram, MEMORY_MAP_SIZE);
+                free(clone->sync_pages);
+                free(clone->slots);
+                free(clone);
+                return NULL;
+            }
+            start = page;
+        }
+    }
+    for (size_t page = 0; page < MEMORY_PAGE_COUNT; page++) {
+        page_pool_ref(map->slots[page]);
+    }
+    memcpy(clone->slots, map->slots, MEMORY_PAGE_COUNT * sizeof(page_slot_t));
+
+    // Every page is now shared until someone writes it
+    memset(map->shared, 0xFF, sizeof(map->shared));
+    memset(clone->shared, 0xFF, sizeof(clone->shared));
+
+    memcpy(clone->ram_banks, map->ram_banks, sizeof(map->ram_banks));
+    clone->pool_used = map->pool_used;
+    memcpy(clone->written, map->written, sizeof(map->written));
+
+    // Same memory, so the same sync point and dirty pages apply
+    if (map->synced) {
+        for (size_t page = 0; page < MEMORY_PAGE_COUNT; page++) {
+            clone->sync_pages[page] = map->sync_pages[page];
+            if (clone->sync_pages[page]) {
+                __atomic_add_fetch(&clone->sync_pages[page]->refs, 1, __ATOMIC_RELAXED);
+            }
+        }
+        memcpy(clone->dirty, map->dirty, sizeof(map->dirty));
+        clone->synced = true;
+        clone->sync_serial = map->sync_serial;
+    }
+
+    if (map->mapping_count) {
+        clone->mappings = (host_mapping_t **)malloc(map->mapping_count * sizeof(host_mapping_t *));
+        if (!clone->mappings) {
+            memory_map_destroy(clone);
+            return NULL;
+        }
+        for (size_t i = 0; i < map->mapping_count; i++) {
+            clone->mappings[i] = map->mappings[i];
+            __atomic_add_fetch(&clone->mappings[i]->refs, 1, __ATOMIC_RELAXED);
+        }
+        clone->mapping_count = map->mapping_count;
+    }
+    return clone;
+}
+
+static void release_mapping(host_mapping_t *mapping) {
+    if (__atomic_sub_fetch(&mapping->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        munmap(mapping->addr, mapping->length);
+        free(mapping);
+    }
+}
+
+// Does a mapper page (which outlives the banks) point into the mapping?
+static bool mapping_in_use(const memory_map_t *map, const host_mapping_t *mapping) {
+    const uint8_t *start = (const uint8_t *)mapping->addr;
+    for (const mapper_t *mapper = map->mappers; mapper; mapper = mapper->next) {
+        for (uint16_t page = 0; page < mapper->config.page_count; page++) {
+            const uint8_t *data = mapper->pages[page].data;
+            if (data >= start && data < start + mapping->length) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void memory_map_release_mappings(memory_map_t *map) {
+    size_t kept = 0;
+    for (size_t i = 0; i < map->mapping_count; i++) {
+        host_mapping_t *mapping = map->mappings[i];
+        if (mapping_in_use(map, mapping)) {
+            map->mappings[kept++] = mapping;
+        } else {
+            release_mapping(mapping);
+        }
+    }
+    map->mapping_count = kept;
+}
+
+void memory_map_destroy(memory_map_t *map) {
+    if (!map) {
+        return;
+    }
+    if (map->ram) {
+        munmap(map->ram, MEMORY_MAP_SIZE);
+        release_slots(map->slots, MEMORY_PAGE_COUNT);
+    }
+    free(map->slots);
+    for (size_t page = 0; page < MEMORY_PAGE_COUNT; page++) {
+        snapshot_page_release(map->sync_pages[page]);
+    }
+    free(map->sync_pages);
+    for (size_t i = 0; i < map->mapping_count; i++) {
+        release_mapping(map->mappings[i]);
+    }
+    free(map->mappings);
+    mapper_t *mapper = map->mappers;
+    while (mapper) {
+        mapper_t *next = mapper->next;
+        mapper_destroy(mapper);
+        mapper = next;
+    }
+    free(map);
+}
+
+uint8_t *memory_map_translate(const memory_map_t *from, const memory_map_t *to, uint8_t *host) {
+    size_t offset = (size_t)(host - from->ram);
+    if (host && offset < MEMORY_MAP_SIZE) {
+        return to->ram + offset;
+    }
+    return host;
+}
+
+uint8_t *memory_map_bank(memory_map_t *map, uint8_t bank) {
+    return map->ram + ((size_t)bank * RAM_BANK_SIZE);
+}
+
+bool memory_map_is_ram_bank(memory_map_t *map, uint8_t bank) {
+    return (map->ram_banks[bank >> 3] & (1 << (bank & 7))) != 0;
+}
+
+static inline void clear_bit(uint64_t *bits, size_t page) {
+    bits[page >> 6] &= ~((uint64_t)1 << (page & 63));
+}
+
+// Zero a run of pages whose slots are consecutive and all shared or all private
+static void zero_run(memory_map_t *map, size_t first_page, size_t count, bool shared) {
+    uint8_t *host = map->ram + (first_page << MEMORY_PAGE_SHIFT);
+    if (!shared) {
+        // Nobody else sees these slots: punch them out in place, which also
+        // hands the memory back
+        page_pool_punch(map->slots[first_page], (uint32_t)count);
+        return;
+    }
+
+    // Map fresh (sparse, zero) slots over the run and drop the shared ones
+    page_slot_t first;
+    if (page_pool_alloc_run((uint32_t)count, &first) != 0 || map_slots(host, first, count) != 0) {
+        fprintf(stderr, "Error: Failed to remap RAM, clearing in place\n");
+        for (size_t page = first_page; page < first_page + count; page++) {
+            memory_map_unshare(map, page);
+        }
+        memset(host, 0, count << MEMORY_PAGE_SHIFT);
+        return;
+    }
+    page_pool_release_run(map->slots[first_page], (uint32_t)count);
+    for (size_t page = first_page; page < first_page + count; page++) {
+        map->slots[page] = first + (page_slot_t)(page - first_page);
+    }
+}
+
+void memory_map_zero_pages(memory_map_t *map, size_t first_page, size_t count) {
+    size_t end = first_page + count;
+    size_t start = first_page;
+    bool shared = page_pool_refs(map->slots[start]) > 1;
+
+    for (size_t page = first_page + 1; page <= end; page++) {
+        bool page_shared = page < end && page_pool_refs(map->slots[page]) > 1;
+        if (page == end || page_shared != shared || map->slots[page] != map->slots[page - 1] + 1) {
+            zero_run(map, start, page - start, shared);
+            start = page;
+            shared = page_shared;
+        }
+    }
+    for (size_t page = first_page; page < end; page++) {
+        clear_bit(map->shared, page);
+        clear_bit(map->written, page);
+    }
+}
+
+void memory_map_clear_written(memory_map_t *map) {
+    for (size_t word = 0; word < (RAM_SPACE_SIZE >> MEMORY_PAGE_SHIFT) / 64; word++) {
+        uint64_t bits = map->written[word];
+        while (bits) {
+            size_t page = word * 64 + __builtin_ctzll(bits);
+            uint8_t *host = map->ram + (page << MEMORY_PAGE_SHIFT);
+            if (page_pool_refs(map->slots[page]) > 1) {
+                zero_run(map, page, 1, true);
+                clear_bit(map->shared, page);
+            } else {
+                // Stays resident, so the next run does not fault it back in
+                memset(host, 0, MEMORY_PAGE_SIZE);
+            }
+            map->dirty[word] |= bits & -bits;
+            bits &= bits - 1;
+        }
+        map->written[word] = 0;
+    }
+}
+
+void memory_map_clear_ram(memory_map_t *map) {
+    memory_map_zero_pages(map, 0, RAM_SPACE_SIZE >> MEMORY_PAGE_SHIFT);
+
+    // Memory no longer matches the last snapshot; the next one starts over
+    map->synced = false;
+}
+
+void memory_map_unshare(memory_map_t *map, size_t page) {
+    page_slot_t slot = map->slots[page];
+
+    if (page_pool_refs(slot) > 1) {
+        // Copy-on-write: move this map's view of the page to a slot of its own
+        uint8_t *host = map->ram + (page << MEMORY_PAGE_SHIFT);
+        page_slot_t copy;
+        if (page_pool_alloc(&copy) != 0 ||
+            pwrite(page_pool_fd(), host, MEMORY_PAGE_SIZE, page_pool_offset(copy)) != MEMORY_PAGE_SIZE ||
+            map_slots(host, copy, 1) != 0) {
+            fprintf(stderr, "Error: Copy-on-write failed for page %zu\n", page);
+            return;
+        }
+        map->slots[page] = copy;
+        page_pool_release_run(slot, 1);
+    }
+    clear_bit(map->shared, page);
+}
+
+uint8_t *memory_map_alloc(memory_map_t *map, size_t size) {
+    size = (size + MEMORY_PAGE_SIZE - 1) & ~((size_t)MEMORY_PAGE_SIZE - 1);
+    if (size == 0 || size > RAM_POOL_SIZE - map->pool_used) {
+        return NULL;
+    }
+    uint8_t *data = map->ram + RAM_SPACE_SIZE + map->pool_used;
+    map->pool_used += size;
+    return data;
+}
+
+// Called before every tracked store into the reservation
+static inline void prepare_write(memory_map_t *map, size_t offset) {
+    size_t page = offset >> MEMORY_PAGE_SHIFT;
+    if (memory_map_page_shared(map, page)) {
+        memory_map_unshare(map, page);
+    }
+    map->dirty[page >> 6] |= (uint64_t)1 << (page & 63);
+    map->written[page >> 6] |= (uint64_t)1 << (page & 63);
+}
+
+void memory_map_poke(memory_map_t *map, uint8_t *host, uint8_t value) {
+    if (map) {
+        size_t offset = (size_t)(host - map->ram);
+        if (offset < MEMORY_MAP_SIZE) {
+            prepare_write(map, offset);
+        }
+    }
+    *host = value;
+}
+
+void memory_map_prepare_range(memory_map_t *map, uint8_t *host, size_t length) {
+    if (!map || length == 0) {
+        return;
+    }
+    size_t offset = (size_t)(host - map->ram);
+    if (offset >= MEMORY_MAP_SIZE) {
+        return;
+    }
+    size_t last = offset + length - 1;
+    if (last >= MEMORY_MAP_SIZE) {
+        last = MEMORY_MAP_SIZE - 1;
+    }
+    for (size_t page = offset >> MEMORY_PAGE_SHIFT; page <= last >> MEMORY_PAGE_SHIFT; page++) {
+        prepare_write(map, page << MEMORY_PAGE_SHIFT);
+    }
+}
+
+void write_byte_to_region_ram(memory_region_t *region, uint16_t address, uint8_t value) {
+    if (region->flags & MEM_READWRITE) {
+        memory_map_t *map = (memory_map_t *)region->device;
+        uint8_t *data = &region->data[address - region->start_offset];
+        size_t offset = (size_t)(data - map->ram);
+
+        // Unsigned compare also rejects caller-owned memory below the reservation
+        if (offset < MEMORY_MAP_SIZE) {
+            prepare_write(map, offset);
+        }
+        *data = value;
+    }
+}
+
+void write_word_to_region_ram(memory_region_t *region, uint16_t address, uint16_t value) {
+    write_byte_to_region_ram(region, address, value & 0xFF);
+    write_byte_to_region_ram(region, (address + 1) & 0xFFFF, (value >> 8) & 0xFF);
+}
+
+uint8_t *machine_memory_run(machine_state_t *machine, uint32_t address, bool write, uint32_t *length) {
+    uint8_t bank = (address >> 16) & 0xFF;
+    uint16_t addr = address & 0xFFFF;
+    memory_region_t *region = find_memory_region(machine, bank, addr);
+    if (!region || !region->data || (region->flags & MEM_DEVICE)) {
+        return NULL;
+    }
+    if (write) {
+        if (!(region->flags & MEM_READWRITE) ||
+            (region->write_byte != write_byte_to_region_ram && region->write_byte != write_byte_to_region_nodev)) {
+            return NULL;
+        }
+    } else if (!(region->flags & (MEM_READONLY | MEM_READWRITE)) ||
+               region->read_byte != read_byte_from_region_nodev) {
+        return NULL;
+    }
+
+    // Lookups take the first match, so earlier regions shadow this one
+    uint16_t end = region->end_offset;
+    for (memory_region_t *r = machine->memory_banks[bank]->regions; r != region; r = r->next) {
+        if (r->start_offset > addr && r->start_offset <= end) {
+            end = r->start_offset - 1;
+        }
+    }
+    *length = (uint32_t)(end - addr) + 1;
+    return &region->data[addr - region->start_offset];
+}
+
+void machine_copy_to_guest(machine_state_t *machine, uint32_t address, const uint8_t *data, size_t length) {
+    while (length > 0) {
+        uint32_t run = 0;
+        uint8_t *to = machine_memory_run(machine, address, true, &run);
+        if (!to) {
+            write_byte_long(machine, (long_address_t){ .bank = (address >> 16) & 0xFF, .address = address & 0xFFFF }, *data);
+            run = 1;
+        } else {
+            if (run > length) {
+                run = (uint32_t)length;
+            }
+            memory_map_prepare_range(machine->memory_map, to, run);
+            memcpy(to, data, run);
+        }
+        address = (address + run) & 0xFFFFFF;
+        data += run;
+        length -= run;
+    }
+}
+
+void machine_copy_from_guest(machine_state_t *machine, uint32_t address, uint8_t *data, size_t length) {
+    while (length > 0) {
+        uint32_t run = 0;
+        uint8_t *from = machine_memory_run(machine, address, false, &run);
+        if (!from) {
+            *data = read_byte_long(machine, (long_address_t){ .bank = (address >> 16) & 0xFF, .address = address & 0xFFFF });
+            run = 1;
+        } else {
+            if (run > length) {
+                run = (uint32_t)length;
+            }
+            memcpy(data, from, run);
+        }
+        address = (address + run) & 0xFFFFFF;
+        data += run;
+        length -= run;
+    }
+}
+
+memory_bank_t *memory_map_create_ram_bank(memory_map_t *map, uint8_t bank) {
+    memory_bank_t *mem_bank = (memory_bank_t *)malloc(sizeof(memory_bank_t));
+    memory_region_t *region = (memory_region_t *)malloc(sizeof(memory_region_t));
+    if (!mem_bank || !region) {
+        free(mem_bank);
+        free(region);
+        return NULL;
+    }
+
+    region->start_offset = 0x0000;
+    region->end_offset = 0xFFFF;
+    region->data = memory_map_bank(map, bank);
+    region->read_byte = read_byte_from_region_nodev;
+    region->write_byte = write_byte_to_region_ram;
+    region->read_word = read_word_from_region_nodev;
+    region->write_word = write_word_to_region_ram;
+    region->flags = MEM_READWRITE | MEM_MAPPED;
+    region->device = map;
+    region->next = NULL;
+
+    mem_bank->regions = region;
+    return mem_bank;
+}
+
+int machine_add_ram_banks(machine_state_t *machine, uint8_t first_bank, uint16_t count) {
+    memory_map_t *map = machine->memory_map;
+    if (!map) {
+        fprintf(stderr, "Error: Machine has no memory map\n");
+        return -1;
+    }
+    if (first_bank == 0 || (uint32_t)first_bank + count > RAM_BANK_COUNT) {
+        fprintf(stderr, "Error: Invalid RAM bank range $%02X+%u\n", first_bank, count);
+        return -1;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        uint8_t bank = (uint8_t)(first_bank + i);
+        if (machine->memory_banks[bank] != NULL) {
+            fprintf(stderr, "Error: Bank $%02X is already mapped\n", bank);
+            return -1;
+        }
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        uint8_t bank = (uint8_t)(first_bank + i);
+        machine->memory_banks[bank] = memory_map_create_ram_bank(map, bank);
+        if (!machine->memory_banks[bank]) {
+            fprintf(stderr, "Error: Failed to create RAM bank $%02X\n", bank);
+            return -1;
+        }
+        map->ram_banks[bank >> 3] |= (1 << (bank & 7));
+    }
+
+    return 0;
+}
+
+memory_region_t *memory_map_install_region(machine_state_t *machine, uint8_t bank,
+                                           uint16_t start, uint16_t end,
+                                           uint8_t *data, uint32_t flags) {
+    memory_bank_t *mem_bank = machine->memory_banks[bank];
+    if (!mem_bank) {
+        mem_bank = (memory_bank_t *)malloc(sizeof(memory_bank_t));
+        if (!mem_bank) {
+            return NULL;
+        }
+        mem_bank->regions = NULL;
+        machine->memory_banks[bank] = mem_bank;
+    }
+
+    // Rebind a region with exactly this range
+    for (memory_region_t *region = mem_bank->regions; region; region = region->next) {
+        if (region->start_offset == start && region->end_offset == end) {
+            if (!(region->flags & MEM_MAPPED)) {
+                free(region->data);
+            }
+            region->data = data;
+            region->flags = flags;
+            return region;
+        }
+    }
+
+    // Otherwise shadow the existing regions; lookups take the first match
+    memory_region_t *region = (memory_region_t *)malloc(sizeof(memory_region_t));
+    if (!region) {
+        return NULL;
+    }
+    region->start_offset = start;
+    region->end_offset = end;
+    region->data = data;
+    region->read_byte = read_byte_from_region_nodev;
+    region->write_byte = write_byte_to_region_nodev;
+    region->read_word = read_word_from_region_nodev;
+    region->write_word = write_word_to_region_nodev;
+    region->flags = flags;
+    region->device = NULL;
+    region->next = mem_bank->regions;
+    mem_bank->regions = region;
+    return region;
+}
+
+// Give the map a reference to a host mapping
+static int share_host_mapping(memory_map_t *map, host_mapping_t *mapping) {
+    host_mapping_t **mappings = (host_mapping_t **)realloc(map->mappings,
+                                                           (map->mapping_count + 1) * sizeof(host_mapping_t *));
+    if (!mappings) {
+        return -1;
+    }
+    map->mappings = mappings;
+    __atomic_add_fetch(&mapping->refs, 1, __ATOMIC_RELAXED);
+    map->mappings[map->mapping_count++] = mapping;
+    return 0;
+}
+
+// Hand a host mapping to the map, which unmaps it when the last machine
+// using it is destroyed
+static int add_host_mapping(memory_map_t *map, void *addr, size_t length, bool persistent) {
+    host_mapping_t *mapping = (host_mapping_t *)malloc(sizeof(host_mapping_t));
+    if (!mapping) {
+        return -1;
+    }
+    mapping->addr = addr;
+    mapping->length = length;
+    mapping->refs = 0;
+    mapping->persistent = persistent;
+    if (share_host_mapping(map, mapping) != 0) {
+        free(mapping);
+        return -1;
+    }
+    return 0;
+}
+
+// Map `needed` bytes of an image: whole file pages come straight from the page
+// cache, the partial last page and anything past EOF are 0xFF padded copies.
+// The CPU sees the image through MEM_READONLY regions; the host mapping stays
+// writable (private) so loaders can still patch ROM, copying only that page.
+static uint8_t *map_rom_image(int fd, size_t file_size, size_t needed, size_t *length) {
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    size_t map_length = (needed + page_size - 1) & ~(page_size - 1);
+    size_t file_pages = file_size < needed ? file_size & ~(page_size - 1) : map_length;
+
+    uint8_t *image = (uint8_t *)mmap(NULL, map_length, PROT_READ | PROT_WRITE,
+                                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (image == MAP_FAILED) {
+        return NULL;
+    }
+
+    if (file_pages > 0 &&
+        mmap(image, file_pages, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(image, map_length);
+        return NULL;
+    }
+
+    if (file_pages < map_length) {
+        uint8_t *tail = image + file_pages;
+        size_t tail_length = map_length - file_pages;
+        size_t tail_file = file_size > file_pages ? file_size - file_pages : 0;
+
+        memset(tail, 0xFF, tail_length);
+        if (tail_file > 0 && pread(fd, tail, tail_file, (off_t)file_pages) != (ssize_t)tail_file) {
+            munmap(image, map_length);
+            return NULL;
+        }
+    }
+
+    *length = map_length;
+    return image;
+}
+
+int machine_map_rom(machine_state_t *machine, const char *filename,
+                    const rom_layout_t *layout, size_t count) {
+    memory_map_t *map = machine->memory_map;
+    if (!map) {
+        fprintf(stderr, "Error: Machine has no memory map\n");
+        return -1;
+    }
+
+    size_t needed = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (layout[i].end < layout[i].start) {
+            fprintf(stderr, "Error: Invalid ROM window $%02X:%04X-%04X\n",
+                    layout[i].bank, layout[i].start, layout[i].end);
+            return -1;
+        }
+        size_t window_end = (size_t)layout[i].file_offset + (layout[i].end - layout[i].start) + 1;
+        if (window_end > needed) {
+            needed = window_end;
+        }
+    }
+    if (needed == 0) {
+        return 0;
+    }
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot open ROM file '%s'\n", filename);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        fprintf(stderr, "Error: Cannot stat ROM file '%s'\n", filename);
+        close(fd);
+        return -1;
+    }
+
+    size_t length = 0;
+    uint8_t *image = map_rom_image(fd, (size_t)st.st_size, needed, &length);
+    close(fd);
+    if (!image) {
+        fprintf(stderr, "Error: Cannot map ROM file '%s'\n", filename);
+        return -1;
+    }
+
+    if (add_host_mapping(map, image, length, false) != 0) {
+        munmap(image, length);
+        return -1;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (!memory_map_install_region(machine, layout[i].bank, layout[i].start, layout[i].end,
+                                       image + layout[i].file_offset,
+                                       MEM_READONLY | MEM_MAPPED)) {
+            fprintf(stderr, "Error: Failed to map ROM window $%02X:%04X\n",
+                    layout[i].bank, layout[i].start);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int machine_map_sram(machine_state_t *machine, const char *filename,
+                     uint8_t bank, uint16_t start, uint16_t end) {
+    memory_map_t *map = machine->memory_map;
+    if (!map) {
+        fprintf(stderr, "Error: Machine has no memory map\n");
+        return -1;
+    }
+    if (end < start) {
+        fprintf(stderr, "Error: Invalid SRAM window $%02X:%04X-%04X\n", bank, start, end);
+        return -1;
+    }
+
+    int fd = open(filename, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot open SRAM file '%s'\n", filename);
+        return -1;
+    }
+
+    // A new (or short) file is extended with zeroes; a longer one is left as is
+    size_t size = (size_t)(end - start) + 1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || ((size_t)st.st_size < size && ftruncate(fd, (off_t)size) != 0)) {
+        fprintf(stderr, "Error: Cannot size SRAM file '%s'\n", filename);
+        close(fd);
+        return -1;
+    }
+
+    // MAP_SHARED: guest stores go straight to the page cache and reach the
+    // file without a save step, even if the emulator dies
+    uint8_t *sram = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (sram == MAP_FAILED) {
+        fprintf(stderr, "Error: Cannot map SRAM file '%s'\n", filename);
+        return -1;
+    }
+    if (add_host_mapping(map, sram, size, true) != 0) {
+        munmap(sram, size);
+        return -1;
+    }
+
+    if (!memory_map_install_region(machine, bank, start, end, sram, MEM_READWRITE | MEM_MAPPED)) {
+        fprintf(stderr, "Error: Failed to map SRAM window $%02X:%04X\n", bank, start);
+        return -1;
+    }
+    return 0;
+}
+
+int machine_sync_sram(machine_state_t *machine) {
+    memory_map_t *map = machine->memory_map;
+    int result = 0;
+    if (!map) {
+        return 0;
+    }
+    for (size_t i = 0; i < map->mapping_count; i++) {
+        host_mapping_t *mapping = map->mappings[i];
+        if (mapping->persistent && msync(mapping->addr, mapping->length, MS_SYNC) != 0) {
+            perror("msync");
+            result = -1;
+        }
+    }
+    return result;
+}
+
+uint8_t *memory_map_alloc_shared(memory_map_t **maps, size_t count, size_t size) {
+    if (count == 0 || size == 0) {
+        return NULL;
+    }
+    uint8_t *memory = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+                                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+    if (add_host_mapping(maps[0], memory, size, false) != 0) {
+        munmap(memory, size);
+        return NULL;
+    }
+
+    // From here the mapping goes with the maps that took it
+    host_mapping_t *mapping = maps[0]->mappings[maps[0]->mapping_count - 1];
+    for (size_t i = 1; i < count; i++) {
+        if (share_host_mapping(maps[i], mapping) != 0) {
+            memory_map_release_shared(maps, i, memory);
+            return NULL;
+        }
+    }
+    return memory;
+}
+
+void memory_map_release_shared(memory_map_t **maps, size_t count, uint8_t *memory) {
+    for (size_t i = 0; i < count; i++) {
+        memory_map_t *map = maps[i];
+        for (size_t j = 0; j < map->mapping_count; j++) {
+            host_mapping_t *mapping = map->mappings[j];
+            if (mapping->addr == memory) {
+                memmove(&map->mappings[j], &map->mappings[j + 1],
+                        (map->mapping_count - j - 1) * sizeof(host_mapping_t *));
+                map->mapping_count--;
+                release_mapping(mapping);
+                break;
+            }
+        }
+    }
+}
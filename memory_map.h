@@ -0,0 +1,182 @@
+#ifndef __MEMORY_MAP_H__
+#define __MEMORY_MAP_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "machine.h"
+#include "page_pool.h"
+
+// The 65816 can address 256 banks of 64KB (16MB).  All RAM banks are carved
+// out of a single anonymous reservation of that size, so banks that are never
+// touched cost nothing but address space.
+#define RAM_BANK_SIZE   0x10000
+#define RAM_BANK_COUNT  256
+#define RAM_SPACE_SIZE  ((size_t)RAM_BANK_SIZE * RAM_BANK_COUNT)
+
+// Behind the banks the reservation holds a pool for other machine-owned RAM
+// (mapper pages), so snapshots and clones can treat all of it as one run of
+// pages.  Every page is mapped MAP_SHARED from a slot of the process-wide page
+// pool (see page_pool.h); clones map the same slots and copy a page only when
+// either machine first writes to it.
+#define RAM_POOL_SIZE       RAM_SPACE_SIZE
+#define MEMORY_MAP_SIZE     (RAM_SPACE_SIZE + RAM_POOL_SIZE)
+#define MEMORY_PAGE_SHIFT   12
+#define MEMORY_PAGE_SIZE    (1 << MEMORY_PAGE_SHIFT)
+#define MEMORY_PAGE_COUNT   (MEMORY_MAP_SIZE >> MEMORY_PAGE_SHIFT)
+
+typedef struct mapper_s mapper_t;
+typedef struct snapshot_page_s snapshot_page_t;
+
+// A host mapping (ROM image, SRAM file) whose pages regions point into.
+// Clones share the mapping, so it is reference counted.
+typedef struct host_mapping_s {
+    void *addr;
+    size_t length;
+    uint32_t refs;
+    bool persistent;        // MAP_SHARED file mapping flushed by machine_sync_sram()
+} host_mapping_t;
+
+struct memory_map_s {
+    uint8_t *ram;                           // Reservation backing every RAM bank and the pool
+    page_slot_t *slots;                     // Page pool slot mapped at each page
+    uint64_t shared[MEMORY_PAGE_COUNT / 64];// Pages that may still be shared with a clone
+    uint64_t written[MEMORY_PAGE_COUNT / 64];// Pages written since they were last zeroed
+    uint8_t ram_banks[RAM_BANK_COUNT / 8];  // Banks (other than 0) configured as RAM
+    size_t pool_used;                       // Bytes handed out from the pool
+    host_mapping_t **mappings;              // File mappings released with the map
+    size_t mapping_count;
+    mapper_t *mappers;                      // Bank-switching mappers (see mapper.h)
+
+    // Snapshot bookkeeping (see snapshot.h)
+    uint64_t dirty[MEMORY_PAGE_COUNT / 64]; // Pages written since the last snapshot/restore
+    snapshot_page_t **sync_pages;           // Page contents as of that point (NULL = zero)
+    bool synced;                            // sync_pages describe memory apart from dirty pages
+    uint64_t sync_serial;                   // Snapshot the sync point was taken from/restored to
+};
+
+// One window of a ROM image placed into the address space
+typedef struct rom_layout_s {
+    uint32_t file_offset;   // Offset of the window in the image file
+    uint8_t bank;           // Destination bank
+    uint16_t start;         // First address of the window in the bank
+    uint16_t end;           // Last address of the window in the bank (inclusive)
+} rom_layout_t;
+
+// Create/destroy the host backing for a machine's address space
+memory_map_t *memory_map_create(void);
+void memory_map_destroy(memory_map_t *map);
+
+// New map sharing every page of `map` copy-on-write.  The clone also inherits
+// the snapshot sync point, so restoring a snapshot of `map` onto it only
+// touches pages written since.  Mappers are not cloned here (see
+// mapper_clone_all()).
+memory_map_t *memory_map_clone(memory_map_t *map);
+
+// Translate a host pointer into `from`'s reservation to the same spot in `to`;
+// anything else is returned unchanged
+uint8_t *memory_map_translate(const memory_map_t *from, const memory_map_t *to, uint8_t *host);
+
+// Host pointer to the start of a bank inside the RAM reservation
+uint8_t *memory_map_bank(memory_map_t *map, uint8_t bank);
+
+// Is the bank configured as a full 64KB RAM bank?
+bool memory_map_is_ram_bank(memory_map_t *map, uint8_t bank);
+
+// Drop the map's references to host mappings (ROM images, SRAM files,
+// shared windows) that no mapper page points into, unmapping those no other
+// map uses.  Only once no region points into them either, as on reset.
+void memory_map_release_mappings(memory_map_t *map);
+
+// Return every RAM bank page to the kernel; contents read back as zero
+void memory_map_clear_ram(memory_map_t *map);
+
+// Replace `count` pages from `first_page` with fresh zero pages
+void memory_map_zero_pages(memory_map_t *map, size_t first_page, size_t count);
+
+// Zero only the RAM bank pages written since they were last zeroed.  Pages
+// stay mapped and resident, so this is the cheap way to wipe RAM between runs.
+// Stores that bypass the write callbacks and memory_map_poke() are not seen.
+void memory_map_clear_written(memory_map_t *map);
+
+// Give this map a private copy of a page before it is written
+void memory_map_unshare(memory_map_t *map, size_t page);
+
+static inline bool memory_map_page_shared(const memory_map_t *map, size_t page) {
+    return (map->shared[page >> 6] >> (page & 63)) & 1;
+}
+
+// Zeroed, page-aligned memory from the pool; lives as long as the map
+uint8_t *memory_map_alloc(memory_map_t *map, size_t size);
+
+// Store a byte straight into region data, bypassing access checks (loaders).
+// Writes into the reservation are unshared and tracked like CPU writes.
+void memory_map_poke(memory_map_t *map, uint8_t *host, uint8_t value);
+
+// Get `length` bytes at `host` ready for a bulk store such as a memcpy: the
+// pages they cover in the reservation are unshared and tracked like CPU writes
+void memory_map_prepare_range(memory_map_t *map, uint8_t *host, size_t length);
+
+// Write callbacks for regions backed by the reservation; region->device
+// points at the map so writes can be tracked for snapshots
+void write_byte_to_region_ram(memory_region_t *region, uint16_t address, uint8_t value);
+void write_word_to_region_ram(memory_region_t *region, uint16_t address, uint16_t value);
+
+// Map `count` full RAM banks starting at `first_bank` (bank 0 is fixed layout).
+// Returns: 0 on success, -1 on error
+int machine_add_ram_banks(machine_state_t *machine, uint8_t first_bank, uint16_t count);
+
+// Host pointer to the 24-bit `address` if it lies in plain memory (RAM, or
+// ROM when not `write`) that can be copied with memcpy, with *length set to
+// how far that memory runs before the region ends or another one shadows it.
+// Stores through the pointer must go through memory_map_prepare_range().
+// Returns: NULL for devices, mapper registers and unmapped addresses
+uint8_t *machine_memory_run(machine_state_t *machine, uint32_t address, bool write, uint32_t *length);
+
+// Copy between host memory and the guest address space from the 24-bit
+// `address` up, carrying into the next bank.  Plain memory is copied in runs;
+// anything else goes through the region callbacks a byte at a time.
+void machine_copy_to_guest(machine_state_t *machine, uint32_t address, const uint8_t *data, size_t length);
+void machine_copy_from_guest(machine_state_t *machine, uint32_t address, uint8_t *data, size_t length);
+
+// Build the region list for a configured RAM bank (used by machine setup/reset)
+memory_bank_t *memory_map_create_ram_bank(memory_map_t *map, uint8_t bank);
+
+// Point bank:start-end at host memory.  A region covering exactly that range
+// is rebound in place; otherwise a new region is put in front of the bank's
+// list so it shadows whatever was mapped there before.
+memory_region_t *memory_map_install_region(machine_state_t *machine, uint8_t bank,
+                                           uint16_t start, uint16_t end,
+                                           uint8_t *data, uint32_t flags);
+
+// Map a ROM image read-only (MAP_PRIVATE) straight from the file according to
+// `layout`.  Windows reaching past the end of the file read as 0xFF.
+// Returns: 0 on success, -1 on error
+int machine_map_rom(machine_state_t *machine, const char *filename,
+                    const rom_layout_t *layout, size_t count);
+
+// Back bank:start-end with battery-backed SRAM kept in a host file.  The file
+// is created (zero filled) if needed and mapped MAP_SHARED, so guest writes
+// land in the page cache and persist with no save step.  SRAM is outside the
+// snapshot/clone machinery: clones share it and restores leave it alone.  Like
+// ROM mappings, it has to be mapped again after reset_machine().
+// Returns: 0 on success, -1 on error
+int machine_map_sram(machine_state_t *machine, const char *filename,
+                     uint8_t bank, uint16_t start, uint16_t end);
+
+// Flush every SRAM file of the machine to disk (msync), e.g. at checkpoints.
+// Optional: the kernel writes the pages back on its own.
+// Returns: 0 on success, -1 on error
+int machine_sync_sram(machine_state_t *machine);
+
+// Zeroed host memory for several machines at once, e.g. RAM that CPUs share
+// (see multicore.h).  Every map in `maps` holds a reference and the memory is
+// unmapped with the last of them.  Like SRAM it is outside the
+// snapshot/clone machinery: clones share it and restores leave it alone.
+// Returns: the memory, or NULL on error
+uint8_t *memory_map_alloc_shared(memory_map_t **maps, size_t count, size_t size);
+
+// Drop the references `maps` hold to memory from memory_map_alloc_shared(),
+// unmapping it with the last.  Only once no region points into it.
+void memory_map_release_shared(memory_map_t **maps, size_t count, uint8_t *memory);
+
+#endif // __MEMORY_MAP_H__
@@ -0,0 +1,319 @@
+#include "multicore.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "machine_setup.h"
+#include "memory_map.h"
+
+typedef struct multicore_core_s {
+    machine_state_t *machine;
+    uint64_t base;             // machine->cycles when the multicore started
+    bool halted;
+    uint64_t instructions;
+} multicore_core_t;
+
+struct multicore_s {
+    multicore_core_t cores[MULTICORE_MAX_CORES];
+    size_t count;
+    uint32_t quantum;
+    bool threaded;
+    uint64_t cycles;           // Every core has run this far
+    uint64_t quanta;
+};
+
+// Threaded mode: one per core for the length of a multicore_run()
+typedef struct multicore_worker_s {
+    multicore_t *multicore;
+    multicore_core_t *core;
+    pthread_barrier_t *barrier;
+    uint64_t end;
+} multicore_worker_t;
+
+// Holds the threads until all of them are up (go) or one failed to start
+typedef struct multicore_gate_s {
+    pthread_mutex_t lock;
+    pthread_cond_t open;
+    int state;                 // 0: wait, 1: go, -1: abort
+} multicore_gate_t;
+
+typedef struct multicore_thread_s {
+    multicore_worker_t worker;
+    multicore_gate_t *gate;
+} multicore_thread_t;
+
+// Shared windows: byte at a time with acquire/release, for cores on other
+// host threads
+static uint8_t read_byte_shared(memory_region_t *region, uint16_t address) {
+    return __atomic_load_n(&region->data[(uint16_t)(address - region->start_offset)], __ATOMIC_ACQUIRE);
+}
+
+static void write_byte_shared(memory_region_t *region, uint16_t address, uint8_t value) {
+    __atomic_store_n(&region->data[(uint16_t)(address - region->start_offset)], value, __ATOMIC_RELEASE);
+}
+
+// A word running off the end of the window only gets its first byte here;
+// the second belongs to whatever region follows
+static uint16_t read_word_shared(memory_region_t *region, uint16_t address) {
+    uint8_t low = read_byte_shared(region, address);
+    uint8_t high = address < region->end_offset ? read_byte_shared(region, address + 1) : 0;
+    return (high << 8) | low;
+}
+
+static void write_word_shared(memory_region_t *region, uint16_t address, uint16_t value) {
+    write_byte_shared(region, address, value & 0xFF);
+    if (address < region->end_offset) {
+        write_byte_shared(region, address + 1, (value >> 8) & 0xFF);
+    }
+}
+
+// What installing a shared window on one core changed
+typedef struct share_undo_s {
+    memory_region_t *region;   // The window's region
+    bool rebound;              // An existing region of the same range, rebound in place
+    memory_region_t before;    // ... as it was
+    bool new_bank;             // The bank was created for the window
+} share_undo_t;
+
+// Take a shared window back off a core.  A rebound region gets its old
+// binding back, unless it owned its memory: the rebind freed that, so the
+// region goes.
+static void share_undo(machine_state_t *machine, uint8_t bank, const share_undo_t *undo) {
+    memory_bank_t *mem_bank = machine->memory_banks[bank];
+    if (undo->rebound && (undo->before.flags & MEM_MAPPED)) {
+        memory_region_t *next = undo->region->next;
+        *undo->region = undo->before;
+        undo->region->next = next;
+        return;
+    }
+    for (memory_region_t **link = &mem_bank->regions; *link; link = &(*link)->next) {
+        if (*link == undo->region) {
+            *link = undo->region->next;
+            free(undo->region);
+            break;
+        }
+    }
+    if (undo->new_bank && !mem_bank->regions) {
+        free(mem_bank);
+        machine->memory_banks[bank] = NULL;
+    }
+}
+
+multicore_t *multicore_create(size_t count) {
+    if (count == 0 || count > MULTICORE_MAX_CORES) {
+        fprintf(stderr, "Error: %zu cores (1 to %d)\n", count, MULTICORE_MAX_CORES);
+        return NULL;
+    }
+    multicore_t *multicore = (multicore_t *)calloc(1, sizeof(multicore_t));
+    if (!multicore) {
+        return NULL;
+    }
+    multicore->quantum = MULTICORE_DEFAULT_QUANTUM;
+    for (size_t i = 0; i < count; i++) {
+        machine_state_t *machine = create_machine();
+        if (!machine) {
+            multicore_destroy(multicore);
+            return NULL;
+        }
+        multicore->cores[i].machine = machine;
+        multicore->cores[i].base = machine->cycles;
+        multicore->count++;
+    }
+    return multicore;
+}
+
+void multicore_destroy(multicore_t *multicore) {
+    if (!multicore) {
+        return;
+    }
+    for (size_t i = 0; i < multicore->count; i++) {
+        destroy_machine(multicore->cores[i].machine);
+    }
+    free(multicore);
+}
+
+size_t multicore_core_count(const multicore_t *multicore) {
+    return multicore->count;
+}
+
+machine_state_t *multicore_core(multicore_t *multicore, size_t index) {
+    return index < multicore->count ? multicore->cores[index].machine : NULL;
+}
+
+uint8_t *multicore_share(multicore_t *multicore, uint8_t bank, uint16_t start, uint16_t end) {
+    if (end < start) {
+        fprintf(stderr, "Error: Invalid shared window $%02X:%04X-%04X\n", bank, start, end);
+        return NULL;
+    }
+    memory_map_t *maps[MULTICORE_MAX_CORES];
+    for (size_t i = 0; i < multicore->count; i++) {
+        maps[i] = multicore->cores[i].machine->memory_map;
+        if (!maps[i]) {
+            fprintf(stderr, "Error: Core %zu has no memory map\n", i);
+            return NULL;
+        }
+    }
+    uint8_t *memory = memory_map_alloc_shared(maps, multicore->count, (size_t)(end - start) + 1);
+    if (!memory) {
+        return NULL;
+    }
+
+    // Remember what each core had there, to put it back if a later core
+    // fails (see share_undo())
+    share_undo_t undo[MULTICORE_MAX_CORES];
+    for (size_t i = 0; i < multicore->count; i++) {
+        machine_state_t *machine = multicore->cores[i].machine;
+        memory_bank_t *mem_bank = machine->memory_banks[bank];
+        memory_region_t *existing = mem_bank ? mem_bank->regions : NULL;
+        while (existing && (existing->start_offset != start || existing->end_offset != end)) {
+            existing = existing->next;
+        }
+        undo[i] = (share_undo_t){ .new_bank = mem_bank == NULL, .rebound = existing != NULL };
+        if (existing) {
+            undo[i].before = *existing;
+        }
+
+        memory_region_t *region = memory_map_install_region(machine, bank, start, end,
+                                                            memory, MEM_READWRITE | MEM_MAPPED);
+        if (!region) {
+            fprintf(stderr, "Error: Failed to share window $%02X:%04X on core %zu\n", bank, start, i);
+            undo[i].region = NULL;
+            for (size_t j = i + 1; j-- > 0; ) {
+                share_undo(multicore->cores[j].machine, bank, &undo[j]);
+            }
+            memory_map_release_shared(maps, multicore->count, memory);
+            return NULL;
+        }
+        undo[i].region = region;
+        region->read_byte = read_byte_shared;
+        region->write_byte = write_byte_shared;
+        region->read_word = read_word_shared;
+        region->write_word = write_word_shared;
+        region->device = NULL;
+    }
+    return memory;
+}
+
+void multicore_set_quantum(multicore_t *multicore, uint32_t cycles) {
+    multicore->quantum = cycles ? cycles : 1;
+}
+
+void multicore_set_threaded(multicore_t *multicore, bool threaded) {
+    multicore->threaded = threaded;
+}
+
+// One turn: run the core until it reaches `end` (multicore time)
+static void run_core(multicore_core_t *core, uint64_t end) {
+    machine_state_t *machine = core->machine;
+    uint64_t deadline = core->base + end;
+    while (!core->halted && machine->cycles < deadline) {
+        if (!machine->processor.interrupts_disabled && machine_irq_sources(machine)) {
+            machine_process_interrupt(machine);
+        }
+        machine_execute_instruction(machine, &core->halted);
+        core->instructions++;
+    }
+}
+
+static void run_worker(multicore_worker_t *worker) {
+    uint64_t quantum = worker->multicore->quantum;
+    for (uint64_t now = worker->multicore->cycles; now < worker->end; ) {
+        now = worker->end - now > quantum ? now + quantum : worker->end;
+        run_core(worker->core, now);
+        pthread_barrier_wait(worker->barrier);
+    }
+}
+
+static void *multicore_thread_main(void *arg) {
+    multicore_thread_t *thread = (multicore_thread_t *)arg;
+    multicore_gate_t *gate = thread->gate;
+    pthread_mutex_lock(&gate->lock);
+    while (gate->state == 0) {
+        pthread_cond_wait(&gate->open, &gate->lock);
+    }
+    int state = gate->state;
+    pthread_mutex_unlock(&gate->lock);
+    if (state > 0) {
+        run_worker(&thread->worker);
+    }
+    return NULL;
+}
+
+// Cores 1 and up on threads of their own, core 0 on the caller's
+static int run_threaded(multicore_t *multicore, uint64_t end) {
+    multicore_thread_t threads[MULTICORE_MAX_CORES];
+    pthread_t ids[MULTICORE_MAX_CORES];
+    pthread_barrier_t barrier;
+    multicore_gate_t gate = { .state = 0 };
+    if (pthread_barrier_init(&barrier, NULL, (unsigned)multicore->count) != 0) {
+        return -1;
+    }
+    pthread_mutex_init(&gate.lock, NULL);
+    pthread_cond_init(&gate.open, NULL);
+
+    size_t started = 1;
+    for (size_t i = 0; i < multicore->count; i++) {
+        threads[i] = (multicore_thread_t){
+            .worker = { .multicore = multicore, .core = &multicore->cores[i], .barrier = &barrier, .end = end },
+            .gate = &gate,
+        };
+    }
+    while (started < multicore->count &&
+           pthread_create(&ids[started], NULL, multicore_thread_main, &threads[started]) == 0) {
+        started++;
+    }
+
+    pthread_mutex_lock(&gate.lock);
+    gate.state = started == multicore->count ? 1 : -1;
+    pthread_cond_broadcast(&gate.open);
+    pthread_mutex_unlock(&gate.lock);
+    if (gate.state > 0) {
+        run_worker(&threads[0].worker);
+    } else {
+        fprintf(stderr, "Error: Cannot start core threads\n");
+    }
+    for (size_t i = 1; i < started; i++) {
+        pthread_join(ids[i], NULL);
+    }
+
+    pthread_cond_destroy(&gate.open);
+    pthread_mutex_destroy(&gate.lock);
+    pthread_barrier_destroy(&barrier);
+    return gate.state > 0 ? 0 : -1;
+}
+
+int multicore_run(multicore_t *multicore, uint64_t cycles) {
+    uint64_t end = multicore->cycles + cycles;
+    uint64_t quantum = multicore->quantum;
+
+    if (multicore->threaded && multicore->count > 1) {
+        if (run_threaded(multicore, end) != 0) {
+            return -1;
+        }
+        multicore->quanta += (cycles + quantum - 1) / quantum;
+        multicore->cycles = end;
+        return 0;
+    }
+
+    while (multicore->cycles < end) {
+        uint64_t next = end - multicore->cycles > quantum ? multicore->cycles + quantum : end;
+        for (size_t i = 0; i < multicore->count; i++) {
+            run_core(&multicore->cores[i], next);
+        }
+        multicore->cycles = next;
+        multicore->quanta++;
+    }
+    return 0;
+}
+
+void multicore_get_stats(const multicore_t *multicore, multicore_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->cycles = multicore->cycles;
+    stats->quanta = multicore->quanta;
+    for (size_t i = 0; i < multicore->count; i++) {
+        stats->instructions += multicore->cores[i].instructions;
+        if (multicore->cores[i].halted) {
+            stats->halted |= 1u << i;
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef __MULTICORE_H__
+#define __MULTICORE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "machine.h"
+
+// Several 65816s sharing RAM
+//
+// Each core is a machine of its own (processor state, bank layout, devices),
+// so everything is private to it until multicore_share() backs a window with
+// memory every core sees at the same address.  A mailbox is then just a few
+// shared bytes the cores poll.
+//
+// Cores take turns of a quantum of cycles each, in core order, so a run is
+// the same every time whatever the guests do to the shared memory.  In
+// threaded mode each core runs its turns on a host thread of its own, all of
+// them meeting at a barrier after every quantum: no core is more than a
+// quantum ahead of another, but the order of their accesses inside a quantum
+// is up to the host.  Shared bytes are loaded with acquire and stored with
+// release semantics in both modes, so a flag stored after the data it guards
+// is seen after it.  Word accesses are two byte accesses, as on the bus, and
+// read-modify-write instructions are only indivisible in deterministic mode.
+//
+// The cores are owned by the multicore: set them up (load programs, map ROM,
+// add RAM banks) through multicore_core() before running.  Shared windows
+// are lost by reset_machine() on a core, like ROM and SRAM mappings.
+
+#define MULTICORE_MAX_CORES         16
+#define MULTICORE_DEFAULT_QUANTUM   100   // Cycles per turn
+
+typedef struct multicore_s multicore_t;
+
+typedef struct multicore_stats_s {
+    uint64_t cycles;           // Cycles every core has run to
+    uint64_t quanta;           // Turns taken by each core
+    uint64_t instructions;     // Over all cores
+    uint32_t halted;           // Bit per core stopped on STP
+} multicore_stats_t;
+
+// `count` fresh cores, run deterministically
+// Returns: multicore, or NULL on failure
+multicore_t *multicore_create(size_t count);
+
+// Free the multicore and its cores
+void multicore_destroy(multicore_t *multicore);
+
+size_t multicore_core_count(const multicore_t *multicore);
+machine_state_t *multicore_core(multicore_t *multicore, size_t index);
+
+// Back bank:start-end of every core with the same zeroed memory.  On error
+// no core keeps the window: each gets back what it had mapped there (a
+// region of exactly that range which owned its memory is dropped instead).
+// Returns: the memory (for the host to look at between runs), or NULL on error
+uint8_t *multicore_share(multicore_t *multicore, uint8_t bank, uint16_t start, uint16_t end);
+
+// Turn length in cycles (at least 1)
+void multicore_set_quantum(multicore_t *multicore, uint32_t cycles);
+void multicore_set_threaded(multicore_t *multicore, bool threaded);
+
+// Run every core `cycles` further.  A core stopped on STP sits out its turns.
+// Returns: 0 on success, -1 if threads could not be started
+int multicore_run(multicore_t *multicore, uint64_t cycles);
+
+void multicore_get_stats(const multicore_t *multicore, multicore_stats_t *stats);
+
+#endif // __MULTICORE_H__
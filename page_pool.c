@@ -0,0 +1,235 @@
+#define _GNU_SOURCE
+#include "page_pool.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// Reference counts live in lazily allocated chunks so slot lookups need no lock
+#define REF_CHUNK_SHIFT 16
+#define REF_CHUNK_SIZE  (1u << REF_CHUNK_SHIFT)
+#define REF_CHUNK_COUNT (1u << (32 - REF_CHUNK_SHIFT))
+
+// The backing file grows in large sparse steps
+#define POOL_GROW_BYTES ((off_t)1 << 30)
+
+static pthread_mutex_t g_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static int g_pool_fd = -1;
+static off_t g_pool_size = 0;
+static uint64_t g_next_slot = 0;
+static _Atomic uint32_t *g_refs[REF_CHUNK_COUNT];
+
+// Freed slots as coalesced extents sorted by first slot, reused first fit.
+// The last extent never reaches g_next_slot: that much is given back to the
+// bump allocator instead.
+typedef struct pool_extent_s {
+    page_slot_t first;
+    uint32_t count;
+} pool_extent_t;
+
+static pool_extent_t *g_free = NULL;
+static uint32_t g_free_count = 0;
+static uint32_t g_free_capacity = 0;
+
+static inline _Atomic uint32_t *slot_refs(page_slot_t slot) {
+    return &g_refs[slot >> REF_CHUNK_SHIFT][slot & (REF_CHUNK_SIZE - 1)];
+}
+
+// Make room for slots below `end`.  Called with the lock held.
+static int pool_reserve_locked(uint64_t end) {
+    if (g_pool_fd < 0) {
+        g_pool_fd = memfd_create("65816-ram", MFD_CLOEXEC);
+        if (g_pool_fd < 0) {
+            perror("memfd_create");
+            return -1;
+        }
+    }
+    if (end > (uint64_t)UINT32_MAX + 1) {
+        fprintf(stderr, "Error: Page pool exhausted\n");
+        return -1;
+    }
+
+    for (uint64_t chunk = g_next_slot >> REF_CHUNK_SHIFT;
+         chunk <= (end - 1) >> REF_CHUNK_SHIFT; chunk++) {
+        if (!g_refs[chunk]) {
+            g_refs[chunk] = (_Atomic uint32_t *)calloc(REF_CHUNK_SIZE, sizeof(uint32_t));
+            if (!g_refs[chunk]) {
+                return -1;
+            }
+        }
+    }
+
+    off_t needed = (off_t)end * PAGE_POOL_PAGE_SIZE;
+    if (needed > g_pool_size) {
+        off_t size = (needed + POOL_GROW_BYTES - 1) & ~(POOL_GROW_BYTES - 1);
+        if (ftruncate(g_pool_fd, size) != 0) {
+            perror("ftruncate");
+            return -1;
+        }
+        g_pool_size = size;
+    }
+    return 0;
+}
+
+int page_pool_fd(void) {
+    return g_pool_fd;
+}
+
+off_t page_pool_offset(page_slot_t slot) {
+    return (off_t)slot * PAGE_POOL_PAGE_SIZE;
+}
+
+// First freed extent with room for `count`.  Called with the lock held.
+static bool take_free_locked(uint32_t count, page_slot_t *first) {
+    for (uint32_t i = 0; i < g_free_count; i++) {
+        pool_extent_t *extent = &g_free[i];
+        if (extent->count < count) {
+            continue;
+        }
+        *first = extent->first;
+        extent->first += count;
+        extent->count -= count;
+        if (extent->count == 0) {
+            g_free_count--;
+            memmove(extent, extent + 1, (g_free_count - i) * sizeof(pool_extent_t));
+        }
+        return true;
+    }
+    return false;
+}
+
+int page_pool_alloc_run(uint32_t count, page_slot_t *first) {
+    pthread_mutex_lock(&g_pool_lock);
+    if (count == 0) {
+        pthread_mutex_unlock(&g_pool_lock);
+        return -1;
+    }
+    if (!take_free_locked(count, first)) {
+        if (pool_reserve_locked(g_next_slot + count) != 0) {
+            pthread_mutex_unlock(&g_pool_lock);
+            return -1;
+        }
+        *first = (page_slot_t)g_next_slot;
+        g_next_slot += count;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        atomic_store_explicit(slot_refs(*first + i), 1, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&g_pool_lock);
+    return 0;
+}
+
+int page_pool_alloc(page_slot_t *slot) {
+    return page_pool_alloc_run(1, slot);
+}
+
+uint64_t page_pool_high_water(void) {
+    pthread_mutex_lock(&g_pool_lock);
+    uint64_t slots = g_next_slot;
+    pthread_mutex_unlock(&g_pool_lock);
+    return slots;
+}
+
+void page_pool_ref(page_slot_t slot) {
+    atomic_fetch_add_explicit(slot_refs(slot), 1, memory_order_relaxed);
+}
+
+uint32_t page_pool_refs(page_slot_t slot) {
+    return atomic_load_explicit(slot_refs(slot), memory_order_acquire);
+}
+
+void page_pool_punch(page_slot_t first, uint32_t count) {
+    fallocate(g_pool_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+              page_pool_offset(first), (off_t)count * PAGE_POOL_PAGE_SIZE);
+}
+
+// Lower the bump allocator past free slots at the top, with the reference
+// chunks only they used.  Called with the lock held.
+static void trim_top_locked(void) {
+    while (g_free_count > 0) {
+        pool_extent_t *last = &g_free[g_free_count - 1];
+        if ((uint64_t)last->first + last->count != g_next_slot) {
+            break;
+        }
+        g_next_slot = last->first;
+        g_free_count--;
+    }
+    uint64_t chunk = (g_next_slot + REF_CHUNK_SIZE - 1) >> REF_CHUNK_SHIFT;
+    for (; chunk < REF_CHUNK_COUNT && g_refs[chunk]; chunk++) {
+        free((void *)g_refs[chunk]);
+        g_refs[chunk] = NULL;
+    }
+}
+
+static void pool_free_range(page_slot_t first, uint32_t count) {
+    // Give the memory back; a punched hole reads as zero when reused
+    page_pool_punch(first, count);
+
+    pthread_mutex_lock(&g_pool_lock);
+
+    // Extent to merge with or insert before
+    uint32_t low = 0, high = g_free_count;
+    while (low < high) {
+        uint32_t middle = (low + high) / 2;
+        if (g_free[middle].first < first) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    bool before = low > 0 && g_free[low - 1].first + g_free[low - 1].count == first;
+    bool after = low < g_free_count && first + count == g_free[low].first;
+    if (before && after) {
+        g_free[low - 1].count += count + g_free[low].count;
+        g_free_count--;
+        memmove(&g_free[low], &g_free[low + 1], (g_free_count - low) * sizeof(pool_extent_t));
+    } else if (before) {
+        g_free[low - 1].count += count;
+    } else if (after) {
+        g_free[low].first = first;
+        g_free[low].count += count;
+    } else {
+        if (g_free_count == g_free_capacity) {
+            uint32_t capacity = g_free_capacity ? g_free_capacity * 2 : 64;
+            pool_extent_t *extents = (pool_extent_t *)realloc(g_free, capacity * sizeof(pool_extent_t));
+            if (!extents) {
+                // The slots are leaked (as holes) rather than reused
+                pthread_mutex_unlock(&g_pool_lock);
+                return;
+            }
+            g_free = extents;
+            g_free_capacity = capacity;
+        }
+        memmove(&g_free[low + 1], &g_free[low], (g_free_count - low) * sizeof(pool_extent_t));
+        g_free[low] = (pool_extent_t){ .first = first, .count = count };
+        g_free_count++;
+    }
+    trim_top_locked();
+    pthread_mutex_unlock(&g_pool_lock);
+}
+
+void page_pool_release_run(page_slot_t first, uint32_t count) {
+    uint32_t freed_start = 0;
+    uint32_t freed = 0;
+
+    // Free maximal runs of slots whose last reference went away together
+    for (uint32_t i = 0; i < count; i++) {
+        if (atomic_fetch_sub_explicit(slot_refs(first + i), 1, memory_order_acq_rel) == 1) {
+            if (freed == 0) {
+                freed_start = i;
+            }
+            freed++;
+        } else if (freed > 0) {
+            pool_free_range(first + freed_start, freed);
+            freed = 0;
+        }
+    }
+    if (freed > 0) {
+        pool_free_range(first + freed_start, freed);
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef __PAGE_POOL_H__
+#define __PAGE_POOL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+// Process-wide pool of 4KB page slots kept in one memfd.  Machine memory is
+// mapped MAP_SHARED from slots, so several machines can map the same slot and
+// share a page; each slot carries a reference count of the maps using it.
+// Unused slots are hole-punched, so they cost no memory.
+
+typedef uint32_t page_slot_t;
+
+#define PAGE_POOL_PAGE_SIZE 4096
+
+// File descriptor and byte offset of a slot, for mmap()/pwrite()
+int page_pool_fd(void);
+off_t page_pool_offset(page_slot_t slot);
+
+// Allocate `count` contiguous zeroed slots, each with one reference, from
+// freed slots when a run of them is long enough
+// Returns: 0 on success, -1 on error
+int page_pool_alloc_run(uint32_t count, page_slot_t *first);
+
+// Allocate a single zeroed slot with one reference
+// Returns: 0 on success, -1 on error
+int page_pool_alloc(page_slot_t *slot);
+
+// One past the highest slot in use.  Freed slots are reused first fit and
+// free slots at the top are given back, so this follows the live peak.
+uint64_t page_pool_high_water(void);
+
+// Reference counting.  Releasing the last reference frees the slot.
+void page_pool_ref(page_slot_t slot);
+uint32_t page_pool_refs(page_slot_t slot);
+void page_pool_release_run(page_slot_t first, uint32_t count);
+
+// Discard the contents of slots the caller holds alone; they stay allocated
+// and read back as zero
+void page_pool_punch(page_slot_t first, uint32_t count);
+
+#endif // __PAGE_POOL_H__
@@ -0,0 +1,61 @@
+#include "perfctr.h"
+#include "machine_setup.h"
+#include <string.h>
+
+void perfctr_init(perfctr_t *perf) {
+    memset(perf, 0, sizeof(perfctr_t));
+}
+
+uint64_t perfctr_counter(machine_state_t *machine, uint8_t counter) {
+    machine_hardware_t *hw = machine->hardware;
+    switch (counter) {
+        case PERFCTR_CYCLES:       return machine->cycles;
+        case PERFCTR_INSTRUCTIONS: return machine->counters.instructions;
+        case PERFCTR_IRQS:         return machine->counters.irqs_taken;
+        case PERFCTR_WAI_CYCLES:   return machine->counters.wai_cycles;
+        case PERFCTR_DMA_CYCLES:   return hw && hw->dma_initialized ? hw->dma.stolen_cycles : 0;
+        default:                   return 0;
+    }
+}
+
+uint8_t perfctr_read(perfctr_t *perf, uint8_t reg) {
+    if (reg >= PERFCTR_VALUE0 && reg <= PERFCTR_VALUE7) {
+        return (perf->latch >> ((reg - PERFCTR_VALUE0) * 8)) & 0xFF;
+    }
+    switch (reg) {
+        case PERFCTR_SELECT: return perf->select;
+        case PERFCTR_MARK:   return perf->mark;
+        default:             return 0xFF;
+    }
+}
+
+void perfctr_write(perfctr_t *perf, machine_state_t *machine, uint8_t reg, uint8_t value) {
+    switch (reg) {
+        case PERFCTR_SELECT:
+            perf->select = value;
+            perf->latch = perfctr_counter(machine, value);
+            break;
+        case PERFCTR_MARK:
+            perf->mark = value;
+            if (perf->mark_callback) {
+                perf->mark_callback(perf->mark_context, value, machine->cycles,
+                                    machine->counters.instructions);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void perfctr_set_mark_callback(perfctr_t *perf, perfctr_mark_fn callback, void *context) {
+    perf->mark_callback = callback;
+    perf->mark_context = context;
+}
+
+void perfctr_copy_state(perfctr_t *dst, const perfctr_t *src) {
+    perfctr_mark_fn callback = dst->mark_callback;
+    void *context = dst->mark_context;
+    *dst = *src;
+    dst->mark_callback = callback;
+    dst->mark_context = context;
+}
@@ -0,0 +1,60 @@
+#ifndef __PERFCTR_H__
+#define __PERFCTR_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "machine.h"
+
+// Performance counters
+//
+// Lets guest code time itself.  Writing a counter number to PERFCTR_SELECT
+// latches that counter's 64-bit value, which then reads back a byte at a time
+// from PERFCTR_VALUE0-7 without tearing.  Values are as of the start of the
+// instruction doing the write.
+//
+// Writing to PERFCTR_MARK hands the host the mark number and the current
+// cycle and instruction counts (see perfctr_set_mark_callback()), so a
+// benchmark can report its own timings, e.g. to CI, without the host
+// scraping guest memory.
+
+// Register offsets
+#define PERFCTR_SELECT   0x00  // Write: latch a counter; read: counter last latched
+#define PERFCTR_MARK     0x01  // Write: report a mark to the host; read: last mark
+#define PERFCTR_VALUE0   0x08  // Latched value, bits 0-7
+#define PERFCTR_VALUE7   0x0F  //                bits 56-63
+
+// Counters
+#define PERFCTR_CYCLES        0x00  // Machine cycles since power-on
+#define PERFCTR_INSTRUCTIONS  0x01  // Instructions retired
+#define PERFCTR_IRQS          0x02  // Hardware interrupts taken
+#define PERFCTR_WAI_CYCLES    0x03  // Cycles spent waiting in WAI
+#define PERFCTR_DMA_CYCLES    0x04  // Cycles stolen by the DMA controller
+#define PERFCTR_COUNTERS      5     // Others read as 0
+
+typedef void (*perfctr_mark_fn)(void *context, uint8_t mark, uint64_t cycles, uint64_t instructions);
+
+typedef struct perfctr_s {
+    uint8_t select;
+    uint8_t mark;
+    uint64_t latch;
+
+    // Host callback for PERFCTR_MARK (optional)
+    perfctr_mark_fn mark_callback;
+    void *mark_context;
+} perfctr_t;
+
+void perfctr_init(perfctr_t *perf);
+
+// Register access; `machine` supplies the counters
+uint8_t perfctr_read(perfctr_t *perf, uint8_t reg);
+void perfctr_write(perfctr_t *perf, machine_state_t *machine, uint8_t reg, uint8_t value);
+
+// Current value of a PERFCTR_* counter
+uint64_t perfctr_counter(machine_state_t *machine, uint8_t counter);
+
+void perfctr_set_mark_callback(perfctr_t *perf, perfctr_mark_fn callback, void *context);
+
+// Copy register state, keeping dst's callback
+void perfctr_copy_state(perfctr_t *dst, const perfctr_t *src);
+
+#endif // __PERFCTR_H__
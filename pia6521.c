@@ -1,10 +1,13 @@
 #include "pia6521.h"
+#include "gpio_shm.h"
 #include <string.h>
 
 static void update_irqa(pia6521_t* pia);
 static void update_irqb(pia6521_t* pia);
 static void update_ca2_output(pia6521_t* pia);
 static void update_cb2_output(pia6521_t* pia);
+static void gpio_take_inputs(pia6521_t* pia);
+static void gpio_publish(pia6521_t* pia);
 
 void pia6521_init(pia6521_t* pia) {
     memset(pia, 0, sizeof(pia6521_t));
@@ -36,11 +39,15 @@ uint8_t pia6521_read(pia6521_t* pia, uint8_t reg) {
     
     reg &= 0x03;  // Only 4 registers
     
+    if (pia->gpio) {
+        gpio_take_inputs(pia);
+    }
+    
     switch (reg) {
         case PIA_PORTA_DATA: {
             if (pia->porta_ctrl & PIA_CR_DDR_ACCESS) {
                 // Access Port A data register
-                uint8_t input = 0;
+                uint8_t input = pia->gpio ? pia->gpio_porta : 0;
                 if (pia->porta_read) {
                     input = pia->porta_read(pia->callback_context);
                 }
@@ -82,7 +89,7 @@ uint8_t pia6521_read(pia6521_t* pia, uint8_t reg) {
         case PIA_PORTB_DATA: {
             if (pia->portb_ctrl & PIA_CR_DDR_ACCESS) {
                 // Access Port B data register
-                uint8_t input = 0;
+                uint8_t input = pia->gpio ? pia->gpio_portb : 0;
                 if (pia->portb_read) {
                     input = pia->portb_read(pia->callback_context);
                 }
@@ -122,12 +129,19 @@ uint8_t pia6521_read(pia6521_t* pia, uint8_t reg) {
         }
     }
     
+    if (pia->gpio) {
+        gpio_publish(pia);
+    }
     return value;
 }
 
 void pia6521_write(pia6521_t* pia, uint8_t reg, uint8_t value) {
     reg &= 0x03;
     
+    if (pia->gpio) {
+        gpio_take_inputs(pia);
+    }
+    
     switch (reg) {
         case PIA_PORTA_DATA: {
             if (pia->porta_ctrl & PIA_CR_DDR_ACCESS) {
@@ -204,6 +218,10 @@ void pia6521_write(pia6521_t* pia, uint8_t reg, uint8_t value) {
             break;
         }
     }
+    
+    if (pia->gpio) {
+        gpio_publish(pia);
+    }
 }
 
 void pia6521_set_ca1(pia6521_t* pia, bool state) {
@@ -370,6 +388,33 @@ void pia6521_set_irqb_callback(pia6521_t* pia,
     pia->irq_context = context;
 }
 
+void pia6521_attach_gpio(pia6521_t* pia, struct gpio_shm_chip_s* chip) {
+    pia->gpio = chip;
+    pia->gpio_seen = 1;  // Odd, so the current inputs are taken
+    if (chip) {
+        gpio_take_inputs(pia);
+        gpio_publish(pia);
+    }
+}
+
+// Copy register/control line state from src, keeping dst's callbacks
+void pia6521_copy_state(pia6521_t* dst, const pia6521_t* src) {
+    pia6521_t wiring = *dst;
+    *dst = *src;
+    dst->porta_read = wiring.porta_read;
+    dst->porta_write = wiring.porta_write;
+    dst->portb_read = wiring.portb_read;
+    dst->portb_write = wiring.portb_write;
+    dst->callback_context = wiring.callback_context;
+    dst->irqa_callback = wiring.irqa_callback;
+    dst->irqb_callback = wiring.irqb_callback;
+    dst->irq_context = wiring.irq_context;
+    dst->gpio = wiring.gpio;
+    dst->gpio_seen = wiring.gpio_seen;
+    dst->gpio_porta = wiring.gpio_porta;
+    dst->gpio_portb = wiring.gpio_portb;
+}
+
 // Internal helper functions
 
 static void update_irqa(pia6521_t* pia) {
@@ -451,3 +496,29 @@ static void update_cb2_output(pia6521_t* pia) {
             break;
     }
 }
+
+// Pins and control lines from the GPIO mirror, if the harness changed them
+static void gpio_take_inputs(pia6521_t* pia) {
+    gpio_shm_inputs_t inputs;
+    if (!gpio_shm_poll_inputs(pia->gpio, &pia->gpio_seen, &inputs)) {
+        return;
+    }
+    pia->gpio_porta = inputs.port_a;
+    pia->gpio_portb = inputs.port_b;
+    pia6521_set_ca1(pia, inputs.lines & GPIO_SHM_CA1);
+    pia6521_set_ca2_input(pia, inputs.lines & GPIO_SHM_CA2);
+    pia6521_set_cb1(pia, inputs.lines & GPIO_SHM_CB1);
+    pia6521_set_cb2_input(pia, inputs.lines & GPIO_SHM_CB2);
+}
+
+static void gpio_publish(pia6521_t* pia) {
+    gpio_shm_outputs_t outputs = {
+        .port_a = pia->porta_data,
+        .port_b = pia->portb_data,
+        .ddr_a = pia->porta_ddr,
+        .ddr_b = pia->portb_ddr,
+        .lines = (pia->ca1 ? GPIO_SHM_CA1 : 0) | (pia->ca2 ? GPIO_SHM_CA2 : 0) |
+                 (pia->cb1 ? GPIO_SHM_CB1 : 0) | (pia->cb2 ? GPIO_SHM_CB2 : 0),
+    };
+    gpio_shm_publish(pia->gpio, &outputs);
+}
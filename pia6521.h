@@ -65,6 +65,12 @@ typedef struct pia6521_s {
     void (*irqa_callback)(void* context, bool state);
     void (*irqb_callback)(void* context, bool state);
     void* irq_context;
+    
+    // Shared-memory GPIO mirror (optional, see gpio_shm.h)
+    struct gpio_shm_chip_s* gpio;
+    uint32_t gpio_seen;    // Input sequence number last taken
+    uint8_t gpio_porta;    // Pin levels last taken from the mirror
+    uint8_t gpio_portb;
 } pia6521_t;
 
 // Initialize a PIA chip
@@ -105,4 +111,13 @@ void pia6521_set_irqb_callback(pia6521_t* pia,
                                 void (*irq_fn)(void*, bool),
                                 void* context);
 
+// Mirror the ports into a GPIO shared memory chip (NULL detaches).  The
+// mirror's pins are read unless a port read callback is set, and its control
+// lines drive CA1/CA2/CB1/CB2.  Inputs are taken and outputs published on
+// register access.
+void pia6521_attach_gpio(pia6521_t* pia, struct gpio_shm_chip_s* chip);
+
+// Copy register/control line state from src, keeping dst's callbacks
+void pia6521_copy_state(pia6521_t* dst, const pia6521_t* src);
+
 #endif // __PIA6521_H__
@@ -0,0 +1,372 @@
+#include "runner.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "machine_setup.h"
+#include "acia6551.h"
+#include "spsc_ring.h"
+
+typedef struct runner_command_s {
+    runner_command_fn fn;
+    void *context;
+    bool *done;                // Set once fn has run (runner_call() only)
+} runner_command_t;
+
+struct runner_s {
+    machine_state_t *machine;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;       // Emulation thread: commands, settings, stop
+    pthread_cond_t done;       // runner_call() callers
+    bool running;
+    bool stop;
+    bool resume;               // Leave an STP halt
+
+    // Settings, under lock
+    uint64_t clock_hz;
+    bool turbo;
+    bool settings_changed;
+
+    // Commands, under lock
+    runner_command_t queue[RUNNER_COMMAND_QUEUE];
+    size_t queue_head;
+    size_t queue_count;
+
+    // Published by the emulation thread after each slice, under lock
+    runner_metrics_t metrics;
+    uint64_t started_ns;
+    uint64_t console_dropped;
+
+    // Console: guest output waiting for the host
+    acia6551_t *console;
+    spsc_ring_t console_out;
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Emulated time of `cycles` at `hz`, without overflowing on long runs
+static uint64_t cycles_to_ns(uint64_t cycles, uint64_t hz) {
+    return cycles / hz * 1000000000ULL + cycles % hz * 1000000000ULL / hz;
+}
+
+static void console_tx(void *context, uint8_t byte) {
+    runner_t *runner = (runner_t *)context;
+    if (!spsc_ring_push_byte(&runner->console_out, byte)) {
+        runner->console_dropped++;
+    }
+}
+
+// Run queued commands with the lock dropped.  Called and returns with the
+// lock held.
+// Returns: true if any ran
+static bool run_commands(runner_t *runner) {
+    bool ran = false;
+    while (runner->queue_count > 0) {
+        runner_command_t command = runner->queue[runner->queue_head];
+        runner->queue_head = (runner->queue_head + 1) % RUNNER_COMMAND_QUEUE;
+        runner->queue_count--;
+
+        pthread_mutex_unlock(&runner->lock);
+        command.fn(runner->machine, command.context);
+        pthread_mutex_lock(&runner->lock);
+        if (command.done) {
+            *command.done = true;
+            pthread_cond_broadcast(&runner->done);
+        }
+        ran = true;
+    }
+    return ran;
+}
+
+// Sleep until `deadline` on the monotonic clock unless woken first
+static void wait_until(runner_t *runner, uint64_t deadline) {
+    struct timespec ts = {
+        .tv_sec = (time_t)(deadline / 1000000000ULL),
+        .tv_nsec = (long)(deadline % 1000000000ULL),
+    };
+    pthread_cond_timedwait(&runner->wake, &runner->lock, &ts);
+}
+
+static void *runner_thread(void *arg) {
+    runner_t *runner = (runner_t *)arg;
+    machine_state_t *machine = runner->machine;
+    runner_metrics_t *metrics = &runner->metrics;
+
+    // Pacing baseline: emulated time since base_cycles should match wall
+    // time since base_ns
+    uint64_t base_ns = 0;
+    uint64_t base_cycles = 0;
+    uint64_t slice_start_ns = 0;
+    double paced_wall_ns = 0;
+    double paced_emulated_ns = 0;
+    bool rebase = true;
+    bool halted = false;
+
+    pthread_mutex_lock(&runner->lock);
+    for (;;) {
+        if (run_commands(runner)) {
+            rebase = true;
+        }
+        if (runner->stop) {
+            break;
+        }
+        if (runner->resume) {
+            runner->resume = false;
+            halted = false;
+            rebase = true;
+        }
+        if (halted) {
+            metrics->halted = true;
+            pthread_cond_wait(&runner->wake, &runner->lock);
+            continue;
+        }
+        metrics->halted = false;
+        if (runner->settings_changed) {
+            runner->settings_changed = false;
+            rebase = true;
+        }
+        uint64_t hz = runner->clock_hz;
+        bool turbo = runner->turbo;
+        pthread_mutex_unlock(&runner->lock);
+
+        if (rebase) {
+            base_ns = now_ns();
+            base_cycles = machine->cycles;
+            slice_start_ns = base_ns;
+            rebase = false;
+        }
+
+        // One slice, interrupts taken between instructions
+        uint64_t slice_cycles = hz / (1000000000ULL / RUNNER_SLICE_NS);
+        uint64_t end = machine->cycles + (slice_cycles ? slice_cycles : 1);
+        uint64_t first = machine->cycles;
+        uint64_t instructions = 0;
+        while (machine->cycles < end && !halted) {
+            if (!machine->processor.interrupts_disabled && machine_irq_sources(machine)) {
+                machine_process_interrupt(machine);
+            }
+            machine_execute_instruction(machine, &halted);
+            instructions++;
+        }
+
+        uint64_t now = now_ns();
+        uint64_t emulated = cycles_to_ns(machine->cycles - base_cycles, hz);
+        int64_t lag = (int64_t)(now - base_ns) - (int64_t)emulated;
+        if (!turbo) {
+            paced_wall_ns += (double)(now - slice_start_ns);
+            paced_emulated_ns += (double)cycles_to_ns(machine->cycles - first, hz);
+        }
+
+        pthread_mutex_lock(&runner->lock);
+        metrics->cycles += machine->cycles - first;
+        metrics->instructions += instructions;
+        metrics->slices++;
+        metrics->console_dropped = runner->console_dropped;
+        metrics->lag_ns = turbo ? 0 : lag;
+        if (!turbo && lag > metrics->max_lag_ns) {
+            metrics->max_lag_ns = lag;
+        }
+        if (paced_wall_ns > 0) {
+            metrics->drift_ppm = (paced_emulated_ns - paced_wall_ns) / paced_wall_ns * 1e6;
+        }
+        slice_start_ns = now;
+
+        if (turbo) {
+            rebase = true;
+        } else if (lag > (int64_t)RUNNER_MAX_LAG_NS) {
+            // Too far behind to catch up without a burst
+            metrics->resyncs++;
+            rebase = true;
+        } else if (-lag >= (int64_t)RUNNER_MIN_SLEEP_NS && runner->queue_count == 0 &&
+                   !runner->stop && !runner->settings_changed) {
+            wait_until(runner, base_ns + emulated);
+            uint64_t woke = now_ns();
+            metrics->sleeps++;
+            metrics->sleep_ns += woke - now;
+        }
+    }
+    pthread_mutex_unlock(&runner->lock);
+    return NULL;
+}
+
+runner_t *runner_create(machine_state_t *machine, uint64_t clock_hz) {
+    if (!machine || clock_hz == 0) {
+        return NULL;
+    }
+    runner_t *runner = (runner_t *)calloc(1, sizeof(runner_t));
+    if (!runner) {
+        return NULL;
+    }
+    runner->machine = machine;
+    runner->clock_hz = clock_hz;
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&runner->lock, NULL);
+    pthread_cond_init(&runner->wake, &attr);
+    pthread_cond_init(&runner->done, NULL);
+    pthread_condattr_destroy(&attr);
+    return runner;
+}
+
+void runner_destroy(runner_t *runner) {
+    if (!runner) {
+        return;
+    }
+    runner_stop(runner);
+    if (runner->console) {
+        acia6551_set_byte_callbacks(runner->console, NULL, NULL, NULL);
+    }
+    spsc_ring_free(&runner->console_out);
+    pthread_cond_destroy(&runner->done);
+    pthread_cond_destroy(&runner->wake);
+    pthread_mutex_destroy(&runner->lock);
+    free(runner);
+}
+
+int runner_start(runner_t *runner) {
+    pthread_mutex_lock(&runner->lock);
+    if (runner->running) {
+        pthread_mutex_unlock(&runner->lock);
+        return 0;
+    }
+    runner->stop = false;
+    if (!runner->started_ns) {
+        runner->started_ns = now_ns();
+    }
+    int rc = pthread_create(&runner->thread, NULL, runner_thread, runner);
+    runner->running = (rc == 0);
+    pthread_mutex_unlock(&runner->lock);
+    return rc == 0 ? 0 : -1;
+}
+
+void runner_stop(runner_t *runner) {
+    pthread_mutex_lock(&runner->lock);
+    if (!runner->running) {
+        pthread_mutex_unlock(&runner->lock);
+        return;
+    }
+    runner->stop = true;
+    pthread_cond_signal(&runner->wake);
+    pthread_mutex_unlock(&runner->lock);
+
+    pthread_join(runner->thread, NULL);
+
+    pthread_mutex_lock(&runner->lock);
+    runner->running = false;
+    runner->stop = false;
+    pthread_mutex_unlock(&runner->lock);
+}
+
+void runner_set_clock(runner_t *runner, uint64_t clock_hz) {
+    if (clock_hz == 0) {
+        return;
+    }
+    pthread_mutex_lock(&runner->lock);
+    runner->clock_hz = clock_hz;
+    runner->settings_changed = true;
+    pthread_cond_signal(&runner->wake);
+    pthread_mutex_unlock(&runner->lock);
+}
+
+void runner_set_turbo(runner_t *runner, bool turbo) {
+    pthread_mutex_lock(&runner->lock);
+    runner->turbo = turbo;
+    runner->settings_changed = true;
+    pthread_cond_signal(&runner->wake);
+    pthread_mutex_unlock(&runner->lock);
+}
+
+// Queue a command, or run it here when there is no emulation thread
+static int enqueue(runner_t *runner, runner_command_fn fn, void *context, bool wait) {
+    pthread_mutex_lock(&runner->lock);
+    if (!runner->running) {
+        pthread_mutex_unlock(&runner->lock);
+        fn(runner->machine, context);
+        return 0;
+    }
+    if (runner->queue_count == RUNNER_COMMAND_QUEUE) {
+        pthread_mutex_unlock(&runner->lock);
+        return -1;
+    }
+
+    bool done = false;
+    size_t tail = (runner->queue_head + runner->queue_count) % RUNNER_COMMAND_QUEUE;
+    runner->queue[tail] = (runner_command_t){ .fn = fn, .context = context, .done = wait ? &done : NULL };
+    runner->queue_count++;
+    pthread_cond_signal(&runner->wake);
+    while (wait && !done) {
+        pthread_cond_wait(&runner->done, &runner->lock);
+    }
+    pthread_mutex_unlock(&runner->lock);
+    return 0;
+}
+
+int runner_post(runner_t *runner, runner_command_fn fn, void *context) {
+    return enqueue(runner, fn, context, false);
+}
+
+int runner_call(runner_t *runner, runner_command_fn fn, void *context) {
+    return enqueue(runner, fn, context, true);
+}
+
+void runner_resume(runner_t *runner) {
+    pthread_mutex_lock(&runner->lock);
+    runner->resume = true;
+    pthread_cond_signal(&runner->wake);
+    pthread_mutex_unlock(&runner->lock);
+}
+
+void runner_get_metrics(runner_t *runner, runner_metrics_t *metrics) {
+    pthread_mutex_lock(&runner->lock);
+    *metrics = runner->metrics;
+    metrics->clock_hz = runner->clock_hz;
+    metrics->turbo = runner->turbo;
+    uint64_t elapsed = runner->started_ns ? now_ns() - runner->started_ns : 0;
+    pthread_mutex_unlock(&runner->lock);
+    metrics->effective_hz = elapsed ? (double)metrics->cycles * 1e9 / (double)elapsed : 0;
+}
+
+int runner_attach_console(runner_t *runner) {
+    if (runner->console) {
+        return 0;
+    }
+    if (spsc_ring_init(&runner->console_out, RUNNER_CONSOLE_SIZE) != 0) {
+        return -1;
+    }
+    runner->console = get_acia_instance(runner->machine);
+    acia6551_set_byte_callbacks(runner->console, console_tx, NULL, runner);
+    return 0;
+}
+
+size_t runner_console_write(runner_t *runner, const uint8_t *data, size_t length) {
+    if (!runner->console) {
+        return 0;
+    }
+    // Recorded, or ignored in a replay, when an I/O log is attached
+    iolog_t *log = runner->machine->hardware->iolog;
+    if (log) {
+        return iolog_send_acia(log, data, length);
+    }
+    size_t room = spsc_ring_free_space(&runner->console->rx_ring);
+    if (length > room) {
+        length = room;
+    }
+    for (size_t i = 0; i < length; i++) {
+        acia6551_receive_byte(runner->console, data[i]);
+    }
+    return length;
+}
+
+size_t runner_console_read(runner_t *runner, uint8_t *data, size_t length) {
+    if (!runner->console) {
+        return 0;
+    }
+    return spsc_ring_pop(&runner->console_out, data, length);
+}
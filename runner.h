@@ -0,0 +1,87 @@
+#ifndef __RUNNER_H__
+#define __RUNNER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "machine.h"
+
+// Threaded runner
+//
+// Runs a machine on its own thread in slices of about a millisecond of
+// emulated time, paced against the monotonic clock at a target rate (8 MHz,
+// 14 MHz, ...).  The thread only sleeps once it is at least
+// RUNNER_MIN_SLEEP_NS ahead of wall time, so sleeps are few and long rather
+// than one per instruction; a guest idling in WAI turns into sleep instead
+// of a busy core.  Turbo mode drops the pacing.
+//
+// While the runner is started, the machine belongs to its thread.  Host
+// threads reach it only through runner_post()/runner_call(), which run a
+// function on the emulation thread between slices, and through the console
+// queues.
+
+#define RUNNER_SLICE_NS       1000000ULL    // Emulated time per slice
+#define RUNNER_MIN_SLEEP_NS   2000000ULL    // Run ahead at least this far before sleeping
+#define RUNNER_MAX_LAG_NS     100000000ULL  // Behind by more than this: drop the debt and resync
+#define RUNNER_COMMAND_QUEUE  64
+#define RUNNER_CONSOLE_SIZE   4096
+
+typedef struct runner_s runner_t;
+
+typedef void (*runner_command_fn)(machine_state_t *machine, void *context);
+
+typedef struct runner_metrics_s {
+    uint64_t clock_hz;         // Target rate
+    bool turbo;
+    bool halted;               // Stopped on STP until runner_resume()
+    uint64_t cycles;           // Cycles run on the runner's thread
+    uint64_t instructions;
+    uint64_t slices;
+    uint64_t sleeps;           // Pacing sleeps taken
+    uint64_t sleep_ns;         // Wall time spent in them
+    uint64_t resyncs;          // Times the runner fell RUNNER_MAX_LAG_NS behind and gave up catching up
+    int64_t lag_ns;            // Wall time minus emulated time after the last slice (> 0: behind)
+    int64_t max_lag_ns;
+    double drift_ppm;          // Paced rate error against the target, over all paced time
+    double effective_hz;       // Cycles per wall second since start
+    uint64_t console_dropped;  // Guest console output lost with the host queue full
+} runner_metrics_t;
+
+// Runner for `machine` at `clock_hz`; nothing runs until runner_start()
+// Returns: runner, or NULL on failure
+runner_t *runner_create(machine_state_t *machine, uint64_t clock_hz);
+
+// Stop the thread if running and free the runner (not the machine)
+void runner_destroy(runner_t *runner);
+
+// Start or stop the emulation thread.  Stopping waits for the current slice.
+// Returns: 0 on success, -1 on error
+int runner_start(runner_t *runner);
+void runner_stop(runner_t *runner);
+
+void runner_set_clock(runner_t *runner, uint64_t clock_hz);
+void runner_set_turbo(runner_t *runner, bool turbo);
+
+// Run fn(machine, context) on the emulation thread before its next slice.
+// runner_call() also waits for it to finish.  Either one runs fn at once
+// when the runner is stopped.
+// Returns: 0 on success, -1 if the queue is full
+int runner_post(runner_t *runner, runner_command_fn fn, void *context);
+int runner_call(runner_t *runner, runner_command_fn fn, void *context);
+
+// Leave an STP halt, typically after a command has reset the CPU
+void runner_resume(runner_t *runner);
+
+void runner_get_metrics(runner_t *runner, runner_metrics_t *metrics);
+
+// Serial console through the machine's ACIA.  Guest output is queued for the
+// host; host input goes into the ACIA's receive FIFO, never more than fits,
+// or through the machine's I/O log if one is attached (machine_attach_iolog()).
+// Call runner_attach_console() before runner_start().  The read and write
+// calls may come from one host thread each.
+// Returns: 0 on success, -1 on error
+int runner_attach_console(runner_t *runner);
+size_t runner_console_write(runner_t *runner, const uint8_t *data, size_t length);
+size_t runner_console_read(runner_t *runner, uint8_t *data, size_t length);
+
+#endif // __RUNNER_H__
@@ -0,0 +1,127 @@
+#include "scheduler.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void sift_up(scheduler_t *scheduler, size_t index) {
+    scheduler_event_t event = scheduler->events[index];
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (scheduler->events[parent].when <= event.when) {
+            break;
+        }
+        scheduler->events[index] = scheduler->events[parent];
+        index = parent;
+    }
+    scheduler->events[index] = event;
+}
+
+static void sift_down(scheduler_t *scheduler, size_t index) {
+    scheduler_event_t event = scheduler->events[index];
+    for (;;) {
+        size_t child = index * 2 + 1;
+        if (child >= scheduler->count) {
+            break;
+        }
+        if (child + 1 < scheduler->count &&
+            scheduler->events[child + 1].when < scheduler->events[child].when) {
+            child++;
+        }
+        if (event.when <= scheduler->events[child].when) {
+            break;
+        }
+        scheduler->events[index] = scheduler->events[child];
+        index = child;
+    }
+    scheduler->events[index] = event;
+}
+
+static void remove_at(scheduler_t *scheduler, size_t index) {
+    scheduler->count--;
+    if (index == scheduler->count) {
+        return;
+    }
+    scheduler->events[index] = scheduler->events[scheduler->count];
+    sift_down(scheduler, index);
+    sift_up(scheduler, index);
+}
+
+static size_t find_event(const scheduler_t *scheduler, scheduler_event_fn fn, void *context) {
+    for (size_t i = 0; i < scheduler->count; i++) {
+        if (scheduler->events[i].fn == fn && scheduler->events[i].context == context) {
+            return i;
+        }
+    }
+    return SIZE_MAX;
+}
+
+scheduler_t *scheduler_create(void) {
+    return (scheduler_t *)calloc(1, sizeof(scheduler_t));
+}
+
+void scheduler_destroy(scheduler_t *scheduler) {
+    if (!scheduler) {
+        return;
+    }
+    free(scheduler->events);
+    free(scheduler);
+}
+
+scheduler_t *scheduler_clone(const scheduler_t *scheduler) {
+    scheduler_t *clone = scheduler_create();
+    if (!clone || scheduler->count == 0) {
+        return clone;
+    }
+    clone->events = (scheduler_event_t *)malloc(scheduler->count * sizeof(scheduler_event_t));
+    if (!clone->events) {
+        free(clone);
+        return NULL;
+    }
+    memcpy(clone->events, scheduler->events, scheduler->count * sizeof(scheduler_event_t));
+    clone->count = scheduler->count;
+    clone->capacity = scheduler->count;
+    return clone;
+}
+
+int scheduler_schedule(scheduler_t *scheduler, uint64_t when, scheduler_event_fn fn, void *context) {
+    size_t index = find_event(scheduler, fn, context);
+    if (index != SIZE_MAX) {
+        scheduler->events[index].when = when;
+        sift_down(scheduler, index);
+        sift_up(scheduler, index);
+        return 0;
+    }
+
+    if (scheduler->count == scheduler->capacity) {
+        size_t capacity = scheduler->capacity ? scheduler->capacity * 2 : 8;
+        scheduler_event_t *events = (scheduler_event_t *)realloc(scheduler->events,
+                                                                 capacity * sizeof(scheduler_event_t));
+        if (!events) {
+            return -1;
+        }
+        scheduler->events = events;
+        scheduler->capacity = capacity;
+    }
+    scheduler->events[scheduler->count] = (scheduler_event_t){ .when = when, .fn = fn, .context = context };
+    sift_up(scheduler, scheduler->count++);
+    return 0;
+}
+
+void scheduler_cancel(scheduler_t *scheduler, scheduler_event_fn fn, void *context) {
+    size_t index = find_event(scheduler, fn, context);
+    if (index != SIZE_MAX) {
+        remove_at(scheduler, index);
+    }
+}
+
+void scheduler_clear(scheduler_t *scheduler) {
+    scheduler->count = 0;
+}
+
+void scheduler_run(scheduler_t *scheduler, machine_state_t *machine, uint64_t now) {
+    while (scheduler->count && scheduler->events[0].when <= now) {
+        scheduler_event_t event = scheduler->events[0];
+        remove_at(scheduler, 0);
+        event.fn(machine, event.context);
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "machine.h"
+
+// Device event scheduler
+//
+// Pending device events in a binary min-heap ordered by machine cycle.  Each
+// event is identified by its callback and context; a device keeps at most one
+// and moves it with scheduler_schedule() whenever its next state change moves
+// (a timer underflow, the end of a serial character, ...).  Between events
+// the CPU loop only compares the cycle counter with scheduler_next().
+
+typedef void (*scheduler_event_fn)(machine_state_t *machine, void *context);
+
+typedef struct scheduler_event_s {
+    uint64_t when;              // Machine cycle the event is due at
+    scheduler_event_fn fn;
+    void *context;
+} scheduler_event_t;
+
+struct scheduler_s {
+    scheduler_event_t *events;  // Heap, earliest first
+    size_t count;
+    size_t capacity;
+};
+
+scheduler_t *scheduler_create(void);
+void scheduler_destroy(scheduler_t *scheduler);
+
+// Copy of every pending event (for machine_clone())
+scheduler_t *scheduler_clone(const scheduler_t *scheduler);
+
+// Add the (fn, context) event at `when`, or move it there if already pending.
+// Lookups are linear; a machine only has a handful of devices.
+// Returns: 0 on success, -1 on error
+int scheduler_schedule(scheduler_t *scheduler, uint64_t when, scheduler_event_fn fn, void *context);
+
+// Drop the (fn, context) event if pending
+void scheduler_cancel(scheduler_t *scheduler, scheduler_event_fn fn, void *context);
+
+// Forget every pending event
+void scheduler_clear(scheduler_t *scheduler);
+
+// Cycle of the earliest pending event, UINT64_MAX if there is none
+static inline uint64_t scheduler_next(const scheduler_t *scheduler) {
+    return scheduler->count ? scheduler->events[0].when : UINT64_MAX;
+}
+
+// Fire every event due at or before `now`, earliest first.  Events are
+// removed before their callback runs, so callbacks may schedule again.
+void scheduler_run(scheduler_t *scheduler, machine_state_t *machine, uint64_t now);
+
+#endif // __SCHEDULER_H__
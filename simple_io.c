@@ -3,9 +3,17 @@
  */
 
 #include <stddef.h>
+#include <string.h>
+#include <time.h>
 #include "simple_io.h"
 #include "via6522.h"
 
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
 // Check if data is available to read from USB
 bool io_data_available(fifo_t *fifo) {
     uint8_t portb = board_fifo_read_via(fifo, VIA_ORB_IRB);
@@ -18,67 +26,65 @@ bool io_space_available(fifo_t *fifo) {
     return !(portb & PORTB_TXE_N);  // TXE# is active low
 }
 
-// Read a byte from USB/FIFO (blocking)
-uint8_t io_read_byte(fifo_t *fifo) {
-    // Wait for data available
-    while (!io_data_available(fifo)) {
-        board_fifo_clock(fifo);
+// Milliseconds left until `deadline` (monotonic ns); -1 stays forever
+static int remaining_ms(int timeout_ms, uint64_t deadline) {
+    if (timeout_ms < 0) {
+        return -1;
     }
-    
-    // Set Port A as input for reading
-    board_fifo_write_via(fifo, VIA_DDRA, 0x00);
-    
-    // Assert RD# (clear bit 0)
-    board_fifo_write_via(fifo, VIA_ORB_IRB, 0x00);
-    
-    // Clock to process read
-    for (int i = 0; i < 5; i++) {
-        board_fifo_clock(fifo);
+    uint64_t now = monotonic_ns();
+    return now >= deadline ? 0 : (int)((deadline - now + 999999) / 1000000);
+}
+
+bool io_wait_readable(fifo_t *fifo, int timeout_ms) {
+    return board_fifo_wait(fifo, BOARD_FIFO_READABLE, timeout_ms) != 0;
+}
+
+bool io_wait_writable(fifo_t *fifo, int timeout_ms) {
+    return board_fifo_wait(fifo, BOARD_FIFO_WRITABLE, timeout_ms) != 0;
+}
+
+// Wait once for data, then drain the FIFO into the buffer
+size_t io_read_block(fifo_t *fifo, uint8_t *buffer, size_t length, int timeout_ms) {
+    if (length == 0 || !io_wait_readable(fifo, timeout_ms)) {
+        return 0;
     }
-    
-    // Read data from Port A
-    uint8_t data = board_fifo_read_via(fifo, VIA_ORA_IRA);
-    
-    // Deassert RD# (set bit 0)
-    board_fifo_write_via(fifo, VIA_ORB_IRB, PORTB_RD_N);
-    
-    board_fifo_clock(fifo);
-    
-    // Set Port A back to output for writing
-    board_fifo_write_via(fifo, VIA_DDRA, 0xFF);
-    
+    size_t count = 0;
+    while (count < length && board_fifo_fast_read(fifo, &buffer[count])) {
+        count++;
+    }
+    return count;
+}
+
+// Fill the TX FIFO, then sleep until the host makes room, until done
+size_t io_write_block(fifo_t *fifo, const uint8_t *buffer, size_t length, int timeout_ms) {
+    uint64_t deadline = timeout_ms > 0 ? monotonic_ns() + (uint64_t)timeout_ms * 1000000ULL : 0;
+    size_t count = 0;
+    while (count < length) {
+        while (count < length && board_fifo_fast_write(fifo, buffer[count])) {
+            count++;
+        }
+        if (count < length && !io_wait_writable(fifo, remaining_ms(timeout_ms, deadline))) {
+            break;
+        }
+    }
+    return count;
+}
+
+// Read a byte from USB/FIFO (blocking)
+uint8_t io_read_byte(fifo_t *fifo) {
+    uint8_t data;
+    io_read_block(fifo, &data, 1, -1);
     return data;
 }
 
 // Write a byte to USB/FIFO (blocking)
 void io_write_byte(fifo_t *fifo, uint8_t data) {
-    // Wait for space available
-    while (!io_space_available(fifo)) {
-        board_fifo_clock(fifo);
-    }
-    
-    // Write data to Port A
-    board_fifo_write_via(fifo, VIA_ORA_IRA, data);
-    
-    // Assert WR (set bit 1)
-    board_fifo_write_via(fifo, VIA_ORB_IRB, PORTB_RD_N | PORTB_WR);
-    
-    // Clock to process write
-    for (int i = 0; i < 5; i++) {
-        board_fifo_clock(fifo);
-    }
-    
-    // Deassert WR (clear bit 1)
-    board_fifo_write_via(fifo, VIA_ORB_IRB, PORTB_RD_N);
-    
-    board_fifo_clock(fifo);
+    io_write_block(fifo, &data, 1, -1);
 }
 
 // Write a string to USB/FIFO
 void io_write_string(fifo_t *fifo, const char *str) {
-    while (*str) {
-        io_write_byte(fifo, *str++);
-    }
+    io_write_block(fifo, (const uint8_t *)str, strlen(str), -1);
 }
 
 // Initialize the IO system
@@ -10,6 +10,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "board_fifo.h"
 
 // Initialize the IO system
@@ -22,6 +23,20 @@ bool io_data_available(fifo_t *fifo);
 // Check if space is available to write to USB
 bool io_space_available(fifo_t *fifo);
 
+// Sleep until data can be read / written, at most timeout_ms (< 0: no
+// limit, 0: just check).  The host's ft245_usb_* calls wake the waiter.
+// Returns: true if ready, false on timeout
+bool io_wait_readable(fifo_t *fifo, int timeout_ms);
+bool io_wait_writable(fifo_t *fifo, int timeout_ms);
+
+// Wait for data, then read everything queued, up to length bytes
+// Returns: bytes read, 0 on timeout
+size_t io_read_block(fifo_t *fifo, uint8_t *buffer, size_t length, int timeout_ms);
+
+// Write the whole buffer, sleeping while the TX FIFO is full
+// Returns: bytes written, less than length on timeout
+size_t io_write_block(fifo_t *fifo, const uint8_t *buffer, size_t length, int timeout_ms);
+
 // Read a byte from USB/FIFO (blocking)
 uint8_t io_read_byte(fifo_t *fifo);
 
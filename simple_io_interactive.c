@@ -5,6 +5,10 @@
  * - Data sent by the CPU is displayed to stdout
  * - Data typed into stdin is sent to the CPU
  * 
+ * The CPU program runs on its own thread against the blocking simple_io
+ * calls, and the host side waits on stdin and on the FIFO, so an idle
+ * session sleeps instead of spinning.  The CPU time used is shown on exit.
+ * 
  * Use Ctrl+D to exit.
  */
 
@@ -14,8 +18,11 @@
 #include <stdbool.h>
 #include <string.h>
 #include <unistd.h>
-#include <fcntl.h>
 #include <termios.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
 #include "simple_io.h"
 #include "board_fifo.h"
 
@@ -32,7 +39,7 @@ void enable_raw_mode(void) {
     
     raw = orig_termios;
     raw.c_lflag &= ~(ECHO | ICANON);  // Disable echo and canonical mode
-    raw.c_cc[VMIN] = 0;   // Non-blocking read
+    raw.c_cc[VMIN] = 0;   // Return what is there; poll() does the waiting
     raw.c_cc[VTIME] = 0;
     
     if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) != -1) {
@@ -48,21 +55,21 @@ void disable_raw_mode(void) {
     }
 }
 
-// CPU echo program - reads from FIFO and echoes back
+// CPU echo program - reads from FIFO and echoes back, a block at a time
 void cpu_echo_program(fifo_t *fifo) {
+    uint8_t buffer[64];
     while (1) {
-        // Check if data available from USB
-        if (io_data_available(fifo)) {
-            uint8_t byte = io_read_byte(fifo);
-            
-            // Exit on Ctrl+D (EOF, 0x04)
-            if (byte == 0x04) {
-                break;
-            }
-            
-            // Echo the byte back
-            io_write_byte(fifo, byte);
+        size_t count = io_read_block(fifo, buffer, sizeof(buffer), -1);
+        
+        // Exit on Ctrl+D (EOF, 0x04)
+        uint8_t *eof = memchr(buffer, 0x04, count);
+        if (eof) {
+            io_write_block(fifo, buffer, eof - buffer, -1);
+            break;
         }
+        
+        // Echo the block back
+        io_write_block(fifo, buffer, count, -1);
     }
 }
 
@@ -75,22 +82,20 @@ void cpu_greeting_program(fifo_t *fifo) {
     io_write_string(fifo, prompt);
     
     while (1) {
-        if (io_data_available(fifo)) {
-            uint8_t byte = io_read_byte(fifo);
-            
-            // Exit on Ctrl+D
-            if (byte == 0x04) {
-                io_write_string(fifo, "\r\nGoodbye!\r\n");
-                break;
-            }
-            
-            // Echo the character
-            io_write_byte(fifo, byte);
-            
-            // On newline, send prompt
-            if (byte == '\r' || byte == '\n') {
-                io_write_string(fifo, prompt);
-            }
+        uint8_t byte = io_read_byte(fifo);
+        
+        // Exit on Ctrl+D
+        if (byte == 0x04) {
+            io_write_string(fifo, "\r\nGoodbye!\r\n");
+            break;
+        }
+        
+        // Echo the character
+        io_write_byte(fifo, byte);
+        
+        // On newline, send prompt
+        if (byte == '\r' || byte == '\n') {
+            io_write_string(fifo, prompt);
         }
     }
 }
@@ -105,63 +110,116 @@ void cpu_line_program(fifo_t *fifo) {
     io_write_string(fifo, "> ");
     
     while (1) {
-        if (io_data_available(fifo)) {
-            uint8_t byte = io_read_byte(fifo);
-            
-            // Exit on Ctrl+D
-            if (byte == 0x04) {
-                io_write_string(fifo, "\r\nBye!\r\n");
-                break;
-            }
-            
-            // Echo character
-            io_write_byte(fifo, byte);
-            
-            // Handle backspace
-            if (byte == 0x7F || byte == 0x08) {
-                if (line_pos > 0) {
-                    line_pos--;
-                }
-                continue;
+        uint8_t byte = io_read_byte(fifo);
+        
+        // Exit on Ctrl+D
+        if (byte == 0x04) {
+            io_write_string(fifo, "\r\nBye!\r\n");
+            break;
+        }
+        
+        // Echo character
+        io_write_byte(fifo, byte);
+        
+        // Handle backspace
+        if (byte == 0x7F || byte == 0x08) {
+            if (line_pos > 0) {
+                line_pos--;
             }
+            continue;
+        }
+        
+        // Process on newline
+        if (byte == '\r' || byte == '\n') {
+            line_buffer[line_pos] = '\0';
             
-            // Process on newline
-            if (byte == '\r' || byte == '\n') {
-                line_buffer[line_pos] = '\0';
-                
-                // Process command
-                if (line_pos > 0) {
-                    if (strcmp(line_buffer, "HELLO") == 0) {
-                        io_write_string(fifo, "Hi there!\r\n");
-                    } else if (strncmp(line_buffer, "ECHO ", 5) == 0) {
-                        io_write_string(fifo, line_buffer + 5);
-                        io_write_string(fifo, "\r\n");
-                    } else if (strncmp(line_buffer, "ADD ", 4) == 0) {
-                        int a, b;
-                        if (sscanf(line_buffer + 4, "%d %d", &a, &b) == 2) {
-                            char result[64];
-                            snprintf(result, sizeof(result), "Result: %d\r\n", a + b);
-                            io_write_string(fifo, result);
-                        } else {
-                            io_write_string(fifo, "Error: Usage: ADD <num1> <num2>\r\n");
-                        }
-                    } else if (strcmp(line_buffer, "QUIT") == 0) {
-                        io_write_string(fifo, "Goodbye!\r\n");
-                        break;
+            // Process command
+            if (line_pos > 0) {
+                if (strcmp(line_buffer, "HELLO") == 0) {
+                    io_write_string(fifo, "Hi there!\r\n");
+                } else if (strncmp(line_buffer, "ECHO ", 5) == 0) {
+                    io_write_string(fifo, line_buffer + 5);
+                    io_write_string(fifo, "\r\n");
+                } else if (strncmp(line_buffer, "ADD ", 4) == 0) {
+                    int a, b;
+                    if (sscanf(line_buffer + 4, "%d %d", &a, &b) == 2) {
+                        char result[64];
+                        snprintf(result, sizeof(result), "Result: %d\r\n", a + b);
+                        io_write_string(fifo, result);
                     } else {
-                        io_write_string(fifo, "Unknown command\r\n");
+                        io_write_string(fifo, "Error: Usage: ADD <num1> <num2>\r\n");
                     }
+                } else if (strcmp(line_buffer, "QUIT") == 0) {
+                    io_write_string(fifo, "Goodbye!\r\n");
+                    break;
+                } else {
+                    io_write_string(fifo, "Unknown command\r\n");
                 }
-                
-                line_pos = 0;
-                io_write_string(fifo, "> ");
-            } else if (line_pos < 255) {
-                line_buffer[line_pos++] = byte;
             }
+            
+            line_pos = 0;
+            io_write_string(fifo, "> ");
+        } else if (line_pos < 255) {
+            line_buffer[line_pos++] = byte;
         }
     }
 }
 
+typedef struct session_s {
+    fifo_t *fifo;
+    int mode;
+    atomic_bool cpu_done;
+} session_t;
+
+// The CPU side: one of the programs above, sleeping in the blocking calls
+static void *cpu_thread(void *arg) {
+    session_t *session = (session_t *)arg;
+    switch (session->mode) {
+        case 0:
+            cpu_echo_program(session->fifo);
+            break;
+        case 1:
+            cpu_greeting_program(session->fifo);
+            break;
+        default:
+            cpu_line_program(session->fifo);
+            break;
+    }
+    atomic_store(&session->cpu_done, true);
+    return NULL;
+}
+
+// Host output: sleep until the CPU has written something, print it.  The
+// timeout only bounds how long it takes to notice the CPU has finished.
+static void *output_thread(void *arg) {
+    session_t *session = (session_t *)arg;
+    uint8_t buffer[256];
+    while (1) {
+        bool done = atomic_load(&session->cpu_done);
+        board_fifo_wait(session->fifo, BOARD_FIFO_USB_READABLE, 100);
+        uint16_t count;
+        while ((count = board_fifo_usb_receive_buffer(session->fifo, buffer, sizeof(buffer))) > 0) {
+            write(STDOUT_FILENO, buffer, count);
+        }
+        if (done) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static double cpu_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double wall_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
 int main(int argc, char *argv[]) {
     printf("╔════════════════════════════════════════╗\n");
     printf("║   Simple IO Interactive Test           ║\n");
@@ -199,147 +257,50 @@ int main(int argc, char *argv[]) {
     
     printf("\nPress Ctrl+D to exit\n");
     printf("════════════════════════════════════════\n\n");
+    fflush(stdout);
     
     // Enable raw mode for character-by-character input
     enable_raw_mode();
     
-    // Make stdin non-blocking
-    int flags = fcntl(STDIN_FILENO, F_GETFL, 0);
-    fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK);
+    double cpu_start = cpu_seconds();
+    double wall_start = wall_seconds();
     
-    // Start CPU program in the background (simulated)
-    bool cpu_running = true;
-    bool cpu_started = false;
+    // The CPU program and the host output each get a thread
+    session_t session = { .fifo = fifo, .mode = mode };
+    atomic_init(&session.cpu_done, false);
+    pthread_t cpu, output;
+    pthread_create(&cpu, NULL, cpu_thread, &session);
+    pthread_create(&output, NULL, output_thread, &session);
     
-    // Main loop: shuttle data between stdin/stdout and FIFO
-    while (cpu_running) {
-        // Start CPU program on first iteration
-        if (!cpu_started) {
-            cpu_started = true;
-            // Note: In a real system, CPU would be running independently
-            // For this simulation, we'll interleave CPU execution with IO
-        }
-        
-        // Read from stdin and send to CPU via USB→FIFO
-        char ch;
-        ssize_t n = read(STDIN_FILENO, &ch, 1);
-        if (n > 0) {
-            // Send character to CPU
-            board_fifo_usb_send_to_cpu(fifo, ch);
+    // Host input: sleep in poll() until stdin has something, send it to the
+    // CPU, waiting for room in the RX FIFO when it is full
+    while (!atomic_load(&session.cpu_done)) {
+        struct pollfd pfd = { .fd = STDIN_FILENO, .events = POLLIN };
+        if (poll(&pfd, 1, 100) <= 0) {
+            continue;
         }
-        
-        // Let CPU process (simulate CPU executing instructions)
-        switch (mode) {
-            case 0:
-                // Simple echo: if data available, read and write back
-                if (io_data_available(fifo)) {
-                    uint8_t byte = io_read_byte(fifo);
-                    if (byte == 0x04) {
-                        cpu_running = false;
-                    } else {
-                        io_write_byte(fifo, byte);
-                    }
-                }
-                break;
-                
-            case 1:
-                // Greeting echo
-                if (!cpu_started) {
-                    const char *greeting = "Hello! I'm the 65816 CPU. Type something and I'll echo it back.\r\n";
-                    const char *prompt = "CPU> ";
-                    io_write_string(fifo, greeting);
-                    io_write_string(fifo, prompt);
-                }
-                if (io_data_available(fifo)) {
-                    uint8_t byte = io_read_byte(fifo);
-                    if (byte == 0x04) {
-                        io_write_string(fifo, "\r\nGoodbye!\r\n");
-                        cpu_running = false;
-                    } else {
-                        io_write_byte(fifo, byte);
-                        if (byte == '\r' || byte == '\n') {
-                            io_write_string(fifo, "CPU> ");
-                        }
-                    }
-                }
-                break;
-                
-            case 2:
-                // Line processor
-                {
-                    static char line_buffer[256];
-                    static int line_pos = 0;
-                    static bool prompt_sent = false;
-                    
-                    if (!prompt_sent) {
-                        io_write_string(fifo, "65816 Line Processor Ready\r\n");
-                        io_write_string(fifo, "Commands: HELLO, ECHO <text>, ADD <a> <b>, QUIT\r\n");
-                        io_write_string(fifo, "> ");
-                        prompt_sent = true;
-                    }
-                    
-                    if (io_data_available(fifo)) {
-                        uint8_t byte = io_read_byte(fifo);
-                        
-                        if (byte == 0x04) {
-                            io_write_string(fifo, "\r\nBye!\r\n");
-                            cpu_running = false;
-                        } else {
-                            // Echo character
-                            io_write_byte(fifo, byte);
-                            
-                            // Handle backspace
-                            if (byte == 0x7F || byte == 0x08) {
-                                if (line_pos > 0) {
-                                    line_pos--;
-                                }
-                            } else if (byte == '\r' || byte == '\n') {
-                                line_buffer[line_pos] = '\0';
-                                
-                                if (line_pos > 0) {
-                                    if (strcmp(line_buffer, "HELLO") == 0) {
-                                        io_write_string(fifo, "Hi there!\r\n");
-                                    } else if (strncmp(line_buffer, "ECHO ", 5) == 0) {
-                                        io_write_string(fifo, line_buffer + 5);
-                                        io_write_string(fifo, "\r\n");
-                                    } else if (strncmp(line_buffer, "ADD ", 4) == 0) {
-                                        int a, b;
-                                        if (sscanf(line_buffer + 4, "%d %d", &a, &b) == 2) {
-                                            char result[64];
-                                            snprintf(result, sizeof(result), "Result: %d\r\n", a + b);
-                                            io_write_string(fifo, result);
-                                        } else {
-                                            io_write_string(fifo, "Error: Usage: ADD <num1> <num2>\r\n");
-                                        }
-                                    } else if (strcmp(line_buffer, "QUIT") == 0) {
-                                        io_write_string(fifo, "Goodbye!\r\n");
-                                        cpu_running = false;
-                                    } else {
-                                        io_write_string(fifo, "Unknown command\r\n");
-                                    }
-                                }
-                                
-                                line_pos = 0;
-                                io_write_string(fifo, "> ");
-                            } else if (line_pos < 255) {
-                                line_buffer[line_pos++] = byte;
-                            }
-                        }
-                    }
-                }
-                break;
+        uint8_t input[256];
+        ssize_t n = read(STDIN_FILENO, input, sizeof(input));
+        if (n <= 0) {
+            // End of input: tell the CPU program to finish
+            input[0] = 0x04;
+            n = 1;
         }
-        
-        // Read from FIFO→USB and display to stdout
-        uint8_t output_byte;
-        if (board_fifo_usb_receive_from_cpu(fifo, &output_byte)) {
-            write(STDOUT_FILENO, &output_byte, 1);
+        ssize_t sent = 0;
+        while (sent < n && !atomic_load(&session.cpu_done)) {
+            sent += board_fifo_usb_send_buffer(fifo, input + sent, (uint16_t)(n - sent));
+            if (sent < n) {
+                board_fifo_wait(fifo, BOARD_FIFO_USB_WRITABLE, 100);
+            }
         }
-        
-        // Small delay to avoid spinning too fast
-        usleep(1000);
     }
     
+    pthread_join(cpu, NULL);
+    pthread_join(output, NULL);
+    
+    double cpu_used = cpu_seconds() - cpu_start;
+    double wall = wall_seconds() - wall_start;
+    
     // Cleanup
     disable_raw_mode();
     free_board_fifo(fifo);
@@ -347,6 +308,8 @@ int main(int argc, char *argv[]) {
     printf("\n\n╔════════════════════════════════════════╗\n");
     printf("║   Session ended                        ║\n");
     printf("╚════════════════════════════════════════╝\n");
+    printf("CPU time: %.3f s over %.1f s (%.1f%%)\n", cpu_used, wall,
+           wall > 0 ? cpu_used / wall * 100.0 : 0.0);
     
     return 0;
 }
@@ -0,0 +1,233 @@
+#include "snapshot.h"
+#include "mapper.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+static bool page_is_zero(const uint8_t *data) {
+    const uint64_t *words = (const uint64_t *)data;
+    for (size_t i = 0; i < MEMORY_PAGE_SIZE / sizeof(uint64_t); i++) {
+        if (words[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Capture one page; all-zero pages are stored as NULL
+static snapshot_page_t *page_capture(const uint8_t *data) {
+    if (page_is_zero(data)) {
+        return NULL;
+    }
+    snapshot_page_t *page = (snapshot_page_t *)malloc(sizeof(snapshot_page_t));
+    if (!page) {
+        return NULL;
+    }
+    page->refs = 1;
+    memcpy(page->data, data, MEMORY_PAGE_SIZE);
+    return page;
+}
+
+static snapshot_page_t *page_ref(snapshot_page_t *page) {
+    if (page) {
+        __atomic_add_fetch(&page->refs, 1, __ATOMIC_RELAXED);
+    }
+    return page;
+}
+
+void snapshot_page_release(snapshot_page_t *page) {
+    // Clones share pages, and may be on other threads
+    if (page && __atomic_sub_fetch(&page->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(page);
+    }
+}
+
+// Machines snapshot on threads of their own: hand serials out atomically
+static uint64_t g_next_serial = 1;
+
+static inline bool page_dirty(const memory_map_t *map, size_t page) {
+    return (map->dirty[page >> 6] >> (page & 63)) & 1;
+}
+
+// Make the map's sync point match `snapshot` and start a new dirty interval
+static void memory_map_sync(memory_map_t *map, const machine_snapshot_t *snapshot) {
+    if (map->synced && map->sync_serial == snapshot->serial) {
+        // Already the sync point; nothing but dirty pages were rewritten
+        memset(map->dirty, 0, sizeof(map->dirty));
+        return;
+    }
+    for (size_t page = 0; page < MEMORY_PAGE_COUNT; page++) {
+        if (map->sync_pages[page] != snapshot->pages[page]) {
+            snapshot_page_release(map->sync_pages[page]);
+            map->sync_pages[page] = page_ref(snapshot->pages[page]);
+        }
+    }
+    memset(map->dirty, 0, sizeof(map->dirty));
+    map->synced = true;
+    map->sync_serial = snapshot->serial;
+}
+
+// First snapshot: capture every page the host has ever faulted in.  This also
+// picks up writes that bypassed the region callbacks before tracking started.
+static int capture_resident_pages(memory_map_t *map, snapshot_page_t **pages) {
+    size_t host_page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t host_pages = MEMORY_MAP_SIZE / host_page;
+    unsigned char *resident = (unsigned char *)malloc(host_pages);
+    if (!resident) {
+        return -1;
+    }
+    if (mincore(map->ram, MEMORY_MAP_SIZE, resident) != 0) {
+        free(resident);
+        return -1;
+    }
+
+    for (size_t page = 0; page < MEMORY_PAGE_COUNT; page++) {
+        if (resident[((size_t)page << MEMORY_PAGE_SHIFT) / host_page] & 1) {
+            pages[page] = page_capture(map->ram + ((size_t)page << MEMORY_PAGE_SHIFT));
+        }
+    }
+    free(resident);
+    return 0;
+}
+
+machine_snapshot_t *machine_snapshot(machine_state_t *machine) {
+    memory_map_t *map = machine->memory_map;
+    if (!map) {
+        fprintf(stderr, "Error: Machine has no memory map\n");
+        return NULL;
+    }
+
+    machine_snapshot_t *snapshot = (machine_snapshot_t *)calloc(1, sizeof(machine_snapshot_t));
+    if (!snapshot) {
+        return NULL;
+    }
+    snapshot->pages = (snapshot_page_t **)calloc(MEMORY_PAGE_COUNT, sizeof(snapshot_page_t *));
+    if (!snapshot->pages) {
+        free(snapshot);
+        return NULL;
+    }
+
+    snapshot->serial = __atomic_fetch_add(&g_next_serial, 1, __ATOMIC_RELAXED);
+    snapshot->processor = machine->processor;
+    snapshot->cycles = machine->cycles;
+    snapshot->counters = machine->counters;
+    machine_save_devices(machine, &snapshot->devices);
+
+    for (mapper_t *mapper = map->mappers; mapper; mapper = mapper->next) {
+        snapshot->mapper_count++;
+    }
+    if (snapshot->mapper_count) {
+        snapshot->mappers = (mapper_snapshot_t *)malloc(snapshot->mapper_count * sizeof(mapper_snapshot_t));
+        if (!snapshot->mappers) {
+            machine_snapshot_free(snapshot);
+            return NULL;
+        }
+        uint16_t i = 0;
+        for (mapper_t *mapper = map->mappers; mapper; mapper = mapper->next, i++) {
+            snapshot->mappers[i].current = mapper->current;
+            snapshot->mappers[i].latch = mapper->latch;
+        }
+    }
+
+    if (!map->synced) {
+        if (capture_resident_pages(map, snapshot->pages) != 0) {
+            machine_snapshot_free(snapshot);
+            return NULL;
+        }
+    } else {
+        // Share everything that has not been written since the last sync point
+        for (size_t page = 0; page < MEMORY_PAGE_COUNT; page++) {
+            if (page_dirty(map, page)) {
+                snapshot->pages[page] = page_capture(map->ram + (page << MEMORY_PAGE_SHIFT));
+            } else {
+                snapshot->pages[page] = page_ref(map->sync_pages[page]);
+            }
+        }
+    }
+
+    memory_map_sync(map, snapshot);
+    return snapshot;
+}
+
+static void restore_page(memory_map_t *map, size_t page, const snapshot_page_t *data) {
+    uint8_t *host = map->ram + (page << MEMORY_PAGE_SHIFT);
+    if (memory_map_page_shared(map, page)) {
+        memory_map_unshare(map, page);
+    }
+    uint64_t bit = (uint64_t)1 << (page & 63);
+    if (data) {
+        memcpy(host, data->data, MEMORY_PAGE_SIZE);
+        map->written[page >> 6] |= bit;
+    } else {
+        memset(host, 0, MEMORY_PAGE_SIZE);
+        map->written[page >> 6] &= ~bit;
+    }
+}
+
+int machine_restore(machine_state_t *machine, const machine_snapshot_t *snapshot) {
+    memory_map_t *map = machine->memory_map;
+    if (!map || !snapshot) {
+        fprintf(stderr, "Error: Nothing to restore\n");
+        return -1;
+    }
+
+    if (map->synced && map->sync_serial == snapshot->serial) {
+        // The usual case of going back to the same snapshot again and again:
+        // only pages written since can differ
+        for (size_t word = 0; word < MEMORY_PAGE_COUNT / 64; word++) {
+            uint64_t bits = map->dirty[word];
+            while (bits) {
+                size_t page = word * 64 + __builtin_ctzll(bits);
+                restore_page(map, page, snapshot->pages[page]);
+                bits &= bits - 1;
+            }
+        }
+    } else if (map->synced) {
+        // Only pages written since the sync point, or captured differently in
+        // the sync point and this snapshot, can differ from the snapshot
+        for (size_t page = 0; page < MEMORY_PAGE_COUNT; page++) {
+            if (page_dirty(map, page) || map->sync_pages[page] != snapshot->pages[page]) {
+                restore_page(map, page, snapshot->pages[page]);
+            }
+        }
+    } else {
+        memory_map_zero_pages(map, 0, MEMORY_PAGE_COUNT);
+        for (size_t page = 0; page < MEMORY_PAGE_COUNT; page++) {
+            if (snapshot->pages[page]) {
+                restore_page(map, page, snapshot->pages[page]);
+            }
+        }
+    }
+    memory_map_sync(map, snapshot);
+
+    uint16_t i = 0;
+    for (mapper_t *mapper = map->mappers; mapper && i < snapshot->mapper_count;
+         mapper = mapper->next, i++) {
+        mapper_select(mapper, snapshot->mappers[i].current);
+        mapper->latch = snapshot->mappers[i].latch;
+    }
+
+    machine->processor = snapshot->processor;
+    machine->cycles = snapshot->cycles;
+    machine->counters = snapshot->counters;
+    machine_load_devices(machine, &snapshot->devices);
+    return 0;
+}
+
+void machine_snapshot_free(machine_snapshot_t *snapshot) {
+    if (!snapshot) {
+        return;
+    }
+    if (snapshot->pages) {
+        for (size_t page = 0; page < MEMORY_PAGE_COUNT; page++) {
+            snapshot_page_release(snapshot->pages[page]);
+        }
+        free(snapshot->pages);
+    }
+    free(snapshot->mappers);
+    machine_free_devices(&snapshot->devices);
+    free(snapshot);
+}
@@ -0,0 +1,57 @@
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "machine.h"
+#include "machine_setup.h"
+#include "memory_map.h"
+
+// Machine snapshots
+//
+// A snapshot holds the CPU registers and cycle count, device state, mapper
+// selections and the contents of every RAM page in the memory map (see
+// memory_map.h), as reference-counted 4KB pages.  The write path marks pages dirty; after the
+// first snapshot of a machine, later snapshots copy only the dirty pages and
+// share the rest with the previous one, and restoring only rewrites pages
+// that differ from the snapshot.
+//
+// ROM images mapped from files, caller-owned mapper pages and the bank layout
+// itself are not captured.
+
+// One captured page of memory
+struct snapshot_page_s {
+    uint32_t refs;             // Atomic: shared by clones on any thread
+    uint8_t data[MEMORY_PAGE_SIZE];
+};
+
+typedef struct mapper_snapshot_s {
+    uint16_t current;
+    uint8_t latch;
+} mapper_snapshot_t;
+
+typedef struct machine_snapshot_s {
+    processor_state_t processor;
+    uint64_t cycles;               // Machine cycle count
+    machine_counters_t counters;
+    machine_devices_t devices;
+    snapshot_page_t **pages;       // MEMORY_PAGE_COUNT entries, NULL = all zero
+    mapper_snapshot_t *mappers;    // In memory map list order
+    uint16_t mapper_count;
+    uint64_t serial;               // Identifies the snapshot as a sync point
+} machine_snapshot_t;
+
+// Capture the machine's current state
+machine_snapshot_t *machine_snapshot(machine_state_t *machine);
+
+// Put the machine back into a captured state
+// Returns: 0 on success, -1 on error
+int machine_restore(machine_state_t *machine, const machine_snapshot_t *snapshot);
+
+// Free a snapshot (pages shared with other snapshots stay alive)
+void machine_snapshot_free(machine_snapshot_t *snapshot);
+
+// Drop a reference to a captured page
+void snapshot_page_release(snapshot_page_t *page);
+
+#endif // __SNAPSHOT_H__
@@ -0,0 +1,164 @@
+#include "spsc_ring.h"
+#include <stdlib.h>
+#include <string.h>
+
+static size_t round_capacity(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    return size;
+}
+
+int spsc_ring_init(spsc_ring_t *ring, size_t capacity) {
+    size_t size = round_capacity(capacity);
+    ring->data = (uint8_t *)malloc(size);
+    if (!ring->data) {
+        ring->mask = 0;
+        atomic_init(&ring->head, 0);
+        atomic_init(&ring->tail, 0);
+        return -1;
+    }
+    ring->mask = size - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return 0;
+}
+
+void spsc_ring_free(spsc_ring_t *ring) {
+    free(ring->data);
+    ring->data = NULL;
+    ring->mask = 0;
+    atomic_store(&ring->head, 0);
+    atomic_store(&ring->tail, 0);
+}
+
+int spsc_ring_resize(spsc_ring_t *ring, size_t capacity) {
+    size_t size = round_capacity(capacity);
+    uint8_t *data = (uint8_t *)malloc(size);
+    if (!data) {
+        return -1;
+    }
+    free(ring->data);
+    ring->data = data;
+    ring->mask = size - 1;
+    atomic_store(&ring->head, 0);
+    atomic_store(&ring->tail, 0);
+    return 0;
+}
+
+int spsc_ring_copy(spsc_ring_t *dst, const spsc_ring_t *src) {
+    if (spsc_ring_capacity(dst) != spsc_ring_capacity(src)) {
+        if (spsc_ring_resize(dst, spsc_ring_capacity(src)) != 0) {
+            return -1;
+        }
+    }
+    size_t tail = atomic_load(&src->tail);
+    size_t count = atomic_load(&src->head) - tail;
+    for (size_t i = 0; i < count; i++) {
+        dst->data[i] = src->data[(tail + i) & src->mask];
+    }
+    atomic_store(&dst->tail, 0);
+    atomic_store(&dst->head, count);
+    return 0;
+}
+
+size_t spsc_ring_write_span(spsc_ring_t *ring, uint8_t **span) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t space = spsc_ring_capacity(ring) - (head - tail);
+    size_t offset = head & ring->mask;
+    size_t to_end = ring->mask + 1 - offset;
+    *span = ring->data + offset;
+    return space < to_end ? space : to_end;
+}
+
+void spsc_ring_commit(spsc_ring_t *ring, size_t length) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + length, memory_order_release);
+}
+
+size_t spsc_ring_push(spsc_ring_t *ring, const uint8_t *data, size_t length) {
+    size_t pushed = 0;
+    while (pushed < length) {
+        uint8_t *span;
+        size_t room = spsc_ring_write_span(ring, &span);
+        if (room == 0) {
+            break;
+        }
+        if (room > length - pushed) {
+            room = length - pushed;
+        }
+        memcpy(span, data + pushed, room);
+        spsc_ring_commit(ring, room);
+        pushed += room;
+    }
+    return pushed;
+}
+
+bool spsc_ring_push_byte(spsc_ring_t *ring, uint8_t byte) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail >= spsc_ring_capacity(ring)) {
+        return false;
+    }
+    ring->data[head & ring->mask] = byte;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return true;
+}
+
+size_t spsc_ring_read_span(spsc_ring_t *ring, const uint8_t **span) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t count = head - tail;
+    size_t offset = tail & ring->mask;
+    size_t to_end = ring->mask + 1 - offset;
+    *span = ring->data + offset;
+    return count < to_end ? count : to_end;
+}
+
+void spsc_ring_consume(spsc_ring_t *ring, size_t length) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + length, memory_order_release);
+}
+
+size_t spsc_ring_pop(spsc_ring_t *ring, uint8_t *data, size_t length) {
+    size_t popped = 0;
+    while (popped < length) {
+        const uint8_t *span;
+        size_t available = spsc_ring_read_span(ring, &span);
+        if (available == 0) {
+            break;
+        }
+        if (available > length - popped) {
+            available = length - popped;
+        }
+        memcpy(data + popped, span, available);
+        spsc_ring_consume(ring, available);
+        popped += available;
+    }
+    return popped;
+}
+
+bool spsc_ring_pop_byte(spsc_ring_t *ring, uint8_t *byte) {
+    if (!spsc_ring_peek(ring, byte)) {
+        return false;
+    }
+    spsc_ring_consume(ring, 1);
+    return true;
+}
+
+bool spsc_ring_peek(const spsc_ring_t *ring, uint8_t *byte) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+    *byte = ring->data[tail & ring->mask];
+    return true;
+}
+
+void spsc_ring_clear(spsc_ring_t *ring) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    atomic_store_explicit(&ring->tail, head, memory_order_release);
+}
@@ -0,0 +1,90 @@
+#ifndef __SPSC_RING_H__
+#define __SPSC_RING_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+// Single-producer/single-consumer byte ring
+//
+// Lock-free queue between exactly one producer thread and one consumer
+// thread (often the same thread).  head and tail are free-running counters:
+// the producer alone advances head, the consumer alone advances tail, and a
+// release store on one side paired with an acquire load on the other
+// publishes the bytes in between.  Capacity is a power of two chosen at run
+// time, so a position is just counter & mask.
+//
+// Functions are marked with the side that may call them.  The rest
+// (init, free, resize, copy) need both sides quiet.
+
+typedef struct spsc_ring_s {
+    _Atomic size_t head;        // Bytes ever pushed (producer)
+    _Atomic size_t tail;        // Bytes ever popped (consumer)
+    size_t mask;                // Capacity - 1
+    uint8_t *data;
+} spsc_ring_t;
+
+// Allocate storage for `capacity` bytes, rounded up to a power of two
+// Returns: 0 on success, -1 on error
+int spsc_ring_init(spsc_ring_t *ring, size_t capacity);
+void spsc_ring_free(spsc_ring_t *ring);
+
+// Replace the storage, dropping anything queued
+// Returns: 0 on success, -1 on error (the ring is unchanged)
+int spsc_ring_resize(spsc_ring_t *ring, size_t capacity);
+
+// Make dst hold the same bytes as src, resizing dst to src's capacity
+// Returns: 0 on success, -1 on error
+int spsc_ring_copy(spsc_ring_t *dst, const spsc_ring_t *src);
+
+static inline size_t spsc_ring_capacity(const spsc_ring_t *ring) {
+    return ring->data ? ring->mask + 1 : 0;
+}
+
+// Either side.  Exact from the calling side; the other side may only have
+// moved it further in its own direction.
+static inline size_t spsc_ring_count(const spsc_ring_t *ring) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    return head - tail;
+}
+
+static inline size_t spsc_ring_free_space(const spsc_ring_t *ring) {
+    return spsc_ring_capacity(ring) - spsc_ring_count(ring);
+}
+
+static inline bool spsc_ring_empty(const spsc_ring_t *ring) {
+    return spsc_ring_count(ring) == 0;
+}
+
+// Producer: queue up to `length` bytes
+// Returns: bytes queued
+size_t spsc_ring_push(spsc_ring_t *ring, const uint8_t *data, size_t length);
+bool spsc_ring_push_byte(spsc_ring_t *ring, uint8_t byte);
+
+// Producer: contiguous free space to write into directly, then publish
+// `length` bytes of it.  The span may be shorter than the free space when
+// it wraps; call again after committing.
+// Returns: bytes available at *span
+size_t spsc_ring_write_span(spsc_ring_t *ring, uint8_t **span);
+void spsc_ring_commit(spsc_ring_t *ring, size_t length);
+
+// Consumer: take up to `length` bytes
+// Returns: bytes taken
+size_t spsc_ring_pop(spsc_ring_t *ring, uint8_t *data, size_t length);
+bool spsc_ring_pop_byte(spsc_ring_t *ring, uint8_t *byte);
+
+// Consumer: oldest byte without taking it
+bool spsc_ring_peek(const spsc_ring_t *ring, uint8_t *byte);
+
+// Consumer: contiguous queued bytes to read directly, then release
+// `length` of them
+// Returns: bytes available at *span
+size_t spsc_ring_read_span(spsc_ring_t *ring, const uint8_t **span);
+void spsc_ring_consume(spsc_ring_t *ring, size_t length);
+
+// Consumer: drop everything queued (or either side, with the other quiet)
+void spsc_ring_clear(spsc_ring_t *ring);
+
+#endif // __SPSC_RING_H__
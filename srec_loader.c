@@ -13,6 +13,7 @@
 #include <ctype.h>
 #include "machine_setup.h"
 #include "processor_helpers.h"
+#include "memory_map.h"
 
 // Maximum line length for SREC files
 #define MAX_LINE_LENGTH 256
@@ -116,7 +117,7 @@ static int32_t load_srec_file(const char *filename, machine_state_t *machine) {
                     memory_region_t *region = find_current_memory_region(machine, address + i);
                     if (region) {
                         unsigned int offset = (address + i) - region->start_offset;
-                        region->data[offset] = (uint8_t)byte_val;
+                        memory_map_poke(machine->memory_map, &region->data[offset], (uint8_t)byte_val);
                         total_bytes++;
                     } else {
                         fprintf(stderr, "Warning: Address 0x%04X not in any memory region\n", (unsigned int)(address + i));
@@ -159,7 +160,7 @@ static int32_t load_srec_file(const char *filename, machine_state_t *machine) {
                     memory_region_t *region = find_current_memory_region(machine, address + i);
                     if (region) {
                         unsigned int offset = (address + i) - region->start_offset;
-                        region->data[offset] = (uint8_t)byte_val;
+                        memory_map_poke(machine->memory_map, &region->data[offset], (uint8_t)byte_val);
                         total_bytes++;
                     }
                 }
@@ -201,7 +202,7 @@ static int32_t load_srec_file(const char *filename, machine_state_t *machine) {
                     memory_region_t *region = find_current_memory_region(machine, address + i);
                     if (region) {
                         unsigned int offset = (address + i) - region->start_offset;
-                        region->data[offset] = (uint8_t)byte_val;
+                        memory_map_poke(machine->memory_map, &region->data[offset], (uint8_t)byte_val);
                         total_bytes++;
                     }
                 }
@@ -20,8 +20,9 @@ typedef struct p_state_s {
 // Legacy disassembler state (kept for compatibility)
 static p_state_t processor_state;
 
-// Global pointer to actual emulated machine state
-static processor_state_t *g_emulated_processor = NULL;
+// Pointer to actual emulated machine state, per host thread: cores of a
+// multicore machine run on threads of their own, each with its own M/X
+static _Thread_local processor_state_t *g_emulated_processor = NULL;
 
 void init() {
     memset(&processor_state, 0, sizeof(p_state_t));
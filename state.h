@@ -7,6 +7,7 @@
 #include "machine.h"
 
 void init();
+// Processor whose M/X flags size operands, for the calling thread
 void set_emulated_processor(processor_state_t *proc);
 bool isMSet();
 bool isXSet();
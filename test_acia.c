@@ -2,6 +2,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <assert.h>
 #include "acia6551.h"
 
 // Test context for callbacks
@@ -354,6 +355,93 @@ void test_programmed_reset(void) {
     printf("\n✓ Programmed reset test complete\n");
 }
 
+// Receive callback that never has data, counting how often it is asked
+static int rx_polls = 0;
+static uint8_t counting_rx_callback(void* ctx, bool* available) {
+    rx_polls++;
+    *available = false;
+    return 0;
+}
+
+void test_character_timing(void) {
+    print_test_header("Character Timing Without Per-Cycle Polling");
+
+    acia6551_t acia, chunked, once;
+    test_context_t context = {0};
+
+    // 19200 baud divider is 100 cycles per bit; 8N1 is 10 bits per character
+    acia6551_init(&acia);
+    acia6551_write(&acia, ACIA_CONTROL, ACIA_CTRL_BAUD_19200 | ACIA_CTRL_WORD_8BIT | ACIA_CTRL_RECV_CLK);
+    acia6551_write(&acia, ACIA_DATA, 'X');
+    acia6551_write(&acia, ACIA_DATA, 'Y');
+    chunked = acia;
+    once = acia;
+    assert(acia6551_cycles_to_event(&acia) == 1000);
+
+    acia6551_clock(&acia, 1999);
+    assert(acia.tx_bits_remaining == 1);
+    acia6551_clock(&acia, 1);
+    assert(acia.tx_bits_remaining == 0 && acia6551_cycles_to_event(&acia) == 0);
+    printf("Two characters take exactly 2000 cycles\n");
+
+    for (int i = 0; i < 285; i++) {
+        acia6551_clock(&chunked, 7);
+    }
+    acia6551_clock(&once, 285 * 7);
+    assert(chunked.tx_bits_remaining == once.tx_bits_remaining);
+    assert(chunked.tx_clock_counter == once.tx_clock_counter);
+    assert(once.tx_bits_remaining == 1 && once.tx_clock_counter == 95);
+    printf("Clocking in small steps lands on the same bit boundaries\n");
+
+    // The receive callback is asked once per character time
+    acia6551_set_byte_callbacks(&acia, NULL, counting_rx_callback, &context);
+    rx_polls = 0;
+    for (int i = 0; i < 1000000; i++) {
+        acia6551_clock(&acia, 1);
+    }
+    printf("Receive callback asked %d times over 1000000 cycles\n", rx_polls);
+    assert(rx_polls == 1000);
+
+    // An idle host is asked once per clock call, however long it is
+    rx_polls = 0;
+    acia6551_clock(&acia, 1000000);
+    assert(rx_polls == 1);
+    assert(acia6551_cycles_to_event(&acia) == 1000);
+
+    printf("\n✓ Character timing test complete\n");
+}
+
+void test_unthrottled(void) {
+    print_test_header("Unthrottled Mode");
+
+    acia6551_t acia;
+    test_context_t context = {0};
+
+    acia6551_init(&acia);
+    acia6551_set_byte_callbacks(&acia, tx_byte_callback, rx_byte_callback, &context);
+    acia6551_write(&acia, ACIA_CONTROL, ACIA_CTRL_BAUD_50 | ACIA_CTRL_WORD_8BIT);
+    acia6551_write(&acia, ACIA_DATA, 'a');
+    assert(context.tx_count == 1 && acia.tx_bits_remaining > 0);
+
+    acia6551_set_unthrottled(&acia, true);
+    assert(acia.tx_bits_remaining == 0 && (acia.status & ACIA_STATUS_TDRE));
+    const char* msg = "fast";
+    for (int i = 0; i < 4; i++) {
+        acia6551_write(&acia, ACIA_DATA, msg[i]);
+        assert(acia.status & ACIA_STATUS_TDRE);
+    }
+    assert(context.tx_count == 5 && memcmp(context.tx_buffer + 1, msg, 4) == 0);
+    printf("Bytes go out as soon as they are written\n");
+
+    memcpy(context.rx_buffer, "abc", 3);
+    context.rx_write_pos = 3;
+    acia6551_clock(&acia, 1);
+    assert(spsc_ring_count(&acia.rx_ring) == 3);
+    printf("Pending input is taken on the next clock\n");
+
+    printf("\n✓ Unthrottled test complete\n");
+}
+
 int main(void) {
     printf("╔═══════════════════════════════════════════════╗\n");
     printf("║  6551 ACIA (Asynchronous Communications       ║\n");
@@ -370,6 +458,8 @@ int main(void) {
     test_control_lines();
     test_interrupts();
     test_programmed_reset();
+    test_character_timing();
+    test_unthrottled();
     
     printf("\n");
     printf("╔═══════════════════════════════════════════════╗\n");
@@ -91,7 +91,7 @@ void test_acia_receive(machine_state_t *machine) {
     TEST_ASSERT((status & ACIA_STATUS_RDRF) == 0, "RDRF flag clear when no data");
     
     // Simulate receiving a byte
-    acia6551_t* acia = get_acia_instance();
+    acia6551_t* acia = get_acia_instance(machine);
     acia6551_receive_byte(acia, 'X');
     
     // RDRF should be set
@@ -127,7 +127,7 @@ void test_acia_with_callbacks(machine_state_t *machine) {
     }
     
     // Get ACIA instance and set callbacks
-    acia6551_t* acia = get_acia_instance();
+    acia6551_t* acia = get_acia_instance(machine);
     acia6551_set_byte_callbacks(acia, tx_callback, rx_callback, NULL);
     
     // Initialize ACIA
@@ -204,7 +204,7 @@ void test_acia_serial_loopback(machine_state_t *machine) {
     print_test_header("ACIA Transmit and Receive");
     
     // Reset ACIA to clear any previous state
-    acia6551_t* acia = get_acia_instance();
+    acia6551_t* acia = get_acia_instance(machine);
     acia6551_reset(acia);
     
     // Initialize ACIA
@@ -0,0 +1,297 @@
+/*
+ * Tests for the block storage device
+ *
+ * - A guest boots by DMAing its first sector into RAM and jumping to it
+ * - PIO reads and writes through the data port go straight to the image
+ * - DMA transfers cross banks and leave clones copy-on-write
+ * - Bad commands, ranges and read-only images report errors
+ * - Clones share the image, and can let go of it on any thread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include "machine_setup.h"
+#include "memory_map.h"
+#include "processor_helpers.h"
+#include "blockdev.h"
+#include "test_helpers.h"
+
+#define BLOCKDEV_BASE 0x7F90
+#define SECTORS 64
+
+static char image_path[64];
+
+// Fresh image whose every byte encodes its sector and offset
+static void make_image(void) {
+    unlink(image_path);
+    assert(blockdev_create_image(image_path, SECTORS) == 0);
+    int fd = open(image_path, O_RDWR);
+    assert(fd >= 0);
+    uint8_t sector[BLOCKDEV_SECTOR_SIZE];
+    for (int s = 0; s < SECTORS; s++) {
+        for (int i = 0; i < BLOCKDEV_SECTOR_SIZE; i++) {
+            sector[i] = (uint8_t)(s * 3 + i);
+        }
+        assert(pwrite(fd, sector, sizeof(sector), (off_t)s * BLOCKDEV_SECTOR_SIZE) == sizeof(sector));
+    }
+    close(fd);
+}
+
+static uint8_t image_byte(uint32_t sector, uint32_t offset) {
+    int fd = open(image_path, O_RDONLY);
+    uint8_t value = 0;
+    assert(pread(fd, &value, 1, (off_t)sector * BLOCKDEV_SECTOR_SIZE + offset) == 1);
+    close(fd);
+    return value;
+}
+
+static void set_lba(machine_state_t *machine, uint32_t lba, uint8_t count) {
+    write_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_LBA0, lba & 0xFF);
+    write_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_LBA1, (lba >> 8) & 0xFF);
+    write_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_LBA2, (lba >> 16) & 0xFF);
+    write_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_LBA3, (lba >> 24) & 0xFF);
+    write_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_COUNT, count);
+}
+
+static void set_dma(machine_state_t *machine, uint32_t address) {
+    write_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_DMA_LO, address & 0xFF);
+    write_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_DMA_HI, (address >> 8) & 0xFF);
+    write_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_DMA_BANK, (address >> 16) & 0xFF);
+}
+
+static uint8_t status(machine_state_t *machine) {
+    return read_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_COMMAND);
+}
+
+static void *destroy_clone(void *machine) {
+    destroy_machine((machine_state_t *)machine);
+    return NULL;
+}
+
+static uint8_t peek(machine_state_t *machine, uint32_t address) {
+    return read_byte_long(machine, (long_address_t){ .bank = address >> 16, .address = address & 0xFFFF });
+}
+
+void test_boot() {
+    printf("Test: Booting from sector 0...\n");
+
+    // Boot sector: LDA #$42 / STA $0300 / STP, loaded at $0400
+    static const uint8_t boot[] = { 0xA9, 0x42, 0x8D, 0x00, 0x03, 0xDB };
+    int fd = open(image_path, O_RDWR);
+    assert(pwrite(fd, boot, sizeof(boot), 0) == sizeof(boot));
+    close(fd);
+
+    static const uint8_t loader[] = {
+        0xA9, 0x00, 0x8D, 0x90, 0x7F,   // LDA #$00 : STA $7F90  LBA 0
+        0x8D, 0x91, 0x7F,               // STA $7F91
+        0x8D, 0x92, 0x7F,               // STA $7F92
+        0x8D, 0x93, 0x7F,               // STA $7F93
+        0x8D, 0x98, 0x7F,               // STA $7F98             DMA to $00:0400
+        0x8D, 0x9A, 0x7F,               // STA $7F9A
+        0xA9, 0x04, 0x8D, 0x99, 0x7F,   // LDA #$04 : STA $7F99
+        0xA9, 0x01, 0x8D, 0x94, 0x7F,   // LDA #$01 : STA $7F94  one sector
+        0xA9, 0xC8, 0x8D, 0x95, 0x7F,   // LDA #$C8 : STA $7F95  READ DMA
+        0x4C, 0x00, 0x04,               // JMP $0400
+    };
+    machine_state_t *machine = create_machine();
+    load_program(machine, loader, sizeof(loader));
+    assert(blockdev_attach(get_blockdev_instance(machine), image_path, true) == 0);
+
+    bool halted = false;
+    for (int i = 0; i < 100 && !halted; i++) {
+        machine_execute_instruction(machine, &halted);
+    }
+    assert(halted && peek(machine, 0x0300) == 0x42);
+    assert(peek(machine, 0x0400 + 0x1FF) == (uint8_t)0x1FF);
+    printf("  Loader pulled in the boot sector and ran it ✓\n");
+
+    blockdev_t *dev = get_blockdev_instance(machine);
+    assert(dev->lba == 1 && dev->dma_address == 0x0600 && dev->sectors_read == 1);
+    assert(status(machine) == BLOCKDEV_STATUS_READY);
+    printf("  LBA and DMA address advanced past the sector ✓\n");
+
+    destroy_machine(machine);
+    make_image();
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_pio() {
+    printf("Test: PIO through the data port...\n");
+
+    machine_state_t *machine = create_machine();
+    assert(blockdev_attach(get_blockdev_instance(machine), image_path, false) == 0);
+    write_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_CONTROL, BLOCKDEV_CONTROL_IRQ_ENABLE);
+
+    set_lba(machine, 5, 2);
+    write_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_COMMAND, BLOCKDEV_CMD_READ);
+    assert(status(machine) == (BLOCKDEV_STATUS_READY | BLOCKDEV_STATUS_DRQ));
+    for (int s = 5; s < 7; s++) {
+        for (int i = 0; i < BLOCKDEV_SECTOR_SIZE; i++) {
+            assert(read_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_DATA) == (uint8_t)(s * 3 + i));
+        }
+    }
+    assert(machine->irq_sources & IRQ_SOURCE_BLOCKDEV);
+    assert(status(machine) == BLOCKDEV_STATUS_READY);
+    assert(!(machine->irq_sources & IRQ_SOURCE_BLOCKDEV));
+    assert(read_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_LBA0) == 7);
+    printf("  Two sectors read; IRQ at the end, acknowledged by status ✓\n");
+
+    set_lba(machine, 9, 1);
+    write_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_COMMAND, BLOCKDEV_CMD_WRITE);
+    for (int i = 0; i < BLOCKDEV_SECTOR_SIZE; i++) {
+        write_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_DATA, (uint8_t)(0xFF - i));
+    }
+    assert(status(machine) == BLOCKDEV_STATUS_READY);
+    write_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_COMMAND, BLOCKDEV_CMD_FLUSH);
+    assert(status(machine) == BLOCKDEV_STATUS_READY);
+    assert(image_byte(9, 0) == 0xFF && image_byte(9, 0x1FF) == 0x00 && image_byte(10, 0) == 30);
+    printf("  Sector written through the port is in the file ✓\n");
+
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_dma() {
+    printf("Test: DMA transfers...\n");
+
+    machine_state_t *parent = create_machine();
+    assert(machine_add_ram_banks(parent, 0x01, 2) == 0);
+    blockdev_t *dev = get_blockdev_instance(parent);
+    assert(blockdev_attach(dev, image_path, false) == 0);
+    machine_state_t *machine = machine_clone(parent);
+    assert(machine != NULL);
+
+    // 16 sectors (8KB) into $01:F000, running on into bank 2
+    set_lba(machine, 20, 16);
+    set_dma(machine, 0x01F000);
+    write_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_COMMAND, BLOCKDEV_CMD_READ_DMA);
+    assert(status(machine) == BLOCKDEV_STATUS_READY);
+    for (uint32_t i = 0; i < 16 * BLOCKDEV_SECTOR_SIZE; i++) {
+        assert(peek(machine, 0x01F000 + i) == (uint8_t)((20 + i / 512) * 3 + i % 512));
+        assert(peek(parent, 0x01F000 + i) == 0);
+    }
+    printf("  8KB landed across the bank boundary, in the clone only ✓\n");
+
+    memory_map_t *map = machine->memory_map;
+    size_t page = (size_t)(memory_map_bank(map, 0x02) - map->ram) >> MEMORY_PAGE_SHIFT;
+    assert((map->dirty[page >> 6] >> (page & 63)) & 1);
+    printf("  Destination pages tracked like CPU writes ✓\n");
+
+    // Write four sectors of guest RAM back out
+    for (uint32_t i = 0; i < 4 * BLOCKDEV_SECTOR_SIZE; i++) {
+        write_byte_long(machine, (long_address_t){ .bank = 0x00, .address = 0x1000 + i }, (uint8_t)(i ^ 0x5A));
+    }
+    set_lba(machine, 40, 4);
+    set_dma(machine, 0x001000);
+    write_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_COMMAND, BLOCKDEV_CMD_WRITE_DMA);
+    assert(status(machine) == BLOCKDEV_STATUS_READY);
+    assert(get_blockdev_instance(machine)->sectors_written == 4);
+    assert(image_byte(40, 0) == 0x5A && image_byte(43, 0x1FF) == (uint8_t)(0x7FF ^ 0x5A));
+    printf("  Four sectors written from guest RAM ✓\n");
+
+    // The clone shares the image with its parent
+    assert(dev->media == get_blockdev_instance(machine)->media && dev->media->refs == 2);
+    assert(dev->media->data[40 * BLOCKDEV_SECTOR_SIZE] == 0x5A);
+    destroy_machine(machine);
+    assert(dev->media->refs == 1);
+    printf("  Clone shares the parent's image ✓\n");
+
+    // Clones going away on threads of their own leave the parent's reference
+    machine_state_t *clones[8];
+    pthread_t threads[8];
+    for (int i = 0; i < 8; i++) {
+        clones[i] = machine_clone(parent);
+        assert(clones[i] != NULL);
+    }
+    assert(dev->media->refs == 9);
+    for (int i = 0; i < 8; i++) {
+        assert(pthread_create(&threads[i], NULL, destroy_clone, clones[i]) == 0);
+    }
+    for (int i = 0; i < 8; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    assert(dev->media->refs == 1 && dev->media->data[40 * BLOCKDEV_SECTOR_SIZE] == 0x5A);
+    printf("  Clones destroyed on 8 threads, image still mapped ✓\n");
+
+    destroy_machine(parent);
+    make_image();
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_errors() {
+    printf("Test: Errors...\n");
+
+    machine_state_t *machine = create_machine();
+    write_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_COMMAND, BLOCKDEV_CMD_READ);
+    assert(status(machine) == BLOCKDEV_STATUS_ERR);
+    assert(read_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_ERROR) == BLOCKDEV_ERROR_ABORT);
+    printf("  No image: not ready, commands abort ✓\n");
+
+    assert(blockdev_attach(get_blockdev_instance(machine), image_path, true) == 0);
+    assert(read_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_CAPACITY0) == SECTORS);
+    assert(read_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_CAPACITY1) == 0);
+
+    set_lba(machine, SECTORS - 1, 2);
+    write_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_COMMAND, BLOCKDEV_CMD_READ);
+    assert(status(machine) == (BLOCKDEV_STATUS_READY | BLOCKDEV_STATUS_ERR));
+    assert(read_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_ERROR) == BLOCKDEV_ERROR_RANGE);
+    printf("  Past the end of the image ✓\n");
+
+    set_lba(machine, 0, 1);
+    write_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_COMMAND, BLOCKDEV_CMD_WRITE_DMA);
+    assert(status(machine) & BLOCKDEV_STATUS_ERR);
+    assert(read_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_ERROR) == BLOCKDEV_ERROR_ABORT);
+    write_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_COMMAND, 0x99);
+    assert(read_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_ERROR) == BLOCKDEV_ERROR_ABORT);
+    printf("  Writes to a read-only image and unknown commands abort ✓\n");
+
+    // A PIO read part way through, copied onto a device with a smaller image
+    char small_path[80];
+    snprintf(small_path, sizeof(small_path), "%s.small", image_path);
+    assert(blockdev_create_image(small_path, 8) == 0);
+    blockdev_t small;
+    blockdev_init(&small);
+    assert(blockdev_attach(&small, small_path, true) == 0);
+    set_lba(machine, 2, 2);
+    write_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_COMMAND, BLOCKDEV_CMD_READ);
+    read_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_DATA);
+    blockdev_copy_state(&small, get_blockdev_instance(machine));
+    assert(small.pio_command == BLOCKDEV_CMD_READ && small.pio_offset == 2 * BLOCKDEV_SECTOR_SIZE + 1);
+    assert(blockdev_read(&small, BLOCKDEV_DATA) == 0);
+
+    set_lba(machine, 40, 2);
+    write_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_COMMAND, BLOCKDEV_CMD_READ);
+    read_byte_new(machine, BLOCKDEV_BASE + BLOCKDEV_DATA);
+    blockdev_copy_state(&small, get_blockdev_instance(machine));
+    assert(small.pio_command == 0 && small.pio_remaining == 0);
+    assert(small.error == BLOCKDEV_ERROR_RANGE && small.irq_pending);
+    assert(blockdev_read(&small, BLOCKDEV_COMMAND) == (BLOCKDEV_STATUS_READY | BLOCKDEV_STATUS_ERR));
+    blockdev_read(&small, BLOCKDEV_DATA);
+    blockdev_detach(&small);
+    unlink(small_path);
+    printf("  Transfer past a smaller image cancelled on copy ✓\n");
+
+    assert(blockdev_attach(get_blockdev_instance(machine), "/nonexistent/disk.img", false) == -1);
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+int main() {
+    printf("=== Block Device Tests ===\n\n");
+
+    snprintf(image_path, sizeof(image_path), "/tmp/test_blockdev_%d.img", (int)getpid());
+    make_image();
+    test_boot();
+    test_pio();
+    test_dma();
+    test_errors();
+    unlink(image_path);
+
+    printf("=== All block device tests passed! ===\n");
+    return 0;
+}
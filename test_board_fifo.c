@@ -2,8 +2,14 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
 #include "board_fifo.h"
+#include "simple_io.h"
 #include "via6522.h"
+#include "ft245.h"
 
 void print_test_header(const char* test_name) {
     printf("\n========================================\n");
@@ -282,6 +288,166 @@ void test_real_world_scenario(void) {
     printf("\n✓ Real-world scenario test complete\n");
 }
 
+// Host-side byte stream for the bulk USB callback
+typedef struct {
+    const uint8_t *data;
+    size_t length;
+    size_t position;
+} host_stream_t;
+
+static uint16_t host_stream_fill(void *context, uint8_t *buffer, uint16_t max_length) {
+    host_stream_t *stream = (host_stream_t *)context;
+    size_t left = stream->length - stream->position;
+    uint16_t count = left < max_length ? (uint16_t)left : max_length;
+    memcpy(buffer, stream->data + stream->position, count);
+    stream->position += count;
+    return count;
+}
+
+static double elapsed_ms(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e3 + (end->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+void test_stream_megabyte(void) {
+    print_test_header("Streaming 1 MB Through the FIFO");
+    
+    const size_t size = 1024 * 1024;
+    uint8_t *source = (uint8_t *)malloc(size);
+    uint8_t *sink = (uint8_t *)malloc(size);
+    assert(source && sink);
+    for (size_t i = 0; i < size; i++) {
+        source[i] = (uint8_t)(i * 7 + (i >> 8));
+    }
+    
+    fifo_t *fifo = init_board_fifo();
+    assert(fifo);
+    board_fifo_write_via(fifo, VIA_DDRA, 0xFF);
+    board_fifo_write_via(fifo, VIA_DDRB, 0x03);
+    board_fifo_write_via(fifo, VIA_ORB_IRB, PORTB_RD_N);
+    
+    // USB -> CPU: the host is pulled in bulk while the board is clocked
+    host_stream_t stream = { source, size, 0 };
+    ft245_t *ft245 = board_fifo_get_ft245(fifo);
+    ft245_set_usb_callbacks(ft245, NULL, NULL, &stream);
+    ft245_set_usb_rx_buffer_callback(ft245, host_stream_fill);
+    
+    struct timespec start, end;
+    uint64_t cycles = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t received = 0;
+    while (received < size) {
+        if (board_fifo_fast_read(fifo, &sink[received])) {
+            received++;
+            cycles += BOARD_FIFO_STROBE_CYCLES;
+        } else {
+            board_fifo_clock_n(fifo, 64);
+            cycles += 64;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double read_ms = elapsed_ms(&start, &end);
+    assert(memcmp(source, sink, size) == 0);
+    printf("USB -> CPU: 1 MB in %.1f ms (%llu emulated cycles)\n",
+           read_ms, (unsigned long long)cycles);
+    
+    // CPU -> USB: the host drains whole buffers when TXE# goes high
+    ft245_set_usb_rx_buffer_callback(ft245, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t sent = 0, drained = 0;
+    while (drained < size) {
+        if (sent < size && board_fifo_fast_write(fifo, source[sent])) {
+            sent++;
+        } else {
+            drained += board_fifo_usb_receive_buffer(fifo, sink + drained, 512);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double write_ms = elapsed_ms(&start, &end);
+    assert(memcmp(source, sink, size) == 0);
+    printf("CPU -> USB: 1 MB in %.1f ms\n", write_ms);
+    
+    assert(read_ms < 1000.0 && write_ms < 1000.0);
+    
+    free_board_fifo(fifo);
+    free(source);
+    free(sink);
+    printf("\n✓ Streaming test complete\n");
+}
+
+static double clock_ms(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+#define BLOCK_BYTES 4000
+
+// USB host: go quiet for a while, send a message, then collect everything
+// the CPU writes back, sleeping between deliveries
+static void *blocking_host(void *arg) {
+    fifo_t *fifo = (fifo_t *)arg;
+    struct timespec quiet = { .tv_sec = 0, .tv_nsec = 200000000L };
+    nanosleep(&quiet, NULL);
+    board_fifo_usb_send_buffer(fifo, (const uint8_t *)"ping", 4);
+    
+    size_t received = 0;
+    uint8_t buffer[300];
+    while (received < BLOCK_BYTES) {
+        assert(board_fifo_wait(fifo, BOARD_FIFO_USB_READABLE, 1000) == BOARD_FIFO_USB_READABLE);
+        uint16_t count = board_fifo_usb_receive_buffer(fifo, buffer, sizeof(buffer));
+        for (uint16_t i = 0; i < count; i++) {
+            assert(buffer[i] == (uint8_t)(received + i));
+        }
+        received += count;
+    }
+    return NULL;
+}
+
+void test_blocking_io(void) {
+    print_test_header("Blocking IO with Timeouts");
+    
+    fifo_t *fifo = io_init();
+    assert(fifo != NULL);
+    
+    // Nothing arrives: the wait times out
+    double start = clock_ms(CLOCK_MONOTONIC);
+    assert(!io_wait_readable(fifo, 20));
+    double waited = clock_ms(CLOCK_MONOTONIC) - start;
+    uint8_t buffer[BLOCK_BYTES];
+    assert(io_read_block(fifo, buffer, sizeof(buffer), 0) == 0);
+    printf("Empty FIFO: wait timed out after %.1f ms\n", waited);
+    assert(waited >= 19.0);
+    
+    // The host is quiet for 200 ms; the reader sleeps until it sends
+    pthread_t host;
+    assert(pthread_create(&host, NULL, blocking_host, fifo) == 0);
+    double cpu = clock_ms(CLOCK_PROCESS_CPUTIME_ID);
+    start = clock_ms(CLOCK_MONOTONIC);
+    size_t count = io_read_block(fifo, buffer, sizeof(buffer), 5000);
+    waited = clock_ms(CLOCK_MONOTONIC) - start;
+    cpu = clock_ms(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+    assert(count == 4 && memcmp(buffer, "ping", 4) == 0);
+    printf("Read \"ping\" after %.0f ms asleep, %.2f ms of CPU\n", waited, cpu);
+    assert(waited >= 150.0 && cpu < waited / 10);
+    
+    // A block eight times the TX FIFO goes out as the host drains it
+    for (size_t i = 0; i < BLOCK_BYTES; i++) {
+        buffer[i] = (uint8_t)i;
+    }
+    assert(io_write_block(fifo, buffer, BLOCK_BYTES, 5000) == BLOCK_BYTES);
+    pthread_join(host, NULL);
+    assert(board_fifo_get_tx_count(fifo) == 0);
+    printf("Wrote %d bytes through the %d-byte TX FIFO\n", BLOCK_BYTES, FT245_TX_FIFO_SIZE);
+    
+    // Nobody drains: the write stops when the FIFO is full and time is up
+    assert(io_write_block(fifo, buffer, BLOCK_BYTES, 20) == FT245_TX_FIFO_SIZE);
+    assert(!io_wait_writable(fifo, 0));
+    printf("Unread output: write returned %d bytes at the timeout\n", FT245_TX_FIFO_SIZE);
+    
+    free_board_fifo(fifo);
+    printf("\n✓ Blocking IO test complete\n");
+}
+
 int main(void) {
     printf("╔═══════════════════════════════════════════════╗\n");
     printf("║  Board FIFO Test Suite                        ║\n");
@@ -294,6 +460,8 @@ int main(void) {
     test_bidirectional_transfer();
     test_status_polling();
     test_real_world_scenario();
+    test_stream_megabyte();
+    test_blocking_io();
     
     printf("\n");
     printf("╔═══════════════════════════════════════════════╗\n");
@@ -0,0 +1,426 @@
+/*
+ * Tests for machine cloning
+ *
+ * - A clone starts with the parent's CPU state and memory contents
+ * - Parent and clone diverge independently after writes on either side
+ * - Unwritten pages (including ROM) stay shared; only written pages are copied
+ * - Cloning a machine with all 16MB mapped costs neither a copy nor memory
+ * - Snapshots work on clones, and a clone outlives its parent
+ * - Every machine owns its devices; a clone gets a copy of the parent's
+ * - Destroyed machines give their pool slots back for the next ones
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "machine_setup.h"
+#include "processor_helpers.h"
+#include "processor.h"
+#include "memory_map.h"
+#include "page_pool.h"
+#include "mapper.h"
+#include "snapshot.h"
+
+#define LATCH_ADDRESS 0x7FA4   // Free I/O address between the PIA and the performance counters
+
+static size_t page_of(machine_state_t *machine, uint8_t bank, uint16_t address) {
+    return (size_t)(memory_map_bank(machine->memory_map, bank) + address - machine->memory_map->ram)
+           >> MEMORY_PAGE_SHIFT;
+}
+
+static bool same_slot(machine_state_t *a, machine_state_t *b, uint8_t bank, uint16_t address) {
+    size_t page = page_of(a, bank, address);
+    return a->memory_map->slots[page] == b->memory_map->slots[page];
+}
+
+// Bytes of the page pool that are actually backed by memory
+static size_t pool_resident_bytes(void) {
+    struct stat st;
+    assert(fstat(page_pool_fd(), &st) == 0);
+    return (size_t)st.st_blocks * 512;
+}
+
+static uint8_t peek(machine_state_t *machine, uint8_t bank, uint16_t address) {
+    return read_byte_long(machine, (long_address_t){ .bank = bank, .address = address });
+}
+
+static void poke(machine_state_t *machine, uint8_t bank, uint16_t address, uint8_t value) {
+    write_byte_long(machine, (long_address_t){ .bank = bank, .address = address }, value);
+}
+
+void test_clone_copies_state() {
+    printf("Test: Clone starts as a copy of the parent...\n");
+
+    machine_state_t *parent = create_machine();
+    assert(machine_add_ram_banks(parent, 0x01, 2) == 0);
+    parent->processor.A.full = 0xBEEF;
+    parent->processor.PC = 0x8000;
+    parent->processor.DBR = 0x01;
+    poke(parent, 0x00, 0x0200, 0x11);
+    poke(parent, 0x02, 0x1234, 0x22);
+
+    machine_state_t *child = machine_clone(parent);
+    assert(child != NULL);
+    assert(child->memory_map != parent->memory_map);
+    assert(child->processor.A.full == 0xBEEF);
+    assert(child->processor.PC == 0x8000);
+    assert(child->processor.DBR == 0x01);
+    printf("  CPU registers copied ✓\n");
+
+    assert(peek(child, 0x00, 0x0200) == 0x11);
+    assert(peek(child, 0x02, 0x1234) == 0x22);
+    assert(find_memory_region(child, 0x02, 0x0000) != find_memory_region(parent, 0x02, 0x0000));
+    printf("  Memory contents visible through the clone's own regions ✓\n");
+
+    destroy_machine(child);
+    destroy_machine(parent);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_clone_diverges() {
+    printf("Test: Parent and clone diverge on write...\n");
+
+    machine_state_t *parent = create_machine();
+    assert(machine_add_ram_banks(parent, 0x01, 1) == 0);
+    poke(parent, 0x00, 0x0300, 0xAA);
+    poke(parent, 0x01, 0x0300, 0xBB);
+
+    machine_state_t *child = machine_clone(parent);
+    assert(child != NULL);
+    assert(same_slot(parent, child, 0x00, 0x0300));
+    assert(same_slot(parent, child, 0x01, 0x0300));
+
+    poke(child, 0x00, 0x0300, 0xCC);
+    assert(peek(child, 0x00, 0x0300) == 0xCC);
+    assert(peek(parent, 0x00, 0x0300) == 0xAA);
+    assert(!same_slot(parent, child, 0x00, 0x0300));
+    printf("  Clone writes are private ✓\n");
+
+    poke(parent, 0x01, 0x0300, 0xDD);
+    assert(peek(parent, 0x01, 0x0300) == 0xDD);
+    assert(peek(child, 0x01, 0x0300) == 0xBB);
+    assert(!same_slot(parent, child, 0x01, 0x0300));
+    printf("  Parent writes are private ✓\n");
+
+    // The rest of a copied page came along with it
+    poke(parent, 0x00, 0x0301, 0x01);
+    assert(peek(child, 0x00, 0x0301) == 0x00);
+    poke(child, 0x01, 0x0301, 0x02);
+    assert(peek(child, 0x01, 0x0300) == 0xBB);
+    printf("  Copied pages keep their other bytes ✓\n");
+
+    // Pages written on neither side are still one page
+    assert(same_slot(parent, child, 0x00, 0x5000));
+    assert(same_slot(parent, child, 0x01, 0x8000));
+    printf("  Untouched pages are still shared ✓\n");
+
+    destroy_machine(child);
+    destroy_machine(parent);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_rom_stays_shared() {
+    printf("Test: ROM stays shared...\n");
+
+    machine_state_t *parent = create_machine();
+    memory_region_t *rom = find_memory_region(parent, 0x00, 0x8000);
+    memory_map_poke(parent->memory_map, &rom->data[0x7FFC], 0x00);
+    memory_map_poke(parent->memory_map, &rom->data[0x7FFD], 0x80);
+
+    machine_state_t *child = machine_clone(parent);
+    assert(child != NULL);
+    assert(peek(child, 0x00, 0xFFFC) == 0x00);
+    assert(peek(child, 0x00, 0xFFFD) == 0x80);
+
+    // ROM ignores bus writes, so nothing ever forces a copy
+    poke(child, 0x00, 0xFFFC, 0x12);
+    poke(parent, 0x00, 0xFFFC, 0x34);
+    assert(peek(child, 0x00, 0xFFFC) == 0x00);
+    assert(same_slot(parent, child, 0x00, 0xFFFC));
+    printf("  Reset vector visible and the ROM page shared ✓\n");
+
+    destroy_machine(child);
+    destroy_machine(parent);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_clone_mapper() {
+    printf("Test: Clone carries its own mapper...\n");
+
+    machine_state_t *parent = create_machine();
+    mapper_config_t config = {
+        .reg_bank = 0x00,
+        .reg_address = LATCH_ADDRESS,
+        .window_bank = 0x00,
+        .window_start = 0x4000,
+        .window_end = 0x4FFF,
+        .page_count = 4,
+        .page_flags = MEM_READWRITE,
+    };
+    mapper_t *mapper = latch_mapper_create(parent, &config);
+    assert(mapper != NULL);
+    for (uint8_t page = 0; page < 4; page++) {
+        write_byte_new(parent, LATCH_ADDRESS, page);
+        write_byte_new(parent, 0x4000, 0x50 + page);
+    }
+    write_byte_new(parent, LATCH_ADDRESS, 2);
+
+    machine_state_t *child = machine_clone(parent);
+    assert(child != NULL);
+    mapper_t *copy = child->memory_map->mappers;
+    assert(copy != NULL && copy != mapper);
+    assert(copy->current == 2);
+    assert(read_byte_new(child, 0x4000) == 0x52);
+
+    write_byte_new(child, LATCH_ADDRESS, 1);
+    assert(copy->current == 1);
+    assert(mapper->current == 2);
+    assert(read_byte_new(child, 0x4000) == 0x51);
+    assert(read_byte_new(parent, 0x4000) == 0x52);
+    printf("  Latch writes switch only the clone's window ✓\n");
+
+    write_byte_new(child, 0x4000, 0x99);
+    write_byte_new(parent, LATCH_ADDRESS, 1);
+    assert(read_byte_new(parent, 0x4000) == 0x51);
+    printf("  Mapper pages are copy-on-write too ✓\n");
+
+    destroy_machine(child);
+    destroy_machine(parent);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_clone_cost() {
+    printf("Test: Cloning a machine with 16MB mapped...\n");
+
+    machine_state_t *parent = create_machine();
+    assert(machine_add_ram_banks(parent, 0x01, 255) == 0);
+    for (int bank = 0; bank < 256; bank++) {
+        for (uint32_t address = 0; address < 0x8000; address += MEMORY_PAGE_SIZE) {
+            poke(parent, (uint8_t)bank, (uint16_t)address, (uint8_t)(bank ^ (address >> 12)));
+        }
+        if (bank > 0) {
+            for (uint32_t address = 0x8000; address < 0x10000; address += MEMORY_PAGE_SIZE) {
+                poke(parent, (uint8_t)bank, (uint16_t)address, (uint8_t)(bank ^ (address >> 12)));
+            }
+        }
+    }
+    size_t before = pool_resident_bytes();
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    machine_state_t *child = machine_clone(parent);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    assert(child != NULL);
+
+    double elapsed = (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+    size_t after = pool_resident_bytes();
+    printf("  Cloned in %.1f us, pool grew by %zu KB (%zu KB resident) ✓\n",
+           elapsed, (after - before) / 1024, after / 1024);
+    assert(after - before < 64 * 1024);
+
+    assert(peek(child, 0xFF, 0xF000) == (0xFF ^ 0x0F));
+    assert(peek(child, 0x80, 0x3000) == (0x80 ^ 0x03));
+
+    // One write costs one page
+    before = pool_resident_bytes();
+    poke(child, 0x80, 0x3000, 0x00);
+    after = pool_resident_bytes();
+    assert(after - before <= MEMORY_PAGE_SIZE);
+    assert(peek(parent, 0x80, 0x3000) == (0x80 ^ 0x03));
+    printf("  A write copies a single page ✓\n");
+
+    destroy_machine(child);
+    destroy_machine(parent);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_clone_snapshot() {
+    printf("Test: Snapshots of a clone...\n");
+
+    machine_state_t *parent = create_machine();
+    assert(machine_add_ram_banks(parent, 0x01, 1) == 0);
+    poke(parent, 0x01, 0x0100, 0x10);
+
+    machine_state_t *child = machine_clone(parent);
+    assert(child != NULL);
+    machine_snapshot_t *snapshot = machine_snapshot(child);
+    assert(snapshot != NULL);
+
+    poke(child, 0x01, 0x0100, 0x20);
+    poke(child, 0x01, 0x9000, 0x30);
+    child->processor.X = 0x4242;
+    assert(machine_restore(child, snapshot) == 0);
+    assert(peek(child, 0x01, 0x0100) == 0x10);
+    assert(peek(child, 0x01, 0x9000) == 0x00);
+    assert(child->processor.X == parent->processor.X);
+    printf("  Restore after divergence ✓\n");
+
+    // Restoring must not write through into the parent's pages
+    poke(parent, 0x01, 0x0100, 0x55);
+    machine_state_t *second = machine_clone(parent);
+    assert(second != NULL);
+    machine_snapshot_t *second_snapshot = machine_snapshot(second);
+    poke(second, 0x00, 0x0400, 0x66);
+    assert(machine_restore(second, snapshot) == 0);
+    assert(peek(second, 0x01, 0x0100) == 0x10);
+    assert(peek(parent, 0x01, 0x0100) == 0x55);
+    assert(peek(second, 0x00, 0x0400) == 0x00);
+    printf("  Restoring a shared page leaves the parent alone ✓\n");
+
+    machine_snapshot_free(second_snapshot);
+    machine_snapshot_free(snapshot);
+    destroy_machine(second);
+    destroy_machine(child);
+    destroy_machine(parent);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_clone_outlives_parent() {
+    printf("Test: Clone outlives its parent...\n");
+
+    machine_state_t *parent = create_machine();
+    assert(machine_add_ram_banks(parent, 0x01, 1) == 0);
+    poke(parent, 0x01, 0x2000, 0x77);
+
+    machine_state_t *child = machine_clone(parent);
+    assert(child != NULL);
+    machine_state_t *grandchild = machine_clone(child);
+    assert(grandchild != NULL);
+    destroy_machine(parent);
+
+    assert(peek(child, 0x01, 0x2000) == 0x77);
+    poke(child, 0x01, 0x2000, 0x78);
+    assert(peek(grandchild, 0x01, 0x2000) == 0x77);
+    destroy_machine(child);
+
+    assert(peek(grandchild, 0x01, 0x2000) == 0x77);
+    poke(grandchild, 0x01, 0x2000, 0x79);
+    assert(peek(grandchild, 0x01, 0x2000) == 0x79);
+    reset_machine(grandchild);
+    assert(peek(grandchild, 0x01, 0x2000) == 0x00);
+    printf("  Pages stay valid after the parent is destroyed ✓\n");
+
+    destroy_machine(grandchild);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_machines_own_devices() {
+    printf("Test: Machines own their devices...\n");
+
+    machine_state_t *first = create_machine();
+    machine_state_t *second = create_machine();
+
+    // VIA Timer 1 running with its IRQ enabled on the first machine only
+    write_byte_new(first, 0x7FCE, 0x80 | VIA_INT_T1);
+    write_byte_new(first, 0x7FC4, 0x20);
+    write_byte_new(first, 0x7FC5, 0x00);
+    write_byte_new(second, 0x7FC4, 0x99);
+    assert(get_via_instance(first) != get_via_instance(second));
+    assert((get_via_instance(second)->t1_latch & 0xFF) == 0x99);
+    assert((get_via_instance(first)->t1_latch & 0xFF) == 0x20);
+    printf("  Register writes land on the machine's own VIA ✓\n");
+
+    for (int i = 0; i < 0x30; i++) {
+        machine_clock_devices(first, 1);
+        machine_clock_devices(second, 1);
+    }
+    assert(machine_check_interrupts(first));
+    assert(!machine_check_interrupts(second));
+    assert(first->irq_sources == IRQ_SOURCE_VIA && second->irq_sources == 0);
+    printf("  IRQ raised only on the machine whose timer ran out ✓\n");
+
+    // The clone starts with the parent's pending IRQ and ACIA setup, then
+    // acknowledging it on one side leaves the other asserted
+    write_byte_new(first, 0x7F83, ACIA_CTRL_BAUD_9600 | ACIA_CTRL_WORD_8BIT);
+    machine_state_t *child = machine_clone(first);
+    assert(child != NULL);
+    assert(child->irq_sources == IRQ_SOURCE_VIA);
+    assert(read_byte_new(child, 0x7F83) == (ACIA_CTRL_BAUD_9600 | ACIA_CTRL_WORD_8BIT));
+    write_byte_new(child, 0x7FCD, VIA_INT_T1);
+    assert(!machine_check_interrupts(child));
+    assert(machine_check_interrupts(first));
+    printf("  Clone copies device state, then diverges ✓\n");
+
+    // USB traffic goes to the addressed machine's board FIFO
+    usb_send_byte_to_cpu(second, 0x5A);
+    assert(board_fifo_get_rx_count(second->hardware->board_fifo) == 1);
+    assert(board_fifo_get_rx_count(first->hardware->board_fifo) == 0);
+    printf("  Board FIFOs are separate ✓\n");
+
+    destroy_machine(child);
+    destroy_machine(second);
+    destroy_machine(first);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_pool_slots_reused() {
+    printf("Test: Pool slots are reused...\n");
+
+    // Warm up once: a machine, a clone and a copied page
+    uint64_t idle = page_pool_high_water();
+    machine_state_t *parent = create_machine();
+    machine_state_t *child = machine_clone(parent);
+    poke(child, 0x00, 0x2000, 0x42);
+    uint64_t peak = page_pool_high_water();
+    destroy_machine(child);
+    destroy_machine(parent);
+    assert(page_pool_high_water() == idle);
+
+    for (int cycle = 0; cycle < 2000; cycle++) {
+        parent = create_machine();
+        assert(parent != NULL);
+        assert(peek(parent, 0x00, 0x2000) == 0x00);
+        child = machine_clone(parent);
+        assert(child != NULL);
+        poke(child, 0x00, 0x2000, 0x42);
+        poke(parent, 0x00, 0x3000, 0x24);
+        assert(page_pool_high_water() <= peak + 1);
+        destroy_machine(child);
+        destroy_machine(parent);
+        assert(page_pool_high_water() == idle);
+    }
+    printf("  2000 create/clone/destroy cycles, peak %llu slots ✓\n",
+           (unsigned long long)(peak + 1 - idle));
+
+    // Interleaved lifetimes leave holes that later machines fill
+    machine_state_t *machines[8];
+    for (int i = 0; i < 8; i++) {
+        machines[i] = create_machine();
+    }
+    uint64_t full = page_pool_high_water();
+    for (int i = 0; i < 8; i += 2) {
+        destroy_machine(machines[i]);
+    }
+    for (int i = 0; i < 8; i += 2) {
+        machines[i] = create_machine();
+        assert(peek(machines[i], 0x00, 0x2000) == 0x00);
+    }
+    assert(page_pool_high_water() == full);
+    for (int i = 0; i < 8; i++) {
+        destroy_machine(machines[i]);
+    }
+    assert(page_pool_high_water() == idle);
+    printf("  Holes refilled, top given back ✓\n");
+
+    printf("  ✓ Test passed\n\n");
+}
+
+int main() {
+    printf("=== Machine Clone Tests ===\n\n");
+
+    test_clone_copies_state();
+    test_clone_diverges();
+    test_rom_stays_shared();
+    test_clone_mapper();
+    test_clone_cost();
+    test_clone_snapshot();
+    test_clone_outlives_parent();
+    test_machines_own_devices();
+    test_pool_slots_reused();
+
+    printf("=== All clone tests passed! ===\n");
+    return 0;
+}
@@ -0,0 +1,260 @@
+/*
+ * Tests for the device thread
+ *
+ * - The lookahead horizon follows the timers and scheduled events
+ * - A guest taking timer IRQs from both VIAs runs instruction for
+ *   instruction the same with its devices on a worker thread as without
+ * - Snapshots, clones and stopping the thread part way through see the
+ *   devices caught up
+ * - A machine with a host bridge attached won't start the thread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "machine_setup.h"
+#include "processor_helpers.h"
+#include "snapshot.h"
+#include "device_thread.h"
+#include "host_bridge.h"
+#include "test_helpers.h"
+
+// Free-running VIA T1 every 500 cycles and a board FIFO T2 the handler
+// re-arms every 311, until 64 IRQs are in; then a couple of WAIs
+static const uint8_t timers[] = {
+    0xA9, 0x40, 0x8D, 0xCB, 0x7F,   // 8000: LDA #$40 : STA $7FCB   VIA ACR: T1 free-run
+    0xA9, 0xC0, 0x8D, 0xCE, 0x7F,   // 8005: LDA #$C0 : STA $7FCE   VIA IER: T1
+    0xA9, 0xF4, 0x8D, 0xC4, 0x7F,   // 800A: LDA #$F4 : STA $7FC4   T1 = 500
+    0xA9, 0x01, 0x8D, 0xC5, 0x7F,   // 800F: LDA #$01 : STA $7FC5
+    0xA9, 0xA0, 0x8D, 0xEE, 0x7F,   // 8014: LDA #$A0 : STA $7FEE   Board IER: T2
+    0xA9, 0x37, 0x8D, 0xE8, 0x7F,   // 8019: LDA #$37 : STA $7FE8   T2 = 311
+    0xA9, 0x01, 0x8D, 0xE9, 0x7F,   // 801E: LDA #$01 : STA $7FE9
+    0x58,                           // 8023: CLI
+    0xE6, 0x10,                     // 8024: INC $10
+    0xA2, 0x05,                     // 8026: LDX #$05
+    0xCA,                           // 8028: DEX
+    0xD0, 0xFD,                     // 8029: BNE $8028
+    0xA5, 0x11,                     // 802B: LDA $11
+    0xC9, 0x40,                     // 802D: CMP #64
+    0x90, 0xF3,                     // 802F: BCC $8024
+    0xCB,                           // 8031: WAI
+    0xCB,                           // 8032: WAI
+    0x78,                           // 8033: SEI
+    0xDB,                           // 8034: STP
+};
+
+static const uint8_t handler[] = {
+    0xE6, 0x11,                     // 8040: INC $11
+    0xAD, 0xC4, 0x7F,               // 8042: LDA $7FC4              clear T1
+    0xAD, 0xED, 0x7F,               // 8045: LDA $7FED              board IFR
+    0x29, 0x20,                     // 8048: AND #$20
+    0xF0, 0x07,                     // 804A: BEQ $8053
+    0xE6, 0x12,                     // 804C: INC $12
+    0xA9, 0x01,                     // 804E: LDA #$01
+    0x8D, 0xE9, 0x7F,               // 8050: STA $7FE9              re-arm T2
+    0x58,                           // 8053: CLI                    RTI leaves I set here
+    0x40,                           // 8054: RTI
+};
+
+static machine_state_t *timer_machine(void) {
+    machine_state_t *machine = create_machine();
+    memory_region_t *rom = load_program(machine, timers, sizeof(timers));
+    memcpy(rom->data + 0x40, handler, sizeof(handler));
+    rom->data[0x7FFE] = 0x40;
+    rom->data[0x7FFF] = 0x80;
+    return machine;
+}
+
+typedef struct trace_s {
+    uint64_t hash;             // Over PC, registers and cycles before every instruction
+    uint64_t instructions;
+    bool halted;
+} trace_t;
+
+// Run like the runner does: IRQs taken between instructions
+static void run(machine_state_t *machine, trace_t *trace, uint64_t instructions) {
+    for (uint64_t i = 0; i < instructions && !trace->halted; i++) {
+        if (!machine->processor.interrupts_disabled && machine_irq_sources(machine)) {
+            machine_process_interrupt(machine);
+        }
+        processor_state_t *p = &machine->processor;
+        uint64_t state = ((uint64_t)p->PC << 48) ^ ((uint64_t)p->A.full << 32) ^
+                         ((uint64_t)p->X << 16) ^ p->P ^ machine->cycles;
+        trace->hash = trace->hash * 1099511628211ULL ^ state;
+        machine_execute_instruction(machine, &trace->halted);
+        trace->instructions++;
+    }
+}
+
+static void assert_same(machine_state_t *a, const trace_t *ta, machine_state_t *b, const trace_t *tb) {
+    machine_sync_devices(a);
+    machine_sync_devices(b);
+    assert(ta->hash == tb->hash && ta->instructions == tb->instructions);
+    assert(ta->halted == tb->halted);
+    assert(a->cycles == b->cycles);
+    assert(memcmp(&a->counters, &b->counters, sizeof(a->counters)) == 0);
+    assert(a->irq_sources == b->irq_sources && a->irq_taken_sources == b->irq_taken_sources);
+    assert(a->hardware->clocked == b->hardware->clocked);
+    for (uint16_t address = 0x10; address <= 0x12; address++) {
+        assert(read_byte_new(a, address) == read_byte_new(b, address));
+    }
+}
+
+void test_horizon() {
+    printf("Test: Lookahead horizon...\n");
+
+    machine_state_t *machine = create_machine();
+    assert(machine_devices_irq_horizon(machine) == UINT64_MAX);
+    printf("  No timers: no horizon ✓\n");
+
+    // A disabled timer doesn't limit it either
+    write_byte_new(machine, 0x7FC4, 0xE8);
+    write_byte_new(machine, 0x7FC5, 0x03);   // T1 = 1000
+    assert(machine_devices_irq_horizon(machine) == UINT64_MAX);
+
+    write_byte_new(machine, 0x7FCE, 0xC0);   // IER: T1
+    uint64_t horizon = machine_devices_irq_horizon(machine);
+    assert(horizon > machine->cycles && horizon <= machine->cycles + 1002);
+    printf("  VIA T1 due in %llu cycles ✓\n", (unsigned long long)(horizon - machine->cycles));
+
+    // The nearer board T2 takes over
+    write_byte_new(machine, 0x7FEE, 0xA0);
+    write_byte_new(machine, 0x7FE8, 0x64);
+    write_byte_new(machine, 0x7FE9, 0x00);   // T2 = 100
+    uint64_t board = machine_devices_irq_horizon(machine);
+    assert(board > machine->cycles && board <= machine->cycles + 102 && board < horizon);
+
+    // Once the line is up it stays up until the CPU clears it
+    for (int i = 0; i < 60; i++) {
+        machine_clock_devices(machine, 2);
+    }
+    assert(machine->irq_sources & IRQ_SOURCE_BOARD_FIFO);
+    assert(machine_devices_irq_horizon(machine) == horizon);
+    printf("  Board T2 first, then back to T1 once it fired ✓\n");
+
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_identical() {
+    printf("Test: Same run with and without the device thread...\n");
+
+    machine_state_t *inline_machine = timer_machine();
+    machine_state_t *threaded = timer_machine();
+    assert(machine_start_device_thread(threaded) == 0);
+    assert(threaded->hardware->device_thread != NULL);
+
+    trace_t a = { 0 }, b = { 0 };
+    run(inline_machine, &a, 200000);
+    run(threaded, &b, 200000);
+    assert(a.halted && read_byte_new(inline_machine, 0x11) >= 64);
+    assert(read_byte_new(inline_machine, 0x12) > 0 && inline_machine->counters.wai_cycles > 0);
+    assert_same(inline_machine, &a, threaded, &b);
+    printf("  %llu instructions, %llu cycles, %u IRQs: identical ✓\n",
+           (unsigned long long)a.instructions, (unsigned long long)inline_machine->cycles,
+           read_byte_new(inline_machine, 0x11));
+
+    device_thread_stats_t stats;
+    device_thread_get_stats(threaded->hardware->device_thread, &stats);
+    assert(stats.steps > a.instructions);   // WAI clocks a cycle at a time
+    printf("  %llu steps; %llu syncs, %llu IRQ samples from the horizon, %llu past it ✓\n",
+           (unsigned long long)stats.steps, (unsigned long long)stats.syncs,
+           (unsigned long long)stats.irq_lookahead, (unsigned long long)stats.irq_waits);
+
+    machine_stop_device_thread(threaded);
+    assert(threaded->hardware->device_thread == NULL);
+    destroy_machine(inline_machine);
+    destroy_machine(threaded);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_handover() {
+    printf("Test: Snapshots, clones and stopping mid-run...\n");
+
+    machine_state_t *reference = timer_machine();
+    trace_t ref = { 0 };
+    run(reference, &ref, 200000);
+
+    // Clone and snapshot a threaded machine part way through
+    machine_state_t *threaded = timer_machine();
+    assert(machine_start_device_thread(threaded) == 0);
+    trace_t t = { 0 };
+    run(threaded, &t, 1500);
+    machine_snapshot_t *snapshot = machine_snapshot(threaded);
+    assert(snapshot != NULL);
+    machine_state_t *clone = machine_clone(threaded);
+    assert(clone != NULL && clone->hardware->device_thread == NULL);
+    trace_t c = t;
+
+    // The threaded machine finishes inline, the clone with its own thread
+    machine_stop_device_thread(threaded);
+    run(threaded, &t, 200000);
+    assert_same(reference, &ref, threaded, &t);
+    printf("  Stopping the thread mid-run ✓\n");
+
+    assert(machine_start_device_thread(clone) == 0);
+    run(clone, &c, 200000);
+    assert_same(reference, &ref, clone, &c);
+    printf("  Clone taken mid-run, finished threaded ✓\n");
+
+    // Restore into a machine whose thread is running
+    assert(machine_start_device_thread(threaded) == 0);
+    assert(machine_restore(threaded, snapshot) == 0);
+    trace_t r = { 0 };
+    run(threaded, &r, 200000);
+    machine_state_t *replay = timer_machine();
+    trace_t p = { 0 };
+    run(replay, &p, 1500);
+    p.hash = 0;
+    p.instructions = 0;
+    run(replay, &p, 200000);
+    assert_same(replay, &p, threaded, &r);
+    printf("  Snapshot restored under a running thread ✓\n");
+
+    machine_snapshot_free(snapshot);
+    destroy_machine(reference);
+    destroy_machine(threaded);
+    destroy_machine(clone);
+    destroy_machine(replay);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_host_bridge_refused() {
+    printf("Test: No device thread with a host bridge...\n");
+
+    host_bridge_t *bridge = host_bridge_open_pty();
+    assert(bridge != NULL);
+    machine_state_t *machine = create_machine();
+    acia6551_t *acia = get_acia_instance(machine);
+    host_bridge_attach_acia(bridge, acia);
+    assert(machine_start_device_thread(machine) == -1);
+    assert(machine->hardware->device_thread == NULL);
+    acia6551_set_byte_callbacks(acia, NULL, NULL, NULL);
+    assert(machine_start_device_thread(machine) == 0);
+    machine_stop_device_thread(machine);
+    printf("  ACIA bridged: refused; detached: started ✓\n");
+
+    ft245_t *ft245 = board_fifo_get_ft245(machine->hardware->board_fifo);
+    host_bridge_attach_ft245(bridge, ft245);
+    assert(machine_start_device_thread(machine) == -1);
+    ft245_set_usb_rx_buffer_callback(ft245, NULL);
+    assert(machine_start_device_thread(machine) == 0);
+    printf("  FT245 bridged: refused; detached: started ✓\n");
+
+    destroy_machine(machine);
+    host_bridge_close(bridge);
+    printf("  ✓ Test passed\n\n");
+}
+
+int main() {
+    printf("=== Device Thread Tests ===\n\n");
+
+    test_horizon();
+    test_identical();
+    test_handover();
+    test_host_bridge_refused();
+
+    printf("=== All device thread tests passed! ===\n");
+    return 0;
+}
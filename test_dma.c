@@ -0,0 +1,255 @@
+/*
+ * Tests for the DMA controller
+ *
+ * - A guest program sets up and starts a RAM-to-RAM transfer
+ * - Transfers steal their cycles from the CPU; other devices keep running
+ *   through them and the completion IRQ comes at the end
+ * - Overlapping copies match a byte-by-byte forward copy
+ * - Copies across banks keep clones copy-on-write
+ * - Memory to device register and device register to memory
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "machine_setup.h"
+#include "memory_map.h"
+#include "processor_helpers.h"
+#include "dma.h"
+#include "test_helpers.h"
+
+#define DMA_BASE 0x7FD0
+#define VIA_BASE 0x7FC0
+
+static void program_dma(machine_state_t *machine, uint32_t src, uint32_t dst, uint16_t count, uint8_t mode) {
+    write_byte_new(machine, DMA_BASE + DMA_SRC_LO, src & 0xFF);
+    write_byte_new(machine, DMA_BASE + DMA_SRC_HI, (src >> 8) & 0xFF);
+    write_byte_new(machine, DMA_BASE + DMA_SRC_BANK, (src >> 16) & 0xFF);
+    write_byte_new(machine, DMA_BASE + DMA_DST_LO, dst & 0xFF);
+    write_byte_new(machine, DMA_BASE + DMA_DST_HI, (dst >> 8) & 0xFF);
+    write_byte_new(machine, DMA_BASE + DMA_DST_BANK, (dst >> 16) & 0xFF);
+    write_byte_new(machine, DMA_BASE + DMA_COUNT_LO, count & 0xFF);
+    write_byte_new(machine, DMA_BASE + DMA_COUNT_HI, count >> 8);
+    write_byte_new(machine, DMA_BASE + DMA_MODE, mode);
+}
+
+static uint8_t peek(machine_state_t *machine, uint32_t address) {
+    return read_byte_long(machine, (long_address_t){ .bank = address >> 16, .address = address & 0xFFFF });
+}
+
+static void poke(machine_state_t *machine, uint32_t address, uint8_t value) {
+    write_byte_long(machine, (long_address_t){ .bank = address >> 16, .address = address & 0xFFFF }, value);
+}
+
+void test_guest_transfer() {
+    printf("Test: Guest-programmed RAM to RAM transfer...\n");
+
+    static const uint8_t program[] = {
+        0xA9, 0x00, 0x8D, 0xD0, 0x7F,   // LDA #$00 : STA $7FD0  source $00:2000
+        0xA9, 0x20, 0x8D, 0xD1, 0x7F,   // LDA #$20 : STA $7FD1
+        0xA9, 0x00, 0x8D, 0xD2, 0x7F,   // LDA #$00 : STA $7FD2
+        0xA9, 0x00, 0x8D, 0xD3, 0x7F,   // LDA #$00 : STA $7FD3  destination $00:3000
+        0xA9, 0x30, 0x8D, 0xD4, 0x7F,   // LDA #$30 : STA $7FD4
+        0xA9, 0x00, 0x8D, 0xD5, 0x7F,   // LDA #$00 : STA $7FD5
+        0xA9, 0x00, 0x8D, 0xD6, 0x7F,   // LDA #$00 : STA $7FD6  count $1000
+        0xA9, 0x10, 0x8D, 0xD7, 0x7F,   // LDA #$10 : STA $7FD7
+        0xA9, 0x00, 0x8D, 0xD8, 0x7F,   // LDA #$00 : STA $7FD8  memory to memory
+        0xA9, 0x01, 0x8D, 0xD9, 0x7F,   // LDA #$01 : STA $7FD9  start
+        0xAD, 0xD9, 0x7F,               // LDA $7FD9             status
+        0xDB,                           // STP
+    };
+    machine_state_t *machine = create_machine();
+    load_program(machine, program, sizeof(program));
+    for (int i = 0; i < 0x1000; i++) {
+        poke(machine, 0x2000 + i, (uint8_t)(i * 7 + 3));
+    }
+
+    bool halted = false;
+    while (!halted) {
+        machine_execute_instruction(machine, &halted);
+    }
+    for (int i = 0; i < 0x1000; i++) {
+        assert(peek(machine, 0x3000 + i) == (uint8_t)(i * 7 + 3));
+    }
+    assert(machine->processor.A.low == DMA_STATUS_DONE);
+    printf("  4KB copied; status read back DONE ✓\n");
+
+    dma_t *dma = get_dma_instance(machine);
+    assert(dma->transfers == 1 && dma->bytes == 0x1000 && dma->memcpy_bytes == 0x1000);
+    assert(dma->stolen_cycles == 0x1000 * DMA_CYCLES_PER_BYTE);
+    assert(machine->cycles >= dma->stolen_cycles);
+    assert(dma->source == 0x3000 && dma->dest == 0x4000 && dma->count == 0);
+    assert(dma_read(dma, DMA_CTRL) == 0);
+    printf("  %llu cycles stolen (MVN would take %d); moved as memcpy ✓\n",
+           (unsigned long long)dma->stolen_cycles, 0x1000 * 7);
+
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_cycle_stealing() {
+    printf("Test: Cycle stealing and the completion IRQ...\n");
+
+    machine_state_t *machine = create_machine();
+
+    // VIA timer 1 due 100 cycles in, well inside the transfer
+    write_byte_new(machine, VIA_BASE + VIA_IER, 0x80 | VIA_INT_T1);
+    write_byte_new(machine, VIA_BASE + VIA_T1CL, 100);
+    write_byte_new(machine, VIA_BASE + VIA_T1CH, 0);
+
+    program_dma(machine, 0x1000, 0x5000, 256, DMA_MODE_MEM_TO_MEM | DMA_MODE_IRQ_ENABLE);
+    assert(!(machine->irq_sources & IRQ_SOURCE_DMA));
+    uint64_t start = machine->cycles;
+    write_byte_new(machine, DMA_BASE + DMA_CTRL, DMA_CTRL_START);
+    assert(machine->cycles - start == 256 * DMA_CYCLES_PER_BYTE);
+    printf("  Start write held the CPU for %llu cycles ✓\n", (unsigned long long)(machine->cycles - start));
+
+    assert(machine->irq_sources & IRQ_SOURCE_VIA);
+    assert(machine->irq_sources & IRQ_SOURCE_DMA);
+    char names[64];
+    printf("  Pending after the transfer: %s\n", machine_irq_source_names(machine->irq_sources, names, sizeof(names)));
+    printf("  VIA timer expired during the transfer; DMA IRQ raised at its end ✓\n");
+
+    assert(read_byte_new(machine, DMA_BASE + DMA_CTRL) == DMA_STATUS_DONE);
+    assert(!(machine->irq_sources & IRQ_SOURCE_DMA));
+    printf("  Reading the status acknowledges the IRQ ✓\n");
+
+    write_byte_new(machine, DMA_BASE + DMA_MODE, 0x03);
+    start = machine->cycles;
+    write_byte_new(machine, DMA_BASE + DMA_CTRL, DMA_CTRL_START);
+    assert(machine->cycles == start);
+    assert(read_byte_new(machine, DMA_BASE + DMA_CTRL) == DMA_STATUS_ERROR);
+    printf("  Invalid mode flags an error and steals nothing ✓\n");
+
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_overlap() {
+    printf("Test: Overlapping copies...\n");
+
+    machine_state_t *machine = create_machine();
+    poke(machine, 0x1000, 0xAB);
+    poke(machine, 0x1001, 0xCD);
+    poke(machine, 0x1002, 0xEF);
+
+    // Destination three bytes ahead: the first three bytes repeat
+    static const uint8_t pattern[] = { 0xAB, 0xCD, 0xEF };
+    program_dma(machine, 0x1000, 0x1003, 0x200, DMA_MODE_MEM_TO_MEM);
+    write_byte_new(machine, DMA_BASE + DMA_CTRL, DMA_CTRL_START);
+    for (int i = 0; i < 0x203; i++) {
+        assert(peek(machine, 0x1000 + i) == pattern[i % 3]);
+    }
+    printf("  Forward overlap fills with the source pattern ✓\n");
+
+    // Destination behind the source: a plain move
+    for (int i = 0; i < 16; i++) {
+        poke(machine, 0x2010 + i, (uint8_t)i);
+    }
+    program_dma(machine, 0x2010, 0x2008, 16, DMA_MODE_MEM_TO_MEM);
+    write_byte_new(machine, DMA_BASE + DMA_CTRL, DMA_CTRL_START);
+    for (int i = 0; i < 16; i++) {
+        assert(peek(machine, 0x2008 + i) == i);
+    }
+    printf("  Backward overlap moves the block intact ✓\n");
+
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_banks_and_clones() {
+    printf("Test: Cross-bank copies and clones...\n");
+
+    machine_state_t *parent = create_machine();
+    assert(machine_add_ram_banks(parent, 0x01, 2) == 0);
+    for (int i = 0; i < 0x3000; i++) {
+        poke(parent, 0x01E000 + i, (uint8_t)(i >> 4));  // Runs from bank 1 into bank 2
+        poke(parent, 0x018000 + i, 0x55);
+    }
+
+    machine_state_t *clone = machine_clone(parent);
+    assert(clone != NULL);
+    program_dma(clone, 0x01E000, 0x018000, 0x3000, DMA_MODE_MEM_TO_MEM);
+    write_byte_new(clone, DMA_BASE + DMA_CTRL, DMA_CTRL_START);
+    for (int i = 0; i < 0x3000; i++) {
+        assert(peek(clone, 0x018000 + i) == (uint8_t)(i >> 4));
+        assert(peek(parent, 0x018000 + i) == 0x55);
+    }
+    printf("  Copy across the bank 1/2 boundary lands in the clone only ✓\n");
+
+    dma_t *dma = get_dma_instance(clone);
+    assert(dma->memcpy_bytes == 0x3000 && dma->dest == 0x01B000);
+    assert(!parent->hardware->dma_initialized);
+    printf("  Clone's controller state is its own ✓\n");
+
+    // Destination pages are tracked like CPU writes
+    memory_map_t *map = clone->memory_map;
+    size_t page = (size_t)(memory_map_bank(map, 0x01) + 0x8000 - map->ram) >> MEMORY_PAGE_SHIFT;
+    assert(!memory_map_page_shared(map, page) && !memory_map_page_shared(map, page + 2));
+    assert((map->dirty[page >> 6] >> (page & 63)) & 1);
+    printf("  Destination pages unshared and marked dirty ✓\n");
+
+    destroy_machine(clone);
+    destroy_machine(parent);
+    printf("  ✓ Test passed\n\n");
+}
+
+static char transmitted[64];
+static size_t transmitted_count;
+
+static void capture_tx(void *context, uint8_t byte) {
+    if (transmitted_count < sizeof(transmitted)) {
+        transmitted[transmitted_count++] = (char)byte;
+    }
+}
+
+void test_device_modes() {
+    printf("Test: Device register transfers...\n");
+
+    machine_state_t *machine = create_machine();
+    acia6551_t *acia = get_acia_instance(machine);
+    acia6551_set_unthrottled(acia, true);
+    acia6551_set_byte_callbacks(acia, capture_tx, NULL, NULL);
+
+    const char *message = "DMA to the ACIA";
+    size_t length = strlen(message);
+    for (size_t i = 0; i < length; i++) {
+        poke(machine, 0x0400 + i, (uint8_t)message[i]);
+    }
+    program_dma(machine, 0x000400, 0x007F80, (uint16_t)length, DMA_MODE_MEM_TO_DEV);
+    write_byte_new(machine, DMA_BASE + DMA_CTRL, DMA_CTRL_START);
+    assert(transmitted_count == length && memcmp(transmitted, message, length) == 0);
+    dma_t *dma = get_dma_instance(machine);
+    assert(dma->dest == 0x007F80 && dma->source == 0x000400 + length);
+    printf("  \"%.*s\" written to the ACIA data register ✓\n", (int)transmitted_count, transmitted);
+
+    const char *reply = "reply";
+    for (size_t i = 0; i < strlen(reply); i++) {
+        acia6551_receive_byte(acia, (uint8_t)reply[i]);
+    }
+    program_dma(machine, 0x007F80, 0x000600, (uint16_t)strlen(reply), DMA_MODE_DEV_TO_MEM);
+    write_byte_new(machine, DMA_BASE + DMA_CTRL, DMA_CTRL_START);
+    for (size_t i = 0; i < strlen(reply); i++) {
+        assert(peek(machine, 0x0600 + i) == (uint8_t)reply[i]);
+    }
+    assert(!(read_byte_new(machine, 0x7F81) & ACIA_STATUS_RDRF));
+    assert(dma->memcpy_bytes == 0);
+    printf("  ACIA receive FIFO drained into RAM ✓\n");
+
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+int main() {
+    printf("=== DMA Controller Tests ===\n\n");
+
+    test_guest_transfer();
+    test_cycle_stealing();
+    test_overlap();
+    test_banks_and_clones();
+    test_device_modes();
+
+    printf("=== All DMA controller tests passed! ===\n");
+    return 0;
+}
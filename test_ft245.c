@@ -2,6 +2,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <assert.h>
 #include "ft245.h"
 
 // Test context
@@ -350,6 +351,79 @@ void test_control_signals(void) {
     printf("\n✓ Control signal test complete\n");
 }
 
+// Host that has `ready` bytes queued; the test adds to it between steps
+typedef struct {
+    uint32_t ready;
+    uint8_t next;
+} host_queue_t;
+
+static uint8_t queue_rx_callback(void* ctx, bool* available) {
+    host_queue_t* queue = (host_queue_t*)ctx;
+    *available = queue->ready > 0;
+    if (!*available) {
+        return 0;
+    }
+    queue->ready--;
+    return queue->next++;
+}
+
+void test_clock_n_matches_per_cycle(void) {
+    print_test_header("Batched Clocking vs Per-Cycle Clocking");
+    
+    ft245_t fast, slow;
+    host_queue_t fast_host = {0}, slow_host = {0};
+    ft245_init(&fast);
+    ft245_init(&slow);
+    ft245_set_usb_connected(&fast, true);
+    ft245_set_usb_connected(&slow, true);
+    ft245_set_usb_callbacks(&fast, NULL, queue_rx_callback, &fast_host);
+    ft245_set_usb_callbacks(&slow, NULL, queue_rx_callback, &slow_host);
+    
+    uint32_t seed = 245;
+    for (int step = 0; step < 20000; step++) {
+        seed = seed * 1103515245 + 12345;
+        uint32_t r = (seed >> 16) & 0x7FFF;
+        
+        // Host trickles data in; the CPU strobes RD# now and then
+        if (r % 3 == 0) {
+            fast_host.ready += r % 5;
+            slow_host.ready += r % 5;
+        }
+        if (r % 7 == 0) {
+            bool rd = (r & 0x100) != 0;
+            ft245_set_rd(&fast, rd);
+            ft245_set_rd(&slow, rd);
+        }
+        if (r % 11 == 0) {
+            assert(ft245_read(&fast) == ft245_read(&slow));
+        }
+        
+        uint32_t cycles = r % 9;
+        ft245_clock_n(&fast, cycles);
+        for (uint32_t i = 0; i < cycles; i++) {
+            ft245_clock(&slow);
+        }
+        assert(ft245_get_rx_fifo_count(&fast) == ft245_get_rx_fifo_count(&slow));
+        assert(fast.data_bus == slow.data_bus);
+        assert(fast.read_timer == slow.read_timer);
+        assert(fast.rxf_n == slow.rxf_n);
+    }
+    printf("Batched clocking matched per-cycle clocking over 20000 steps\n");
+    
+    // Bulk pull stops when the RX FIFO is full instead of dropping bytes
+    ft245_t full;
+    host_queue_t host = { .ready = 2 * FT245_RX_FIFO_SIZE };
+    ft245_init(&full);
+    ft245_set_usb_connected(&full, true);
+    ft245_set_usb_callbacks(&full, NULL, queue_rx_callback, &host);
+    ft245_clock_n(&full, 10000);
+    assert(ft245_get_rx_fifo_count(&full) == FT245_RX_FIFO_SIZE);
+    assert(host.ready == FT245_RX_FIFO_SIZE);
+    printf("Host data waits while the RX FIFO is full\n");
+    
+    printf("\n✓ Batched clocking test complete\n");
+}
+
 int main(void) {
     printf("╔═══════════════════════════════════════════════╗\n");
     printf("║  FT245 USB FIFO Emulation Test Suite          ║\n");
@@ -363,6 +437,7 @@ int main(void) {
     test_fifo_status();
     test_buffer_operations();
     test_control_signals();
+    test_clock_n_matches_per_cycle();
     
     printf("\n");
     printf("╔═══════════════════════════════════════════════╗\n");
@@ -0,0 +1,185 @@
+/*
+ * Tests for the shared-memory GPIO mirror
+ *
+ * - VIA and PIA output registers, DDRs and control lines show up in the
+ *   segment; unchanged writes don't bump the sequence number
+ * - Pins and control line edges driven through the segment reach the chip
+ * - A harness in another process drives and watches the ports
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include "gpio_shm.h"
+#include "via6522.h"
+#include "pia6521.h"
+
+static char segment_name[64];
+
+void test_via_mirror() {
+    printf("Test: VIA mirror...\n");
+
+    gpio_shm_t *shm = gpio_shm_create(segment_name);
+    assert(shm != NULL);
+    gpio_shm_t *harness = gpio_shm_open(segment_name);
+    assert(harness != NULL && harness != shm);
+    gpio_shm_chip_t *pins = gpio_shm_chip(harness, GPIO_SHM_VIA);
+
+    via6522_t via;
+    via6522_init(&via);
+    via6522_attach_gpio(&via, gpio_shm_chip(shm, GPIO_SHM_VIA));
+
+    via6522_write(&via, VIA_DDRB, 0xF0);
+    via6522_write(&via, VIA_ORB_IRB, 0xA5);
+    gpio_shm_outputs_t out;
+    uint32_t seq = gpio_shm_read_outputs(pins, &out);
+    assert(out.port_b == 0xA5 && out.ddr_b == 0xF0 && out.port_a == 0 && out.ddr_a == 0);
+    assert(seq > 0 && (seq & 1) == 0);
+    printf("  ORB/DDRB visible to the harness (sequence %u) ✓\n", seq);
+
+    via6522_write(&via, VIA_ORB_IRB, 0xA5);
+    via6522_read(&via, VIA_T1CL);
+    assert(gpio_shm_output_seq(pins) == seq);
+    via6522_write(&via, VIA_PCR, VIA_PCR_CA2_OUTPUT_HIGH);
+    assert(gpio_shm_output_seq(pins) > seq);
+    gpio_shm_read_outputs(pins, &out);
+    assert(out.lines & GPIO_SHM_CA2);
+    printf("  Sequence moves only on changes; CA2 output mirrored ✓\n");
+
+    gpio_shm_inputs_t in = { .port_b = 0x0F };
+    gpio_shm_set_inputs(pins, &in);
+    assert(via6522_read(&via, VIA_ORB_IRB) == 0xAF);
+    printf("  Input pins read through DDRB ✓\n");
+
+    // CA1 defaults to negative edge: high, then low
+    in.lines = GPIO_SHM_CA1;
+    gpio_shm_set_inputs(pins, &in);
+    assert(!(via6522_read(&via, VIA_IFR) & VIA_INT_CA1));
+    in.lines = 0;
+    gpio_shm_set_inputs(pins, &in);
+    via6522_clock(&via);
+    assert(via.ifr & VIA_INT_CA1);
+    printf("  CA1 edge from the harness sets IFR ✓\n");
+
+    gpio_shm_close(harness);
+    gpio_shm_close(shm);
+    gpio_shm_unlink(segment_name);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_pia_mirror() {
+    printf("Test: PIA mirror...\n");
+
+    gpio_shm_t *shm = gpio_shm_create(segment_name);
+    assert(shm != NULL);
+    gpio_shm_chip_t *pins = gpio_shm_chip(shm, GPIO_SHM_PIA);
+
+    pia6521_t pia;
+    pia6521_init(&pia);
+    pia6521_attach_gpio(&pia, pins);
+
+    pia6521_write(&pia, PIA_PORTA_DATA, 0xFF);            // DDRA
+    pia6521_write(&pia, PIA_PORTA_CTRL, PIA_CR_DDR_ACCESS);
+    pia6521_write(&pia, PIA_PORTA_DATA, 0x3C);
+    gpio_shm_outputs_t out;
+    gpio_shm_read_outputs(pins, &out);
+    assert(out.port_a == 0x3C && out.ddr_a == 0xFF);
+    printf("  Port A output and DDR mirrored ✓\n");
+
+    pia6521_write(&pia, PIA_PORTB_CTRL, PIA_CR_DDR_ACCESS);
+    gpio_shm_inputs_t in = { .port_b = 0x99, .lines = GPIO_SHM_CB1 };
+    gpio_shm_set_inputs(pins, &in);
+    assert(pia6521_read(&pia, PIA_PORTB_DATA) == 0x99);
+    in.lines = 0;
+    gpio_shm_set_inputs(pins, &in);
+    assert(pia6521_read(&pia, PIA_PORTB_CTRL) & PIA_CR_IRQA1_FLAG);
+    printf("  Port B pins and a CB1 edge reach the PIA ✓\n");
+
+    gpio_shm_close(shm);
+    gpio_shm_unlink(segment_name);
+    assert(gpio_shm_open(segment_name) == NULL);
+    printf("  ✓ Test passed\n\n");
+}
+
+// The other process: wait for port B to show 0x01, answer on port A
+static int run_harness(void) {
+    gpio_shm_t *shm = NULL;
+    for (int i = 0; i < 1000 && !shm; i++) {
+        shm = gpio_shm_open(segment_name);
+        sched_yield();
+    }
+    if (!shm) {
+        return 1;
+    }
+    gpio_shm_chip_t *pins = gpio_shm_chip(shm, GPIO_SHM_VIA);
+    uint32_t seen = 0;
+    gpio_shm_outputs_t out = { 0 };
+    struct timespec pause = { .tv_sec = 0, .tv_nsec = 100000 };
+    for (int i = 0; i < 20000 && out.port_b != 0x01; i++) {
+        if (gpio_shm_output_seq(pins) != seen) {
+            seen = gpio_shm_read_outputs(pins, &out);
+        } else {
+            nanosleep(&pause, NULL);
+        }
+    }
+    if (out.port_b != 0x01) {
+        return 2;
+    }
+    gpio_shm_inputs_t in = { .port_a = 0x42 };
+    gpio_shm_set_inputs(pins, &in);
+    gpio_shm_close(shm);
+    return 0;
+}
+
+void test_harness_process() {
+    printf("Test: Harness in another process...\n");
+
+    gpio_shm_t *shm = gpio_shm_create(segment_name);
+    assert(shm != NULL);
+    via6522_t via;
+    via6522_init(&via);
+    via6522_attach_gpio(&via, gpio_shm_chip(shm, GPIO_SHM_VIA));
+
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        _exit(run_harness());
+    }
+
+    via6522_write(&via, VIA_DDRB, 0xFF);
+    via6522_write(&via, VIA_ORB_IRB, 0x01);
+    uint8_t answer = 0;
+    struct timespec pause = { .tv_sec = 0, .tv_nsec = 100000 };
+    for (int i = 0; i < 20000 && answer != 0x42; i++) {
+        answer = via6522_read(&via, VIA_ORA_IRA_NH);
+        if (answer != 0x42) {
+            nanosleep(&pause, NULL);
+        }
+    }
+    int status;
+    assert(waitpid(pid, &status, 0) == pid);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    assert(answer == 0x42);
+    printf("  Harness saw PB0 go high and drove 0x42 onto port A ✓\n");
+
+    gpio_shm_close(shm);
+    gpio_shm_unlink(segment_name);
+    printf("  ✓ Test passed\n\n");
+}
+
+int main() {
+    printf("=== GPIO Shared Memory Tests ===\n\n");
+
+    snprintf(segment_name, sizeof(segment_name), "/65816-gpio-test-%d", (int)getpid());
+    test_via_mirror();
+    test_pia_mirror();
+    test_harness_process();
+
+    printf("=== All GPIO shared memory tests passed! ===\n");
+    return 0;
+}
@@ -0,0 +1,26 @@
+#ifndef __TEST_HELPERS_H__
+#define __TEST_HELPERS_H__
+
+#include <assert.h>
+#include <string.h>
+#include "machine_setup.h"
+
+// Shared fixtures for the test programs
+
+// Copy `code` into the ROM region at $00:8000 and point the processor at it,
+// in emulation mode
+// Returns: the ROM region, to patch the program or its vectors
+static inline memory_region_t *load_program(machine_state_t *machine, const uint8_t *code, size_t length) {
+    memory_region_t *rom = machine->memory_banks[0]->regions;
+    while (rom && rom->start_offset != 0x8000) {
+        rom = rom->next;
+    }
+    assert(rom != NULL);
+    memcpy(rom->data, code, length);
+    machine->processor.PC = 0x8000;
+    machine->processor.PBR = 0x00;
+    machine->processor.emulation_mode = true;
+    return rom;
+}
+
+#endif // __TEST_HELPERS_H__
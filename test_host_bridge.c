@@ -0,0 +1,331 @@
+/*
+ * Tests for the host bridge
+ *
+ * - The machine's ACIA talks to a Unix socket client in both directions
+ * - Host I/O is batched: one read()/write() per poll, not per character
+ * - A client hanging up frees the socket for the next one
+ * - The same works over a pseudo-terminal
+ * - The board FIFO moves bulk data through named pipes in blocks, with
+ *   backpressure through RXF#/TXE# instead of dropped bytes
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "machine_setup.h"
+#include "processor_helpers.h"
+#include "host_bridge.h"
+#include "board_fifo.h"
+
+#define ACIA_BASE 0x7F80
+#define MESSAGE_SIZE 1000
+#define FIRMWARE_SIZE (256 * 1024)
+
+static int connect_client(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(fd >= 0);
+    assert(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    return fd;
+}
+
+static void read_all(int fd, uint8_t *data, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t got = read(fd, data + done, size - done);
+        assert(got > 0);
+        done += (size_t)got;
+    }
+}
+
+// Bridge the machine's ACIA, unthrottled, with the receiver enabled
+static acia6551_t *setup_acia(machine_state_t *machine, host_bridge_t *bridge) {
+    write_byte_new(machine, ACIA_BASE + ACIA_CONTROL, ACIA_CTRL_BAUD_19200 | ACIA_CTRL_WORD_8BIT);
+    write_byte_new(machine, ACIA_BASE + ACIA_COMMAND, ACIA_CMD_DTR_ENABLE);
+    acia6551_t *acia = get_acia_instance(machine);
+    acia6551_set_unthrottled(acia, true);
+    host_bridge_attach_acia(bridge, acia);
+    return acia;
+}
+
+// What the CPU sees arriving on the ACIA, reading it as fast as it comes
+static size_t cpu_receive(machine_state_t *machine, uint8_t *data, size_t size) {
+    size_t count = 0;
+    for (int idle = 0; count < size && idle < 4; ) {
+        machine_clock_devices(machine, 1);
+        if (read_byte_new(machine, ACIA_BASE + ACIA_STATUS) & ACIA_STATUS_RDRF) {
+            data[count++] = read_byte_new(machine, ACIA_BASE + ACIA_DATA);
+            idle = 0;
+        } else {
+            idle++;
+        }
+    }
+    return count;
+}
+
+void test_socket_round_trip() {
+    printf("Test: ACIA over a Unix socket...\n");
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/test_host_bridge_%d.sock", (int)getpid());
+    host_bridge_t *bridge = host_bridge_open_socket(path);
+    assert(bridge != NULL);
+    machine_state_t *machine = create_machine();
+    setup_acia(machine, bridge);
+
+    // Output with no client attached goes nowhere
+    write_byte_new(machine, ACIA_BASE + ACIA_DATA, 'x');
+    assert(bridge->tx.count == 0 && bridge->tx_dropped == 1);
+    host_bridge_poll(bridge);
+    assert(!host_bridge_connected(bridge));
+
+    int client = connect_client(path);
+    host_bridge_poll(bridge);
+    assert(host_bridge_connected(bridge));
+    printf("  Client accepted on poll ✓\n");
+
+    // Host -> CPU
+    uint8_t message[MESSAGE_SIZE];
+    for (int i = 0; i < MESSAGE_SIZE; i++) {
+        message[i] = (uint8_t)(i * 7 + 3);
+    }
+    assert(write(client, message, MESSAGE_SIZE) == MESSAGE_SIZE);
+    uint64_t reads = bridge->read_calls;
+    host_bridge_poll(bridge);
+    assert(bridge->read_calls == reads + 1);
+    assert(bridge->rx.count == MESSAGE_SIZE);
+
+    uint8_t received[MESSAGE_SIZE];
+    assert(cpu_receive(machine, received, MESSAGE_SIZE) == MESSAGE_SIZE);
+    assert(memcmp(received, message, MESSAGE_SIZE) == 0);
+    printf("  %d bytes in with one read() ✓\n", MESSAGE_SIZE);
+
+    // CPU -> host: nothing leaves until the next poll, then all at once
+    uint64_t writes = bridge->write_calls;
+    for (int i = 0; i < MESSAGE_SIZE; i++) {
+        write_byte_new(machine, ACIA_BASE + ACIA_DATA, message[MESSAGE_SIZE - 1 - i]);
+    }
+    assert(bridge->write_calls == writes);
+    assert(bridge->tx.count == MESSAGE_SIZE);
+    host_bridge_poll(bridge);
+    assert(bridge->write_calls == writes + 1);
+    assert(bridge->tx.count == 0);
+    read_all(client, received, MESSAGE_SIZE);
+    for (int i = 0; i < MESSAGE_SIZE; i++) {
+        assert(received[i] == message[MESSAGE_SIZE - 1 - i]);
+    }
+    printf("  %d bytes out with one write() ✓\n", MESSAGE_SIZE);
+
+    // More output than the ring holds between polls is flushed early, not lost
+    writes = bridge->write_calls;
+    uint64_t dropped = bridge->tx_dropped;
+    size_t burst = HOST_BRIDGE_BUFFER_SIZE * 3;
+    for (size_t i = 0; i < burst; i++) {
+        write_byte_new(machine, ACIA_BASE + ACIA_DATA, (uint8_t)i);
+    }
+    host_bridge_poll(bridge);
+    assert(bridge->tx_dropped == dropped);
+    assert(bridge->write_calls - writes <= burst / HOST_BRIDGE_BUFFER_SIZE + 1);
+    uint8_t *big = (uint8_t *)malloc(burst);
+    read_all(client, big, burst);
+    for (size_t i = 0; i < burst; i++) {
+        assert(big[i] == (uint8_t)i);
+    }
+    free(big);
+    printf("  %zu-byte burst in %llu writes ✓\n", burst,
+           (unsigned long long)(bridge->write_calls - writes));
+
+    // Hang up, then a new client takes over
+    close(client);
+    host_bridge_poll(bridge);
+    assert(!host_bridge_connected(bridge));
+    client = connect_client(path);
+    assert(write(client, "ok", 2) == 2);
+    host_bridge_poll(bridge);
+    assert(host_bridge_connected(bridge));
+    assert(cpu_receive(machine, received, 2) == 2 && memcmp(received, "ok", 2) == 0);
+    printf("  Reconnect after hangup ✓\n");
+
+    close(client);
+    host_bridge_close(bridge);
+    assert(access(path, F_OK) != 0);
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_pty_round_trip() {
+    printf("Test: ACIA over a pseudo-terminal...\n");
+
+    host_bridge_t *bridge = host_bridge_open_pty();
+    assert(bridge != NULL);
+    assert(host_bridge_connected(bridge));
+    printf("  Console on %s\n", host_bridge_path(bridge));
+    machine_state_t *machine = create_machine();
+    setup_acia(machine, bridge);
+
+    int terminal = open(host_bridge_path(bridge), O_RDWR | O_NOCTTY);
+    assert(terminal >= 0);
+
+    // Raw mode: CR, NUL and control characters arrive unchanged
+    const uint8_t typed[] = { 'l', 's', '\r', 0x00, 0x03, 0xFF };
+    assert(write(terminal, typed, sizeof(typed)) == sizeof(typed));
+    uint8_t received[16];
+    size_t count = 0;
+    for (int tries = 0; tries < 100 && count < sizeof(typed); tries++) {
+        host_bridge_poll(bridge);
+        count += cpu_receive(machine, received + count, sizeof(typed) - count);
+    }
+    assert(count == sizeof(typed) && memcmp(received, typed, sizeof(typed)) == 0);
+    printf("  Terminal input reaches the CPU ✓\n");
+
+    const char *reply = "$ \n";
+    for (const char *c = reply; *c; c++) {
+        write_byte_new(machine, ACIA_BASE + ACIA_DATA, (uint8_t)*c);
+    }
+    host_bridge_poll(bridge);
+    read_all(terminal, received, strlen(reply));
+    assert(memcmp(received, reply, strlen(reply)) == 0);
+    printf("  CPU output reaches the terminal ✓\n");
+
+    close(terminal);
+    host_bridge_close(bridge);
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+static uint8_t firmware_byte(size_t i) {
+    return (uint8_t)(i ^ (i >> 8) ^ (i >> 16));
+}
+
+void test_ft245_pipes() {
+    printf("Test: Board FIFO over named pipes...\n");
+
+    char in_path[64], out_path[64];
+    snprintf(in_path, sizeof(in_path), "/tmp/test_host_bridge_%d.in", (int)getpid());
+    snprintf(out_path, sizeof(out_path), "/tmp/test_host_bridge_%d.out", (int)getpid());
+    host_bridge_t *bridge = host_bridge_open_fifo(in_path, out_path);
+    assert(bridge != NULL);
+    machine_state_t *machine = create_machine();
+    fifo_t *board = machine->hardware->board_fifo;
+    ft245_t *ft245 = board_fifo_get_ft245(board);
+    host_bridge_attach_ft245(bridge, ft245);
+
+    int host_in = open(in_path, O_WRONLY | O_NONBLOCK);
+    assert(host_in >= 0);
+
+    // Host -> CPU: a firmware image far bigger than every buffer on the way
+    uint8_t *image = (uint8_t *)malloc(FIRMWARE_SIZE);
+    for (size_t i = 0; i < FIRMWARE_SIZE; i++) {
+        image[i] = firmware_byte(i);
+    }
+    size_t sent = 0;
+    ssize_t chunk = write(host_in, image, FIRMWARE_SIZE);
+    assert(chunk > 0 && chunk < FIRMWARE_SIZE);
+    sent += (size_t)chunk;
+
+    // Nothing read by the CPU yet: the FT245 and the ring fill up, the rest
+    // waits in the pipe and the host's next write would block
+    host_bridge_poll(bridge);
+    assert(ft245_get_rx_fifo_count(ft245) == FT245_RX_FIFO_SIZE);
+    assert(!ft245_get_rxf(ft245));
+    host_bridge_poll(bridge);
+    assert(bridge->rx.count == HOST_BRIDGE_BUFFER_SIZE);
+    chunk = write(host_in, image + sent, FIRMWARE_SIZE - sent);
+    assert(chunk > 0 && chunk <= HOST_BRIDGE_BUFFER_SIZE + FT245_RX_FIFO_SIZE);
+    sent += (size_t)chunk;
+    host_bridge_poll(bridge);
+    assert(write(host_in, image + sent, FIRMWARE_SIZE - sent) < 0);
+    printf("  Full FIFO holds the host back, nothing dropped ✓\n");
+
+    size_t received = 0;
+    uint64_t polls = 0;
+    while (received < FIRMWARE_SIZE) {
+        uint8_t byte;
+        if (board_fifo_fast_read(board, &byte)) {
+            assert(byte == firmware_byte(received));
+            received++;
+            continue;
+        }
+        if (sent < FIRMWARE_SIZE) {
+            chunk = write(host_in, image + sent, FIRMWARE_SIZE - sent);
+            if (chunk > 0) {
+                sent += (size_t)chunk;
+            }
+        }
+        host_bridge_poll(bridge);
+        polls++;
+        board_fifo_clock_n(board, 1);
+    }
+    assert(bridge->read_calls <= polls + 2);
+    printf("  %d KB in order in %llu reads ✓\n", FIRMWARE_SIZE / 1024,
+           (unsigned long long)bridge->read_calls);
+
+    // CPU -> host with nobody reading: TXE# goes high once the FT245 and
+    // the ring are full, and the CPU waits
+    size_t written = 0;
+    while (board_fifo_fast_write(board, firmware_byte(written))) {
+        written++;
+        if (written % FT245_TX_FIFO_SIZE == 0) {
+            host_bridge_poll(bridge);
+        }
+    }
+    host_bridge_poll(bridge);
+    while (board_fifo_fast_write(board, firmware_byte(written))) {
+        written++;
+    }
+    assert(written == HOST_BRIDGE_BUFFER_SIZE + FT245_TX_FIFO_SIZE);
+    assert(ft245_get_txe(ft245));
+    assert(bridge->tx_dropped == 0);
+    printf("  No reader: CPU held off by TXE# after %zu bytes ✓\n", written);
+
+    // A reader shows up and the backlog streams out
+    int host_out = open(out_path, O_RDONLY | O_NONBLOCK);
+    assert(host_out >= 0);
+    uint8_t *echo = (uint8_t *)malloc(FIRMWARE_SIZE);
+    size_t drained = 0;
+    uint64_t writes = bridge->write_calls;
+    while (drained < FIRMWARE_SIZE) {
+        while (written < FIRMWARE_SIZE && board_fifo_fast_write(board, firmware_byte(written))) {
+            written++;
+        }
+        host_bridge_poll(bridge);
+        board_fifo_clock_n(board, 1);
+        ssize_t got = read(host_out, echo + drained, FIRMWARE_SIZE - drained);
+        if (got > 0) {
+            drained += (size_t)got;
+        }
+    }
+    for (size_t i = 0; i < FIRMWARE_SIZE; i++) {
+        assert(echo[i] == firmware_byte(i));
+    }
+    assert(bridge->write_calls - writes < FIRMWARE_SIZE / 256);
+    printf("  %d KB out in order in %llu writes ✓\n", FIRMWARE_SIZE / 1024,
+           (unsigned long long)(bridge->write_calls - writes));
+
+    free(echo);
+    free(image);
+    close(host_out);
+    close(host_in);
+    host_bridge_close(bridge);
+    unlink(in_path);
+    unlink(out_path);
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+int main() {
+    printf("=== Host Bridge Tests ===\n\n");
+
+    test_socket_round_trip();
+    test_pty_round_trip();
+    test_ft245_pipes();
+
+    printf("=== All host bridge tests passed! ===\n");
+    return 0;
+}
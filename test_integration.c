@@ -121,7 +121,7 @@ void test_via_callbacks(machine_state_t *machine) {
     }
     
     // Get VIA instance and set up callbacks
-    via6522_t *via = get_via_instance();
+    via6522_t *via = get_via_instance(machine);
     via6522_set_port_a_callbacks(via, test_read_callback, test_write_callback, NULL);
     
     // Configure Port A as input
@@ -194,7 +194,7 @@ void test_board_fifo_cpu_to_usb(machine_state_t *machine) {
     printf("  USB receiving: ");
     char received[6] = {0};
     for (int i = 0; i < 5; i++) {
-        received[i] = usb_receive_byte_from_cpu();
+        received[i] = usb_receive_byte_from_cpu(machine);
         printf("%c", received[i]);
     }
     printf("\n");
@@ -216,7 +216,7 @@ void test_board_fifo_usb_to_cpu(machine_state_t *machine) {
     
     // USB sends data
     for (int i = 0; i < 5; i++) {
-        usb_send_byte_to_cpu(test_string[i]);
+        usb_send_byte_to_cpu(machine, test_string[i]);
     }
     
     // Check that RXF# indicates data available
@@ -258,7 +258,7 @@ void test_board_fifo_bidirectional(machine_state_t *machine) {
     const char *command = "READ";
     printf("  1. USB sends command: %s\n", command);
     for (int i = 0; i < 4; i++) {
-        usb_send_byte_to_cpu(command[i]);
+        usb_send_byte_to_cpu(machine, command[i]);
     }
     
     // Step 2: CPU reads command
@@ -308,7 +308,7 @@ void test_board_fifo_bidirectional(machine_state_t *machine) {
     printf("  4. USB receives response: ");
     char usb_received[4] = {0};
     for (int i = 0; i < 3; i++) {
-        usb_received[i] = usb_receive_byte_from_cpu();
+        usb_received[i] = usb_receive_byte_from_cpu(machine);
         printf("%c", usb_received[i]);
     }
     printf("\n");
@@ -357,7 +357,7 @@ void test_concurrent_devices(machine_state_t *machine) {
     print_test_header("Concurrent Device Access");
     
     // Reset VIA callbacks from previous test
-    via6522_t *via = get_via_instance();
+    via6522_t *via = get_via_instance(machine);
     via6522_set_port_a_callbacks(via, NULL, NULL, NULL);
     via6522_set_port_b_callbacks(via, NULL, NULL, NULL);
     
@@ -0,0 +1,313 @@
+/*
+ * Tests for host I/O record and replay
+ *
+ * - A guest taking ACIA bytes and VIA CA1 edges by IRQ and polling the
+ *   FT245 and PIA port A, fed by the host at odd times, replays from the
+ *   saved log with no host instruction for instruction the same
+ * - Recording and replaying with the device thread gives the same run
+ * - A replay only starts at its recorded cycle; malformed logs don't load
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include "machine_setup.h"
+#include "processor_helpers.h"
+#include "iolog.h"
+#include "test_helpers.h"
+
+// ACIA bytes to $60+, CA1 edges counted in $21 (both by IRQ); FT245 bytes
+// polled into $40+, PIA port A copied to $23
+static const uint8_t guest[] = {
+    0xA9, 0x03, 0x8D, 0x82, 0x7F,   // 8000: LDA #$03 : STA $7F82   ACIA: RX IRQ, DTR
+    0xA9, 0x01, 0x8D, 0xCC, 0x7F,   // 8005: LDA #$01 : STA $7FCC   VIA PCR: CA1 rising
+    0xA9, 0x82, 0x8D, 0xCE, 0x7F,   // 800A: LDA #$82 : STA $7FCE   VIA IER: CA1
+    0xA9, 0x03, 0x8D, 0xE2, 0x7F,   // 800F: LDA #$03 : STA $7FE2   Board DDRB: RD#, WR
+    0xA9, 0x01, 0x8D, 0xE0, 0x7F,   // 8014: LDA #$01 : STA $7FE0   RD# high
+    0xA9, 0x04, 0x8D, 0xA1, 0x7F,   // 8019: LDA #$04 : STA $7FA1   PIA CRA: port A data
+    0x58,                           // 801E: CLI
+    0xAD, 0xA0, 0x7F,               // 801F: LDA $7FA0
+    0x85, 0x23,                     // 8022: STA $23
+    0xAD, 0xE0, 0x7F,               // 8024: LDA $7FE0
+    0x29, 0x04,                     // 8027: AND #$04               RXF#
+    0xD0, 0xF4,                     // 8029: BNE $801F
+    0xA9, 0x00, 0x8D, 0xE0, 0x7F,   // 802B: LDA #$00 : STA $7FE0   RD# low
+    0xAD, 0xE1, 0x7F,               // 8030: LDA $7FE1
+    0xA6, 0x22,                     // 8033: LDX $22
+    0x95, 0x40,                     // 8035: STA $40,X
+    0xE6, 0x22,                     // 8037: INC $22
+    0xA9, 0x01, 0x8D, 0xE0, 0x7F,   // 8039: LDA #$01 : STA $7FE0   RD# high
+    0x4C, 0x1F, 0x80,               // 803E: JMP $801F
+};
+
+static const uint8_t handler[] = {
+    0x48,                           // 8050: PHA
+    0xDA,                           // 8051: PHX
+    0xAD, 0x81, 0x7F,               // 8052: LDA $7F81              ACIA status
+    0x29, 0x08,                     // 8055: AND #$08               RDRF
+    0xF0, 0x09,                     // 8057: BEQ $8062
+    0xAD, 0x80, 0x7F,               // 8059: LDA $7F80
+    0xA6, 0x20,                     // 805C: LDX $20
+    0x95, 0x60,                     // 805E: STA $60,X
+    0xE6, 0x20,                     // 8060: INC $20
+    0xAD, 0xCD, 0x7F,               // 8062: LDA $7FCD              VIA IFR
+    0x29, 0x02,                     // 8065: AND #$02               CA1
+    0xF0, 0x05,                     // 8067: BEQ $806E
+    0xAD, 0xC1, 0x7F,               // 8069: LDA $7FC1              clear CA1
+    0xE6, 0x21,                     // 806C: INC $21
+    0xFA,                           // 806E: PLX
+    0x68,                           // 806F: PLA
+    0x58,                           // 8070: CLI                    RTI leaves I set here
+    0x40,                           // 8071: RTI
+};
+
+static machine_state_t *guest_machine(void) {
+    machine_state_t *machine = create_machine();
+    memory_region_t *rom = load_program(machine, guest, sizeof(guest));
+    memcpy(rom->data + 0x50, handler, sizeof(handler));
+    rom->data[0x7FFE] = 0x50;
+    rom->data[0x7FFF] = 0x80;
+    return machine;
+}
+
+typedef struct trace_s {
+    uint64_t hash;             // Over PC, registers and cycles before every instruction
+    uint64_t instructions;
+} trace_t;
+
+static void run(machine_state_t *machine, trace_t *trace, uint64_t instructions) {
+    bool halted = false;
+    for (uint64_t i = 0; i < instructions && !halted; i++) {
+        if (!machine->processor.interrupts_disabled && machine_irq_sources(machine)) {
+            machine_process_interrupt(machine);
+        }
+        processor_state_t *p = &machine->processor;
+        uint64_t state = ((uint64_t)p->PC << 48) ^ ((uint64_t)p->A.full << 32) ^
+                         ((uint64_t)p->X << 16) ^ p->P ^ machine->cycles;
+        trace->hash = trace->hash * 1099511628211ULL ^ state;
+        machine_execute_instruction(machine, &halted);
+        trace->instructions++;
+    }
+}
+
+#define CHUNK 1777
+
+// Run the guest, the host feeding it between chunks of instructions
+static void record(machine_state_t *machine, iolog_t *log, trace_t *trace) {
+    const gpio_shm_inputs_t high = { .port_a = 0x5A, .lines = GPIO_SHM_CA1 };
+    const gpio_shm_inputs_t low = { .port_a = 0xA5 };
+    const gpio_shm_inputs_t pia = { .port_a = 0x3C };
+
+    run(machine, trace, CHUNK);
+    assert(iolog_send_acia(log, (const uint8_t *)"hello", 5) == 5);
+    run(machine, trace, CHUNK);
+    assert(iolog_send_usb(log, (const uint8_t *)"usb!", 4) == 4);
+    iolog_set_pins(log, GPIO_SHM_VIA, &high);
+    run(machine, trace, 3);
+    iolog_set_pins(log, GPIO_SHM_VIA, &low);
+    run(machine, trace, CHUNK);
+    iolog_set_pins(log, GPIO_SHM_PIA, &pia);
+    assert(iolog_send_acia(log, (const uint8_t *)" world", 6) == 6);
+    iolog_set_pins(log, GPIO_SHM_VIA, &high);
+    run(machine, trace, 1);
+    iolog_set_pins(log, GPIO_SHM_VIA, &low);
+    assert(iolog_send_usb(log, (const uint8_t *)"!", 1) == 1);
+    run(machine, trace, CHUNK);
+}
+
+static void assert_same(machine_state_t *a, const trace_t *ta, machine_state_t *b, const trace_t *tb) {
+    machine_sync_devices(a);
+    machine_sync_devices(b);
+    assert(ta->hash == tb->hash && ta->instructions == tb->instructions);
+    assert(a->cycles == b->cycles);
+    assert(a->irq_sources == b->irq_sources);
+    for (uint16_t address = 0x20; address < 0x80; address++) {
+        assert(read_byte_new(a, address) == read_byte_new(b, address));
+    }
+}
+
+static char log_file[64];
+
+void test_record_replay() {
+    printf("Test: Record and replay...\n");
+
+    machine_state_t *recorded = guest_machine();
+    iolog_t *log = iolog_create();
+    assert(log != NULL && !iolog_is_replay(log));
+    assert(machine_attach_iolog(recorded, log) == 0);
+    trace_t a = { 0 };
+    record(recorded, log, &a);
+
+    // The guest got all of it
+    assert(read_byte_new(recorded, 0x20) == 11 && read_byte_new(recorded, 0x22) == 5);
+    for (int i = 0; i < 11; i++) {
+        assert(read_byte_new(recorded, 0x60 + i) == (uint8_t)"hello world"[i]);
+    }
+    for (int i = 0; i < 5; i++) {
+        assert(read_byte_new(recorded, 0x40 + i) == (uint8_t)"usb!!"[i]);
+    }
+    assert(read_byte_new(recorded, 0x21) == 2);
+    assert(read_byte_new(recorded, 0x23) == 0x3C);
+    printf("  Guest took 11 ACIA bytes, 5 USB bytes, 2 CA1 edges and the PIA pins ✓\n");
+
+    machine_detach_iolog(recorded);
+    assert(recorded->hardware->iolog == NULL && recorded->hardware->via.gpio == NULL);
+    iolog_stats_t stats;
+    iolog_get_stats(log, &stats);
+    assert(stats.bytes == 16 && stats.pin_changes == 5);
+    assert(stats.entries == 9 && stats.dropped == 0);   // Byte runs coalesce
+    assert(stats.last_cycle > 0 && stats.last_cycle <= recorded->cycles);
+    assert(iolog_save(log, log_file) == 0);
+    printf("  %llu entries, %zu bytes logged ✓\n", (unsigned long long)stats.entries, stats.size);
+
+    // A fresh machine, nobody at the other end
+    iolog_t *replay = iolog_load(log_file);
+    assert(replay != NULL && iolog_is_replay(replay) && !iolog_replay_done(replay));
+    machine_state_t *replayed = guest_machine();
+    assert(machine_attach_iolog(replayed, replay) == 0);
+    assert(iolog_send_acia(replay, (const uint8_t *)"x", 1) == 0);
+    trace_t b = { 0 };
+    run(replayed, &b, a.instructions);
+    assert(iolog_replay_done(replay));
+    assert_same(recorded, &a, replayed, &b);
+
+    iolog_stats_t replay_stats;
+    iolog_get_stats(replay, &replay_stats);
+    assert(replay_stats.entries == stats.entries && replay_stats.bytes == stats.bytes);
+    assert(replay_stats.last_cycle == stats.last_cycle && replay_stats.size == stats.size);
+    printf("  Replay: %llu instructions, %llu cycles identical ✓\n",
+           (unsigned long long)b.instructions, (unsigned long long)replayed->cycles);
+
+    machine_detach_iolog(replayed);
+    iolog_free(replay);
+    iolog_free(log);
+    destroy_machine(recorded);
+    destroy_machine(replayed);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_device_thread() {
+    printf("Test: Record and replay with the device thread...\n");
+
+    // When host input lands depends on how far the thread has got, so the
+    // recording is compared with its replays
+    machine_state_t *threaded = guest_machine();
+    assert(machine_start_device_thread(threaded) == 0);
+    iolog_t *log = iolog_create();
+    assert(machine_attach_iolog(threaded, log) == 0);
+    trace_t t = { 0 };
+    record(threaded, log, &t);
+    machine_detach_iolog(threaded);
+    assert(read_byte_new(threaded, 0x20) == 11 && read_byte_new(threaded, 0x22) == 5);
+    assert(iolog_save(log, log_file) == 0);
+
+    iolog_t *replay = iolog_load(log_file);
+    assert(replay != NULL);
+    machine_state_t *inline_machine = guest_machine();
+    assert(machine_attach_iolog(inline_machine, replay) == 0);
+    trace_t i = { 0 };
+    run(inline_machine, &i, t.instructions);
+    assert(iolog_replay_done(replay));
+    assert_same(threaded, &t, inline_machine, &i);
+    printf("  Threaded recording, replayed inline ✓\n");
+
+    // Replaying on the thread, where the next entry bounds the IRQ lookahead
+    iolog_t *threaded_replay = iolog_load(log_file);
+    assert(threaded_replay != NULL);
+    machine_state_t *replayed = guest_machine();
+    assert(machine_start_device_thread(replayed) == 0);
+    assert(machine_attach_iolog(replayed, threaded_replay) == 0);
+    trace_t p = { 0 };
+    run(replayed, &p, t.instructions);
+    machine_sync_devices(replayed);
+    assert(iolog_replay_done(threaded_replay));
+    assert_same(threaded, &t, replayed, &p);
+
+    device_thread_stats_t stats;
+    device_thread_get_stats(replayed->hardware->device_thread, &stats);
+    assert(stats.irq_lookahead > 0);
+    printf("  Threaded replay, %llu IRQ samples from the horizon ✓\n",
+           (unsigned long long)stats.irq_lookahead);
+
+    destroy_machine(threaded);
+    destroy_machine(inline_machine);
+    destroy_machine(replayed);
+    iolog_free(log);
+    iolog_free(replay);
+    iolog_free(threaded_replay);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_bad_logs() {
+    printf("Test: Start cycle and malformed logs...\n");
+
+    iolog_t *log = iolog_create();
+    machine_state_t *machine = guest_machine();
+    trace_t t = { 0 };
+    run(machine, &t, 10);
+    assert(machine_attach_iolog(machine, log) == 0);
+    assert(iolog_send_acia(log, (const uint8_t *)"ab", 2) == 2);
+    run(machine, &t, 100);
+    machine_detach_iolog(machine);
+    assert(iolog_save(log, log_file) == 0);
+    iolog_free(log);
+    destroy_machine(machine);
+
+    // Recorded from cycle > 0: a fresh machine can't replay it
+    log = iolog_load(log_file);
+    assert(log != NULL);
+    machine = guest_machine();
+    assert(machine_attach_iolog(machine, log) == -1);
+    assert(machine->hardware->iolog == NULL);
+    run(machine, &t, 10);
+    assert(machine_attach_iolog(machine, log) == 0);
+    machine_detach_iolog(machine);
+    iolog_free(log);
+    destroy_machine(machine);
+    printf("  Replay refused at the wrong cycle ✓\n");
+
+    FILE *file = fopen(log_file, "rb");
+    uint8_t data[64];
+    size_t size = fread(data, 1, sizeof(data), file);
+    fclose(file);
+    assert(size > 13);
+
+    // Cut short in the last entry
+    file = fopen(log_file, "wb");
+    fwrite(data, 1, size - 1, file);
+    fclose(file);
+    assert(iolog_load(log_file) == NULL);
+
+    // Unknown entry type
+    data[14] = 0x7F;
+    file = fopen(log_file, "wb");
+    fwrite(data, 1, size, file);
+    fclose(file);
+    assert(iolog_load(log_file) == NULL);
+
+    // Wrong magic
+    data[0] ^= 0xFF;
+    file = fopen(log_file, "wb");
+    fwrite(data, 1, size, file);
+    fclose(file);
+    assert(iolog_load(log_file) == NULL);
+    assert(iolog_load("/nonexistent/iolog") == NULL);
+    printf("  Truncated, unknown entry, bad magic, missing file ✓\n");
+
+    printf("  ✓ Test passed\n\n");
+}
+
+int main() {
+    printf("=== I/O Log Tests ===\n\n");
+
+    snprintf(log_file, sizeof(log_file), "/tmp/test_iolog_%d.bin", (int)getpid());
+    test_record_replay();
+    test_device_thread();
+    test_bad_logs();
+    unlink(log_file);
+
+    printf("=== All I/O log tests passed! ===\n");
+    return 0;
+}
@@ -0,0 +1,247 @@
+/*
+ * Tests for fast machine reset and the machine pool
+ *
+ * - reset_machine_fast() zeroes written RAM but keeps regions and mappers
+ * - Pooled machines come out in the template state and go back to it
+ * - Reusing pooled machines is cheaper than create/destroy per run
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include "machine_setup.h"
+#include "processor_helpers.h"
+#include "processor.h"
+#include "memory_map.h"
+#include "mapper.h"
+#include "machine_pool.h"
+
+#define LATCH_ADDRESS 0x7FA4   // Free I/O address between the PIA and the performance counters
+
+static uint8_t peek(machine_state_t *machine, uint8_t bank, uint16_t address) {
+    return read_byte_long(machine, (long_address_t){ .bank = bank, .address = address });
+}
+
+static void poke(machine_state_t *machine, uint8_t bank, uint16_t address, uint8_t value) {
+    write_byte_long(machine, (long_address_t){ .bank = bank, .address = address }, value);
+}
+
+static double elapsed_us(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e6 + (end->tv_nsec - start->tv_nsec) / 1e3;
+}
+
+static const mapper_config_t window_config = {
+    .reg_bank = 0x00,
+    .reg_address = LATCH_ADDRESS,
+    .window_bank = 0x01,
+    .window_start = 0x4000,
+    .window_end = 0x4FFF,
+    .page_count = 4,
+    .page_flags = MEM_READWRITE,
+};
+
+// Template for the pool tests: a RAM bank, a mapper and a "program" in RAM
+static void setup_template(machine_state_t *machine, void *context) {
+    int *calls = (int *)context;
+    (*calls)++;
+    assert(machine_add_ram_banks(machine, 0x01, 2) == 0);
+    assert(latch_mapper_create(machine, &window_config) != NULL);
+    poke(machine, 0x00, 0x1000, 0xA9);
+    poke(machine, 0x00, 0x1001, 0x42);
+    machine->processor.PC = 0x1000;
+}
+
+// A short batch job: run a few instructions' worth of stores
+static void run_job(machine_state_t *machine, uint8_t seed) {
+    processor_state_t *state = &machine->processor;
+    state->P |= M_FLAG;
+    for (uint16_t i = 0; i < 64; i++) {
+        LDA_IMM(machine, (uint8_t)(seed + i), 0);
+        STA_ABS(machine, 0x2000 + i * 0x40, 0);
+    }
+    poke(machine, 0x02, 0x8000, seed);
+    write_byte_new(machine, LATCH_ADDRESS, 3);
+    poke(machine, 0x01, 0x4000, seed);
+}
+
+void test_fast_reset() {
+    printf("Test: Fast reset keeps the layout...\n");
+
+    machine_state_t *machine = create_machine();
+    assert(machine_add_ram_banks(machine, 0x01, 1) == 0);
+    mapper_t *mapper = latch_mapper_create(machine, &window_config);
+    assert(mapper != NULL);
+    memory_region_t *bank1 = find_memory_region(machine, 0x01, 0x0000);
+    memory_region_t *window = find_memory_region(machine, 0x01, 0x4000);
+
+    machine->processor.A.full = 0x1234;
+    machine->processor.PC = 0x4321;
+    poke(machine, 0x00, 0x0200, 0x11);
+    poke(machine, 0x01, 0xF000, 0x22);
+    write_byte_new(machine, LATCH_ADDRESS, 2);
+    poke(machine, 0x01, 0x4000, 0x33);
+
+    reset_machine_fast(machine);
+    assert(machine->processor.A.full == 0);
+    assert(machine->processor.PC == 0);
+    printf("  Processor reset ✓\n");
+
+    assert(peek(machine, 0x00, 0x0200) == 0x00);
+    assert(peek(machine, 0x01, 0xF000) == 0x00);
+    printf("  Written RAM reads back as zero ✓\n");
+
+    assert(find_memory_region(machine, 0x01, 0x0000) == bank1);
+    assert(find_memory_region(machine, 0x01, 0x4000) == window);
+    assert(mapper->current == 0 && mapper->latch == 0);
+    // Like reset_machine(), mapper pages keep their contents (they often hold ROM)
+    write_byte_new(machine, LATCH_ADDRESS, 2);
+    assert(peek(machine, 0x01, 0x4000) == 0x33);
+    printf("  Regions kept, mapper back on page 0 with its pages intact ✓\n");
+
+    // Writes after a fast reset are tracked again
+    poke(machine, 0x01, 0x0010, 0x44);
+    reset_machine_fast(machine);
+    assert(peek(machine, 0x01, 0x0010) == 0x00);
+    printf("  Repeated fast resets ✓\n");
+
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_fast_reset_clone() {
+    printf("Test: Fast reset of a clone leaves the parent alone...\n");
+
+    machine_state_t *parent = create_machine();
+    assert(machine_add_ram_banks(parent, 0x01, 1) == 0);
+    poke(parent, 0x01, 0x1000, 0x5A);
+
+    machine_state_t *child = machine_clone(parent);
+    assert(child != NULL);
+    reset_machine_fast(child);
+    assert(peek(child, 0x01, 0x1000) == 0x00);
+    assert(peek(parent, 0x01, 0x1000) == 0x5A);
+    printf("  Shared written page cleared only in the clone ✓\n");
+
+    destroy_machine(child);
+    destroy_machine(parent);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_pool_round_trip() {
+    printf("Test: Pool hands out template machines...\n");
+
+    int calls = 0;
+    machine_pool_t *pool = machine_pool_create(2, setup_template, &calls);
+    assert(pool != NULL);
+    assert(calls == 1);
+    assert(pool->idle_count == 2);
+
+    machine_state_t *machine = machine_pool_acquire(pool);
+    assert(machine != NULL);
+    assert(machine->processor.PC == 0x1000);
+    assert(peek(machine, 0x00, 0x1001) == 0x42);
+    printf("  Acquired machine matches the template ✓\n");
+
+    run_job(machine, 0x80);
+    machine->processor.PC = 0x9999;
+    assert(peek(machine, 0x02, 0x8000) == 0x80);
+    machine_pool_release(pool, machine);
+
+    machine_state_t *again = machine_pool_acquire(pool);
+    assert(again == machine);
+    assert(again->processor.PC == 0x1000);
+    assert(peek(again, 0x02, 0x8000) == 0x00);
+    assert(peek(again, 0x00, 0x2000) == 0x00);
+    assert(again->memory_map->mappers->current == 0);
+    assert(peek(again, 0x01, 0x4000) == 0x00);
+    write_byte_new(again, LATCH_ADDRESS, 3);
+    assert(peek(again, 0x01, 0x4000) == 0x00);
+    printf("  Released machine comes back in the template state ✓\n");
+
+    // Draining the pool clones more
+    machine_state_t *second = machine_pool_acquire(pool);
+    machine_state_t *third = machine_pool_acquire(pool);
+    assert(second && third && second != third && third != again);
+    assert(peek(third, 0x00, 0x1000) == 0xA9);
+    printf("  Empty pool grows on demand ✓\n");
+
+    machine_pool_release(pool, third);
+    machine_pool_release(pool, second);
+    machine_pool_release(pool, again);
+    assert(pool->idle_count == 3);
+    machine_pool_destroy(pool);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_pool_cost() {
+    printf("Test: Pool reuse versus create/destroy...\n");
+
+    const int runs = 200;
+    struct timespec start, end;
+    int calls = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < runs; i++) {
+        machine_state_t *machine = create_machine();
+        setup_template(machine, &calls);
+        run_job(machine, (uint8_t)i);
+        destroy_machine(machine);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double fresh = elapsed_us(&start, &end) / runs;
+
+    machine_pool_t *pool = machine_pool_create(1, setup_template, &calls);
+    assert(pool != NULL);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < runs; i++) {
+        machine_state_t *machine = machine_pool_acquire(pool);
+        run_job(machine, (uint8_t)i);
+        machine_pool_release(pool, machine);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double pooled = elapsed_us(&start, &end) / runs;
+
+    machine_state_t *machine = create_machine();
+    setup_template(machine, &calls);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < runs; i++) {
+        run_job(machine, (uint8_t)i);
+        reset_machine_fast(machine);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double fast = elapsed_us(&start, &end) / runs;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < runs; i++) {
+        run_job(machine, (uint8_t)i);
+        reset_machine(machine);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double full = elapsed_us(&start, &end) / runs;
+
+    printf("  create/run/destroy:  %8.1f us per job\n", fresh);
+    printf("  acquire/run/release: %8.1f us per job\n", pooled);
+    printf("  run/reset_machine:   %8.1f us per job\n", full);
+    printf("  run/fast reset:      %8.1f us per job\n", fast);
+    assert(pooled < fresh);
+    assert(fast < full);
+    printf("  Pool and fast reset beat rebuilding ✓\n");
+
+    destroy_machine(machine);
+    machine_pool_destroy(pool);
+    printf("  ✓ Test passed\n\n");
+}
+
+int main() {
+    printf("=== Machine Pool Tests ===\n\n");
+
+    test_fast_reset();
+    test_fast_reset_clone();
+    test_pool_round_trip();
+    test_pool_cost();
+
+    printf("=== All machine pool tests passed! ===\n");
+    return 0;
+}
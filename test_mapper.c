@@ -0,0 +1,202 @@
+/*
+ * Tests for bank-switching mappers
+ *
+ * - A latch register write swaps which page a window of the address space shows
+ * - RAM pages keep their contents across switches, ROM pages ignore writes
+ * - Mappers survive a machine reset
+ * - A tight flip loop measures the cost of a switch
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include "machine_setup.h"
+#include "processor_helpers.h"
+#include "processor.h"
+#include "memory_map.h"
+#include "mapper.h"
+
+#define LATCH_ADDRESS 0x7FA4   // Free I/O address between the PIA and the performance counters
+
+static const mapper_config_t rom_config = {
+    .reg_bank = 0x00,
+    .reg_address = LATCH_ADDRESS,
+    .window_bank = 0x00,
+    .window_start = 0x8000,
+    .window_end = 0xBFFF,
+    .page_count = 4,
+    .page_flags = MEM_READONLY,
+    .latch_mask = 0x03,
+};
+
+static mapper_t *create_rom_mapper(machine_state_t *machine) {
+    mapper_t *mapper = latch_mapper_create(machine, &rom_config);
+    assert(mapper != NULL);
+    for (uint16_t page = 0; page < rom_config.page_count; page++) {
+        memset(mapper_page_data(mapper, page), 0x10 * (page + 1), 0x4000);
+    }
+    return mapper;
+}
+
+void test_latch_switches_rom_window() {
+    printf("Test: Latch write switches the ROM window...\n");
+
+    machine_state_t *machine = create_machine();
+    create_rom_mapper(machine);
+
+    assert(read_byte_new(machine, 0x8000) == 0x10);
+    assert(read_byte_new(machine, 0xBFFF) == 0x10);
+    printf("  Window starts on page 0 ✓\n");
+
+    for (uint8_t page = 0; page < 4; page++) {
+        write_byte_new(machine, LATCH_ADDRESS, page);
+        assert(read_byte_new(machine, 0x8000) == 0x10 * (page + 1));
+        assert(read_byte_new(machine, 0xBFFF) == 0x10 * (page + 1));
+    }
+    printf("  Each latch value selects its page ✓\n");
+
+    write_byte_new(machine, LATCH_ADDRESS, 0xFD);
+    assert(read_byte_new(machine, LATCH_ADDRESS) == 0xFD);
+    assert(read_byte_new(machine, 0x9000) == 0x20);
+    printf("  Latch reads back and only masked bits select ✓\n");
+
+    // Outside the window the fixed ROM region is still in place
+    assert(find_memory_region(machine, 0, 0xC000)->start_offset == 0x8000);
+    assert(find_memory_region(machine, 0, 0xC000)->end_offset == 0xFFFF);
+    printf("  $C000-$FFFF still decodes to the fixed ROM ✓\n");
+
+    write_byte_new(machine, 0x8000, 0x99);
+    assert(read_byte_new(machine, 0x8000) == 0x20);
+    printf("  ROM pages ignore writes ✓\n");
+
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_ram_pages_keep_contents() {
+    printf("Test: RAM pages keep their contents across switches...\n");
+
+    machine_state_t *machine = create_machine();
+    processor_state_t *state = &machine->processor;
+    assert(machine_add_ram_banks(machine, 0x01, 1) == 0);
+
+    mapper_config_t config = {
+        .reg_bank = 0x00,
+        .reg_address = LATCH_ADDRESS,
+        .window_bank = 0x01,
+        .window_start = 0x4000,
+        .window_end = 0x7FFF,
+        .page_count = 8,
+        .page_flags = MEM_READWRITE,
+    };
+    mapper_t *mapper = latch_mapper_create(machine, &config);
+    assert(mapper != NULL);
+
+    for (uint8_t page = 0; page < 8; page++) {
+        write_byte_new(machine, LATCH_ADDRESS, page);
+        write_byte_long(machine, (long_address_t){ .bank = 0x01, .address = 0x4000 }, 0xA0 + page);
+    }
+    for (uint8_t page = 0; page < 8; page++) {
+        write_byte_new(machine, LATCH_ADDRESS, page);
+        assert(read_byte_long(machine, (long_address_t){ .bank = 0x01, .address = 0x4000 }) == 0xA0 + page);
+    }
+    printf("  8 pages hold independent data ✓\n");
+
+    // The rest of the RAM bank is not switched
+    write_byte_long(machine, (long_address_t){ .bank = 0x01, .address = 0x3FFF }, 0x55);
+    write_byte_new(machine, LATCH_ADDRESS, 3);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x01, .address = 0x3FFF }) == 0x55);
+    printf("  RAM outside the window is unaffected ✓\n");
+
+    // Program-driven switch through STA
+    state->P |= M_FLAG;
+    LDA_IMM(machine, 0x05, 0);
+    STA_ABS(machine, LATCH_ADDRESS, 0);
+    assert(mapper->current == 5);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x01, .address = 0x4000 }) == 0xA5);
+    printf("  STA to the latch switches pages ✓\n");
+
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_external_page() {
+    printf("Test: Page backed by caller memory...\n");
+
+    machine_state_t *machine = create_machine();
+    mapper_t *mapper = create_rom_mapper(machine);
+    uint8_t *image = (uint8_t *)malloc(0x4000);
+    memset(image, 0xEE, 0x4000);
+
+    mapper_set_page(mapper, 2, image, MEM_READONLY);
+    write_byte_new(machine, LATCH_ADDRESS, 2);
+    assert(read_byte_new(machine, 0xA000) == 0xEE);
+    printf("  Window shows the caller's buffer ✓\n");
+
+    destroy_machine(machine);
+    free(image);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_mapper_survives_reset() {
+    printf("Test: Mapper after machine reset...\n");
+
+    machine_state_t *machine = create_machine();
+    mapper_t *mapper = create_rom_mapper(machine);
+
+    write_byte_new(machine, LATCH_ADDRESS, 3);
+    assert(read_byte_new(machine, 0x8000) == 0x40);
+
+    reset_machine(machine);
+    assert(mapper->current == 0);
+    assert(read_byte_new(machine, 0x8000) == 0x10);
+    write_byte_new(machine, LATCH_ADDRESS, 1);
+    assert(read_byte_new(machine, 0x8000) == 0x20);
+    printf("  Mapper is re-installed on page 0 and still switches ✓\n");
+
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_switch_cost() {
+    printf("Test: Switch cost in a tight loop...\n");
+
+    machine_state_t *machine = create_machine();
+    create_rom_mapper(machine);
+
+    const int iterations = 1000000;
+    uint32_t sum = 0;
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < iterations; i++) {
+        write_byte_new(machine, LATCH_ADDRESS, (uint8_t)i);
+        sum += read_byte_new(machine, 0x8000);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // Pages cycle 0x10, 0x20, 0x30, 0x40
+    assert(sum == (uint32_t)(iterations / 4) * (0x10 + 0x20 + 0x30 + 0x40));
+
+    double elapsed = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    printf("  %d switches + reads in %.2f ms (%.1f ns each) ✓\n",
+           iterations, elapsed / 1e6, elapsed / iterations);
+
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+int main() {
+    printf("=== Mapper Tests ===\n\n");
+
+    test_latch_switches_rom_window();
+    test_ram_pages_keep_contents();
+    test_external_page();
+    test_mapper_survives_reset();
+    test_switch_cost();
+
+    printf("=== All mapper tests passed! ===\n");
+    return 0;
+}
@@ -0,0 +1,365 @@
+/*
+ * Tests for the host memory map behind the machine's address space
+ *
+ * - RAM banks beyond bank 0 are carved out of one sparse 16MB reservation
+ * - Untouched banks cost no resident memory
+ * - Long addressing and block moves work across real banks
+ * - ROM images are mapped straight from the file into one or more banks
+ * - Battery-backed SRAM writes land in a host file and survive the machine
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "machine_setup.h"
+#include "processor_helpers.h"
+#include "processor.h"
+#include "memory_map.h"
+
+// Count resident pages of a host range
+static size_t resident_pages(const uint8_t *addr, size_t length) {
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    size_t pages = (length + page_size - 1) / page_size;
+    unsigned char *vec = (unsigned char *)malloc(pages);
+    size_t count = 0;
+
+    assert(vec != NULL);
+    assert(mincore((void *)addr, length, vec) == 0);
+    for (size_t i = 0; i < pages; i++) {
+        if (vec[i] & 1) {
+            count++;
+        }
+    }
+    free(vec);
+    return count;
+}
+
+void test_ram_banks_full_space() {
+    printf("Test: RAM banks across the full 16MB space...\n");
+
+    machine_state_t *machine = create_machine();
+    assert(machine->memory_map != NULL);
+    assert(machine_add_ram_banks(machine, 0x01, 255) == 0);
+
+    // Every bank is now backed by real memory
+    write_byte_long(machine, (long_address_t){ .bank = 0x01, .address = 0x0000 }, 0x11);
+    write_byte_long(machine, (long_address_t){ .bank = 0x7F, .address = 0x8000 }, 0x22);
+    write_byte_long(machine, (long_address_t){ .bank = 0xFF, .address = 0xFFFF }, 0x33);
+    write_word_long(machine, (long_address_t){ .bank = 0x40, .address = 0x1234 }, 0xBEEF);
+
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x01, .address = 0x0000 }) == 0x11);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x7F, .address = 0x8000 }) == 0x22);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0xFF, .address = 0xFFFF }) == 0x33);
+    assert(read_word_long(machine, (long_address_t){ .bank = 0x40, .address = 0x1234 }) == 0xBEEF);
+    printf("  Long reads/writes hit banks $01, $40, $7F and $FF ✓\n");
+
+    // Fresh banks read as zero
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x80, .address = 0x4321 }) == 0x00);
+    printf("  Untouched RAM reads as zero ✓\n");
+
+    // Banks are distinct memory
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x02, .address = 0x0000 }) == 0x00);
+    printf("  Banks do not alias ✓\n");
+
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_ram_banks_are_sparse() {
+    printf("Test: Untouched banks cost no resident memory...\n");
+
+    machine_state_t *machine = create_machine();
+    assert(machine_add_ram_banks(machine, 0x01, 255) == 0);
+
+    uint8_t *bank_c0 = memory_map_bank(machine->memory_map, 0xC0);
+    assert(resident_pages(bank_c0, RAM_BANK_SIZE) == 0);
+    printf("  Bank $C0 has no resident pages before first touch ✓\n");
+
+    write_byte_long(machine, (long_address_t){ .bank = 0xC0, .address = 0x2000 }, 0x5A);
+    assert(resident_pages(bank_c0, RAM_BANK_SIZE) > 0);
+    // With transparent hugepages a fault may populate the surrounding 2MB
+    // (32 banks), so check a bank outside that window
+    assert(resident_pages(memory_map_bank(machine->memory_map, 0xE0), RAM_BANK_SIZE) == 0);
+    printf("  First write faults in bank $C0 without touching bank $E0 ✓\n");
+
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_ram_bank_errors() {
+    printf("Test: RAM bank configuration errors...\n");
+
+    machine_state_t *machine = create_machine();
+    assert(machine_add_ram_banks(machine, 0x00, 1) == -1);    // Bank 0 has a fixed layout
+    assert(machine_add_ram_banks(machine, 0xF0, 32) == -1);   // Past the end of the space
+    assert(machine_add_ram_banks(machine, 0x10, 4) == 0);
+    assert(machine_add_ram_banks(machine, 0x12, 1) == -1);    // Already mapped
+    printf("  Invalid ranges are rejected ✓\n");
+
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_ram_banks_survive_reset() {
+    printf("Test: Reset keeps RAM banks and clears them...\n");
+
+    machine_state_t *machine = create_machine();
+    assert(machine_add_ram_banks(machine, 0x05, 2) == 0);
+    write_byte_long(machine, (long_address_t){ .bank = 0x06, .address = 0x0100 }, 0x77);
+    write_byte_new(machine, 0x0200, 0x66);
+
+    reset_machine(machine);
+
+    assert(machine->memory_banks[0x05] != NULL);
+    assert(machine->memory_banks[0x06] != NULL);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x06, .address = 0x0100 }) == 0x00);
+    assert(read_byte_new(machine, 0x0200) == 0x00);
+    printf("  Banks remain mapped and read back as zero ✓\n");
+
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_mvn_across_banks() {
+    printf("Test: MVN between RAM banks...\n");
+
+    machine_state_t *machine = create_machine();
+    processor_state_t *state = &machine->processor;
+    assert(machine_add_ram_banks(machine, 0x01, 2) == 0);
+
+    for (int i = 0; i < 16; i++) {
+        write_byte_long(machine, (long_address_t){ .bank = 0x01, .address = 0xF000 + i }, 0xA0 + i);
+    }
+
+    state->A.full = 15;
+    state->X = 0xF000;
+    state->Y = 0x0100;
+    MVN(machine, 0x02, 0x01);
+
+    for (int i = 0; i < 16; i++) {
+        assert(read_byte_long(machine, (long_address_t){ .bank = 0x02, .address = 0x0100 + i }) == 0xA0 + i);
+    }
+    printf("  16 bytes moved from $01:F000 to $02:0100 ✓\n");
+
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_indirect_long_into_bank() {
+    printf("Test: LDA [dp] into a high bank...\n");
+
+    machine_state_t *machine = create_machine();
+    processor_state_t *state = &machine->processor;
+    assert(machine_add_ram_banks(machine, 0x20, 1) == 0);
+
+    write_byte_long(machine, (long_address_t){ .bank = 0x20, .address = 0x4567 }, 0x9C);
+
+    // Pointer at $10 in the direct page: $20:4567
+    write_byte_new(machine, 0x0010, 0x67);
+    write_byte_new(machine, 0x0011, 0x45);
+    write_byte_new(machine, 0x0012, 0x20);
+
+    state->DP = 0x0000;
+    state->P |= M_FLAG;
+    LDA_DP_IL(machine, 0x10, 0);
+    assert(state->A.low == 0x9C);
+    printf("  A = $%02X loaded through [$10] ✓\n", state->A.low);
+
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+// Write a ROM image where each byte encodes its offset
+static void write_rom_image(const char *filename, size_t size) {
+    FILE *fp = fopen(filename, "wb");
+    assert(fp != NULL);
+    for (size_t i = 0; i < size; i++) {
+        fputc((int)((i >> 8) ^ i) & 0xFF, fp);
+    }
+    fclose(fp);
+}
+
+static uint8_t rom_image_byte(size_t offset) {
+    return (uint8_t)(((offset >> 8) ^ offset) & 0xFF);
+}
+
+void test_rom_layout_multi_bank() {
+    printf("Test: ROM image mapped by layout into several banks...\n");
+
+    const char *rom_file = "test_map_rom.bin";
+    write_rom_image(rom_file, 0x20000);
+
+    machine_state_t *machine = create_machine();
+    rom_layout_t layout[] = {
+        { .file_offset = 0x00000, .bank = 0x00, .start = 0x8000, .end = 0xFFFF },
+        { .file_offset = 0x08000, .bank = 0x40, .start = 0x0000, .end = 0xFFFF },
+        { .file_offset = 0x18000, .bank = 0x41, .start = 0xC000, .end = 0xFFFF },
+    };
+    assert(machine_map_rom(machine, rom_file, layout, 3) == 0);
+
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x00, .address = 0x8000 }) == rom_image_byte(0x0000));
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x00, .address = 0xFFFC }) == rom_image_byte(0x7FFC));
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x40, .address = 0x1234 }) == rom_image_byte(0x9234));
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x41, .address = 0xC001 }) == rom_image_byte(0x18001));
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x41, .address = 0xFFFF }) == rom_image_byte(0x1BFFF));
+    printf("  Windows read back the right file offsets ✓\n");
+
+    // CPU writes are ignored
+    write_byte_long(machine, (long_address_t){ .bank = 0x40, .address = 0x1234 }, 0x00);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x40, .address = 0x1234 }) == rom_image_byte(0x9234));
+    printf("  ROM windows are read-only ✓\n");
+
+    // Pages come from the file itself rather than a copy of it
+    int fd = open(rom_file, O_WRONLY);
+    uint8_t patched = (uint8_t)~rom_image_byte(0x9000);
+    assert(fd >= 0);
+    assert(pwrite(fd, &patched, 1, 0x9000) == 1);
+    close(fd);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x40, .address = 0x1000 }) == patched);
+    printf("  Window is backed by the file's pages ✓\n");
+
+    // Reset drops the image with its regions, so mapping it again doesn't pile up
+    for (int i = 0; i < 4; i++) {
+        reset_machine(machine);
+        assert(machine->memory_map->mapping_count == 0);
+        assert(machine_map_rom(machine, rom_file, layout, 3) == 0);
+        assert(machine->memory_map->mapping_count == 1);
+    }
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x41, .address = 0xC001 }) == rom_image_byte(0x18001));
+    printf("  Reset and remap keeps one mapping ✓\n");
+
+    destroy_machine(machine);
+    unlink(rom_file);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_rom_overlay_and_padding() {
+    printf("Test: ROM overlay over RAM and short images...\n");
+
+    const char *rom_file = "test_map_rom.bin";
+    write_rom_image(rom_file, 0x1800);  // Ends mid-page
+
+    machine_state_t *machine = create_machine();
+    assert(machine_add_ram_banks(machine, 0x02, 1) == 0);
+    write_byte_long(machine, (long_address_t){ .bank = 0x02, .address = 0x0100 }, 0x42);
+
+    rom_layout_t layout[] = {
+        { .file_offset = 0x0000, .bank = 0x02, .start = 0xE000, .end = 0xFFFF },
+    };
+    assert(machine_map_rom(machine, rom_file, layout, 1) == 0);
+
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x02, .address = 0x0100 }) == 0x42);
+    write_byte_long(machine, (long_address_t){ .bank = 0x02, .address = 0x0101 }, 0x43);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x02, .address = 0x0101 }) == 0x43);
+    printf("  RAM outside the window is untouched ✓\n");
+
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x02, .address = 0xE000 }) == rom_image_byte(0x0000));
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x02, .address = 0xF7FF }) == rom_image_byte(0x17FF));
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x02, .address = 0xF800 }) == 0xFF);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x02, .address = 0xFFFF }) == 0xFF);
+    printf("  Window shadows RAM and pads past EOF with $FF ✓\n");
+
+    assert(machine_map_rom(machine, "nonexistent.bin", layout, 1) == -1);
+    printf("  Missing image is rejected ✓\n");
+
+    destroy_machine(machine);
+    unlink(rom_file);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_load_rom_larger_than_32k() {
+    printf("Test: load_rom_from_file with a 96KB image...\n");
+
+    const char *rom_file = "test_map_rom.bin";
+    write_rom_image(rom_file, 0x18000);
+
+    machine_state_t *machine = create_machine();
+    assert(load_rom_from_file(machine, rom_file) == 0);
+
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x00, .address = 0x8123 }) == rom_image_byte(0x00123));
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x01, .address = 0x8123 }) == rom_image_byte(0x08123));
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x02, .address = 0xFFFF }) == rom_image_byte(0x17FFF));
+    printf("  Image spans banks $00-$02 without truncation ✓\n");
+
+    destroy_machine(machine);
+    unlink(rom_file);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_sram_persists() {
+    printf("Test: Battery-backed SRAM file...\n");
+
+    const char *sram_file = "test_sram.bin";
+    unlink(sram_file);
+
+    machine_state_t *machine = create_machine();
+    assert(machine_map_sram(machine, sram_file, 0x00, 0x6000, 0x6FFF) == 0);
+
+    struct stat st;
+    assert(stat(sram_file, &st) == 0 && st.st_size == 0x1000);
+    assert(read_byte_new(machine, 0x6000) == 0x00);
+    printf("  Missing file created as 4KB of zeroes ✓\n");
+
+    write_byte_new(machine, 0x6000, 0x5A);
+    write_byte_new(machine, 0x6FFF, 0xA5);
+    write_byte_new(machine, 0x5FFF, 0x11);  // Bank 0 RAM below the window
+    assert(read_byte_new(machine, 0x6000) == 0x5A);
+    assert(read_byte_new(machine, 0x5FFF) == 0x11);
+
+    // No save step: the file already holds the guest's writes
+    int fd = open(sram_file, O_RDONLY);
+    uint8_t bytes[2];
+    assert(fd >= 0);
+    assert(pread(fd, &bytes[0], 1, 0x000) == 1);
+    assert(pread(fd, &bytes[1], 1, 0xFFF) == 1);
+    close(fd);
+    assert(bytes[0] == 0x5A && bytes[1] == 0xA5);
+    assert(machine_sync_sram(machine) == 0);
+    printf("  Guest writes visible in the file before shutdown ✓\n");
+
+    destroy_machine(machine);
+
+    machine = create_machine();
+    assert(machine_add_ram_banks(machine, 0x10, 1) == 0);
+    assert(machine_map_sram(machine, sram_file, 0x10, 0x2000, 0x2FFF) == 0);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x10, .address = 0x2000 }) == 0x5A);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x10, .address = 0x2FFF }) == 0xA5);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x10, .address = 0x3000 }) == 0x00);
+    printf("  Contents survive into the next machine ✓\n");
+
+    // Reset wipes RAM but not SRAM
+    write_byte_long(machine, (long_address_t){ .bank = 0x10, .address = 0x2001 }, 0x77);
+    reset_machine_fast(machine);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x10, .address = 0x2001 }) == 0x77);
+    printf("  SRAM keeps its contents across a reset ✓\n");
+
+    assert(machine_map_sram(machine, "/nonexistent/dir/sram.bin", 0x00, 0x6000, 0x6FFF) == -1);
+    printf("  Unusable path is rejected ✓\n");
+
+    destroy_machine(machine);
+    unlink(sram_file);
+    printf("  ✓ Test passed\n\n");
+}
+
+int main() {
+    printf("=== Memory Map Tests ===\n\n");
+
+    test_ram_banks_full_space();
+    test_ram_banks_are_sparse();
+    test_ram_bank_errors();
+    test_ram_banks_survive_reset();
+    test_mvn_across_banks();
+    test_indirect_long_into_bank();
+    test_rom_layout_multi_bank();
+    test_rom_overlay_and_padding();
+    test_load_rom_larger_than_32k();
+    test_sram_persists();
+
+    printf("=== All memory map tests passed! ===\n");
+    return 0;
+}
@@ -0,0 +1,264 @@
+/*
+ * Tests for multi-CPU machines
+ *
+ * - Shared windows show the same memory on every core; the rest stays private
+ * - Two cores passing values through a shared mailbox run the same every
+ *   time, at any quantum
+ * - The mailbox works with each core on its own thread
+ * - Threaded cores decode with their own register widths
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "multicore.h"
+#include "machine_setup.h"
+#include "processor_helpers.h"
+#include "test_helpers.h"
+
+// Each core runs its program with 8-bit registers, as in emulation mode
+static void load_core(machine_state_t *machine, const uint8_t *code, size_t length) {
+    load_program(machine, code, length);
+    machine->processor.P |= M_FLAG | X_FLAG;
+}
+
+// Core 0: hand 1..100 to core 1 through the mailbox at $4000 (flag) and
+// $4001 (value), then wait for the last one to be taken and stop
+static const uint8_t producer[] = {
+    0xA2, 0x01,                     // 8000: LDX #$01
+    0xAD, 0x00, 0x40,               // 8002: LDA $4000              mailbox empty?
+    0xD0, 0xFB,                     // 8005: BNE $8002
+    0x8E, 0x01, 0x40,               // 8007: STX $4001
+    0xA9, 0x01,                     // 800A: LDA #$01
+    0x8D, 0x00, 0x40,               // 800C: STA $4000              full
+    0xE8,                           // 800F: INX
+    0xE0, 0x65,                     // 8010: CPX #101
+    0xD0, 0xEE,                     // 8012: BNE $8002
+    0xAD, 0x00, 0x40,               // 8014: LDA $4000
+    0xD0, 0xFB,                     // 8017: BNE $8014
+    0xDB,                           // 8019: STP
+};
+
+// Core 1: add up what comes through the mailbox into $10-$11, count in $12
+static const uint8_t consumer[] = {
+    0xD8,                           // 8000: CLD
+    0xAD, 0x00, 0x40,               // 8001: LDA $4000              mailbox full?
+    0xF0, 0xFB,                     // 8004: BEQ $8001
+    0xAD, 0x01, 0x40,               // 8006: LDA $4001
+    0x18,                           // 8009: CLC
+    0x65, 0x10,                     // 800A: ADC $10
+    0x85, 0x10,                     // 800C: STA $10
+    0x90, 0x02,                     // 800E: BCC $8012
+    0xE6, 0x11,                     // 8010: INC $11
+    0xE6, 0x12,                     // 8012: INC $12
+    0xA9, 0x00,                     // 8014: LDA #$00
+    0x8D, 0x00, 0x40,               // 8016: STA $4000              empty
+    0x4C, 0x01, 0x80,               // 8019: JMP $8001
+};
+
+static multicore_t *mailbox_machine(uint32_t quantum, bool threaded) {
+    multicore_t *multicore = multicore_create(2);
+    assert(multicore != NULL && multicore_core_count(multicore) == 2);
+    assert(multicore_share(multicore, 0x00, 0x4000, 0x40FF) != NULL);
+    load_core(multicore_core(multicore, 0), producer, sizeof(producer));
+    load_core(multicore_core(multicore, 1), consumer, sizeof(consumer));
+    multicore_set_quantum(multicore, quantum);
+    multicore_set_threaded(multicore, threaded);
+    return multicore;
+}
+
+static void assert_mailbox_done(multicore_t *multicore) {
+    machine_state_t *consumer_core = multicore_core(multicore, 1);
+    assert(read_byte_new(consumer_core, 0x12) == 100);
+    assert((read_byte_new(consumer_core, 0x11) << 8 | read_byte_new(consumer_core, 0x10)) == 5050);
+    assert(read_byte_new(multicore_core(multicore, 0), 0x10) == 0);
+
+    multicore_stats_t stats;
+    multicore_get_stats(multicore, &stats);
+    assert(stats.halted == 0x01);
+}
+
+void test_shared_window() {
+    printf("Test: Shared and private memory...\n");
+
+    multicore_t *multicore = multicore_create(3);
+    assert(multicore != NULL);
+    assert(multicore_core(multicore, 3) == NULL);
+    uint8_t *shared = multicore_share(multicore, 0x00, 0x2000, 0x2FFF);
+    assert(shared != NULL && shared[0] == 0 && shared[0xFFF] == 0);
+    uint8_t *bank = multicore_share(multicore, 0x05, 0x0000, 0xFFFF);
+    assert(bank != NULL);
+
+    machine_state_t *a = multicore_core(multicore, 0);
+    machine_state_t *b = multicore_core(multicore, 1);
+    machine_state_t *c = multicore_core(multicore, 2);
+    write_byte_new(a, 0x2010, 0x5A);
+    write_word_new(b, 0x2FFE, 0x1234);
+    write_byte_new(b, 0x3000, 0x99);
+    assert(read_byte_new(c, 0x2010) == 0x5A && shared[0x10] == 0x5A);
+    assert(read_word_new(a, 0x2FFE) == 0x1234 && read_byte_new(c, 0x2FFF) == 0x12);
+    assert(read_byte_new(b, 0x3000) == 0x99 && read_byte_new(a, 0x3000) == 0x00);
+    printf("  Window in bank 0 shared, RAM around it private ✓\n");
+
+    long_address_t address = { .bank = 0x05, .address = 0xBEEF };
+    write_byte_long(c, address, 0x77);
+    assert(read_byte_long(a, address) == 0x77 && bank[0xBEEF] == 0x77);
+    write_byte_new(a, 0x1000, 0x11);
+    write_byte_new(b, 0x1000, 0x22);
+    assert(read_byte_new(a, 0x1000) == 0x11 && read_byte_new(b, 0x1000) == 0x22);
+    printf("  Whole shared bank; private bank 0 RAM ✓\n");
+
+    // A clone of a core keeps seeing the window, and keeps it alive
+    machine_state_t *clone = machine_clone(b);
+    assert(clone != NULL);
+    multicore_destroy(multicore);
+    assert(read_byte_new(clone, 0x2010) == 0x5A);
+    write_byte_new(clone, 0x2010, 0xA5);
+    assert(read_byte_new(clone, 0x2010) == 0xA5);
+    destroy_machine(clone);
+    printf("  Clones share the window ✓\n");
+
+    assert(multicore_create(0) == NULL);
+    assert(multicore_create(MULTICORE_MAX_CORES + 1) == NULL);
+    printf("  ✓ Test passed\n\n");
+}
+
+static void assert_same(multicore_t *x, multicore_t *y) {
+    multicore_stats_t sx, sy;
+    multicore_get_stats(x, &sx);
+    multicore_get_stats(y, &sy);
+    assert(memcmp(&sx, &sy, sizeof(sx)) == 0);
+    for (size_t i = 0; i < multicore_core_count(x); i++) {
+        machine_state_t *a = multicore_core(x, i);
+        machine_state_t *b = multicore_core(y, i);
+        assert(a->cycles == b->cycles);
+        processor_state_t *p = &a->processor, *q = &b->processor;
+        assert(p->PC == q->PC && p->A.full == q->A.full && p->X == q->X && p->Y == q->Y);
+        assert(p->SP == q->SP && p->P == q->P);
+        for (uint16_t address = 0; address < 0x200; address++) {
+            assert(read_byte_new(a, address) == read_byte_new(b, address));
+        }
+    }
+}
+
+void test_deterministic() {
+    printf("Test: Deterministic interleaving...\n");
+
+    multicore_t *first = mailbox_machine(MULTICORE_DEFAULT_QUANTUM, false);
+    multicore_t *second = mailbox_machine(MULTICORE_DEFAULT_QUANTUM, false);
+    assert(multicore_run(first, 100000) == 0);
+    for (int i = 0; i < 10; i++) {
+        assert(multicore_run(second, 10000) == 0);   // Same quanta, in pieces
+    }
+    assert_mailbox_done(first);
+    assert_same(first, second);
+
+    multicore_stats_t stats;
+    multicore_get_stats(first, &stats);
+    assert(stats.cycles == 100000 && stats.quanta == 1000);
+    machine_state_t *consumer_core = multicore_core(first, 1);
+    assert(consumer_core->cycles >= 100000 && consumer_core->cycles < 100000 + 8);
+    printf("  100 values handed over, %llu instructions; identical rerun ✓\n",
+           (unsigned long long)stats.instructions);
+
+    // Any quantum gets the same answer, in more time the longer the turns
+    uint64_t previous = 0;
+    for (uint32_t quantum = 1; quantum <= 1000; quantum *= 10) {
+        multicore_t *multicore = mailbox_machine(quantum, false);
+        assert(multicore_run(multicore, 1000000) == 0);
+        assert_mailbox_done(multicore);
+        uint64_t stopped = multicore_core(multicore, 0)->cycles;
+        assert(stopped >= previous);
+        previous = stopped;
+        printf("  Quantum %4u: producer done at cycle %llu ✓\n", quantum, (unsigned long long)stopped);
+        multicore_destroy(multicore);
+    }
+
+    multicore_destroy(first);
+    multicore_destroy(second);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_threaded() {
+    printf("Test: A host thread per core...\n");
+
+    for (int run = 0; run < 5; run++) {
+        multicore_t *multicore = mailbox_machine(50, true);
+        assert(multicore_run(multicore, 2000000) == 0);
+        assert_mailbox_done(multicore);
+
+        // Everyone met at every barrier
+        multicore_stats_t stats;
+        multicore_get_stats(multicore, &stats);
+        assert(stats.cycles == 2000000 && stats.quanta == 40000);
+        assert(multicore_core(multicore, 1)->cycles >= 2000000);
+        multicore_destroy(multicore);
+    }
+    printf("  Mailbox intact over 5 threaded runs ✓\n");
+
+    // A single core has no one to thread against
+    multicore_t *single = multicore_create(1);
+    multicore_set_threaded(single, true);
+    load_core(multicore_core(single, 0), consumer, sizeof(consumer));
+    assert(multicore_run(single, 1000) == 0);
+    assert(multicore_core(single, 0)->cycles >= 1000);
+    multicore_destroy(single);
+    printf("  One core runs inline ✓\n");
+
+    printf("  ✓ Test passed\n\n");
+}
+
+// Loops of immediate loads, sized by each core's own M flag
+static const uint8_t load_wide[] = {
+    0xA9, 0x34, 0x12,               // 8000: LDA #$1234
+    0x4C, 0x00, 0x80,               // 8003: JMP $8000
+};
+
+static const uint8_t load_narrow[] = {
+    0xA9, 0x12,                     // 8000: LDA #$12
+    0x4C, 0x00, 0x80,               // 8002: JMP $8000
+};
+
+void test_threaded_widths() {
+    printf("Test: Register widths per thread...\n");
+
+    for (int run = 0; run < 5; run++) {
+        multicore_t *multicore = multicore_create(2);
+        machine_state_t *wide = multicore_core(multicore, 0);
+        machine_state_t *narrow = multicore_core(multicore, 1);
+        load_program(wide, load_wide, sizeof(load_wide));
+        wide->processor.emulation_mode = false;
+        wide->processor.P &= ~(M_FLAG | X_FLAG);
+        load_core(narrow, load_narrow, sizeof(load_narrow));
+        multicore_set_quantum(multicore, 1000);
+        multicore_set_threaded(multicore, true);
+
+        for (int i = 0; i < 20; i++) {
+            assert(multicore_run(multicore, 10000) == 0);
+            assert(wide->processor.PC == 0x8000 || wide->processor.PC == 0x8003);
+            assert(wide->processor.A.full == 0x1234);
+            assert(narrow->processor.PC == 0x8000 || narrow->processor.PC == 0x8002);
+            assert((narrow->processor.A.full & 0xFF) == 0x12);
+        }
+        multicore_stats_t stats;
+        multicore_get_stats(multicore, &stats);
+        assert(stats.halted == 0);
+        multicore_destroy(multicore);
+    }
+    printf("  16-bit native core beside an emulation-mode core, 5 runs ✓\n");
+
+    printf("  ✓ Test passed\n\n");
+}
+
+int main() {
+    printf("=== Multicore Tests ===\n\n");
+
+    test_shared_window();
+    test_deterministic();
+    test_threaded();
+    test_threaded_widths();
+
+    printf("=== All multicore tests passed! ===\n");
+    return 0;
+}
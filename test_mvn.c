@@ -10,6 +10,7 @@
  * - Y contains destination address
  * - DBR is set to srcbank after operation
  * - After completion: A=$FFFF, X=source+count, Y=dest+count
+ * - Each byte moved takes 7 cycles, however long the block
  */
 
 #include <stdio.h>
@@ -19,6 +20,7 @@
 #include "machine_setup.h"
 #include "processor_helpers.h"
 #include "processor.h"
+#include "test_helpers.h"
 
 void test_mvn_basic() {
     printf("Test: MVN basic block move (8 bytes)...\n");
@@ -386,6 +388,39 @@ void test_mvp_wraparound() {
     printf("  ✓ Test passed\n\n");
 }
 
+// Run MVN $00,$00 from ROM for a block of `count` bytes
+// Returns: cycles machine->cycles moved by
+static uint64_t mvn_cycles(uint32_t count, uint32_t *reported) {
+    static const uint8_t program[] = { 0x54, 0x00, 0x00 };   // MVN $00,$00
+    machine_state_t *machine = create_machine();
+    load_program(machine, program, sizeof(program));
+    machine->processor.A.full = (uint16_t)(count - 1);
+    machine->processor.X = 0x1000;
+    machine->processor.Y = 0x4000;
+    uint64_t start = machine->cycles;
+    *reported = machine_execute_instruction(machine, NULL);
+    uint64_t taken = machine->cycles - start;
+    assert(machine->processor.A.full == 0xFFFF && machine->processor.Y == 0x4000 + count);
+    destroy_machine(machine);
+    return taken;
+}
+
+void test_mvn_cycles() {
+    printf("Test: MVN cycles for long blocks...\n");
+
+    uint32_t reported;
+    uint64_t single = mvn_cycles(1, &reported);
+    assert(reported == single);
+    uint64_t base = single - 7;
+    for (uint32_t count = 36; count <= 10000; count *= 4) {
+        uint64_t taken = mvn_cycles(count, &reported);
+        assert(taken == base + 7 * (uint64_t)count && reported == taken);
+        printf("  %5u bytes: %llu cycles ✓\n", count, (unsigned long long)taken);
+    }
+
+    printf("  ✓ Test passed\n\n");
+}
+
 int main() {
     printf("=== MVN Instruction Tests ===\n\n");
     
@@ -394,6 +429,7 @@ int main() {
     test_mvn_wraparound();
     test_mvn_overlapping();
     test_mvn_pattern();
+    test_mvn_cycles();
     
     printf("\n=== MVP Instruction Tests ===\n\n");
     
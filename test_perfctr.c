@@ -0,0 +1,211 @@
+/*
+ * Tests for the performance counters
+ *
+ * - Guest code latches the cycle and instruction counters and reads them a
+ *   byte at a time; values are as of the latching instruction
+ * - Marks reach the host callback with the current counts
+ * - IRQs taken, WAI cycles and DMA cycles are counted
+ * - Snapshots carry the counters
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "machine_setup.h"
+#include "processor_helpers.h"
+#include "snapshot.h"
+#include "perfctr.h"
+#include "test_helpers.h"
+
+#define PERFCTR_BASE 0x7FB0
+
+static uint64_t read_latch(machine_state_t *machine, uint16_t address) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | read_byte_new(machine, address + i);
+    }
+    return value;
+}
+
+static uint64_t latch(machine_state_t *machine, uint8_t counter) {
+    write_byte_new(machine, PERFCTR_BASE + PERFCTR_SELECT, counter);
+    return read_latch(machine, PERFCTR_BASE + PERFCTR_VALUE0);
+}
+
+void test_guest_timing() {
+    printf("Test: Guest latches its own timings...\n");
+
+    static const uint8_t program[] = {
+        0xA9, 0x00, 0x8D, 0xB0, 0x7F,   // 8000: LDA #$00 : STA $7FB0   latch cycles
+        0xA2, 0x00,                     // 8005: LDX #$00
+        0xBD, 0xB8, 0x7F,               // 8007: LDA $7FB8,X            copy to $0200
+        0x9D, 0x00, 0x02,               // 800A: STA $0200,X
+        0xE8,                           // 800D: INX
+        0xE0, 0x08,                     // 800E: CPX #$08
+        0xD0, 0xF5,                     // 8010: BNE $8007
+        0xA9, 0x00, 0x8D, 0xB0, 0x7F,   // 8012: LDA #$00 : STA $7FB0   latch cycles again
+        0xA2, 0x00,                     // 8017: LDX #$00
+        0xBD, 0xB8, 0x7F,               // 8019: LDA $7FB8,X            copy to $0208
+        0x9D, 0x08, 0x02,               // 801C: STA $0208,X
+        0xE8,                           // 801F: INX
+        0xE0, 0x08,                     // 8020: CPX #$08
+        0xD0, 0xF5,                     // 8022: BNE $8019
+        0xA9, 0x01, 0x8D, 0xB0, 0x7F,   // 8024: LDA #$01 : STA $7FB0   latch instructions
+        0xDB,                           // 8029: STP
+    };
+    machine_state_t *machine = create_machine();
+    load_program(machine, program, sizeof(program));
+
+    // Note the counters as each latching STA starts
+    uint64_t cycles_at[2] = { 0 };
+    uint64_t instructions_at = 0;
+    int latches = 0;
+    bool halted = false;
+    for (int i = 0; i < 1000 && !halted; i++) {
+        uint16_t pc = machine->processor.PC;
+        if (pc == 0x8002 || pc == 0x8014) {
+            cycles_at[latches++] = machine->cycles;
+        } else if (pc == 0x8026) {
+            instructions_at = machine->counters.instructions;
+        }
+        machine_execute_instruction(machine, &halted);
+    }
+    assert(halted && latches == 2);
+
+    uint64_t first = read_latch(machine, 0x0200);
+    uint64_t second = read_latch(machine, 0x0208);
+    assert(first == cycles_at[0] && second == cycles_at[1]);
+    printf("  Copy loop measured at %llu cycles from inside the guest ✓\n",
+           (unsigned long long)(second - first));
+
+    assert(read_byte_new(machine, PERFCTR_BASE + PERFCTR_SELECT) == PERFCTR_INSTRUCTIONS);
+    assert(read_latch(machine, PERFCTR_BASE + PERFCTR_VALUE0) == instructions_at);
+    assert(machine->counters.instructions == instructions_at + 2);
+    printf("  Instruction count latched at %llu ✓\n", (unsigned long long)instructions_at);
+
+    // The latch holds still while the counter moves on
+    uint64_t held = read_latch(machine, PERFCTR_BASE + PERFCTR_VALUE0);
+    machine_execute_instruction(machine, NULL);
+    assert(read_latch(machine, PERFCTR_BASE + PERFCTR_VALUE0) == held);
+    assert(latch(machine, 0x7F) == 0);
+    printf("  Latched values don't tear; unknown counters read 0 ✓\n");
+
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+typedef struct marks_s {
+    int count;
+    uint8_t id[4];
+    uint64_t cycles[4];
+    uint64_t instructions[4];
+} marks_t;
+
+static void record_mark(void *context, uint8_t mark, uint64_t cycles, uint64_t instructions) {
+    marks_t *marks = (marks_t *)context;
+    if (marks->count < 4) {
+        marks->id[marks->count] = mark;
+        marks->cycles[marks->count] = cycles;
+        marks->instructions[marks->count] = instructions;
+        marks->count++;
+    }
+}
+
+void test_marks() {
+    printf("Test: Marks reported to the host...\n");
+
+    static const uint8_t program[] = {
+        0xA9, 0x01, 0x8D, 0xB1, 0x7F,   // 8000: LDA #$01 : STA $7FB1   mark 1
+        0xA2, 0x00,                     // 8005: LDX #$00
+        0xE8,                           // 8007: INX
+        0xE0, 0x64,                     // 8008: CPX #100
+        0xD0, 0xFB,                     // 800A: BNE $8007
+        0xA9, 0x02, 0x8D, 0xB1, 0x7F,   // 800C: LDA #$02 : STA $7FB1   mark 2
+        0xDB,                           // 8011: STP
+    };
+    machine_state_t *machine = create_machine();
+    load_program(machine, program, sizeof(program));
+    marks_t marks = { 0 };
+    perfctr_set_mark_callback(get_perfctr_instance(machine), record_mark, &marks);
+
+    bool halted = false;
+    for (int i = 0; i < 1000 && !halted; i++) {
+        machine_execute_instruction(machine, &halted);
+    }
+    assert(halted && marks.count == 2 && marks.id[0] == 1 && marks.id[1] == 2);
+    assert(marks.instructions[1] - marks.instructions[0] == 2 + 3 * 100 + 1);
+    printf("  Marks 1 and 2: %llu cycles, %llu instructions apart ✓\n",
+           (unsigned long long)(marks.cycles[1] - marks.cycles[0]),
+           (unsigned long long)(marks.instructions[1] - marks.instructions[0]));
+    assert(read_byte_new(machine, PERFCTR_BASE + PERFCTR_MARK) == 2);
+
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_host_counters() {
+    printf("Test: IRQ, WAI and DMA counters...\n");
+
+    static const uint8_t program[] = {
+        0xA9, 0xC0, 0x8D, 0xCE, 0x7F,   // 8000: LDA #$C0 : STA $7FCE   VIA IER: T1
+        0xA9, 0xC8, 0x8D, 0xC4, 0x7F,   // 8005: LDA #200 : STA $7FC4   T1 = 200
+        0xA9, 0x00, 0x8D, 0xC5, 0x7F,   // 800A: LDA #$00 : STA $7FC5
+        0x58,                           // 800F: CLI
+        0xCB,                           // 8010: WAI
+        0xDB,                           // 8011: STP
+    };
+    static const uint8_t handler[] = {
+        0xAD, 0xC4, 0x7F,               // 8020: LDA $7FC4              clear T1
+        0x40,                           // 8023: RTI
+    };
+    machine_state_t *machine = create_machine();
+    memory_region_t *rom = load_program(machine, program, sizeof(program));
+    memcpy(rom->data + 0x20, handler, sizeof(handler));
+    rom->data[0x7FFE] = 0x20;
+    rom->data[0x7FFF] = 0x80;
+
+    bool halted = false;
+    for (int i = 0; i < 100 && !halted; i++) {
+        machine_execute_instruction(machine, &halted);
+    }
+    assert(halted);
+    assert(machine->counters.irqs_taken == 1);
+    assert(machine->counters.wai_cycles > 150 && machine->counters.wai_cycles < 250);
+    assert(latch(machine, PERFCTR_IRQS) == 1);
+    assert(latch(machine, PERFCTR_WAI_CYCLES) == machine->counters.wai_cycles);
+    printf("  1 IRQ taken after %llu cycles in WAI ✓\n", (unsigned long long)machine->counters.wai_cycles);
+
+    // Snapshots carry the counters
+    machine_snapshot_t *snapshot = machine_snapshot(machine);
+    assert(snapshot != NULL);
+    uint64_t instructions = machine->counters.instructions;
+
+    assert(latch(machine, PERFCTR_DMA_CYCLES) == 0);
+    write_byte_new(machine, 0x7FD6, 0x40);   // DMA count 64
+    write_byte_new(machine, 0x7FD9, 0x01);   // start
+    assert(latch(machine, PERFCTR_DMA_CYCLES) == 64 * DMA_CYCLES_PER_BYTE);
+    printf("  DMA cycles counted ✓\n");
+
+    machine->processor.PC = 0x8011;
+    machine_execute_instruction(machine, NULL);
+    assert(machine->counters.instructions == instructions + 1);
+    assert(machine_restore(machine, snapshot) == 0);
+    assert(machine->counters.instructions == instructions && machine->counters.irqs_taken == 1);
+    printf("  Restoring a snapshot restores the counters ✓\n");
+
+    machine_snapshot_free(snapshot);
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+int main() {
+    printf("=== Performance Counter Tests ===\n\n");
+
+    test_guest_timing();
+    test_marks();
+    test_host_counters();
+
+    printf("=== All performance counter tests passed! ===\n");
+    return 0;
+}
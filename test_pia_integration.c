@@ -85,7 +85,7 @@ void test_pia_with_callbacks(machine_state_t *machine) {
     }
     
     // Get PIA instance and set callbacks
-    pia6521_t* pia = get_pia_instance();
+    pia6521_t* pia = get_pia_instance(machine);
     pia6521_set_porta_callbacks(pia, porta_read_cb, porta_write_cb, NULL);
     
     // Configure Port A as output
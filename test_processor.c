@@ -1414,7 +1414,7 @@ TEST(LDA_ABL_long_addressing) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -1441,7 +1441,7 @@ TEST(STA_ABL_long_addressing) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -2164,7 +2164,7 @@ TEST(ADC_ABL_long_addressing) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -2223,7 +2223,7 @@ TEST(ADC_AL_IX_long_indexed) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -2301,7 +2301,7 @@ TEST(ADC_DP_IL_indirect_long) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -2336,7 +2336,7 @@ TEST(ADC_DP_IL_IY_indirect_long_indexed) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -2407,7 +2407,7 @@ TEST(SBC_ABL_long_addressing) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -2529,7 +2529,7 @@ TEST(SBC_DP_IL_indirect_long) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -2566,7 +2566,7 @@ TEST(SBC_DP_IL_IY_indirect_long_indexed) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -2635,7 +2635,7 @@ TEST(AND_ABL_long_addressing) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -2665,7 +2665,7 @@ TEST(AND_ABL_IX_long_indexed) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -2749,7 +2749,7 @@ TEST(AND_DP_IL_indirect_long) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -2783,7 +2783,7 @@ TEST(AND_DP_IL_IY_indirect_long_indexed) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -2852,7 +2852,7 @@ TEST(ORA_ABL_long_addressing) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -2882,7 +2882,7 @@ TEST(ORA_ABL_IX_long_indexed) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -2951,7 +2951,7 @@ TEST(ORA_DP_IL_indirect_long) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -2990,7 +2990,7 @@ TEST(ORA_DP_IL_IY_indirect_long_indexed) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -3059,7 +3059,7 @@ TEST(EOR_ABL_long_addressing) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -3116,7 +3116,7 @@ TEST(EOR_AL_IX_long_indexed) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -3191,7 +3191,7 @@ TEST(EOR_DP_IL_indirect_long) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -3226,7 +3226,7 @@ TEST(EOR_DP_IL_IY_indirect_long_indexed) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -3294,7 +3294,7 @@ TEST(CMP_ABL_long_addressing) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -3324,7 +3324,7 @@ TEST(CMP_ABL_IX_long_indexed) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -3410,7 +3410,7 @@ TEST(CMP_DP_IL_indirect_long) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -3444,7 +3444,7 @@ TEST(CMP_DP_IL_IY_indirect_long_indexed) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -3580,7 +3580,7 @@ TEST(LDA_DP_IL_indirect_long) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -3613,7 +3613,7 @@ TEST(LDA_DP_IL_IY_indirect_long_indexed) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -3780,7 +3780,7 @@ TEST(STA_DP_IL_indirect_long) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -3812,7 +3812,7 @@ TEST(STA_DP_IL_IY_indirect_long_indexed) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -3871,7 +3871,7 @@ TEST(STA_ABL_long_absolute) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -3900,7 +3900,7 @@ TEST(STA_ABL_IX_long_indexed) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -4849,7 +4849,7 @@ TEST(JMP_ABS_IL_absolute_indirect_long) {
 
     region0->start_offset = 0x0000;
     region0->end_offset = 0xFFFF;
-    region0->data = (uint8_t *)malloc(65536 * sizeof(uint8_t));
+    region0->data = (uint8_t *)calloc(65536, sizeof(uint8_t));
     region0->read_byte = read_byte_from_region_nodev;  // Default read/write functions can be set later
     region0->write_byte = write_byte_to_region_nodev;
     region0->read_word = read_word_from_region_nodev;
@@ -0,0 +1,266 @@
+/*
+ * Tests for the threaded runner
+ *
+ * - Paced runs track the target clock with a few long sleeps
+ * - Turbo runs as fast as the host allows
+ * - Commands run on the emulation thread; STP parks the runner until resumed
+ * - The console queues carry bytes both ways while the guest runs
+ * - A guest idling in WAI leaves the host CPU mostly idle
+ *
+ * Wall-clock and CPU-time checks are only order-of-magnitude by default, so
+ * a loaded host can't fail them; set RUNNER_STRICT_TIMING=1 for the tight
+ * bounds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include "machine_setup.h"
+#include "runner.h"
+#include "test_helpers.h"
+
+static uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static bool strict_timing(void) {
+    const char *value = getenv("RUNNER_STRICT_TIMING");
+    return value && strcmp(value, "0") != 0;
+}
+
+static void sleep_ms(unsigned ms) {
+    struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = (long)(ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+void test_pacing() {
+    printf("Test: Real-time pacing...\n");
+
+    static const uint8_t spin[] = { 0x4C, 0x00, 0x80 };  // JMP $8000
+    machine_state_t *machine = create_machine();
+    load_program(machine, spin, sizeof(spin));
+
+    runner_t *runner = runner_create(machine, 1000000);
+    assert(runner != NULL);
+    uint64_t wall = clock_ns(CLOCK_MONOTONIC);
+    assert(runner_start(runner) == 0);
+    sleep_ms(500);
+    runner_stop(runner);
+    wall = clock_ns(CLOCK_MONOTONIC) - wall;
+
+    runner_metrics_t metrics;
+    runner_get_metrics(runner, &metrics);
+    double expected = (double)wall / 1e9 * 1000000.0;
+    printf("  %llu cycles in %.0f ms at 1 MHz (%.0f expected), drift %.0f ppm\n",
+           (unsigned long long)metrics.cycles, wall / 1e6, expected, metrics.drift_ppm);
+    assert(metrics.cycles > expected / 10 && metrics.cycles < expected * 2);
+    if (strict_timing()) {
+        assert(metrics.cycles > expected * 0.9 && metrics.cycles < expected * 1.1);
+        assert(metrics.drift_ppm > -100000 && metrics.drift_ppm < 100000);
+    }
+    printf("  Emulated time follows wall time ✓\n");
+
+    printf("  %llu slices, %llu sleeps, %.0f ms asleep\n",
+           (unsigned long long)metrics.slices, (unsigned long long)metrics.sleeps,
+           metrics.sleep_ns / 1e6);
+    assert(metrics.sleeps > 0 && metrics.sleeps * 2 <= metrics.slices);
+    assert(metrics.sleep_ns > 0);
+    if (strict_timing()) {
+        assert(metrics.sleep_ns > wall / 2);
+    }
+    printf("  Sleeps are coalesced over several slices ✓\n");
+
+    runner_destroy(runner);
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_turbo() {
+    printf("Test: Turbo mode...\n");
+
+    static const uint8_t spin[] = { 0x4C, 0x00, 0x80 };  // JMP $8000
+    machine_state_t *machine = create_machine();
+    load_program(machine, spin, sizeof(spin));
+
+    // A target far above what the host can do: paced runs fall behind and
+    // resync instead of bursting
+    runner_t *runner = runner_create(machine, 1000000000);
+    assert(runner_start(runner) == 0);
+    sleep_ms(300);
+    runner_metrics_t paced;
+    runner_get_metrics(runner, &paced);
+    assert(paced.max_lag_ns > 0 && paced.sleeps == 0);
+    if (strict_timing()) {
+        assert(paced.lag_ns > 0 && paced.resyncs > 0);
+    }
+    printf("  Out-paced runner reports lag (%.1f ms max) and %llu resyncs ✓\n",
+           paced.max_lag_ns / 1e6, (unsigned long long)paced.resyncs);
+
+    runner_set_clock(runner, 1000000);
+    runner_set_turbo(runner, true);
+    sleep_ms(300);
+    runner_stop(runner);
+    runner_metrics_t metrics;
+    runner_get_metrics(runner, &metrics);
+    uint64_t turbo_cycles = metrics.cycles - paced.cycles;
+    printf("  Turbo ran %llu cycles in 300 ms (1 MHz target)\n", (unsigned long long)turbo_cycles);
+    assert(metrics.turbo);
+    assert(turbo_cycles > 0);
+    if (strict_timing()) {
+        assert(turbo_cycles > 300000 * 2);
+    }
+    assert(metrics.sleeps == 0);
+    printf("  Turbo ignores the target clock ✓\n");
+
+    runner_destroy(runner);
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+static void read_pc(machine_state_t *machine, void *context) {
+    *(uint16_t *)context = machine->processor.PC;
+}
+
+static void restart(machine_state_t *machine, void *context) {
+    machine->processor.PC = 0x8000;
+    machine->processor.X = 0;
+}
+
+void test_commands_and_halt() {
+    printf("Test: Commands and STP...\n");
+
+    static const uint8_t count_then_stop[] = {
+        0xE8,               // 8000: INX
+        0xE0, 0x10,         // 8001: CPX #$10
+        0xD0, 0xFB,         // 8003: BNE $8000
+        0xDB,               // 8005: STP
+    };
+    machine_state_t *machine = create_machine();
+    load_program(machine, count_then_stop, sizeof(count_then_stop));
+
+    // Without a thread, commands run on the caller
+    uint16_t pc = 0;
+    runner_t *runner = runner_create(machine, 8000000);
+    assert(runner_call(runner, read_pc, &pc) == 0 && pc == 0x8000);
+
+    assert(runner_start(runner) == 0);
+    runner_metrics_t metrics;
+    for (int i = 0; i < 100; i++) {
+        runner_get_metrics(runner, &metrics);
+        if (metrics.halted) {
+            break;
+        }
+        sleep_ms(5);
+    }
+    assert(metrics.halted);
+    assert(runner_call(runner, read_pc, &pc) == 0 && pc == 0x8006);
+    assert(machine->processor.X == 0x10);
+    printf("  STP parks the runner; commands still run ✓\n");
+
+    uint64_t cycles = metrics.cycles;
+    sleep_ms(20);
+    runner_get_metrics(runner, &metrics);
+    assert(metrics.cycles == cycles);
+
+    assert(runner_post(runner, restart, NULL) == 0);
+    runner_resume(runner);
+    for (int i = 0; i < 100; i++) {
+        sleep_ms(5);
+        runner_get_metrics(runner, &metrics);
+        if (metrics.halted && metrics.cycles > cycles) {
+            break;
+        }
+    }
+    assert(metrics.halted && metrics.cycles > cycles);
+    printf("  Resuming after a restart command runs it again ✓\n");
+
+    runner_destroy(runner);
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_console() {
+    printf("Test: Console queues...\n");
+
+    static const uint8_t echo[] = {
+        0xAD, 0x81, 0x7F,   // 8000: LDA $7F81
+        0x29, 0x08,         // 8003: AND #$08 (RDRF)
+        0xF0, 0xF9,         // 8005: BEQ $8000
+        0xAD, 0x80, 0x7F,   // 8007: LDA $7F80
+        0x8D, 0x80, 0x7F,   // 800A: STA $7F80
+        0x4C, 0x00, 0x80,   // 800D: JMP $8000
+    };
+    machine_state_t *machine = create_machine();
+    load_program(machine, echo, sizeof(echo));
+
+    runner_t *runner = runner_create(machine, 8000000);
+    assert(runner_attach_console(runner) == 0);
+    acia6551_set_unthrottled(get_acia_instance(machine), true);
+    assert(runner_start(runner) == 0);
+
+    const char *message = "Hello from the host thread";
+    size_t length = strlen(message);
+    assert(runner_console_write(runner, (const uint8_t *)message, length) == length);
+
+    char reply[64] = { 0 };
+    size_t got = 0;
+    for (int i = 0; i < 200 && got < length; i++) {
+        got += runner_console_read(runner, (uint8_t *)reply + got, sizeof(reply) - 1 - got);
+        sleep_ms(5);
+    }
+    assert(got == length && strcmp(reply, message) == 0);
+    printf("  Guest echoed \"%s\" ✓\n", reply);
+
+    runner_destroy(runner);
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_idle_guest() {
+    printf("Test: Idle guest...\n");
+
+    static const uint8_t idle[] = {
+        0x58,               // 8000: CLI
+        0xCB,               // 8001: WAI
+        0x4C, 0x01, 0x80,   // 8002: JMP $8001
+    };
+    machine_state_t *machine = create_machine();
+    load_program(machine, idle, sizeof(idle));
+
+    runner_t *runner = runner_create(machine, 8000000);
+    uint64_t cpu = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+    uint64_t wall = clock_ns(CLOCK_MONOTONIC);
+    assert(runner_start(runner) == 0);
+    sleep_ms(500);
+    runner_stop(runner);
+    cpu = clock_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+    wall = clock_ns(CLOCK_MONOTONIC) - wall;
+
+    printf("  %.0f ms of CPU over %.0f ms waiting in WAI at 8 MHz\n", cpu / 1e6, wall / 1e6);
+    assert(cpu < wall * 3 / 4);   // A spinning runner takes a whole core
+    if (strict_timing()) {
+        assert(cpu < wall / 2);
+    }
+    printf("  The host core is not kept busy ✓\n");
+
+    runner_destroy(runner);
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+int main() {
+    printf("=== Runner Tests ===\n\n");
+
+    test_pacing();
+    test_turbo();
+    test_commands_and_halt();
+    test_console();
+    test_idle_guest();
+
+    printf("=== All runner tests passed! ===\n");
+    return 0;
+}
@@ -0,0 +1,208 @@
+/*
+ * Tests for the machine cycle counter and device event scheduler
+ *
+ * - The heap fires events in cycle order and supports moving/cancelling them
+ * - The machine counts every clocked cycle
+ * - A lazily clocked VIA and ACIA look exactly like per-cycle reference
+ *   devices through the bus and the IRQ line
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "machine_setup.h"
+#include "processor_helpers.h"
+#include "scheduler.h"
+#include "via6522.h"
+#include "acia6551.h"
+
+#define VIA_BASE  0x7FC0
+#define ACIA_BASE 0x7F80
+
+static int fired[16];
+static int fired_count;
+
+static void record_event(machine_state_t *machine, void *context) {
+    fired[fired_count++] = (int)(intptr_t)context;
+}
+
+static void reschedule_event(machine_state_t *machine, void *context) {
+    fired[fired_count++] = (int)(intptr_t)context;
+    if (fired_count < 4) {
+        scheduler_schedule(machine->scheduler, machine->cycles + 1, reschedule_event, context);
+    }
+}
+
+void test_event_order() {
+    printf("Test: Events fire in cycle order...\n");
+
+    scheduler_t *scheduler = scheduler_create();
+    assert(scheduler != NULL);
+    assert(scheduler_next(scheduler) == UINT64_MAX);
+
+    uint64_t when[] = { 50, 10, 40, 30, 20, 60, 5, 45 };
+    for (int i = 0; i < 8; i++) {
+        assert(scheduler_schedule(scheduler, when[i], record_event, (void *)(intptr_t)when[i]) == 0);
+    }
+    assert(scheduler_next(scheduler) == 5);
+
+    fired_count = 0;
+    scheduler_run(scheduler, NULL, 30);
+    assert(fired_count == 4);
+    assert(fired[0] == 5 && fired[1] == 10 && fired[2] == 20 && fired[3] == 30);
+    assert(scheduler_next(scheduler) == 40);
+    printf("  Due events fire earliest first, later ones stay ✓\n");
+
+    // Moving and cancelling by (fn, context)
+    assert(scheduler_schedule(scheduler, 35, record_event, (void *)(intptr_t)60) == 0);
+    scheduler_cancel(scheduler, record_event, (void *)(intptr_t)45);
+    assert(scheduler->count == 3);
+    fired_count = 0;
+    scheduler_run(scheduler, NULL, 1000);
+    assert(fired_count == 3);
+    assert(fired[0] == 60 && fired[1] == 40 && fired[2] == 50);
+    printf("  Events move and cancel by callback and context ✓\n");
+
+    scheduler_destroy(scheduler);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_cycle_counter() {
+    printf("Test: Machine cycle counter...\n");
+
+    machine_state_t *machine = create_machine();
+    assert(machine->cycles == 0);
+    for (int i = 0; i < 1000; i++) {
+        machine_clock_devices(machine, 7);
+    }
+    assert(machine->cycles == 7000);
+    printf("  Counts clocked cycles ✓\n");
+
+    // Handlers may schedule again while the scheduler runs
+    fired_count = 0;
+    scheduler_schedule(machine->scheduler, 7005, reschedule_event, (void *)1);
+    machine_clock_devices(machine, 10);
+    assert(fired_count == 1);
+    for (int i = 0; i < 5; i++) {
+        machine_clock_devices(machine, 1);
+    }
+    assert(fired_count == 4);
+    printf("  Events fire once the counter passes them ✓\n");
+
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+// Deterministic pseudo-random sequence
+static uint32_t rng_state = 12345;
+static uint32_t next_random(void) {
+    rng_state = rng_state * 1103515245 + 12345;
+    return (rng_state >> 16) & 0x7FFF;
+}
+
+static void via_both(machine_state_t *machine, via6522_t *ref, uint8_t reg, uint8_t value) {
+    write_byte_new(machine, VIA_BASE + reg, value);
+    via6522_write(ref, reg, value);
+}
+
+void test_lazy_via_matches_reference() {
+    printf("Test: Lazy VIA against a per-cycle reference...\n");
+
+    machine_state_t *machine = create_machine();
+    via6522_t ref;
+    via6522_init(&ref);
+
+    via_both(machine, &ref, VIA_IER, 0x80 | VIA_INT_T1 | VIA_INT_T2);
+    via_both(machine, &ref, VIA_ACR, VIA_ACR_T1_CONTINUOUS);
+    via_both(machine, &ref, VIA_T1CL, 0x37);
+    via_both(machine, &ref, VIA_T1CH, 0x01);
+    via_both(machine, &ref, VIA_T2CL, 0x90);
+    via_both(machine, &ref, VIA_T2CH, 0x02);
+
+    int irqs = 0;
+    for (int step = 0; step < 200000; step++) {
+        uint8_t cycles = 1 + next_random() % 8;
+        machine_clock_devices(machine, cycles);
+        for (uint8_t i = 0; i < cycles; i++) {
+            via6522_clock(&ref);
+        }
+
+        // The IRQ line is checked without touching the VIA's registers
+        assert(machine_check_interrupts(machine) == via6522_get_irq(&ref));
+        if (via6522_get_irq(&ref)) {
+            irqs++;
+        }
+
+        uint32_t action = next_random() % 64;
+        if (action == 0) {
+            assert(read_byte_new(machine, VIA_BASE + VIA_T1CL) == via6522_read(&ref, VIA_T1CL));
+        } else if (action == 1) {
+            assert(read_byte_new(machine, VIA_BASE + VIA_T2CL) == via6522_read(&ref, VIA_T2CL));
+        } else if (action == 2) {
+            assert(read_byte_new(machine, VIA_BASE + VIA_IFR) == via6522_read(&ref, VIA_IFR));
+        } else if (action == 3) {
+            via_both(machine, &ref, VIA_IFR, VIA_INT_T1 | VIA_INT_T2);
+        } else if (action == 4) {
+            via_both(machine, &ref, VIA_T2CL, (uint8_t)next_random());
+            via_both(machine, &ref, VIA_T2CH, (uint8_t)(next_random() & 0x03));
+        } else if (action == 5) {
+            via_both(machine, &ref, VIA_ACR, (next_random() & 1) ? VIA_ACR_T1_CONTINUOUS : VIA_ACR_T1_TIMED_INT);
+        }
+    }
+    assert(irqs > 0);
+    printf("  Bus reads and IRQ line match over 200000 steps (%d IRQ checks asserted) ✓\n", irqs);
+
+    // Quiet the VIA for the following tests
+    via_both(machine, &ref, VIA_IER, 0x7F);
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_lazy_acia_matches_reference() {
+    printf("Test: Lazy ACIA against a per-cycle reference...\n");
+
+    machine_state_t *machine = create_machine();
+    acia6551_t ref;
+    acia6551_init(&ref);
+
+    write_byte_new(machine, ACIA_BASE + ACIA_CONTROL, ACIA_CTRL_BAUD_19200 | ACIA_CTRL_RECV_CLK);
+    acia6551_write(&ref, ACIA_CONTROL, ACIA_CTRL_BAUD_19200 | ACIA_CTRL_RECV_CLK);
+    write_byte_new(machine, ACIA_BASE + ACIA_COMMAND, ACIA_CMD_DTR_ENABLE | ACIA_CMD_IRQ_TX_ENABLE);
+    acia6551_write(&ref, ACIA_COMMAND, ACIA_CMD_DTR_ENABLE | ACIA_CMD_IRQ_TX_ENABLE);
+
+    int sent = 0;
+    for (int step = 0; step < 100000; step++) {
+        uint8_t cycles = 1 + next_random() % 8;
+        machine_clock_devices(machine, cycles);
+        acia6551_clock(&ref, cycles);
+        assert(machine_check_interrupts(machine) == acia6551_get_irq(&ref));
+
+        uint32_t action = next_random() % 256;
+        if (action < 2) {
+            uint8_t byte = (uint8_t)next_random();
+            write_byte_new(machine, ACIA_BASE + ACIA_DATA, byte);
+            acia6551_write(&ref, ACIA_DATA, byte);
+            sent++;
+        } else if (action < 8) {
+            assert(read_byte_new(machine, ACIA_BASE + ACIA_STATUS) == acia6551_read(&ref, ACIA_STATUS));
+        }
+    }
+    assert(sent > 0);
+    printf("  Status reads and IRQ line match while sending %d bytes ✓\n", sent);
+
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+int main() {
+    printf("=== Scheduler Tests ===\n\n");
+
+    test_event_order();
+    test_cycle_counter();
+    test_lazy_via_matches_reference();
+    test_lazy_acia_matches_reference();
+
+    printf("=== All scheduler tests passed! ===\n");
+    return 0;
+}
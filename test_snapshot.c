@@ -0,0 +1,335 @@
+/*
+ * Tests for machine snapshots
+ *
+ * - Snapshots capture CPU registers, devices, mapper selection and RAM
+ * - Later snapshots copy only the pages written since the previous one
+ * - Restore only rewrites pages that differ from the snapshot
+ * - Restoring many times to a post-boot state is cheap
+ * - Clones sharing snapshot pages snapshot, restore and go away on threads
+ *   of their own
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+#include "machine_setup.h"
+#include "processor_helpers.h"
+#include "processor.h"
+#include "memory_map.h"
+#include "mapper.h"
+#include "snapshot.h"
+#include "via6522.h"
+#include "acia6551.h"
+
+static size_t page_of(machine_state_t *machine, uint8_t bank, uint16_t address) {
+    return (size_t)(memory_map_bank(machine->memory_map, bank) + address - machine->memory_map->ram)
+           >> MEMORY_PAGE_SHIFT;
+}
+
+void test_snapshot_round_trip() {
+    printf("Test: Snapshot and restore CPU, devices and memory...\n");
+
+    machine_state_t *machine = create_machine();
+    processor_state_t *state = &machine->processor;
+    assert(machine_add_ram_banks(machine, 0x01, 4) == 0);
+
+    state->A.full = 0x1234;
+    state->X = 0x5678;
+    state->PC = 0x8123;
+    state->DBR = 0x02;
+    write_byte_long(machine, (long_address_t){ .bank = 0x00, .address = 0x0200 }, 0x11);
+    write_byte_long(machine, (long_address_t){ .bank = 0x03, .address = 0xBEEF }, 0x22);
+    write_byte_new(machine, 0x7FC0 + VIA_T1LL, 0x34);   // DBR is $02: goes to bank 2 RAM
+    state->DBR = 0x00;
+    write_byte_new(machine, 0x7FC0 + VIA_DDRA, 0xF0);
+    write_byte_new(machine, 0x7FC0 + VIA_T1LL, 0x34);
+
+    machine_snapshot_t *snapshot = machine_snapshot(machine);
+    assert(snapshot != NULL);
+
+    // Scramble everything
+    state->A.full = 0;
+    state->X = 0;
+    state->PC = 0;
+    write_byte_long(machine, (long_address_t){ .bank = 0x00, .address = 0x0200 }, 0x99);
+    write_byte_long(machine, (long_address_t){ .bank = 0x03, .address = 0xBEEF }, 0x99);
+    write_byte_long(machine, (long_address_t){ .bank = 0x04, .address = 0x0000 }, 0x99);
+    write_byte_new(machine, 0x7FC0 + VIA_DDRA, 0x00);
+    write_byte_new(machine, 0x7FC0 + VIA_T1LL, 0x00);
+
+    assert(machine_restore(machine, snapshot) == 0);
+
+    assert(state->A.full == 0x1234);
+    assert(state->X == 0x5678);
+    assert(state->PC == 0x8123);
+    printf("  CPU registers restored ✓\n");
+
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x00, .address = 0x0200 }) == 0x11);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x03, .address = 0xBEEF }) == 0x22);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x04, .address = 0x0000 }) == 0x00);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x02, .address = 0x7FC6 }) == 0x34);
+    printf("  RAM restored, pages written after the snapshot zeroed ✓\n");
+
+    assert(read_byte_new(machine, 0x7FC0 + VIA_DDRA) == 0xF0);
+    assert((get_via_instance(machine)->t1_latch & 0xFF) == 0x34);
+    printf("  VIA registers restored ✓\n");
+
+    machine_snapshot_free(snapshot);
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_incremental_snapshots() {
+    printf("Test: Later snapshots copy only dirty pages...\n");
+
+    machine_state_t *machine = create_machine();
+    assert(machine_add_ram_banks(machine, 0x01, 1) == 0);
+
+    write_byte_long(machine, (long_address_t){ .bank = 0x01, .address = 0x0000 }, 0x01);
+    write_byte_long(machine, (long_address_t){ .bank = 0x01, .address = 0x1000 }, 0x02);
+    write_byte_long(machine, (long_address_t){ .bank = 0x01, .address = 0x2000 }, 0x03);
+
+    machine_snapshot_t *first = machine_snapshot(machine);
+    size_t p0 = page_of(machine, 0x01, 0x0000);
+    size_t p1 = page_of(machine, 0x01, 0x1000);
+    size_t p2 = page_of(machine, 0x01, 0x2000);
+    assert(first->pages[p0] && first->pages[p1] && first->pages[p2]);
+    printf("  First snapshot captures the touched pages ✓\n");
+
+    write_byte_long(machine, (long_address_t){ .bank = 0x01, .address = 0x1001 }, 0x42);
+    machine_snapshot_t *second = machine_snapshot(machine);
+
+    assert(second->pages[p0] == first->pages[p0]);
+    assert(second->pages[p2] == first->pages[p2]);
+    assert(second->pages[p1] != first->pages[p1]);
+    assert(second->pages[p1]->data[1] == 0x42);
+    assert(first->pages[p1]->data[1] == 0x00);
+    printf("  Only the written page was copied, the rest are shared ✓\n");
+
+    // Restoring the older snapshot undoes the write without any new dirt
+    assert(machine_restore(machine, first) == 0);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x01, .address = 0x1001 }) == 0x00);
+    assert(machine_restore(machine, second) == 0);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x01, .address = 0x1001 }) == 0x42);
+    printf("  Older and newer snapshots restore in either order ✓\n");
+
+    // Freeing the first snapshot leaves shared pages alive in the second
+    machine_snapshot_free(first);
+    write_byte_long(machine, (long_address_t){ .bank = 0x01, .address = 0x0000 }, 0x77);
+    assert(machine_restore(machine, second) == 0);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x01, .address = 0x0000 }) == 0x01);
+    printf("  Shared pages outlive the snapshot that captured them ✓\n");
+
+    machine_snapshot_free(second);
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_loader_writes_are_tracked() {
+    printf("Test: Direct loader writes are tracked...\n");
+
+    machine_state_t *machine = create_machine();
+    machine_snapshot_t *snapshot = machine_snapshot(machine);
+
+    FILE *fp = fopen("test_snapshot.hex", "w");
+    assert(fp != NULL);
+    fprintf(fp, "0300:DE AD BE EF\n");
+    fclose(fp);
+    assert(load_hex_file(machine, "test_snapshot.hex") == 4);
+    remove("test_snapshot.hex");
+    assert(read_byte_new(machine, 0x0301) == 0xAD);
+
+    assert(machine_restore(machine, snapshot) == 0);
+    assert(read_byte_new(machine, 0x0301) == 0x00);
+    printf("  Bytes poked by load_hex_file are rolled back ✓\n");
+
+    machine_snapshot_free(snapshot);
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+static int g_tx_count = 0;
+static void count_tx(void *context, uint8_t byte) {
+    g_tx_count++;
+}
+
+void test_devices_keep_wiring() {
+    printf("Test: Restore keeps device callbacks and mapper state...\n");
+
+    machine_state_t *machine = create_machine();
+    mapper_config_t config = {
+        .reg_address = 0x7FD0,
+        .window_bank = 0x00,
+        .window_start = 0x4000,
+        .window_end = 0x4FFF,
+        .page_count = 4,
+        .page_flags = MEM_READWRITE,
+    };
+    mapper_t *mapper = latch_mapper_create(machine, &config);
+    assert(mapper != NULL);
+
+    write_byte_new(machine, 0x7FD0, 2);
+    write_byte_new(machine, 0x4000, 0xA2);
+    machine_snapshot_t *snapshot = machine_snapshot(machine);
+
+    write_byte_new(machine, 0x4000, 0x00);
+    write_byte_new(machine, 0x7FD0, 3);
+    write_byte_new(machine, 0x4000, 0xA3);
+
+    // Host wiring added after the snapshot survives the restore
+    acia6551_set_byte_callbacks(get_acia_instance(machine), count_tx, NULL, NULL);
+
+    assert(machine_restore(machine, snapshot) == 0);
+    assert(mapper->current == 2);
+    assert(read_byte_new(machine, 0x7FD0) == 2);
+    assert(read_byte_new(machine, 0x4000) == 0xA2);
+    assert(mapper_page_data(mapper, 3)[0] == 0x00);
+    printf("  Mapper selection and page contents restored ✓\n");
+
+    assert(get_acia_instance(machine)->tx_byte_callback == count_tx);
+    printf("  ACIA callback set after the snapshot is kept ✓\n");
+
+    machine_snapshot_free(snapshot);
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_restore_loop() {
+    printf("Test: Restoring a post-boot state many times...\n");
+
+    machine_state_t *machine = create_machine();
+    processor_state_t *state = &machine->processor;
+    assert(machine_add_ram_banks(machine, 0x01, 255) == 0);
+
+    // "Boot": fill 64KB spread over several banks
+    for (uint32_t i = 0; i < 0x10000; i++) {
+        write_byte_long(machine, (long_address_t){ .bank = (uint8_t)(1 + (i >> 12)), .address = (uint16_t)i },
+                        (uint8_t)i);
+    }
+    state->PC = 0x8000;
+    machine_snapshot_t *boot = machine_snapshot(machine);
+
+    const int iterations = 5000;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < iterations; i++) {
+        // A short "test run" dirties a few pages
+        write_byte_long(machine, (long_address_t){ .bank = 0x01, .address = 0x0000 }, 0xFF);
+        write_byte_long(machine, (long_address_t){ .bank = 0x80, .address = (uint16_t)i }, 0xFF);
+        write_byte_new(machine, 0x0100 + (i & 0xFF), 0xFF);
+        state->PC = (uint16_t)i;
+        assert(machine_restore(machine, boot) == 0);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    assert(state->PC == 0x8000);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x01, .address = 0x0000 }) == 0x00);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x01, .address = 0x0001 }) == 0x01);
+    assert(read_byte_long(machine, (long_address_t){ .bank = 0x80, .address = 0x0010 }) == 0x00);
+    assert(read_byte_new(machine, 0x0110) == 0x00);
+
+    double elapsed = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    printf("  %d restores in %.2f ms (%.1f us each) ✓\n",
+           iterations, elapsed / 1e6, elapsed / iterations / 1e3);
+
+    machine_snapshot_free(boot);
+    destroy_machine(machine);
+    printf("  ✓ Test passed\n\n");
+}
+
+#define CLONE_THREADS 8
+#define CLONE_ROUNDS  200
+
+typedef struct clone_worker_s {
+    machine_state_t *clone;
+    uint64_t serials[CLONE_ROUNDS];
+} clone_worker_t;
+
+static void *clone_worker_main(void *arg) {
+    clone_worker_t *worker = (clone_worker_t *)arg;
+    machine_state_t *clone = worker->clone;
+    long_address_t address = { .bank = 0x01, .address = 0x1000 };
+    for (int round = 0; round < CLONE_ROUNDS; round++) {
+        write_byte_long(clone, address, (uint8_t)round);
+        machine_snapshot_t *snapshot = machine_snapshot(clone);
+        assert(snapshot != NULL);
+        worker->serials[round] = snapshot->serial;
+        write_byte_long(clone, address, 0xEE);
+        assert(machine_restore(clone, snapshot) == 0);
+        assert(read_byte_long(clone, address) == (uint8_t)round);
+        assert(read_byte_long(clone, (long_address_t){ .bank = 0x01, .address = 0x0000 }) == 0x11);
+        machine_snapshot_free(snapshot);
+    }
+    destroy_machine(clone);
+    return NULL;
+}
+
+void test_clones_on_threads() {
+    printf("Test: Clones snapshot on threads of their own...\n");
+
+    machine_state_t *parent = create_machine();
+    assert(machine_add_ram_banks(parent, 0x01, 1) == 0);
+    for (uint16_t address = 0; address < 0x8000; address += 0x1000) {
+        write_byte_long(parent, (long_address_t){ .bank = 0x01, .address = address }, 0x11);
+    }
+    machine_snapshot_t *base = machine_snapshot(parent);
+    assert(base != NULL);
+
+    // Every clone starts out sharing the parent's snapshot pages
+    static clone_worker_t workers[CLONE_THREADS];
+    pthread_t threads[CLONE_THREADS];
+    for (int i = 0; i < CLONE_THREADS; i++) {
+        workers[i].clone = machine_clone(parent);
+        assert(workers[i].clone != NULL);
+    }
+    for (int i = 0; i < CLONE_THREADS; i++) {
+        assert(pthread_create(&threads[i], NULL, clone_worker_main, &workers[i]) == 0);
+    }
+    for (int i = 0; i < CLONE_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    printf("  %d clones x %d snapshot/restore rounds, then destroyed ✓\n", CLONE_THREADS, CLONE_ROUNDS);
+
+    // Serials stay unique across threads
+    for (int i = 0; i < CLONE_THREADS; i++) {
+        for (int round = 0; round < CLONE_ROUNDS; round++) {
+            uint64_t serial = workers[i].serials[round];
+            assert(serial != base->serial);
+            for (int j = i; j < CLONE_THREADS; j++) {
+                for (int other = j == i ? round + 1 : 0; other < CLONE_ROUNDS; other++) {
+                    assert(workers[j].serials[other] != serial);
+                }
+            }
+        }
+    }
+    printf("  Snapshot serials unique ✓\n");
+
+    // The parent's snapshot pages survived every clone letting go of them
+    write_byte_long(parent, (long_address_t){ .bank = 0x01, .address = 0x3000 }, 0x99);
+    assert(machine_restore(parent, base) == 0);
+    for (uint16_t address = 0; address < 0x8000; address += 0x1000) {
+        assert(read_byte_long(parent, (long_address_t){ .bank = 0x01, .address = address }) == 0x11);
+    }
+    printf("  Parent's snapshot intact ✓\n");
+
+    machine_snapshot_free(base);
+    destroy_machine(parent);
+    printf("  ✓ Test passed\n\n");
+}
+
+int main() {
+    printf("=== Snapshot Tests ===\n\n");
+
+    test_snapshot_round_trip();
+    test_incremental_snapshots();
+    test_loader_writes_are_tracked();
+    test_devices_keep_wiring();
+    test_restore_loop();
+    test_clones_on_threads();
+
+    printf("=== All snapshot tests passed! ===\n");
+    return 0;
+}
@@ -0,0 +1,298 @@
+/*
+ * Tests for the lock-free single-producer/single-consumer ring
+ *
+ * - Capacity rounds up to a power of two and positions wrap around it
+ * - Zero-copy spans hand out the contiguous parts of the ring
+ * - A producer and consumer thread move data through a small ring intact
+ * - Host threads feed the FT245 and ACIA while the CPU thread drains them
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include "spsc_ring.h"
+#include "board_fifo.h"
+#include "ft245.h"
+#include "acia6551.h"
+
+#define STREAM_BYTES (4 * 1024 * 1024)
+
+// Spinning sides give way, so the test also runs on a single CPU
+#define WAIT_FOR(condition) while (!(condition)) { sched_yield(); }
+
+// Byte n of the test stream
+static uint8_t stream_byte(size_t n) {
+    return (uint8_t)((n * 2654435761u) >> 13);
+}
+
+void test_capacity_and_wrap() {
+    printf("Test: Capacity and wrap-around...\n");
+
+    spsc_ring_t ring;
+    assert(spsc_ring_init(&ring, 100) == 0);
+    assert(spsc_ring_capacity(&ring) == 128);
+    assert(spsc_ring_empty(&ring));
+    printf("  100 bytes rounds up to 128 ✓\n");
+
+    // Walk the positions around the end of the storage at varying offsets
+    uint8_t in[96], out[50];
+    size_t next_in = 0, next_out = 0;
+    for (int round = 0; round < 200; round++) {
+        for (size_t i = 0; i < sizeof(in); i++) {
+            in[i] = stream_byte(next_in + i);
+        }
+        size_t room = spsc_ring_free_space(&ring);
+        size_t pushed = spsc_ring_push(&ring, in, sizeof(in));
+        assert(pushed == (room < sizeof(in) ? room : sizeof(in)));
+        next_in += pushed;
+
+        size_t got = spsc_ring_pop(&ring, out, sizeof(out));
+        for (size_t i = 0; i < got; i++) {
+            assert(out[i] == stream_byte(next_out + i));
+        }
+        next_out += got;
+        assert(spsc_ring_count(&ring) == next_in - next_out);
+    }
+    assert(next_out > 128 * 50);
+    printf("  Bytes come out in order across %zu wraps ✓\n", next_out / 128);
+
+    assert(spsc_ring_push(&ring, in, sizeof(in)) == spsc_ring_capacity(&ring) - (next_in - next_out));
+    assert(spsc_ring_free_space(&ring) == 0);
+    assert(!spsc_ring_push_byte(&ring, 0));
+    while (spsc_ring_pop(&ring, out, sizeof(out)) > 0) {
+    }
+    uint8_t byte;
+    assert(!spsc_ring_pop_byte(&ring, &byte));
+    assert(!spsc_ring_peek(&ring, &byte));
+    printf("  Full and empty rings refuse pushes and pops ✓\n");
+
+    spsc_ring_free(&ring);
+    printf("  ✓ Test passed\n\n");
+}
+
+void test_spans() {
+    printf("Test: Zero-copy spans...\n");
+
+    spsc_ring_t ring;
+    assert(spsc_ring_init(&ring, 16) == 0);
+
+    // Move the positions to 12 so the free space wraps
+    uint8_t scratch[16];
+    assert(spsc_ring_push(&ring, scratch, 12) == 12);
+    assert(spsc_ring_pop(&ring, scratch, 12) == 12);
+
+    uint8_t *span;
+    assert(spsc_ring_write_span(&ring, &span) == 4);
+    memcpy(span, "abcd", 4);
+    spsc_ring_commit(&ring, 4);
+    assert(spsc_ring_write_span(&ring, &span) == 12);
+    memcpy(span, "efgh", 4);
+    spsc_ring_commit(&ring, 4);
+    printf("  Free space is handed out up to the end, then from the start ✓\n");
+
+    const uint8_t *data;
+    assert(spsc_ring_read_span(&ring, &data) == 4);
+    assert(memcmp(data, "abcd", 4) == 0);
+    spsc_ring_consume(&ring, 4);
+    assert(spsc_ring_read_span(&ring, &data) == 4);
+    assert(memcmp(data, "efgh", 4) == 0);
+    spsc_ring_consume(&ring, 2);
+    uint8_t byte;
+    assert(spsc_ring_peek(&ring, &byte) && byte == 'g');
+    printf("  Queued bytes are read in place ✓\n");
+
+    // Copies are compacted and resized to the source
+    spsc_ring_t copy;
+    assert(spsc_ring_init(&copy, 4) == 0);
+    assert(spsc_ring_copy(&copy, &ring) == 0);
+    assert(spsc_ring_capacity(&copy) == 16 && spsc_ring_count(&copy) == 2);
+    assert(spsc_ring_pop(&copy, scratch, 16) == 2 && memcmp(scratch, "gh", 2) == 0);
+    assert(spsc_ring_count(&ring) == 2);
+    spsc_ring_clear(&ring);
+    assert(spsc_ring_empty(&ring));
+    printf("  Copy and clear ✓\n");
+
+    spsc_ring_free(&copy);
+    spsc_ring_free(&ring);
+    printf("  ✓ Test passed\n\n");
+}
+
+static void *ring_producer(void *arg) {
+    spsc_ring_t *ring = (spsc_ring_t *)arg;
+    size_t sent = 0;
+    while (sent < STREAM_BYTES) {
+        // Alternate between copying pushes and writing in place
+        if (sent & 1) {
+            uint8_t chunk[37];
+            size_t length = sizeof(chunk);
+            if (length > STREAM_BYTES - sent) {
+                length = STREAM_BYTES - sent;
+            }
+            for (size_t i = 0; i < length; i++) {
+                chunk[i] = stream_byte(sent + i);
+            }
+            size_t pushed = spsc_ring_push(ring, chunk, length);
+            if (pushed == 0) {
+                sched_yield();
+            }
+            sent += pushed;
+        } else {
+            uint8_t *span;
+            size_t room = spsc_ring_write_span(ring, &span);
+            if (room > STREAM_BYTES - sent) {
+                room = STREAM_BYTES - sent;
+            }
+            for (size_t i = 0; i < room; i++) {
+                span[i] = stream_byte(sent + i);
+            }
+            if (room == 0) {
+                sched_yield();
+            }
+            spsc_ring_commit(ring, room);
+            sent += room;
+        }
+    }
+    return NULL;
+}
+
+void test_threads() {
+    printf("Test: Producer and consumer threads...\n");
+
+    spsc_ring_t ring;
+    assert(spsc_ring_init(&ring, 64) == 0);
+
+    pthread_t producer;
+    assert(pthread_create(&producer, NULL, ring_producer, &ring) == 0);
+
+    size_t received = 0;
+    while (received < STREAM_BYTES) {
+        const uint8_t *data;
+        size_t available = spsc_ring_read_span(&ring, &data);
+        for (size_t i = 0; i < available; i++) {
+            assert(data[i] == stream_byte(received + i));
+        }
+        if (available == 0) {
+            sched_yield();
+        }
+        spsc_ring_consume(&ring, available);
+        received += available;
+    }
+    pthread_join(producer, NULL);
+    assert(spsc_ring_empty(&ring));
+    printf("  %d bytes through a 64-byte ring in order ✓\n", STREAM_BYTES);
+
+    spsc_ring_free(&ring);
+    printf("  ✓ Test passed\n\n");
+}
+
+#define DEVICE_BYTES (256 * 1024)
+
+typedef struct host_thread_s {
+    fifo_t *board;
+    acia6551_t *acia;
+    size_t echoed;             // Bytes the CPU sent back, all checked
+} host_thread_t;
+
+// USB host: stream data in and check the CPU's echo, both through the
+// FT245's rings only
+static void *usb_host(void *arg) {
+    host_thread_t *host = (host_thread_t *)arg;
+    ft245_t *ft245 = board_fifo_get_ft245(host->board);
+    size_t sent = 0;
+    uint8_t buffer[300];
+    while (host->echoed < DEVICE_BYTES) {
+        if (sent < DEVICE_BYTES) {
+            size_t length = sizeof(buffer);
+            if (length > DEVICE_BYTES - sent) {
+                length = DEVICE_BYTES - sent;
+            }
+            for (size_t i = 0; i < length; i++) {
+                buffer[i] = stream_byte(sent + i);
+            }
+            sent += ft245_usb_receive_buffer(ft245, buffer, (uint16_t)length);
+        }
+        uint16_t got = ft245_usb_transmit_buffer(ft245, buffer, sizeof(buffer));
+        if (got == 0) {
+            sched_yield();
+        }
+        for (uint16_t i = 0; i < got; i++) {
+            assert(buffer[i] == (uint8_t)~stream_byte(host->echoed + i));
+        }
+        host->echoed += got;
+    }
+    return NULL;
+}
+
+// Serial host: feed the ACIA without ever overrunning it
+static void *serial_host(void *arg) {
+    host_thread_t *host = (host_thread_t *)arg;
+    size_t sent = 0;
+    while (sent < DEVICE_BYTES) {
+        WAIT_FOR(spsc_ring_free_space(&host->acia->rx_ring) > 0);
+        acia6551_receive_byte(host->acia, stream_byte(sent++));
+    }
+    return NULL;
+}
+
+void test_device_threads() {
+    printf("Test: Host threads feeding the FT245 and ACIA...\n");
+
+    // FT245: the CPU echoes every byte, inverted, through the board's VIA
+    host_thread_t host = { .board = init_board_fifo() };
+    assert(host.board != NULL);
+    pthread_t usb;
+    assert(pthread_create(&usb, NULL, usb_host, &host) == 0);
+    for (size_t n = 0; n < DEVICE_BYTES; n++) {
+        uint8_t byte;
+        WAIT_FOR(board_fifo_fast_read(host.board, &byte));
+        assert(byte == stream_byte(n));
+        WAIT_FOR(board_fifo_fast_write(host.board, (uint8_t)~byte));
+    }
+    pthread_join(usb, NULL);
+    assert(host.echoed == DEVICE_BYTES);
+    printf("  %d bytes in and echoed out through the FT245 ✓\n", DEVICE_BYTES);
+    free_board_fifo(host.board);
+
+    // ACIA: the CPU polls RDRF and reads the data register
+    acia6551_t acia;
+    acia6551_init(&acia);
+    assert(acia6551_set_fifo_capacity(&acia, 16, 16) == 0);
+    assert(spsc_ring_capacity(&acia.rx_ring) == 16);
+    host.acia = &acia;
+    pthread_t serial;
+    assert(pthread_create(&serial, NULL, serial_host, &host) == 0);
+    for (size_t n = 0; n < DEVICE_BYTES; n++) {
+        WAIT_FOR(acia6551_read(&acia, ACIA_STATUS) & ACIA_STATUS_RDRF);
+        assert(acia6551_read(&acia, ACIA_DATA) == stream_byte(n));
+    }
+    pthread_join(serial, NULL);
+    assert(!(acia6551_read(&acia, ACIA_STATUS) & ACIA_STATUS_OVERRUN));
+    printf("  %d bytes received through a 16-byte ACIA FIFO, no overruns ✓\n", DEVICE_BYTES);
+
+    // A producer that doesn't check space shows up as an overrun
+    for (int i = 0; i < 20; i++) {
+        acia6551_receive_byte(&acia, (uint8_t)i);
+    }
+    assert(acia6551_read(&acia, ACIA_STATUS) & ACIA_STATUS_OVERRUN);
+    assert(acia6551_read(&acia, ACIA_DATA) == 0);
+    assert(!(acia6551_read(&acia, ACIA_STATUS) & ACIA_STATUS_OVERRUN));
+    printf("  Dropped bytes raise the overrun flag ✓\n");
+
+    acia6551_free(&acia);
+    printf("  ✓ Test passed\n\n");
+}
+
+int main() {
+    printf("=== SPSC Ring Tests ===\n\n");
+
+    test_capacity_and_wrap();
+    test_spans();
+    test_threads();
+    test_device_threads();
+
+    printf("=== All SPSC ring tests passed! ===\n");
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <assert.h>
 #include "via6522.h"
 
 // Test context for port callbacks
@@ -316,6 +317,126 @@ void test_register_access(void) {
     printf("\n✓ Register access test complete\n");
 }
 
+// The original one-cycle-at-a-time timer model, kept as the reference for
+// via6522_clock_n()
+static void reference_clock(via6522_t* via) {
+    if (via->t1_running) {
+        if (via->t1_counter == 0) {
+            via->ifr |= VIA_INT_T1;
+            uint8_t t1_mode = via->acr & 0xC0;
+            if (t1_mode == VIA_ACR_T1_CONTINUOUS || t1_mode == VIA_ACR_T1_CONTINUOUS_PB7) {
+                via->t1_counter = via->t1_latch;
+            } else {
+                via->t1_counter = 0xFFFF;
+            }
+            if (via->acr & 0x80) {
+                via->t1_pb7_state = !via->t1_pb7_state;
+            }
+        } else {
+            via->t1_counter--;
+        }
+    }
+    if (via->t2_running) {
+        if (via->t2_counter == 0) {
+            via->ifr |= VIA_INT_T2;
+            via->t2_running = false;
+            via->t2_counter = 0xFFFF;
+        } else {
+            via->t2_counter--;
+        }
+    }
+}
+
+static uint32_t rng_state = 6522;
+static uint32_t next_random(void) {
+    rng_state = rng_state * 1103515245 + 12345;
+    return (rng_state >> 16) & 0x7FFF;
+}
+
+static void write_both(via6522_t* a, via6522_t* b, uint8_t reg, uint8_t value) {
+    via6522_write(a, reg, value);
+    via6522_write(b, reg, value);
+}
+
+void test_clock_n_matches_per_cycle(void) {
+    print_test_header("Closed-Form Timers vs Per-Cycle Model");
+
+    via6522_t fast, ref;
+    via6522_init(&fast);
+    via6522_init(&ref);
+    write_both(&fast, &ref, VIA_IER, 0x80 | VIA_INT_T1 | VIA_INT_T2);
+
+    static const uint8_t t1_modes[] = {
+        VIA_ACR_T1_TIMED_INT, VIA_ACR_T1_CONTINUOUS, VIA_ACR_T1_TIMED_PB7, VIA_ACR_T1_CONTINUOUS_PB7
+    };
+    uint64_t clocked = 0;
+    int underflows = 0;
+
+    for (int step = 0; step < 20000; step++) {
+        switch (next_random() % 10) {
+            case 0:
+                write_both(&fast, &ref, VIA_T1CL, (uint8_t)next_random());
+                write_both(&fast, &ref, VIA_T1CH, (uint8_t)(next_random() % 4));
+                break;
+            case 1:
+                write_both(&fast, &ref, VIA_T1LL, (uint8_t)next_random());
+                write_both(&fast, &ref, VIA_T1LH, (uint8_t)(next_random() % 4));
+                break;
+            case 2:
+                write_both(&fast, &ref, VIA_T2CL, (uint8_t)next_random());
+                write_both(&fast, &ref, VIA_T2CH, (uint8_t)(next_random() % 4));
+                break;
+            case 3:
+                write_both(&fast, &ref, VIA_ACR, t1_modes[next_random() % 4]);
+                break;
+            case 4:
+                assert(via6522_read(&fast, VIA_T1CL) == via6522_read(&ref, VIA_T1CL));
+                assert(via6522_read(&fast, VIA_T2CL) == via6522_read(&ref, VIA_T2CL));
+                break;
+            default:
+                break;
+        }
+
+        // Mostly short steps, sometimes long runs over many reloads
+        uint64_t cycles = (next_random() % 16 == 0) ? next_random() * 8 : next_random() % 700;
+        via6522_clock_n(&fast, cycles);
+        for (uint64_t i = 0; i < cycles; i++) {
+            reference_clock(&ref);
+        }
+        clocked += cycles;
+
+        assert(via6522_read(&fast, VIA_T1CH) == via6522_read(&ref, VIA_T1CH));
+        assert(via6522_read(&fast, VIA_T2CH) == via6522_read(&ref, VIA_T2CH));
+        assert(via6522_read(&fast, VIA_IFR) == via6522_read(&ref, VIA_IFR));
+        assert(fast.t1_counter == ref.t1_counter && fast.t2_counter == ref.t2_counter);
+        assert(fast.t1_pb7_state == ref.t1_pb7_state);
+        assert(fast.t2_running == ref.t2_running);
+        assert(via6522_get_irq(&fast) == via6522_get_irq(&ref));
+        if (via6522_get_irq(&ref)) {
+            underflows++;
+        }
+
+        // Predicted IRQ cycle: quiet right up to it, raised exactly on it
+        uint64_t until = via6522_cycles_to_irq(&fast);
+        if (until > 0 && until < 2000 && !via6522_get_irq(&fast)) {
+            via6522_t probe = fast;
+            probe.irq_callback = NULL;
+            via6522_clock_n(&probe, until - 1);
+            assert(!via6522_get_irq(&probe));
+            via6522_clock_n(&probe, 1);
+            assert(via6522_get_irq(&probe));
+        }
+        if (next_random() % 4 == 0) {
+            write_both(&fast, &ref, VIA_IFR, VIA_INT_T1 | VIA_INT_T2);
+        }
+    }
+
+    printf("Clocked %llu cycles in random chunks, IRQ seen after %d steps\n",
+           (unsigned long long)clocked, underflows);
+    assert(underflows > 0);
+    printf("\n✓ Closed-form timer test complete\n");
+}
+
 int main(void) {
     printf("╔═══════════════════════════════════════════════╗\n");
     printf("║  6522 VIA (Versatile Interface Adapter)       ║\n");
@@ -329,6 +450,7 @@ int main(void) {
     test_timer2();
     test_ca1_interrupt();
     test_port_latching();
+    test_clock_n_matches_per_cycle();
     
     printf("\n");
     printf("╔═══════════════════════════════════════════════╗\n");
@@ -6,6 +6,7 @@
 #include "machine.h"
 #include "via6522.h"
 #include "acia6551.h"
+#include "processor_helpers.h"
 
 // Test WAI (Wait for Interrupt) instruction
 void test_wai_with_via_timer() {
@@ -49,7 +50,7 @@ void test_wai_with_via_timer() {
     machine->processor.emulation_mode = true; // Start in emulation, will switch to native
     
     // Get VIA instance and configure Timer 1 to generate interrupt
-    via6522_t *via = get_via_instance();
+    via6522_t *via = get_via_instance(machine);
     
     // Enable Timer 1 interrupt in VIA
     via6522_write(via, 0x0E, 0x80 | 0x40); // IER: Set bit 7 (enable), bit 6 (Timer 1)
@@ -97,6 +98,7 @@ void test_wai_with_via_timer() {
     // - Interrupt disable flag should be set
     assert(machine->processor.PC == 0x8005);
     assert(machine->processor.interrupts_disabled);
+    assert(machine->irq_taken_sources == IRQ_SOURCE_VIA);
     
     printf("  ✓ WAI correctly waited for interrupt and jumped to handler\n");
     free(result);
@@ -137,7 +139,7 @@ void test_wai_with_acia_interrupt() {
     machine->processor.emulation_mode = true;
     
     // Get ACIA instance and configure for receive interrupt
-    acia6551_t *acia = get_acia_instance();
+    acia6551_t *acia = get_acia_instance(machine);
     
     // Configure ACIA for receive interrupts
     // Command register: enable RX IRQ (bit 1)
@@ -224,12 +226,53 @@ void test_wai_with_interrupts_disabled() {
     printf("  PASS\n\n");
 }
 
+void test_irq_source_mask() {
+    printf("Test: IRQ sources are tracked as a bitmask\n");
+    
+    machine_state_t *machine = create_machine();
+    assert(machine != NULL);
+    char names[64];
+    
+    // A new machine has its own devices, whatever earlier tests left behind
+    assert(!machine_check_interrupts(machine));
+    assert(machine->irq_sources == 0);
+    
+    // VIA Timer 1 programmed over the bus, clocked lazily
+    write_byte_new(machine, 0x7FCE, 0x80 | VIA_INT_T1);
+    write_byte_new(machine, 0x7FC4, 50);
+    write_byte_new(machine, 0x7FC5, 0);
+    machine_clock_devices(machine, 50);
+    assert(machine->irq_sources == 0);
+    machine_clock_devices(machine, 1);
+    assert(machine->irq_sources == IRQ_SOURCE_VIA);
+    printf("  VIA bit set on the underflow cycle ✓\n");
+    
+    // ACIA transmit IRQ: TDRE is already set, so enabling raises the line
+    write_byte_new(machine, 0x7F82, ACIA_CMD_DTR_ENABLE | ACIA_CMD_IRQ_TX_ENABLE);
+    assert(machine->irq_sources == (IRQ_SOURCE_ACIA | IRQ_SOURCE_VIA));
+    assert(machine_check_interrupts(machine));
+    assert(strcmp(machine_irq_source_names(machine->irq_sources, names, sizeof(names)), "ACIA VIA") == 0);
+    printf("  Sources: %s ✓\n", names);
+    
+    // Acknowledging each device drops its bit
+    read_byte_new(machine, 0x7FC4);
+    assert(machine->irq_sources == IRQ_SOURCE_ACIA);
+    write_byte_new(machine, 0x7F82, ACIA_CMD_DTR_ENABLE);
+    assert(machine->irq_sources == 0);
+    assert(!machine_check_interrupts(machine));
+    printf("  Bits clear when the devices are acknowledged ✓\n");
+    
+    destroy_machine(machine);
+    printf("  PASS\n\n");
+}
+
 int main() {
     printf("=== WAI (Wait for Interrupt) Tests ===\n\n");
     
     test_wai_with_via_timer();
     test_wai_with_acia_interrupt();
     test_wai_with_interrupts_disabled();
+    test_irq_source_mask();
     
     printf("=== All WAI tests passed ===\n");
     return 0;
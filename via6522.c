@@ -1,9 +1,12 @@
 #include "via6522.h"
+#include "gpio_shm.h"
 #include <string.h>
 
 static void update_irq(via6522_t* via);
 static void update_ca2_output(via6522_t* via);
 static void update_cb2_output(via6522_t* via);
+static void gpio_take_inputs(via6522_t* via);
+static void gpio_publish(via6522_t* via);
 
 void via6522_init(via6522_t* via) {
     memset(via, 0, sizeof(via6522_t));
@@ -41,6 +44,9 @@ void via6522_reset(via6522_t* via) {
     via->ca2 = false;
     via->cb1 = false;
     via->cb2 = false;
+    
+    // Reset releases IRQ
+    update_irq(via);
 }
 
 uint8_t via6522_read(via6522_t* via, uint8_t reg) {
@@ -48,6 +54,10 @@ uint8_t via6522_read(via6522_t* via, uint8_t reg) {
     
     reg &= 0x0F;  // Only 16 registers
     
+    if (via->gpio) {
+        gpio_take_inputs(via);
+    }
+    
     switch (reg) {
         case VIA_ORB_IRB: {
             // Read input register B
@@ -160,12 +170,19 @@ uint8_t via6522_read(via6522_t* via, uint8_t reg) {
             break;
     }
     
+    if (via->gpio) {
+        gpio_publish(via);
+    }
     return value;
 }
 
 void via6522_write(via6522_t* via, uint8_t reg, uint8_t value) {
     reg &= 0x0F;
     
+    if (via->gpio) {
+        gpio_take_inputs(via);
+    }
+    
     switch (reg) {
         case VIA_ORB_IRB:
             via->orb = value;
@@ -284,51 +301,82 @@ void via6522_write(via6522_t* via, uint8_t reg, uint8_t value) {
             update_irq(via);
             break;
     }
+    
+    if (via->gpio) {
+        gpio_publish(via);
+    }
 }
 
 void via6522_clock(via6522_t* via) {
-    // Clock Timer 1
-    if (via->t1_running) {
-        if (via->t1_counter == 0) {
-            // Timer underflow
-            via->ifr |= VIA_INT_T1;
-            
+    via6522_clock_n(via, 1);
+}
+
+// Timer 1 counts c, c-1, ..., 0 and underflows on the next clock, reloading
+// with the latch (continuous) or 0xFFFF (one-shot, which keeps counting), so
+// after the first underflow it repeats with a period of reload + 1 clocks.
+// Timer 2 stops at its first underflow.  Both are solved in closed form.
+void via6522_clock_n(via6522_t* via, uint64_t cycles) {
+    bool underflow = false;
+    
+    if (via->gpio) {
+        gpio_take_inputs(via);
+    }
+
+    if (via->t1_running && cycles > 0) {
+        uint64_t counter = via->t1_counter;
+        if (cycles <= counter) {
+            via->t1_counter = (uint16_t)(counter - cycles);
+        } else {
             uint8_t t1_mode = via->acr & 0xC0;
-            if (t1_mode == VIA_ACR_T1_CONTINUOUS || t1_mode == VIA_ACR_T1_CONTINUOUS_PB7) {
-                // Reload from latch and continue
-                via->t1_counter = via->t1_latch;
-            } else {
-                // One-shot mode
-                via->t1_counter = 0xFFFF;
-            }
-            
-            // Toggle PB7 if in PB7 mode
-            if (via->acr & 0x80) {
+            uint64_t reload = (t1_mode == VIA_ACR_T1_CONTINUOUS || t1_mode == VIA_ACR_T1_CONTINUOUS_PB7)
+                              ? via->t1_latch : 0xFFFF;
+            uint64_t after = cycles - (counter + 1);
+            uint64_t underflows = 1 + after / (reload + 1);
+            via->t1_counter = (uint16_t)(reload - after % (reload + 1));
+            via->ifr |= VIA_INT_T1;
+
+            // PB7 toggles on every underflow
+            if ((via->acr & 0x80) && (underflows & 1)) {
                 via->t1_pb7_state = !via->t1_pb7_state;
             }
-            
-            update_irq(via);
-        } else {
-            via->t1_counter--;
+            underflow = true;
         }
     }
-    
-    // Clock Timer 2
-    if (via->t2_running) {
-        if (via->t2_counter == 0) {
-            // Timer underflow
+
+    if (via->t2_running && cycles > 0) {
+        if (cycles <= via->t2_counter) {
+            via->t2_counter = (uint16_t)(via->t2_counter - cycles);
+        } else {
             via->ifr |= VIA_INT_T2;
             via->t2_running = false;
             via->t2_counter = 0xFFFF;
-            update_irq(via);
-        } else {
-            via->t2_counter--;
+            underflow = true;
         }
     }
-    
+
+    if (underflow) {
+        update_irq(via);
+    }
+
     // TODO: Implement shift register clocking based on ACR settings
 }
 
+uint64_t via6522_cycles_to_irq(const via6522_t* via) {
+    uint64_t next = 0;
+    uint8_t pending = via->ier & ~via->ifr;
+
+    if (via->t1_running && (pending & VIA_INT_T1)) {
+        next = (uint64_t)via->t1_counter + 1;
+    }
+    if (via->t2_running && (pending & VIA_INT_T2)) {
+        uint64_t t2 = (uint64_t)via->t2_counter + 1;
+        if (next == 0 || t2 < next) {
+            next = t2;
+        }
+    }
+    return next;
+}
+
 void via6522_set_ca1(via6522_t* via, bool state) {
     bool old_state = via->ca1;
     via->ca1 = state;
@@ -480,6 +528,30 @@ void via6522_set_irq_callback(via6522_t* via,
     via->irq_context = context;
 }
 
+void via6522_attach_gpio(via6522_t* via, struct gpio_shm_chip_s* chip) {
+    via->gpio = chip;
+    via->gpio_seen = 1;  // Odd, so the current inputs are taken
+    if (chip) {
+        gpio_take_inputs(via);
+        gpio_publish(via);
+    }
+}
+
+// Copy register/timer state from src, keeping dst's callbacks
+void via6522_copy_state(via6522_t* dst, const via6522_t* src) {
+    via6522_t wiring = *dst;
+    *dst = *src;
+    dst->port_a_read = wiring.port_a_read;
+    dst->port_a_write = wiring.port_a_write;
+    dst->port_b_read = wiring.port_b_read;
+    dst->port_b_write = wiring.port_b_write;
+    dst->callback_context = wiring.callback_context;
+    dst->irq_callback = wiring.irq_callback;
+    dst->irq_context = wiring.irq_context;
+    dst->gpio = wiring.gpio;
+    dst->gpio_seen = wiring.gpio_seen;
+}
+
 // Internal helper functions
 
 static void update_irq(via6522_t* via) {
@@ -555,3 +627,31 @@ static void update_cb2_output(via6522_t* via) {
             break;
     }
 }
+
+// Pins and control lines from the GPIO mirror, if the harness changed them.
+// Edges on CA1/CB1 (and CA2/CB2 as inputs) act as they would from
+// via6522_set_ca1() and friends.
+static void gpio_take_inputs(via6522_t* via) {
+    gpio_shm_inputs_t inputs;
+    if (!gpio_shm_poll_inputs(via->gpio, &via->gpio_seen, &inputs)) {
+        return;
+    }
+    via->ira = inputs.port_a;
+    via->irb = inputs.port_b;
+    via6522_set_ca1(via, inputs.lines & GPIO_SHM_CA1);
+    via6522_set_ca2_input(via, inputs.lines & GPIO_SHM_CA2);
+    via6522_set_cb1(via, inputs.lines & GPIO_SHM_CB1);
+    via6522_set_cb2_input(via, inputs.lines & GPIO_SHM_CB2);
+}
+
+static void gpio_publish(via6522_t* via) {
+    gpio_shm_outputs_t outputs = {
+        .port_a = via->ora,
+        .port_b = via->orb,
+        .ddr_a = via->ddra,
+        .ddr_b = via->ddrb,
+        .lines = (via->ca1 ? GPIO_SHM_CA1 : 0) | (via->ca2 ? GPIO_SHM_CA2 : 0) |
+                 (via->cb1 ? GPIO_SHM_CB1 : 0) | (via->cb2 ? GPIO_SHM_CB2 : 0),
+    };
+    gpio_shm_publish(via->gpio, &outputs);
+}
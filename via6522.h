@@ -109,6 +109,10 @@ typedef struct via6522_s {
     // IRQ output callback
     void (*irq_callback)(void* context, bool state);
     void* irq_context;
+    
+    // Shared-memory GPIO mirror (optional, see gpio_shm.h)
+    struct gpio_shm_chip_s* gpio;
+    uint32_t gpio_seen;   // Input sequence number last taken
 } via6522_t;
 
 // Initialize a VIA chip
@@ -124,6 +128,15 @@ void via6522_write(via6522_t* via, uint8_t reg, uint8_t value);
 // Clock the VIA (call this each CPU cycle or at appropriate intervals)
 void via6522_clock(via6522_t* via);
 
+// Clock the VIA by many cycles at once; constant time, same result as
+// calling via6522_clock() `cycles` times
+void via6522_clock_n(via6522_t* via, uint64_t cycles);
+
+// Cycles until a timer underflow raises the IRQ line (an enabled T1/T2 flag
+// that is not set yet), 0 if none will.  Counters and PB7 need no clocking
+// in between; via6522_clock_n() catches them up when they are looked at.
+uint64_t via6522_cycles_to_irq(const via6522_t* via);
+
 // Control line inputs (for external hardware simulation)
 void via6522_set_ca1(via6522_t* via, bool state);
 void via6522_set_ca2_input(via6522_t* via, bool state);
@@ -148,4 +161,13 @@ void via6522_set_irq_callback(via6522_t* via,
                                void (*irq_fn)(void*, bool),
                                void* context);
 
+// Mirror the ports into a GPIO shared memory chip (NULL detaches).  The
+// mirror's pins feed IRA/IRB unless a port read callback is set, and its
+// control lines drive CA1/CA2/CB1/CB2; both are taken on register access
+// and when clocked.  Outputs are published on register access.
+void via6522_attach_gpio(via6522_t* via, struct gpio_shm_chip_s* chip);
+
+// Copy register/timer state from src, keeping dst's callbacks
+void via6522_copy_state(via6522_t* dst, const via6522_t* src);
+
 #endif // __VIA6522_H__